@@ -94,7 +94,10 @@ static struct device ide_device[NR_IDE_CTRLS] = {
 		&ata_driver_fsop,
 		NULL,
 		NULL,
-		NULL
+		NULL,
+		ata_read_segments,
+		ata_write_segments,
+		ata_max_segments
 	},
 	{
 		"ide1",
@@ -105,7 +108,10 @@ static struct device ide_device[NR_IDE_CTRLS] = {
 		&ata_driver_fsop,
 		NULL,
 		NULL,
-		NULL
+		NULL,
+		ata_read_segments,
+		ata_write_segments,
+		ata_max_segments
 	}
 };
 
@@ -233,6 +239,15 @@ static void get_device_size(struct ata_drv *drive)
 			drive->lba_factor++;
 		}
 		drive->nr_sects = drive->ident.tot_sectors | (drive->ident.tot_sectors2 << 16);
+		if(drive->ident.cmdset2 & ATA_HAS_LBA48) {
+			drive->flags |= DRIVE_HAS_LBA48;
+			/* sector numbers are limited to 32 bits (2TB) */
+			if(drive->ident.lba48_sectors[2] || drive->ident.lba48_sectors[3]) {
+				drive->nr_sects = 0xFFFFFFFF;
+			} else {
+				drive->nr_sects = drive->ident.lba48_sectors[0] | (drive->ident.lba48_sectors[1] << 16);
+			}
+		}
 	}
 
 	/* some old disk drives (ATA or ATA2) don't specify total sectors */
@@ -367,6 +382,8 @@ static void show_capabilities(struct ide *ide, struct ata_drv *drive)
 		/* default values for 'xfer' */
 		drive->xfer.read_cmd = ATA_READ_PIO;
 		drive->xfer.write_cmd = ATA_WRITE_PIO;
+		drive->xfer.read_cmd48 = ATA_READ_PIO_EXT;
+		drive->xfer.write_cmd48 = ATA_WRITE_PIO_EXT;
 	}
 
 	if(drive->flags & DRIVE_IS_CDROM) {
@@ -393,6 +410,8 @@ static void show_capabilities(struct ide *ide, struct ata_drv *drive)
 			drive->flags |= DRIVE_HAS_RW_MULTIPLE;
 			drive->xfer.read_cmd = ATA_READ_MULTIPLE_PIO;
 			drive->xfer.write_cmd = ATA_WRITE_MULTIPLE_PIO;
+			drive->xfer.read_cmd48 = ATA_READ_MULTIPLE_EXT;
+			drive->xfer.write_cmd48 = ATA_WRITE_MULTIPLE_EXT;
 			drive->multi = drive->ident.rw_multiple & 0xFF;
 			nrsectors = PAGE_SIZE / ATA_HD_SECTSIZE;
 			drive->multi = MIN(drive->multi, nrsectors);
@@ -406,6 +425,8 @@ static void show_capabilities(struct ide *ide, struct ata_drv *drive)
 				drive->flags |= DRIVE_HAS_DMA;
 				drive->xfer.read_cmd = ATA_READ_DMA;
 				drive->xfer.write_cmd = ATA_WRITE_DMA;
+				drive->xfer.read_cmd48 = ATA_READ_DMA_EXT;
+				drive->xfer.write_cmd48 = ATA_WRITE_DMA_EXT;
 				drive->xfer.bm_command = BM_COMMAND;
 				drive->xfer.bm_status = BM_STATUS;
 				drive->xfer.bm_prd_addr = BM_PRD_ADDRESS;
@@ -431,6 +452,9 @@ static void show_capabilities(struct ide *ide, struct ata_drv *drive)
 	if(drive->ident.capabilities & ATA_HAS_LBA) {
 		drive->flags |= DRIVE_REQUIRES_LBA;
 		printk(", LBA");
+		if(drive->flags & DRIVE_HAS_LBA48) {
+			printk("48");
+		}
 	}
 
 	printk("\n");
@@ -676,7 +700,22 @@ int ata_io(struct ide *ide, struct ata_drv *drive, __off_t offset, int nrsectors
 {
 	int cyl, sector, head;
 
-	if(drive->flags & DRIVE_REQUIRES_LBA) {
+	if(NEEDS_LBA48(drive, (unsigned int)offset, nrsectors)) {
+		if(!ata_select_drv(ide, drive->num, ATA_LBA_MODE, 0)) {
+			/* high order bytes go first */
+			outport_b(ide->base + ATA_FEATURES, 0);
+			outport_b(ide->base + ATA_SECCNT, (nrsectors >> 8) & 0xFF);
+			outport_b(ide->base + ATA_LOWLBA, ((unsigned int)offset >> 24) & 0xFF);
+			outport_b(ide->base + ATA_MIDLBA, 0);
+			outport_b(ide->base + ATA_HIGHLBA, 0);
+			outport_b(ide->base + ATA_FEATURES, 0);
+			outport_b(ide->base + ATA_SECCNT, nrsectors & 0xFF);
+			outport_b(ide->base + ATA_LOWLBA, offset & 0xFF);
+			outport_b(ide->base + ATA_MIDLBA, (offset >> 8) & 0xFF);
+			outport_b(ide->base + ATA_HIGHLBA, (offset >> 16) & 0xFF);
+			return 0;
+		}
+	} else if(drive->flags & DRIVE_REQUIRES_LBA) {
 		if(!ata_select_drv(ide, drive->num, ATA_LBA_MODE, offset >> 24)) {
 			outport_b(ide->base + ATA_FEATURES, 0);
 			outport_b(ide->base + ATA_SECCNT, nrsectors);
@@ -711,8 +750,9 @@ void ata_set_timeout(struct ide *ide, int timeout, int reason)
 
 void ata_end_request(struct ide *ide)
 {
-	struct blk_request *br, *brh;
+	struct blk_request *br;
 	struct xfer_data *xd;
+	int errno;
 
 	if(!ide->irq_timeout) {
 		del_callout(&ide->creq);
@@ -729,25 +769,16 @@ void ata_end_request(struct ide *ide)
 		}
 
 		xd = (struct xfer_data *)br->device->xfer_data;
-		br->errno = xd->rw_end_fn(ide, xd);
-		if(br->errno < 0 || xd->count == xd->sectors_to_io) {
-			ide->device->requests_queue = (void *)br->next;
-			br->status = BR_COMPLETED;
-			if(br->head_group) {
-				brh = br->head_group;
-				brh->left--;
-				if(!brh->left) {
-					wakeup(brh);
-				}
-			} else {
-				wakeup(br);
-			}
-			if(br->errno < 0) {
+		errno = xd->rw_end_fn(ide, xd);
+		if(errno < 0 || xd->count == xd->sectors_to_io) {
+			br->errno = errno;
+			end_blk_request(br);
+			if(errno < 0) {
 				return;
 			}
-		}
-		if(br->next) {
-			run_blk_request(br->device);
+			if(ide->device->requests_queue) {
+				run_blk_request(ide->device);
+			}
 		}
 	}
 }
@@ -932,6 +963,44 @@ int ata_write(__dev_t dev, __blk_t block, char *buffer, int blksize)
 	return drive->fsop->write_block(dev, block, buffer, blksize);
 }
 
+int ata_read_segments(__dev_t dev, __blk_t block, struct blk_segment *seg, int nr_segs)
+{
+	struct ide *ide;
+
+	if(!(ide = get_ide_controller(dev))) {
+		printk("%s(): no ide controller!\n", __FUNCTION__);
+		return -EINVAL;
+	}
+	return ata_hd_read_segments(dev, block, seg, nr_segs);
+}
+
+int ata_write_segments(__dev_t dev, __blk_t block, struct blk_segment *seg, int nr_segs)
+{
+	struct ide *ide;
+
+	if(!(ide = get_ide_controller(dev))) {
+		printk("%s(): no ide controller!\n", __FUNCTION__);
+		return -EINVAL;
+	}
+	return ata_hd_write_segments(dev, block, seg, nr_segs);
+}
+
+/* only hard disks accept merged requests */
+int ata_max_segments(__dev_t dev)
+{
+	struct ide *ide;
+	struct ata_drv *drive;
+
+	if(!(ide = get_ide_controller(dev))) {
+		return 0;
+	}
+	drive = &ide->drive[GET_DRIVE_NUM(dev)];
+	if(!(drive->flags & DRIVE_IS_DISK) || !drive->xd.seg) {
+		return 0;
+	}
+	return BLK_MAX_SEGMENTS;
+}
+
 int ata_ioctl(struct inode *i, struct fd *f, int cmd, unsigned int arg)
 {
 	struct ide *ide;
@@ -105,11 +105,51 @@ static __off_t block2sector(__blk_t block, int blksize, struct partition *part,
 	return sector;
 }
 
-static int setup_transfer(int mode, __dev_t dev, __blk_t block, char *buffer, int blksize)
+/* copies the data of the current PIO block across the segments of the transfer */
+static void pio_copy(struct ide *ide, struct ata_drv *drive, struct xfer_data *xd, int mode)
+{
+	int len, left;
+
+	left = xd->datalen;
+	while(left) {
+		len = xd->seg[xd->cur_seg].data + xd->seg[xd->cur_seg].size - xd->buffer;
+		len = MIN(len, left);
+		if(mode == BLK_READ) {
+			drive->xfer.copy_read_fn(ide->base + ATA_DATA, (void *)xd->buffer, len / drive->xfer.copy_raw_factor);
+		} else {
+			drive->xfer.copy_write_fn(ide->base + ATA_DATA, (void *)xd->buffer, len / drive->xfer.copy_raw_factor);
+		}
+		xd->buffer += len;
+		left -= len;
+		if(xd->buffer == xd->seg[xd->cur_seg].data + xd->seg[xd->cur_seg].size) {
+			if(++xd->cur_seg < xd->nr_segs) {
+				xd->buffer = xd->seg[xd->cur_seg].data;
+			}
+		}
+	}
+}
+
+/* sets the size of the next PIO block (one interrupt per block) */
+static void pio_next_block(struct ata_drv *drive, struct xfer_data *xd)
+{
+	if(drive->flags & DRIVE_HAS_RW_MULTIPLE) {
+		xd->nrsectors = MIN(xd->sectors_to_io - xd->count, drive->multi);
+	} else {
+		xd->nrsectors = 1;
+	}
+	xd->datalen = ATA_HD_SECTSIZE * xd->nrsectors;
+}
+
+/*
+ * Sets up a transfer of a list of segments that will be read from or written
+ * to consecutive sectors, starting at 'block', all using a single command.
+ */
+static int setup_transfer(int mode, __dev_t dev, __blk_t block, struct blk_segment *seg, int nr_segs)
 {
 	struct ide *ide;
 	struct ata_drv *drive;
 	struct partition *part;
+	int n;
 
 	if(!(ide = get_ide_controller(dev))) {
 		return -EINVAL;
@@ -121,31 +161,32 @@ static int setup_transfer(int mode, __dev_t dev, __blk_t block, char *buffer, in
 		drive->xd.minor &= ~(1 << IDE_SLAVE_MSF);
 	}
 
-	blksize = blksize ? blksize : BLKSIZE_1K;
-	drive->xd.sectors_to_io = MIN(blksize, PAGE_SIZE) / ATA_HD_SECTSIZE;
+	drive->xd.sectors_to_io = 0;
+	for(n = 0; n < nr_segs; n++) {
+		drive->xd.seg[n] = seg[n];
+		drive->xd.sectors_to_io += seg[n].size / ATA_HD_SECTSIZE;
+	}
+	drive->xd.nr_segs = nr_segs;
+	drive->xd.cur_seg = 0;
 
 	part = drive->part_table;
-	drive->xd.offset = block2sector(block, blksize, part, drive->xd.minor);
-
-	if(drive->flags & DRIVE_HAS_RW_MULTIPLE) {
-		drive->xd.nrsectors = MIN(drive->xd.sectors_to_io, drive->multi);
-		drive->xd.datalen = ATA_HD_SECTSIZE * drive->xd.nrsectors;
-	} else {
-		drive->xd.nrsectors = 1;
-		drive->xd.datalen = ATA_HD_SECTSIZE;
-	}
+	drive->xd.offset = block2sector(block, seg[0].size, part, drive->xd.minor);
 
 	drive->xd.dev = dev;
 	drive->xd.block = block;
-	drive->xd.buffer = buffer;
-	drive->xd.blksize = blksize;
+	drive->xd.buffer = seg[0].data;
+	drive->xd.blksize = seg[0].size;
 	drive->xd.count = 0;
+	pio_next_block(drive, &drive->xd);
 
 	if(mode == BLK_READ) {
 #ifdef CONFIG_PCI
 		drive->xd.bm_cmd = BM_COMMAND_READ;
 #endif /* CONFIG_PCI */
 		drive->xd.cmd = drive->xfer.read_cmd;
+		if(NEEDS_LBA48(drive, (unsigned int)drive->xd.offset, drive->xd.sectors_to_io)) {
+			drive->xd.cmd = drive->xfer.read_cmd48;
+		}
 		drive->xd.mode = "read";
 		drive->xd.rw_end_fn = drive->read_end_fn;
 		return drive->read_fn(ide, drive, &drive->xd);
@@ -154,6 +195,9 @@ static int setup_transfer(int mode, __dev_t dev, __blk_t block, char *buffer, in
 		drive->xd.bm_cmd = BM_COMMAND_WRITE;
 #endif /* CONFIG_PCI */
 		drive->xd.cmd = drive->xfer.write_cmd;
+		if(NEEDS_LBA48(drive, (unsigned int)drive->xd.offset, drive->xd.sectors_to_io)) {
+			drive->xd.cmd = drive->xfer.write_cmd48;
+		}
 		drive->xd.mode = "write";
 		drive->xd.rw_end_fn = drive->write_end_fn;
 		return drive->write_fn(ide, drive, &drive->xd);
@@ -164,7 +208,7 @@ static int pio_read(struct ide *ide, struct ata_drv *drive, struct xfer_data *xd
 {
 	ide->device->xfer_data = xd;
 
-	if(ata_io(ide, drive, xd->offset, xd->nrsectors)) {
+	if(ata_io(ide, drive, xd->offset, xd->sectors_to_io)) {
 		return -EIO;
 	}
 	ata_set_timeout(ide, WAIT_FOR_DISK, 0);
@@ -196,12 +240,13 @@ static int pio_read_end(struct ide *ide, struct xfer_data *xd)
 		inport_b(ide->base + ATA_STATUS);	/* clear any pending interrupt */
 		return -EIO;
 	}
-	drive->xfer.copy_read_fn(ide->base + ATA_DATA, (void *)xd->buffer, xd->datalen / drive->xfer.copy_raw_factor);
+	pio_copy(ide, drive, xd, BLK_READ);
 	xd->count += xd->nrsectors;
 	if(xd->count < xd->sectors_to_io) {
-		xd->offset += xd->nrsectors;
-		xd->buffer += (ATA_HD_SECTSIZE * xd->nrsectors);
-		return pio_read(ide, drive, xd);
+		/* the drive will interrupt again when the next block is ready */
+		pio_next_block(drive, xd);
+		ata_set_timeout(ide, WAIT_FOR_DISK, 0);
+		return 0;
 	}
 	inport_b(ide->base + ATA_STATUS);	/* clear any pending interrupt */
 	return xd->sectors_to_io * ATA_HD_SECTSIZE;
@@ -213,10 +258,10 @@ static int pio_write(struct ide *ide, struct ata_drv *drive, struct xfer_data *x
 
 	ide->device->xfer_data = xd;
 
-	if(ata_io(ide, drive, xd->offset, xd->nrsectors)) {
+	if(ata_io(ide, drive, xd->offset, xd->sectors_to_io)) {
 		return -EIO;
 	}
-	outport_b(ide->base + ATA_COMMAND, drive->xfer.write_cmd);
+	outport_b(ide->base + ATA_COMMAND, xd->cmd);
 	status = ata_wait_nobusy(ide);
 	if(status & ATA_STAT_ERR) {
 		printk("WARNING: %s(): %s: error on hard disk dev %d,%d during write.\n", __FUNCTION__, drive->dev_name, MAJOR(xd->dev), MINOR(xd->dev));
@@ -227,7 +272,7 @@ static int pio_write(struct ide *ide, struct ata_drv *drive, struct xfer_data *x
 		return -EIO;
 	}
 	ata_set_timeout(ide, WAIT_FOR_DISK, 0);
-	drive->xfer.copy_write_fn(ide->base + ATA_DATA, (void *)xd->buffer, xd->datalen / drive->xfer.copy_raw_factor);
+	pio_copy(ide, drive, xd, BLK_WRITE);
 	return 0;
 }
 
@@ -248,9 +293,19 @@ static int pio_write_end(struct ide *ide, struct xfer_data *xd)
 
 	xd->count += xd->nrsectors;
 	if(xd->count < xd->sectors_to_io) {
-		xd->offset += xd->nrsectors;
-		xd->buffer += (ATA_HD_SECTSIZE * xd->nrsectors);
-		return pio_write(ide, drive, xd);
+		/* the drive is waiting for the next block of the same command */
+		pio_next_block(drive, xd);
+		if((status = ata_wait_state(ide, ATA_STAT_DRQ))) {
+			printk("WARNING: %s(): %s: error on hard disk dev %d,%d during write.\n", __FUNCTION__, drive->dev_name, MAJOR(xd->dev), MINOR(xd->dev));
+			printk("\tstatus=0x%x ", status);
+			ata_error(ide, status);
+			printk("\tblock %d, sector %d.\n", xd->block, xd->offset + xd->count);
+			inport_b(ide->base + ATA_STATUS);	/* clear any pending interrupt */
+			return -EIO;
+		}
+		ata_set_timeout(ide, WAIT_FOR_DISK, 0);
+		pio_copy(ide, drive, xd, BLK_WRITE);
+		return 0;
 	}
 	inport_b(ide->base + ATA_STATUS);	/* clear any pending interrupt */
 	return xd->sectors_to_io * ATA_HD_SECTSIZE;
@@ -261,11 +316,14 @@ static int dma_transfer(struct ide *ide, struct ata_drv *drive, struct xfer_data
 {
 	ide->device->xfer_data = xd;
 
+	/* the whole transfer is done in a single command */
+	xd->nrsectors = xd->sectors_to_io;
+	xd->datalen = xd->sectors_to_io * ATA_HD_SECTSIZE;
 	if(ata_io(ide, drive, xd->offset, xd->nrsectors)) {
 		return -EIO;
 	}
 
-	ata_setup_dma(ide, drive, xd->buffer, xd->datalen);
+	ata_setup_dma(ide, drive, xd->seg, xd->nr_segs);
 	ata_start_dma(ide, drive, xd->bm_cmd);
 	ata_set_timeout(ide, WAIT_FOR_DISK, 0);
 	outport_b(ide->base + ATA_COMMAND, xd->cmd);
@@ -299,11 +357,6 @@ static int dma_transfer_end(struct ide *ide, struct xfer_data *xd)
 		return -EIO;
 	}
 	xd->count += xd->nrsectors;
-	if(xd->count < xd->sectors_to_io) {
-		xd->offset += xd->nrsectors;
-		xd->buffer += (ATA_HD_SECTSIZE * xd->nrsectors);
-		dma_transfer(ide, drive, xd);
-	}
 	inport_b(ide->base + ATA_STATUS);	/* clear any pending interrupt */
 	return xd->sectors_to_io * ATA_HD_SECTSIZE;
 }
@@ -322,12 +375,30 @@ int ata_hd_close(struct inode *i, struct fd *f)
 
 int ata_hd_read(__dev_t dev, __blk_t block, char *buffer, int blksize)
 {
-	return setup_transfer(BLK_READ, dev, block, buffer, blksize);
+	struct blk_segment seg;
+
+	seg.data = buffer;
+	seg.size = blksize ? blksize : BLKSIZE_1K;
+	return setup_transfer(BLK_READ, dev, block, &seg, 1);
 }
 
 int ata_hd_write(__dev_t dev, __blk_t block, char *buffer, int blksize)
 {
-	return setup_transfer(BLK_WRITE, dev, block, buffer, blksize);
+	struct blk_segment seg;
+
+	seg.data = buffer;
+	seg.size = blksize ? blksize : BLKSIZE_1K;
+	return setup_transfer(BLK_WRITE, dev, block, &seg, 1);
+}
+
+int ata_hd_read_segments(__dev_t dev, __blk_t block, struct blk_segment *seg, int nr_segs)
+{
+	return setup_transfer(BLK_READ, dev, block, seg, nr_segs);
+}
+
+int ata_hd_write_segments(__dev_t dev, __blk_t block, struct blk_segment *seg, int nr_segs)
+{
+	return setup_transfer(BLK_WRITE, dev, block, seg, nr_segs);
 }
 
 int ata_hd_ioctl(struct inode *i, struct fd *f, int cmd, unsigned int arg)
@@ -422,6 +493,10 @@ int ata_hd_init(struct ide *ide, struct ata_drv *drive)
 	drive->fsop = &ata_hd_driver_fsop;
 	part = drive->part_table;
 
+	if(!(drive->xd.seg = (struct blk_segment *)kmalloc(BLK_MAX_SEGMENTS * sizeof(struct blk_segment)))) {
+		return -ENOMEM;
+	}
+
 	if(drive->num == IDE_MASTER) {
 		rdev = MKDEV(drive->major, drive->num);
 		drive->minor_shift = IDE_MASTER_MSF;
@@ -498,6 +573,11 @@ int ata_hd_init(struct ide *ide, struct ata_drv *drive)
 #ifdef CONFIG_PCI
 	/* set DMA Capable drive bit */
 	if(drive->flags & DRIVE_HAS_DMA) {
+		if(!(drive->xfer.prd_table = (struct prd *)kmalloc(BLK_MAX_SEGMENTS * sizeof(struct prd)))) {
+			kfree((unsigned int)drive->xd.seg);
+			drive->xd.seg = NULL;
+			return -ENOMEM;
+		}
 		drive->read_fn = drive->write_fn = dma_transfer;
 		drive->read_end_fn = drive->write_end_fn = dma_transfer_end;
 		outport_b(ide->bm + drive->xfer.bm_status, BM_STATUS_DRVDMA << drive->num);
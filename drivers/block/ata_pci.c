@@ -18,14 +18,33 @@ static struct pci_supported_devices supported[] = {
 	{ 0, 0 }
 };
 
-void ata_setup_dma(struct ide *ide, struct ata_drv *drive, char *buffer, int datalen)
+/*
+ * Builds the PRD table from the list of segments. Physically contiguous
+ * segments share the same entry, as long as it doesn't cross a 64KB boundary.
+ */
+void ata_setup_dma(struct ide *ide, struct ata_drv *drive, struct blk_segment *seg, int nr_segs)
 {
-	struct prd *prd_table = &drive->xfer.prd_table;
-
-	prd_table->addr = (unsigned int)V2P(buffer);
-	prd_table->size = datalen;
-	prd_table->eot = PRDT_MARK_END;
-	outport_l(ide->bm + drive->xfer.bm_prd_addr, V2P((unsigned int)prd_table));
+	struct prd *prd;
+	unsigned int addr;
+	int n;
+
+	prd = drive->xfer.prd_table;
+	prd->addr = V2P((unsigned int)seg[0].data);
+	prd->size = seg[0].size;
+	for(n = 1; n < nr_segs; n++) {
+		addr = V2P((unsigned int)seg[n].data);
+		if(addr == prd->addr + prd->size &&
+		   ((addr + seg[n].size - 1) & ~0xFFFF) == (prd->addr & ~0xFFFF)) {
+			prd->size += seg[n].size;
+			continue;
+		}
+		prd->eot = 0;
+		prd++;
+		prd->addr = addr;
+		prd->size = seg[n].size;
+	}
+	prd->eot = PRDT_MARK_END;
+	outport_l(ide->bm + drive->xfer.bm_prd_addr, V2P((unsigned int)drive->xfer.prd_table));
 
 	/* clear Error and Interrupt bits */
 	outport_b(ide->bm + drive->xfer.bm_status, BM_STATUS_ERROR | BM_STATUS_INTR);
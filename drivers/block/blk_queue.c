@@ -5,6 +5,7 @@
  * Distributed under the terms of the Fiwix License.
  */
 
+#include <fiwix/kernel.h>
 #include <fiwix/asm.h>
 #include <fiwix/irq.h>
 #include <fiwix/blk_queue.h>
@@ -17,15 +18,89 @@
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
+#define BLK_READ_STATS	0
+#define BLK_WRITE_STATS	1
+
+struct blk_stats blk_stats_table[NR_BLK_STATS];
+
+/* accounts the time elapsed with requests in flight since the last update */
+static void update_io_ticks(struct blk_stats *bs)
+{
+	unsigned int now;
+
+	now = CURRENT_TICKS;
+	if(bs->in_flight) {
+		bs->io_ticks += now - bs->stamp;
+		bs->time_in_queue += bs->in_flight * (now - bs->stamp);
+	}
+	bs->stamp = now;
+}
+
+/*
+ * A request merged into another one is not accounted as a new I/O (it was
+ * already accounted as a merge), but its sectors are.
+ */
+static void account_blk_request(struct blk_request *br, int completed, int merged)
+{
+	struct blk_stats *bs;
+	int rw;
+
+	if(!(bs = get_blk_stats(br->dev))) {
+		return;
+	}
+	update_io_ticks(bs);
+	bs->in_flight--;
+	if(completed && br->errno >= 0) {
+		rw = br->fn == br->device->fsop->read_block ? BLK_READ_STATS : BLK_WRITE_STATS;
+		if(!merged) {
+			bs->ios[rw]++;
+			bs->ticks[rw] += CURRENT_TICKS - br->start_ticks;
+		}
+		bs->sectors[rw] += br->size >> 9;
+	}
+}
+
+struct blk_stats *find_blk_stats(__dev_t dev)
+{
+	int n;
+
+	for(n = 0; n < NR_BLK_STATS; n++) {
+		if(blk_stats_table[n].dev == dev) {
+			return &blk_stats_table[n];
+		}
+	}
+	return NULL;
+}
+
+/* returns the I/O statistics of the device, creating them if needed */
+struct blk_stats *get_blk_stats(__dev_t dev)
+{
+	struct blk_stats *bs;
+
+	if(!(bs = find_blk_stats(dev))) {
+		if((bs = find_blk_stats(0))) {
+			bs->dev = dev;
+			bs->stamp = CURRENT_TICKS;
+		}
+	}
+	return bs;
+}
+
 /* append the request into the queue */
 void add_blk_request(struct blk_request *br)
 {
 	unsigned int flags;
 	struct blk_request *h;
+	struct blk_stats *bs;
 	struct device *d;
 
 	d = br->device;
 	SAVE_FLAGS(flags); CLI();
+	br->start_ticks = CURRENT_TICKS;
+	if((bs = get_blk_stats(br->dev))) {
+		update_io_ticks(bs);
+		bs->in_flight++;
+	}
 	if((h = (struct blk_request *)d->requests_queue)) {
 		while(h->next) {
 			h = h->next;
@@ -67,11 +142,63 @@ int do_blk_request(struct device *d, void *fn, struct buffer *buf)
 	return errno;
 }
 
+/*
+ * Merges into 'br' the requests that follow it in the queue as long as they
+ * are for the next consecutive blocks of the same device and operation. The
+ * resulting list of segments is returned in 'seg' and the number of them as
+ * the return value (zero if no request could be merged).
+ */
+static int merge_blk_requests(struct device *d, struct blk_request *br, struct blk_segment *seg)
+{
+	struct blk_request *next;
+	struct blk_stats *bs;
+	int n, max, total;
+
+	if(!d->max_segments || !br->buffer) {
+		return 0;
+	}
+	max = d->max_segments(br->dev);
+	max = MIN(max, BLK_MAX_SEGMENTS);
+	if(max < 2) {
+		return 0;
+	}
+
+	seg[0].data = br->buffer->data;
+	seg[0].size = br->size;
+	total = br->size;
+	n = 1;
+	next = br->next;
+	while(next && n < max) {
+		if(next->status || next->dev != br->dev || next->fn != br->fn) {
+			break;
+		}
+		if(next->size != br->size || next->block != br->block + n) {
+			break;
+		}
+		if(!next->buffer || total + next->size > BLK_MAX_MERGE) {
+			break;
+		}
+		if((bs = get_blk_stats(next->dev))) {
+			bs->merges[next->fn == d->fsop->read_block ? BLK_READ_STATS : BLK_WRITE_STATS]++;
+		}
+		seg[n].data = next->buffer->data;
+		seg[n].size = next->size;
+		total += next->size;
+		next->status = BR_PROCESSING;
+		next = next->next;
+		n++;
+	}
+
+	br->nr_merged = n - 1;
+	return n > 1 ? n : 0;
+}
+
 void run_blk_request(struct device *d)
 {
 	unsigned int flags;
-	struct blk_request *br, *brh;
-	int errno;
+	struct blk_request *br;
+	struct blk_segment seg[BLK_MAX_SEGMENTS];
+	int errno, nr_segs;
 
 	SAVE_FLAGS(flags); CLI();
 	br = (struct blk_request *)d->requests_queue;
@@ -79,6 +206,7 @@ void run_blk_request(struct device *d)
 		if(br->status) {
 			if(br->status == BR_COMPLETED) {
 				printk("%s(): status marked as BR_COMPLETED, picking the next one ...\n", __FUNCTION__);
+				account_blk_request(br, 0, 0);
 				d->requests_queue = (void *)br->next;
 				br = br->next;
 				continue;
@@ -86,23 +214,71 @@ void run_blk_request(struct device *d)
 			return;
 		}
 		br->status = BR_PROCESSING;
-		if(!(errno = br->fn(br->dev, br->block, br->buffer->data, br->size))) {
+		if((nr_segs = merge_blk_requests(d, br, seg))) {
+			if(br->fn == d->fsop->read_block) {
+				errno = d->read_segments(br->dev, br->block, seg, nr_segs);
+			} else {
+				errno = d->write_segments(br->dev, br->block, seg, nr_segs);
+			}
+		} else {
+			errno = br->fn(br->dev, br->block, br->buffer->data, br->size);
+		}
+		if(!errno) {
 			return;
 		}
 		br->errno = errno;
-		d->requests_queue = (void *)br->next;
+		end_blk_request(br);
+		br = (struct blk_request *)d->requests_queue;
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/*
+ * Completes the request 'br' (which must be the head of the queue) along with
+ * all the requests that were merged into it, and removes them from the queue.
+ */
+void end_blk_request(struct blk_request *br)
+{
+	struct blk_request *brh, *next, *first;
+	struct device *d;
+	int n, errno;
+
+	d = br->device;
+	first = br;
+	errno = br->errno;
+	n = br->nr_merged;
+	for(;;) {
+		next = br->next;
+		if(first->nr_merged && errno >= 0) {
+			/* each request gets its own size out of the merged transfer */
+			if(errno >= br->size) {
+				errno -= br->size;
+				br->errno = br->size;
+			} else {
+				errno = 0;
+				br->errno = -EIO;
+			}
+		} else {
+			br->errno = errno;
+		}
 		br->status = BR_COMPLETED;
+		account_blk_request(br, 1, br != first);
 		if(br->head_group) {
 			brh = br->head_group;
 			brh->left--;
-			brh->errno = errno;
+			if(br->errno < 0) {
+				brh->errno = br->errno;
+			}
 			if(!brh->left) {
 				wakeup(brh);
 			}
 		} else {
 			wakeup(br);
 		}
-		br = br->next;
+		if(!n--) {
+			break;
+		}
+		br = next;
 	}
-	RESTORE_FLAGS(flags);
+	d->requests_queue = (void *)next;
 }
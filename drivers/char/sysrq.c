@@ -12,6 +12,7 @@
 #include <fiwix/string.h>
 #include <fiwix/sleep.h>
 #include <fiwix/sched.h>
+#include <fiwix/smp.h>
 #include <fiwix/mm.h>
 
 static const char *pstate[] = {
@@ -39,6 +40,7 @@ static void memory(void)
 
 static void proc_list(void)
 {
+	struct cpu_data *cpu;
 	struct proc *p;
 
 	printk("USER   PID   PPID    RSS S SLEEP_ADDR CMD\n");
@@ -58,12 +60,14 @@ static void proc_list(void)
 		p = p->next;
 	}
 
-	printk("List of PIDs in running queue: ");
-	FOR_EACH_PROCESS_RUNNING(p) {
-		printk("%d ", p->pid);
-		p = p->next_run;
+	FOR_EACH_CPU(cpu) {
+		printk("List of PIDs in running queue of CPU %d: ", cpu->id);
+		FOR_EACH_PROCESS_RUNNING(cpu, p) {
+			printk("%d ", p->pid);
+			p = p->next_run;
+		}
+		printk("\n");
 	}
-	printk("\n");
 }
 
 void sysrq(int op)
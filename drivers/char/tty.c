@@ -634,7 +634,7 @@ int tty_read(struct inode *i, struct fd *f, char *buffer, __size_t count)
 
 	/* only the foreground process group is allowed to read from the tty */
 	if(current->ctty == tty && current->pgid != tty->pgid) {
-		if(current->sigaction[SIGTTIN - 1].sa_handler == SIG_IGN || current->sigblocked & (1 << (SIGTTIN - 1)) || is_orphaned_pgrp(current->pgid)) {
+		if(current->sighand->sigaction[SIGTTIN - 1].sa_handler == SIG_IGN || current->sigblocked & (1 << (SIGTTIN - 1)) || is_orphaned_pgrp(current->pgid)) {
 			return -EIO;
 		}
 		kill_pgrp(current->pgid, SIGTTIN, KERNEL);
@@ -782,7 +782,7 @@ int tty_write(struct inode *i, struct fd *f, const char *buffer, __size_t count)
 	/* only the foreground process group is allowed to write to the tty */
 	if(current->ctty == tty && current->pgid != tty->pgid) {
 		if(tty->termios.c_lflag & TOSTOP) {
-			if(current->sigaction[SIGTTIN - 1].sa_handler != SIG_IGN && !(current->sigblocked & (1 << (SIGTTIN - 1)))) {
+			if(current->sighand->sigaction[SIGTTIN - 1].sa_handler != SIG_IGN && !(current->sigblocked & (1 << (SIGTTIN - 1)))) {
 				if(is_orphaned_pgrp(current->pgid)) {
 					return -EIO;
 				}
@@ -821,9 +821,7 @@ int tty_write(struct inode *i, struct fd *f, const char *buffer, __size_t count)
 				break;
 			}
 		}
-		if(need_resched) {
-			do_sched();
-		}
+		cond_resched();
 	}
 
 	if(n) {
@@ -0,0 +1,452 @@
+/*
+ * fiwix/drivers/net/virtio_net.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/config.h>
+#include <fiwix/errno.h>
+#include <fiwix/irq.h>
+#include <fiwix/pic.h>
+#include <fiwix/pci.h>
+#include <fiwix/mm.h>
+#include <fiwix/sleep.h>
+#include <fiwix/virtio_net.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_PCI
+#ifdef CONFIG_NET
+#ifdef CONFIG_VIRTIO_NET
+static struct pci_supported_devices supported[] = {
+	{ PCI_VENDOR_ID_QUMRANET, PCI_DEVICE_ID_VIRTIO_NET },
+	{ 0, 0 }
+};
+
+static struct virtio_net virtio_net0;
+
+static void irq_virtio_net(int, struct sigcontext *);
+static void virtio_net_poll(struct sigcontext *);
+
+static struct interrupt irq_config_virtio_net = { 0, "virtio-net", &irq_virtio_net, NULL };
+static struct bh virtio_net_bh = { 0, &virtio_net_poll, NULL };
+
+#define VRING_ALIGN(x)	(((x) + VIRTIO_PCI_VRING_ALIGN - 1) & ~(VIRTIO_PCI_VRING_ALIGN - 1))
+
+static unsigned int vring_size(int num)
+{
+	unsigned int size;
+
+	size = VRING_ALIGN(sizeof(struct vring_desc) * num + sizeof(unsigned short int) * (3 + num));
+	size += VRING_ALIGN(sizeof(unsigned short int) * 3 + sizeof(struct vring_used_elem) * num);
+	return size;
+}
+
+static int setup_queue(struct virtio_net *vn, struct virtqueue *vq, int index)
+{
+	struct page *pg;
+	unsigned int addr;
+	int num, pages;
+
+	outport_w(vn->ioaddr + VIRTIO_PCI_QUEUE_SEL, index);
+	num = inport_w(vn->ioaddr + VIRTIO_PCI_QUEUE_NUM);
+	if(!num || num > VIRTQ_MAX_SIZE || (num & (num - 1))) {
+		printk("WARNING: %s(): invalid size %d of queue %d.\n", __FUNCTION__, num, index);
+		return -EINVAL;
+	}
+
+	/* the legacy interface expects the whole ring physically contiguous */
+	pages = vring_size(num) >> PAGE_SHIFT;
+	if(!(pg = get_free_contig_pages(pages))) {
+		return -ENOMEM;
+	}
+	addr = (unsigned int)pg->data;
+	memset_b((void *)addr, 0, pages * PAGE_SIZE);
+
+	vq->index = index;
+	vq->num = num;
+	vq->desc = (struct vring_desc *)addr;
+	vq->avail = (struct vring_avail *)(addr + sizeof(struct vring_desc) * num);
+	vq->used = (struct vring_used *)(addr + VRING_ALIGN(sizeof(struct vring_desc) * num + sizeof(unsigned short int) * (3 + num)));
+	vq->last_used = vq->pending = 0;
+
+	outport_l(vn->ioaddr + VIRTIO_PCI_QUEUE_PFN, V2P(addr) >> PAGE_SHIFT);
+	return 0;
+}
+
+static void release_queue(struct virtio_net *vn, struct virtqueue *vq)
+{
+	struct page *pg;
+	int n, pages;
+
+	if(!vq->desc) {
+		return;
+	}
+	outport_w(vn->ioaddr + VIRTIO_PCI_QUEUE_SEL, vq->index);
+	outport_l(vn->ioaddr + VIRTIO_PCI_QUEUE_PFN, 0);
+	pg = &page_table[V2P((unsigned int)vq->desc) >> PAGE_SHIFT];
+	pages = vring_size(vq->num) >> PAGE_SHIFT;
+	for(n = 0; n < pages; n++) {
+		release_page(&pg[n]);
+	}
+	vq->desc = NULL;
+}
+
+/* queues the descriptor chain 'head', the device won't see it until a kick */
+static void vq_add(struct virtqueue *vq, int head)
+{
+	vq->avail->ring[(vq->avail->idx + vq->pending) & (vq->num - 1)] = head;
+	vq->pending++;
+}
+
+/* publishes all the pending buffers with a single notification */
+static void vq_kick(struct virtio_net *vn, struct virtqueue *vq)
+{
+	if(!vq->pending) {
+		return;
+	}
+	BARRIER();
+	vq->avail->idx += vq->pending;
+	vq->pending = 0;
+	MB();
+	if(!(vq->used->flags & VRING_USED_F_NO_NOTIFY)) {
+		outport_w(vn->ioaddr + VIRTIO_PCI_QUEUE_NOTIFY, vq->index);
+	}
+}
+
+static int vq_has_used(struct virtqueue *vq)
+{
+	BARRIER();
+	return vq->last_used != vq->used->idx;
+}
+
+/* links the two descriptors (header and frame) of the buffer 'n' */
+static void setup_buffer(struct virtqueue *vq, int n, char *buf, int flags)
+{
+	struct vring_desc *d;
+
+	d = &vq->desc[n * 2];
+	d->addr = V2P((unsigned int)buf);
+	d->len = sizeof(struct virtio_net_hdr);
+	d->flags = VRING_DESC_F_NEXT | flags;
+	d->next = n * 2 + 1;
+	d++;
+	d->addr = V2P((unsigned int)buf + VIRTIO_NET_HDR_SPACE);
+	d->len = VIRTIO_NET_BUF_SIZE - VIRTIO_NET_HDR_SPACE;
+	d->flags = flags;
+	d->next = 0;
+}
+
+static int alloc_buffers(char **bufs, int nr)
+{
+	unsigned int addr;
+	int n;
+
+	for(n = 0; n < nr; n += 2) {
+		if(!(addr = kmalloc(PAGE_SIZE))) {
+			return -ENOMEM;
+		}
+		bufs[n] = (char *)addr;
+		if(n + 1 < nr) {
+			bufs[n + 1] = (char *)addr + VIRTIO_NET_BUF_SIZE;
+		}
+	}
+	return 0;
+}
+
+static void free_buffers(char **bufs, int nr)
+{
+	int n;
+
+	for(n = 0; n < nr; n += 2) {
+		if(bufs[n]) {
+			kfree((unsigned int)bufs[n]);
+			bufs[n] = NULL;
+		}
+	}
+}
+
+static void update_link(struct virtio_net *vn)
+{
+	int status;
+
+	if(!(vn->features & VIRTIO_NET_F_STATUS)) {
+		vn->dev.flags |= IFF_RUNNING;
+		return;
+	}
+	status = inport_w(vn->ioaddr + VIRTIO_PCI_CONFIG + VIRTIO_NET_CFG_STATUS);
+	if(status & VIRTIO_NET_S_LINK_UP) {
+		vn->dev.flags |= IFF_RUNNING;
+	} else {
+		vn->dev.flags &= ~IFF_RUNNING;
+	}
+}
+
+/* recovers the transmit buffers already consumed by the device */
+static void reclaim_tx(struct virtio_net *vn)
+{
+	struct virtqueue *vq;
+	unsigned int id;
+
+	vq = &vn->txq;
+	while(vq_has_used(vq)) {
+		id = vq->used->ring[vq->last_used & (vq->num - 1)].id;
+		vn->tx_free[vn->tx_nr_free++] = id / 2;
+		vq->last_used++;
+	}
+}
+
+/* processes up to 'budget' received frames, returning them to the ring */
+static int rx_poll(struct virtio_net *vn, int budget)
+{
+	struct virtqueue *vq;
+	struct vring_used_elem *elem;
+	struct virtio_net_hdr *hdr;
+	unsigned int id;
+	int done, len;
+
+	vq = &vn->rxq;
+	done = 0;
+	while(done < budget && vq_has_used(vq)) {
+		elem = &vq->used->ring[vq->last_used & (vq->num - 1)];
+		id = elem->id;
+		len = elem->len - sizeof(struct virtio_net_hdr);
+		hdr = (struct virtio_net_hdr *)vn->rx_buf[id / 2];
+		if(len < ETH_HLEN || len > VIRTIO_NET_BUF_SIZE - VIRTIO_NET_HDR_SPACE) {
+			vn->dev.stats.rx_errors++;
+		} else {
+			netif_rx(&vn->dev, (char *)hdr + VIRTIO_NET_HDR_SPACE, len, hdr->flags & VIRTIO_NET_HDR_F_DATA_VALID);
+		}
+		vq_add(vq, id);
+		vq->last_used++;
+		done++;
+	}
+	vq_kick(vn, vq);
+	return done;
+}
+
+static int virtio_net_xmit(struct net_device *dev, const char *buf, int len, int csum_start, int csum_offset)
+{
+	struct virtio_net *vn;
+	struct virtio_net_hdr *hdr;
+	unsigned int flags;
+	int n;
+
+	vn = (struct virtio_net *)dev->priv;
+	if(len > VIRTIO_NET_BUF_SIZE - VIRTIO_NET_HDR_SPACE) {
+		dev->stats.tx_errors++;
+		return -EMSGSIZE;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	reclaim_tx(vn);
+	if(!vn->tx_nr_free) {
+		RESTORE_FLAGS(flags);
+		dev->stats.tx_dropped++;
+		return -ENOBUFS;
+	}
+	n = vn->tx_free[--vn->tx_nr_free];
+	hdr = (struct virtio_net_hdr *)vn->tx_buf[n];
+	memset_b(hdr, 0, sizeof(struct virtio_net_hdr));
+	if(csum_start != NETIF_NO_CSUM) {
+		hdr->flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+		hdr->csum_start = csum_start;
+		hdr->csum_offset = csum_offset;
+	}
+	memcpy_b((char *)hdr + VIRTIO_NET_HDR_SPACE, buf, len);
+	vn->txq.desc[n * 2 + 1].len = len;
+	vq_add(&vn->txq, n * 2);
+	vq_kick(vn, &vn->txq);
+	dev->stats.tx_packets++;
+	dev->stats.tx_bytes += len;
+	RESTORE_FLAGS(flags);
+	return len;
+}
+
+/*
+ * The interrupt only schedules the poll and masks further interrupts from the
+ * receive queue. They are enabled again once a poll finishes below its budget,
+ * so under heavy traffic the frames are picked up in batches from the bottom
+ * half instead of generating one interrupt each.
+ */
+static void irq_virtio_net(int num, struct sigcontext *sc)
+{
+	struct virtio_net *vn;
+	int isr;
+
+	vn = &virtio_net0;
+
+	/* reading the ISR acknowledges the interrupt */
+	if(!(isr = inport_b(vn->ioaddr + VIRTIO_PCI_ISR))) {
+		return;	/* shared interrupt */
+	}
+	if(isr & VIRTIO_PCI_ISR_CONFIG) {
+		update_link(vn);
+	}
+	if(isr & VIRTIO_PCI_ISR_QUEUE) {
+		vn->rxq.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+		virtio_net_bh.flags |= BH_ACTIVE;
+	}
+}
+
+static void virtio_net_poll(struct sigcontext *sc)
+{
+	struct virtio_net *vn;
+	unsigned int flags;
+	int done;
+
+	vn = &virtio_net0;
+
+	/* bottom halves might be nested */
+	if(lock_area(AREA_NET_POLL)) {
+		virtio_net_bh.flags |= BH_ACTIVE;
+		return;
+	}
+
+	done = rx_poll(vn, VIRTIO_NET_BUDGET);
+
+	SAVE_FLAGS(flags); CLI();
+	reclaim_tx(vn);
+	RESTORE_FLAGS(flags);
+
+	if(done < VIRTIO_NET_BUDGET) {
+		vn->rxq.avail->flags &= ~VRING_AVAIL_F_NO_INTERRUPT;
+		MB();
+
+		/* a frame might have arrived before interrupts were enabled */
+		if(!vq_has_used(&vn->rxq)) {
+			unlock_area(AREA_NET_POLL);
+			return;
+		}
+		vn->rxq.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+	}
+
+	/* there is still work, keep polling on the next run of bottom halves */
+	virtio_net_bh.flags |= BH_ACTIVE;
+	unlock_area(AREA_NET_POLL);
+}
+
+static int virtio_net_setup(struct virtio_net *vn)
+{
+	int n, errno;
+
+	if((errno = setup_queue(vn, &vn->rxq, VIRTIO_NET_RXQ))) {
+		return errno;
+	}
+	if((errno = setup_queue(vn, &vn->txq, VIRTIO_NET_TXQ))) {
+		return errno;
+	}
+
+	vn->nr_rx_bufs = MIN(VIRTIO_NET_RX_BUFS, vn->rxq.num / 2);
+	vn->nr_tx_bufs = MIN(VIRTIO_NET_TX_BUFS, vn->txq.num / 2);
+	if((errno = alloc_buffers(vn->rx_buf, vn->nr_rx_bufs))) {
+		return errno;
+	}
+	if((errno = alloc_buffers(vn->tx_buf, vn->nr_tx_bufs))) {
+		return errno;
+	}
+
+	for(n = 0; n < vn->nr_rx_bufs; n++) {
+		setup_buffer(&vn->rxq, n, vn->rx_buf[n], VRING_DESC_F_WRITE);
+		vq_add(&vn->rxq, n * 2);
+	}
+	for(n = 0; n < vn->nr_tx_bufs; n++) {
+		setup_buffer(&vn->txq, n, vn->tx_buf[n], 0);
+		vn->tx_free[n] = n;
+	}
+	vn->tx_nr_free = vn->nr_tx_bufs;
+
+	/* transmitted buffers are reclaimed lazily, no interrupts needed */
+	vn->txq.avail->flags |= VRING_AVAIL_F_NO_INTERRUPT;
+	return 0;
+}
+
+static void virtio_net_release(struct virtio_net *vn)
+{
+	outport_b(vn->ioaddr + VIRTIO_PCI_STATUS, VIRTIO_STATUS_FAILED);
+	free_buffers(vn->rx_buf, vn->nr_rx_bufs);
+	free_buffers(vn->tx_buf, vn->nr_tx_bufs);
+	release_queue(vn, &vn->rxq);
+	release_queue(vn, &vn->txq);
+}
+
+void virtio_net_init(void)
+{
+	struct pci_device *pci_dev;
+	struct virtio_net *vn;
+	unsigned short int cmd;
+	unsigned int features;
+	int n;
+
+	if(!(pci_dev = pci_get_device(supported[0].vendor_id, supported[0].device_id))) {
+		return;
+	}
+	if(pci_dev->flags[0] & PCI_F_ADDR_SPACE_MEM) {
+		printk("WARNING: %s(): MMIO is not supported.\n", __FUNCTION__);
+		return;
+	}
+
+	vn = &virtio_net0;
+	memset_b(vn, 0, sizeof(struct virtio_net));
+	vn->pci_dev = pci_dev;
+	vn->ioaddr = pci_dev->bar[0];
+	vn->irq = pci_dev->irq;
+
+	/* enable I/O space and bus master */
+	cmd = (pci_dev->command | PCI_COMMAND_IO | PCI_COMMAND_MASTER);
+	pci_write_short(pci_dev, PCI_COMMAND, cmd);
+
+	outport_b(vn->ioaddr + VIRTIO_PCI_STATUS, 0);	/* reset */
+	outport_b(vn->ioaddr + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE);
+	outport_b(vn->ioaddr + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER);
+
+	/* checksum offload is used in both directions if the host offers it */
+	features = inport_l(vn->ioaddr + VIRTIO_PCI_HOST_FEATURES);
+	vn->features = features & (VIRTIO_NET_F_CSUM | VIRTIO_NET_F_GUEST_CSUM | VIRTIO_NET_F_MAC | VIRTIO_NET_F_STATUS);
+	outport_l(vn->ioaddr + VIRTIO_PCI_GUEST_FEATURES, vn->features);
+
+	if(virtio_net_setup(vn)) {
+		printk("WARNING: %s(): unable to initialize the device.\n", __FUNCTION__);
+		virtio_net_release(vn);
+		return;
+	}
+
+	strcpy(vn->dev.name, "eth0");
+	vn->dev.flags = IFF_UP;
+	vn->dev.mtu = ETH_DATA_LEN;
+	vn->dev.xmit = virtio_net_xmit;
+	vn->dev.priv = vn;
+	if(vn->features & VIRTIO_NET_F_CSUM) {
+		vn->dev.features |= NETIF_F_HW_CSUM;
+	}
+	if(vn->features & VIRTIO_NET_F_GUEST_CSUM) {
+		vn->dev.features |= NETIF_F_RXCSUM;
+	}
+	if(vn->features & VIRTIO_NET_F_MAC) {
+		for(n = 0; n < NETDEV_ADDR_LEN; n++) {
+			vn->dev.addr[n] = inport_b(vn->ioaddr + VIRTIO_PCI_CONFIG + VIRTIO_NET_CFG_MAC + n);
+		}
+	} else {
+		/* locally administered address (QEMU's prefix) */
+		vn->dev.addr[0] = 0x52;
+		vn->dev.addr[1] = 0x54;
+		vn->dev.addr[5] = 0x01;
+	}
+	update_link(vn);
+
+	add_bh(&virtio_net_bh);
+	if(!register_irq(vn->irq, &irq_config_virtio_net)) {
+		enable_irq(vn->irq);
+	}
+	outport_b(vn->ioaddr + VIRTIO_PCI_STATUS, VIRTIO_STATUS_ACKNOWLEDGE | VIRTIO_STATUS_DRIVER | VIRTIO_STATUS_DRIVER_OK);
+	vq_kick(vn, &vn->rxq);
+	register_netdevice(&vn->dev);
+
+	printk("%s	  0x%04x-0x%04x	  %3d\ttype=virtio-net MAC=%02x:%02x:%02x:%02x:%02x:%02x%s\n", vn->dev.name, vn->ioaddr, vn->ioaddr + pci_dev->size[0] - 1, vn->irq, vn->dev.addr[0], vn->dev.addr[1], vn->dev.addr[2], vn->dev.addr[3], vn->dev.addr[4], vn->dev.addr[5], vn->dev.features & NETIF_F_HW_CSUM ? " csum=yes" : "");
+	pci_show_desc(pci_dev);
+}
+#endif /* CONFIG_VIRTIO_NET */
+#endif /* CONFIG_NET */
+#endif /* CONFIG_PCI */
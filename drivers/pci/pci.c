@@ -20,6 +20,7 @@ static const char *get_strclass(unsigned short int class)
 {
 	switch(class) {
 		case PCI_CLASS_STORAGE_IDE:		return "IDE interface";
+		case PCI_CLASS_NETWORK_ETHERNET:	return "Ethernet controller";
 		case PCI_CLASS_DISPLAY_VGA:		return "VGA Display controller";
 		case PCI_CLASS_COMMUNICATION_SERIAL:	return "Serial controller";
 	}
@@ -32,6 +33,7 @@ static const char *get_strvendor_id(unsigned short int vendor_id)
 	switch(vendor_id) {
 		case PCI_VENDOR_ID_BOCHS:		return "QEMU";
 		case PCI_VENDOR_ID_REDHAT:		return "Red Hat";
+		case PCI_VENDOR_ID_QUMRANET:		return "Red Hat (Qumranet)";
 		case PCI_VENDOR_ID_INTEL:		return "Intel";
 	}
 #endif /* CONFIG_PCI_NAMES */
@@ -44,6 +46,7 @@ static const char *get_strdevice_id(unsigned short int device_id)
 	switch(device_id) {
 		case PCI_DEVICE_ID_BGA:			return "Bochs Graphics Adapter";
 		case PCI_DEVICE_ID_QEMU_16550A:		return "QEMU PCI 16550A";
+		case PCI_DEVICE_ID_VIRTIO_NET:		return "Virtio network device";
 		case PCI_DEVICE_ID_INTEL_82371SB_1:	return "82371SB IDE PIIX3 [Natoma]";
 	}
 #endif /* CONFIG_PCI_NAMES */
@@ -18,6 +18,7 @@
 #include <fiwix/string.h>
 #include <fiwix/stat.h>
 #include <fiwix/blk_queue.h>
+#include <fiwix/timer.h>
 
 #define BUFFER_HASH(dev, block)	(((__dev_t)(dev) ^ (__blk_t)(block)) % (NR_BUF_HASH))
 #define NR_BUF_HASH		(buffer_hash_table_size / sizeof(unsigned int))
@@ -26,6 +27,19 @@
 #define NO_GROW		0
 #define GROW_IF_NEEDED	1
 
+#define WB_EXPIRED	0	/* only the buffers dirty for too long */
+#define WB_ALL		1	/* any buffer, oldest first */
+#define WB_SYNC		2	/* buffers dirtied before the sync started */
+
+#define NR_WB_BATCH	BLK_MAX_SEGMENTS	/* buffers per writeback batch */
+#define NR_WB_CURSORS	16		/* devices with a writeback cursor */
+
+/* where the last writeback batch on a device ended */
+struct wb_cursor {
+	__dev_t dev;
+	__blk_t block;
+};
+
 struct buffer *buffer_table;		/* buffer pool */
 
 /* [0] = 1KB, [1] = 2KB, [2] = unused, [3] = 4KB */
@@ -47,7 +61,9 @@ struct buffer *buffer_dirty_head[4];	/* heads of dirty list */
  */
 struct buffer **buffer_hash_table;
 
-static struct resource sync_resource = { 0, 0 };
+static struct wb_cursor wb_cursor_table[NR_WB_CURSORS];
+static unsigned int dirty_seq;		/* dirty buffers sequence number */
+static struct callout_req kbdflushd_creq;
 
 static struct buffer *add_buffer_to_pool(void)
 {
@@ -162,6 +178,8 @@ static void insert_on_dirty_list(struct buffer *buf)
 		h->prev_dirty->next_dirty = buf;
 	}
 	h->prev_dirty = buf;
+	buf->dirtied = CURRENT_TICKS;
+	buf->dirty_seq = ++dirty_seq;
 
 	kstat.dirty_buffers += (index + 1);
 	kstat.nr_dirty_buffers++;
@@ -383,36 +401,6 @@ static struct buffer *get_free_buffer(int mode, int size)
 	return buf;
 }
 
-static struct buffer *get_dirty_buffer(int size)
-{
-	unsigned int flags;
-	struct buffer *buf;
-	int index;
-
-	index = BUFHEAD_INDEX(size);
-
-	for(;;) {
-		SAVE_FLAGS(flags); CLI();
-		if(!(buf = buffer_dirty_head[index])) {
-			/* no buffers in this dirty list */
-			RESTORE_FLAGS(flags);
-			return NULL;
-		}
-		if(buf->flags & BUFFER_LOCKED) {
-			sleep(&buffer_wait, PROC_UNINTERRUPTIBLE);
-		} else {
-			break;
-		}
-		RESTORE_FLAGS(flags);
-	}
-
-	remove_from_dirty_list(buf);
-	buf->flags |= BUFFER_LOCKED;
-
-	RESTORE_FLAGS(flags);
-	return buf;
-}
-
 static int sync_one_buffer(struct buffer *buf)
 {
 	struct device *d;
@@ -435,6 +423,176 @@ static int sync_one_buffer(struct buffer *buf)
 	return 0;
 }
 
+static int is_eligible(struct buffer *buf, int mode, unsigned int seq)
+{
+	switch(mode) {
+		case WB_EXPIRED:
+			return CURRENT_TICKS - buf->dirtied >= (BUFFER_DIRTY_EXPIRE * HZ) / 100;
+	}
+	/* buffers dirtied (or failed) since the writeback started are skipped */
+	return (int)(seq - buf->dirty_seq) >= 0;
+}
+
+/*
+ * Takes out of the dirty list up to NR_WB_BATCH buffers that belong to the
+ * same device and locks them. If 'dev' is zero, the device is the one of the
+ * oldest eligible buffer. The number of eligible buffers skipped because they
+ * were locked is returned in 'busy'.
+ */
+static int get_dirty_batch(int size, __dev_t dev, int mode, unsigned int seq, struct buffer **bufs, int *busy)
+{
+	unsigned int flags;
+	struct buffer *buf, *next;
+	int n;
+
+	n = 0;
+	SAVE_FLAGS(flags); CLI();
+	buf = buffer_dirty_head[BUFHEAD_INDEX(size)];
+	while(buf && n < NR_WB_BATCH) {
+		next = buf->next_dirty;
+		if(!is_eligible(buf, mode, seq)) {
+			if(mode == WB_EXPIRED) {
+				break;	/* the list is sorted by age */
+			}
+			buf = next;
+			continue;
+		}
+		if(dev && buf->dev != dev) {
+			buf = next;
+			continue;
+		}
+		if(buf->flags & BUFFER_LOCKED) {
+			(*busy)++;
+			buf = next;
+			continue;
+		}
+		dev = buf->dev;
+		remove_from_dirty_list(buf);
+		buf->flags |= BUFFER_LOCKED;
+		bufs[n++] = buf;
+		buf = next;
+	}
+	RESTORE_FLAGS(flags);
+	return n;
+}
+
+static struct wb_cursor *get_wb_cursor(__dev_t dev)
+{
+	struct wb_cursor *wc, *free;
+	int n;
+
+	free = &wb_cursor_table[0];
+	for(n = 0; n < NR_WB_CURSORS; n++) {
+		wc = &wb_cursor_table[n];
+		if(wc->dev == dev) {
+			return wc;
+		}
+		if(!wc->dev) {
+			free = wc;
+		}
+	}
+	free->dev = dev;
+	free->block = 0;
+	return free;
+}
+
+/*
+ * Sorts the batch by block number starting from the device cursor (so that
+ * consecutive batches sweep the disk in one direction), and submits it as a
+ * group of requests that the block layer can merge.
+ */
+static void write_dirty_batch(struct buffer **bufs, int n)
+{
+	unsigned int flags;
+	struct blk_request brh, *brs, *br;
+	struct buffer *buf;
+	struct wb_cursor *wc;
+	struct device *d;
+	int i, j, first, errno;
+
+	for(i = 1; i < n; i++) {
+		buf = bufs[i];
+		for(j = i; j > 0 && bufs[j - 1]->block > buf->block; j--) {
+			bufs[j] = bufs[j - 1];
+		}
+		bufs[j] = buf;
+	}
+	wc = get_wb_cursor(bufs[0]->dev);
+	for(first = 0; first < n; first++) {
+		if(bufs[first]->block >= wc->block) {
+			break;
+		}
+	}
+	if(first == n) {
+		first = 0;
+	}
+
+	d = get_device(BLK_DEV, bufs[0]->dev);
+	brs = d ? (struct blk_request *)kmalloc(n * sizeof(struct blk_request)) : NULL;
+	if(!brs) {
+		/* fall back to write them one by one */
+		for(i = 0; i < n; i++) {
+			buf = bufs[(first + i) % n];
+			errno = sync_one_buffer(buf);
+			SAVE_FLAGS(flags); CLI();
+			if(errno) {
+				insert_on_dirty_list(buf);
+			}
+			buf->flags &= ~BUFFER_LOCKED;
+			RESTORE_FLAGS(flags);
+		}
+		wakeup(&buffer_wait);
+		return;
+	}
+
+	memset_b(&brh, 0, sizeof(struct blk_request));
+	memset_b(brs, 0, n * sizeof(struct blk_request));
+	brh.left = n;
+	for(i = 0; i < n; i++) {
+		buf = bufs[(first + i) % n];
+		br = &brs[i];
+		br->dev = buf->dev;
+		br->block = buf->block;
+		br->size = buf->size;
+		br->buffer = buf;
+		br->device = d;
+		br->fn = d->fsop->write_block;
+		br->head_group = &brh;
+		add_blk_request(br);
+	}
+	wc->block = brs[n - 1].block + 1;
+
+	run_blk_request(d);
+	SAVE_FLAGS(flags); CLI();
+	if(brh.left) {
+		sleep(&brh, PROC_UNINTERRUPTIBLE);
+	}
+	RESTORE_FLAGS(flags);
+
+	for(i = 0; i < n; i++) {
+		br = &brs[i];
+		buf = br->buffer;
+		SAVE_FLAGS(flags); CLI();
+		if(br->errno < 0) {
+			printk("WARNING: %s(): unable to write block %d, I/O error on device %d,%d.\n", __FUNCTION__, buf->block, MAJOR(buf->dev), MINOR(buf->dev));
+			insert_on_dirty_list(buf);
+		} else {
+			buf->flags &= ~BUFFER_DIRTY;
+			if(buf->flags & BUFFER_DATA) {
+				/* the page cache keeps a copy, reuse it first */
+				remove_from_hash(buf);
+				remove_from_free_list(buf);
+				buf->flags &= ~(BUFFER_VALID | BUFFER_DATA);
+				insert_on_free_list(buf);
+			}
+		}
+		buf->flags &= ~BUFFER_LOCKED;
+		RESTORE_FLAGS(flags);
+	}
+	kfree((unsigned int)brs);
+	wakeup(&buffer_wait);
+}
+
 static struct buffer *search_buffer_hash(__dev_t dev, __blk_t block, int size)
 {
 	struct buffer *buf;
@@ -453,7 +611,7 @@ static struct buffer *search_buffer_hash(__dev_t dev, __blk_t block, int size)
 	return NULL;
 }
 
-static struct buffer *getblk(__dev_t dev, __blk_t block, int size)
+struct buffer *getblk(__dev_t dev, __blk_t block, int size)
 {
 	unsigned int flags;
 	struct buffer *buf;
@@ -491,7 +649,7 @@ static struct buffer *getblk(__dev_t dev, __blk_t block, int size)
 		buf->dev = dev;
 		buf->block = block;
 		insert_to_hash(buf);
-		buf->flags &= ~BUFFER_VALID;
+		buf->flags &= ~(BUFFER_VALID | BUFFER_DATA);
 		RESTORE_FLAGS(flags);
 		return buf;
 	}
@@ -505,10 +663,24 @@ int gbread(struct device *d, struct blk_request *brh)
 
 	br = brh->next_group;
 	while(br) {
+		if(br->flags & BRF_NOCACHE) {
+			/*
+			 * The block is read directly into the memory pointed by
+			 * the caller's private buffer, unless the buffer cache
+			 * already has it (it might be newer than the disk).
+			 */
+			if(!search_buffer_hash(br->dev, br->block, br->size)) {
+				brh->left++;
+				add_blk_request(br);
+				br = br->next_group;
+				continue;
+			}
+			br->flags &= ~BRF_NOCACHE;
+		}
 		if(!(br->flags & BRF_NOBLOCK)) {
 			if((buf = getblk(br->dev, br->block, br->size))) {
 				br->buffer = buf;
-				if(buf->flags & BUFFER_VALID) {
+				if(buf->flags & BUFFER_VALID || br->flags & BRF_NOREAD) {
 					br = br->next_group;
 					continue;
 				}
@@ -565,6 +737,16 @@ void bwrite(struct buffer *buf)
 {
 	buf->flags |= (BUFFER_DIRTY | BUFFER_VALID);
 	brelse(buf);
+
+	/*
+	 * Writers that exceed the dirty limit wait here for a round of
+	 * kbdflushd, rather than later inside getblk() when the buffer
+	 * cache has run out of clean buffers.
+	 */
+	if(kstat.nr_dirty_buffers > kstat.throttle_dirty_buffers) {
+		wakeup(&kbdflushd);
+		sleep(&bwrite, PROC_UNINTERRUPTIBLE);
+	}
 }
 
 void brelse(struct buffer *buf)
@@ -586,45 +768,48 @@ void brelse(struct buffer *buf)
 	wakeup(&buffer_wait);
 }
 
+/*
+ * Releases a buffer whose contents are also held by the page cache. If it's
+ * clean it's dropped from the buffer cache right away, otherwise it will be
+ * dropped once written back.
+ */
+void bforget(struct buffer *buf)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	if(buf->flags & BUFFER_DIRTY) {
+		buf->flags |= BUFFER_DATA;
+	} else {
+		remove_from_hash(buf);
+		buf->flags &= ~(BUFFER_VALID | BUFFER_DATA);
+	}
+	RESTORE_FLAGS(flags);
+	brelse(buf);
+}
+
 void sync_buffers(__dev_t dev)
 {
-	struct buffer *buf, *first;
-	int flushed, size;
+	struct buffer *bufs[NR_WB_BATCH];
+	unsigned int seq;
+	int n, size, busy;
 
-	lock_resource(&sync_resource);
-	flushed = 0;
+	seq = dirty_seq;
 	for(size = BLKSIZE_1K; size <= PAGE_SIZE; size <<= 1) {
-		first = NULL;
 		for(;;) {
-			if(!(buf = get_dirty_buffer(size))) {
-				break;
+			busy = 0;
+			if((n = get_dirty_batch(size, dev, WB_SYNC, seq, bufs, &busy))) {
+				write_dirty_batch(bufs, n);
+				cond_resched();
+				continue;
 			}
-			if(first == buf) {
-				insert_on_dirty_list(buf);
-				buf->flags &= ~BUFFER_LOCKED;
-				wakeup(&buffer_wait);
+			if(!busy) {
 				break;
 			}
-			if(!dev || buf->dev == dev) {
-				if(sync_one_buffer(buf)) {
-					insert_on_dirty_list(buf);
-					buf->flags &= ~BUFFER_LOCKED;
-					continue;
-				}
-				flushed++;
-			} else {
-				if(!first) {
-					first = buf;
-				}
-				insert_on_dirty_list(buf);
-			}
-			buf->flags &= ~BUFFER_LOCKED;
+			/* wait for the locked ones to be released */
+			sleep(&buffer_wait, PROC_UNINTERRUPTIBLE);
 		}
 	}
-	if(flushed) {
-		wakeup(&buffer_wait);
-	}
-	unlock_resource(&sync_resource);
 }
 
 void invalidate_buffers(__dev_t dev)
@@ -642,6 +827,15 @@ void invalidate_buffers(__dev_t dev)
 			buf->flags &= ~(BUFFER_VALID | BUFFER_LOCKED);
 			wakeup(&buffer_wait);
 		}
+		/* a locked buffer stays in the pool while others run */
+		if(need_resched && !(buf->flags & BUFFER_LOCKED)) {
+			buf->flags |= BUFFER_LOCKED;
+			RESTORE_FLAGS(flags);
+			cond_resched();
+			SAVE_FLAGS(flags); CLI();
+			buf->flags &= ~BUFFER_LOCKED;
+			wakeup(&buffer_wait);
+		}
 		buf = buf->next;
 	}
 
@@ -727,6 +921,7 @@ int reclaim_buffers(void)
 	/* iterate through all buffer sizes */
 	STI();
 	for(;;) {
+		cond_resched();
 		if((buf = get_free_buffer(NO_GROW, size))) {
 			if(buf->mark == mark) {
 				SAVE_FLAGS(flags); CLI();
@@ -789,59 +984,43 @@ next:
 	return reclaimed;
 }
 
+static void wakeup_kbdflushd(unsigned int arg)
+{
+	wakeup(&kbdflushd);
+}
+
+/*
+ * Writes back the buffers that have been dirty for too long every
+ * BUFFER_WRITEBACK centisecs, and the oldest ones (regardless of their age)
+ * whenever there are too many dirty buffers.
+ */
 int kbdflushd(void)
 {
-	struct buffer *buf, *first;
-	int flushed, size;
+	struct buffer *bufs[NR_WB_BATCH];
+	unsigned int seq;
+	int n, size, mode, busy;
+
+	kbdflushd_creq.fn = wakeup_kbdflushd;
+	kbdflushd_creq.arg = 0;
 
 	for(;;) {
+		add_callout(&kbdflushd_creq, (BUFFER_WRITEBACK * HZ) / 100);
 		sleep(&kbdflushd, PROC_INTERRUPTIBLE);
-		flushed = 0;
 
-		lock_resource(&sync_resource);
+		seq = dirty_seq;
 		for(size = BLKSIZE_1K; size <= PAGE_SIZE; size <<= 1) {
-			first = NULL;
 			for(;;) {
-				if(!(buf = get_dirty_buffer(size))) {
+				mode = kstat.nr_dirty_buffers > kstat.max_dirty_buffers ? WB_ALL : WB_EXPIRED;
+				busy = 0;
+				if(!(n = get_dirty_batch(size, 0, mode, seq, bufs, &busy))) {
 					break;
 				}
-
-				if(!(buf->flags & BUFFER_DIRTY)) {
-					printk("WARNING: %s(): a dirty buffer (dev %x, block %d, flags = %x) is not marked as dirty!\n", __FUNCTION__, buf->dev, buf->block, buf->flags);
-					continue;
-				}
-
-				if(first) {
-					if(first == buf) {
-						insert_on_dirty_list(buf);
-						buf->flags &= ~BUFFER_LOCKED;
-						wakeup(&buffer_wait);
-						break;
-					}
-				} else {
-					first = buf;
-				}
-
-				if(sync_one_buffer(buf)) {
-					insert_on_dirty_list(buf);
-					buf->flags &= ~BUFFER_LOCKED;
-					wakeup(&buffer_wait);
-					continue;
-				}
-				buf->flags &= ~BUFFER_LOCKED;
-				wakeup(&buffer_wait);
-				flushed++;
-
-				if(flushed == NR_BUF_RECLAIM) {
-					if(kstat.nr_dirty_buffers < kstat.max_dirty_buffers) {
-						break;
-					}
-					flushed = 0;
-					do_sched();
-				}
+				write_dirty_batch(bufs, n);
+				wakeup(&bwrite);
+				do_sched();
 			}
 		}
-		unlock_resource(&sync_resource);
+		wakeup(&bwrite);
 	}
 }
 
@@ -851,5 +1030,7 @@ void buffer_init(void)
 	memset_b(buffer_head, 0, sizeof(buffer_head));
 	memset_b(buffer_dirty_head, 0, sizeof(buffer_dirty_head));
 	kstat.max_dirty_buffers = (kstat.max_buffers_size * BUFFER_DIRTY_RATIO) / 100;
+	kstat.throttle_dirty_buffers = (kstat.max_buffers_size * BUFFER_THROTTLE_RATIO) / 100;
+	memset_b(wb_cursor_table, 0, sizeof(wb_cursor_table));
 	memset_b(buffer_hash_table, 0, buffer_hash_table_size);
 }
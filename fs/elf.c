@@ -16,11 +16,105 @@
 #include <fiwix/fs.h>
 #include <fiwix/fcntl.h>
 #include <fiwix/process.h>
+#include <fiwix/sleep.h>
+#include <fiwix/vdso.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
-#define AT_ITEMS	12	/* ELF Auxiliary Vectors */
+#define AT_ITEMS	14	/* ELF Auxiliary Vectors */
+#define NR_RESIDENT_INTERP	2	/* dynamic loaders kept in memory */
+
+/*
+ * Every dynamically linked program maps the same dynamic loader, so its inode
+ * is kept referenced and its text pages are kept in the page cache with an
+ * extra reference that prevents them from being reclaimed.
+ */
+static struct resident_interp {
+	struct inode *inode;
+	__off_t start;			/* range of the pinned text pages */
+	__off_t end;
+} resident_interp[NR_RESIDENT_INTERP];
+static struct resource interp_resource = { 0, 0 };
+
+static void unpin_interp(struct resident_interp *ri, __off_t end)
+{
+	struct page *pg;
+	__off_t offset;
+
+	for(offset = ri->start; offset < end; offset += PAGE_SIZE) {
+		if((pg = search_page_hash(ri->inode, offset))) {
+			release_page(pg);
+			release_page(pg);
+		}
+	}
+}
+
+static void pin_interp(struct inode *ii, struct vma *vma)
+{
+	struct resident_interp *ri, *free;
+	struct page *pg;
+	__off_t offset, end;
+	int n;
+
+	lock_resource(&interp_resource);
+	free = NULL;
+	for(n = 0; n < NR_RESIDENT_INTERP; n++) {
+		ri = &resident_interp[n];
+		if(ri->inode == ii) {
+			unlock_resource(&interp_resource);
+			return;
+		}
+		/* the file was removed or replaced */
+		if(ri->inode && !ri->inode->i_nlink) {
+			unpin_interp(ri, ri->end);
+			iput(ri->inode);
+			ri->inode = NULL;
+		}
+		if(!ri->inode && !free) {
+			free = ri;
+		}
+	}
+	if(!free) {
+		unlock_resource(&interp_resource);
+		return;
+	}
+
+	free->inode = ii;
+	free->start = vma->offset & PAGE_MASK;
+	end = free->start + (vma->end - vma->start);
+	end = MIN(end, PAGE_ALIGN(ii->i_size));
+	for(offset = free->start; offset < end; offset += PAGE_SIZE) {
+		/* the reference got here is the one that pins the page */
+		if(!(pg = search_page_hash(ii, offset))) {
+			unpin_interp(free, offset);
+			free->inode = NULL;
+			unlock_resource(&interp_resource);
+			return;
+		}
+	}
+	free->end = end;
+	ii->count++;
+	unlock_resource(&interp_resource);
+}
+
+/* releases the dynamic loaders kept in memory from the device 'dev' */
+void release_resident_interp(__dev_t dev)
+{
+	struct resident_interp *ri;
+	int n;
+
+	lock_resource(&interp_resource);
+	for(n = 0; n < NR_RESIDENT_INTERP; n++) {
+		ri = &resident_interp[n];
+		if(ri->inode && ri->inode->dev == dev) {
+			unpin_interp(ri, ri->end);
+			iput(ri->inode);
+			ri->inode = NULL;
+		}
+	}
+	unlock_resource(&interp_resource);
+}
 
 /*
  * Setup the initial process stack (UNIX System V ABI for i386)
@@ -67,11 +161,19 @@ static void elf_create_stack(struct binargs *barg, unsigned int *sp, unsigned in
 	unsigned int n, addr;
 	char *str;
 
-	/* copy strings */
-	for(n = 0; n < ARG_MAX; n++) {
+	/*
+	 * The pages holding the strings become the top of the stack, so they
+	 * are mapped there instead of being copied.
+	 */
+	for(n = 0; n < barg->pages; n++) {
 		if(barg->page[n]) {
-			addr = PAGE_OFFSET - ((ARG_MAX - n) * PAGE_SIZE);
-			memcpy_b((void *)addr, (void *)barg->page[n], PAGE_SIZE);
+			addr = PAGE_OFFSET - ((barg->pages - n) * PAGE_SIZE);
+			if(map_page(current, addr, V2P(barg->page[n]), PROT_READ | PROT_WRITE)) {
+				current->rss++;
+				barg->page[n] = 0;
+			} else {
+				memcpy_b((void *)addr, (void *)barg->page[n], PAGE_SIZE);
+			}
 		}
 	}
 
@@ -258,6 +360,30 @@ static void elf_create_stack(struct binargs *barg, unsigned int *sp, unsigned in
 		*sp = current->egid;
 #ifdef __DEBUG__
 		printk("\t\tAT_EGID = %d\n", *sp);
+#endif /*__DEBUG__ */
+		sp++;
+
+		*sp = AT_SYSINFO;
+#ifdef __DEBUG__
+		printk("at 0x%08x -> AT_SYSINFO = %d", sp, *sp);
+#endif /*__DEBUG__ */
+		sp++;
+
+		*sp = vsyscall_entry;
+#ifdef __DEBUG__
+		printk("\t\tAT_SYSINFO = 0x%08x\n", *sp);
+#endif /*__DEBUG__ */
+		sp++;
+
+		*sp = AT_SYSINFO_EHDR;
+#ifdef __DEBUG__
+		printk("at 0x%08x -> AT_SYSINFO_EHDR = %d", sp, *sp);
+#endif /*__DEBUG__ */
+		sp++;
+
+		*sp = VDSO_ADDR;
+#ifdef __DEBUG__
+		printk("\t\tAT_SYSINFO_EHDR = 0x%08x\n", *sp);
 #endif /*__DEBUG__ */
 		sp++;
 	}
@@ -289,6 +415,7 @@ static int elf_load_interpreter(struct inode *ii)
 	struct buffer *buf;
 	struct elf32_hdr *elf32_h;
 	struct elf32_phdr *elf32_ph, *last_ptload;
+	struct vma *vma;
 	__blk_t block;
 	unsigned int start, end, length, offset;
 	unsigned int prot;
@@ -352,6 +479,15 @@ static int elf_load_interpreter(struct inode *ii)
 				send_sig(current, SIGSEGV);
 				return -ENOEXEC;
 			}
+			if((vma = find_vma_region(start))) {
+				if(type == P_TEXT) {
+					/* the whole text is read once and kept */
+					prefault_vma(vma, (vma->end - vma->start) >> PAGE_SHIFT);
+					pin_interp(ii, vma);
+				} else {
+					prefault_vma(vma, ELF_PREFAULT_PAGES);
+				}
+			}
 			last_ptload = elf32_ph;
 		}
 	}
@@ -388,6 +524,42 @@ static int elf_load_interpreter(struct inode *ii)
 	return elf32_h->e_entry + MMAP_START;
 }
 
+/*
+ * A process sharing its address space with others (i.e. a thread) gets a new
+ * empty one, and the rest of its thread group is killed.
+ */
+static int unshare_mm(void)
+{
+	struct mm_struct *mm;
+	unsigned int *pgdir;
+	struct proc *p;
+
+	if(current->mm->count == 1) {
+		return 0;
+	}
+	if(!(mm = get_mm())) {
+		return -ENOMEM;
+	}
+	if(!(pgdir = (void *)kmalloc(PAGE_SIZE))) {
+		kfree((unsigned int)mm);
+		return -ENOMEM;
+	}
+	memcpy_b(pgdir, kpage_dir, PAGE_SIZE);
+
+	FOR_EACH_PROCESS(p) {
+		if(p != current && p->tgid == current->tgid) {
+			send_sig(p, SIGKILL);
+		}
+		p = p->next;
+	}
+
+	current->mm->count--;
+	current->mm = mm;
+	current->tss.cr3 = V2P((unsigned int)pgdir);
+	SET_CR3(current->tss.cr3);
+	return 0;
+}
+
 int check_elf(struct elf32_hdr *elf32_h)
 {
 	if(elf32_h->e_ident[EI_MAG0] != ELFMAG0 ||
@@ -462,10 +634,16 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 #endif /*__DEBUG__ */
 
 
+	if((errno = unshare_mm())) {
+		return errno;
+	}
+
 	/* point of no return */
 
 	release_binary();
 	current->rss = 0;
+	memset_b(current->tls, 0, sizeof(current->tls));
+	load_tls(current->tls);
 
 	current->entry_address = elf32_h->e_entry;
 	if(interpreter) {
@@ -507,6 +685,7 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 				send_sig(current, SIGSEGV);
 				return -ENOEXEC;
 			}
+			prefault_vma(find_vma_region(start), ELF_PREFAULT_PAGES);
 			last_ptload = elf32_ph;
 		}
 	}
@@ -538,7 +717,7 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 		send_sig(current, SIGSEGV);
 		return -ENOEXEC;
 	}
-	current->brk_lower = start;
+	current->mm->brk_lower = start;
 
 	/* setup the HEAP section */
 	start = elf32_ph->p_vaddr + elf32_ph->p_memsz;
@@ -549,7 +728,13 @@ int elf_load(struct inode *i, struct binargs *barg, struct sigcontext *sc, char
 		send_sig(current, SIGSEGV);
 		return -ENOEXEC;
 	}
-	current->brk = start;
+	current->mm->brk = start;
+
+	/* setup the vsyscall page */
+	if(map_vdso()) {
+		send_sig(current, SIGSEGV);
+		return -ENOEXEC;
+	}
 
 	/* setup the STACK section */
 	sp = PAGE_OFFSET - 4;	/* formerly 0xBFFFFFFC */
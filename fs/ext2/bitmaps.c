@@ -318,3 +318,92 @@ void ext2_bfree(struct superblock *sb, int block)
 	superblock_unlock(sb);
 	return;
 }
+
+/*
+ * Allocates a run of up to '*count' contiguous blocks, starting at 'goal' if
+ * it's free or at the nearest free block after it within the same group.
+ * The rest of block groups are only tried if the group of 'goal' is full.
+ * Returns the first block of the run and sets '*count' to its length.
+ */
+int ext2_balloc_run(struct superblock *sb, __blk_t goal, int *count)
+{
+	__blk_t block, first_data;
+	struct ext2_group_desc *gd;
+	struct buffer *buf, *bmbuf;
+	int bg, start, n, bit, nbits, want, found;
+
+	superblock_lock(sb);
+
+	first_data = sb->u.ext2.sb.s_first_data_block;
+	if(goal < first_data || goal >= sb->u.ext2.sb.s_blocks_count) {
+		goal = first_data;
+	}
+	bg = (goal - first_data) / EXT2_BLOCKS_PER_GROUP(sb);
+	start = (goal - first_data) % EXT2_BLOCKS_PER_GROUP(sb);
+	want = *count;
+	buf = bmbuf = NULL;
+	gd = NULL;
+	found = -1;
+
+	for(n = 0; n < sb->u.ext2.block_groups; n++) {
+		block = SUPERBLOCK + first_data + (bg / EXT2_DESC_PER_BLOCK(sb));
+		if(!(buf = bread(sb->dev, block, sb->s_blocksize))) {
+			superblock_unlock(sb);
+			return -EIO;
+		}
+		gd = (struct ext2_group_desc *)(buf->data + ((bg % EXT2_DESC_PER_BLOCK(sb)) * sizeof(struct ext2_group_desc)));
+		if(gd->bg_free_blocks_count) {
+			if(!(bmbuf = bread(sb->dev, gd->bg_block_bitmap, sb->s_blocksize))) {
+				brelse(buf);
+				superblock_unlock(sb);
+				return -EIO;
+			}
+			/* the last group might have less blocks than the others */
+			nbits = sb->u.ext2.sb.s_blocks_count - first_data - (bg * EXT2_BLOCKS_PER_GROUP(sb));
+			nbits = MIN(nbits, EXT2_BLOCKS_PER_GROUP(sb));
+			for(bit = start; bit < nbits; bit++) {
+				if(!(bmbuf->data[bit / 8] & (1 << (bit % 8)))) {
+					found = bit;
+					break;
+				}
+			}
+			if(found < 0 && start) {
+				for(bit = 0; bit < start; bit++) {
+					if(!(bmbuf->data[bit / 8] & (1 << (bit % 8)))) {
+						found = bit;
+						break;
+					}
+				}
+			}
+			if(found >= 0) {
+				break;
+			}
+			brelse(bmbuf);
+		}
+		brelse(buf);
+		bg = (bg + 1) % sb->u.ext2.block_groups;
+		start = 0;
+	}
+	if(found < 0) {
+		superblock_unlock(sb);
+		return -ENOSPC;
+	}
+
+	/* extend the run as long as the next blocks are free */
+	for(n = 0, bit = found; n < want && bit < nbits; n++, bit++) {
+		if(bmbuf->data[bit / 8] & (1 << (bit % 8))) {
+			break;
+		}
+		bmbuf->data[bit / 8] |= (1 << (bit % 8));
+	}
+	bwrite(bmbuf);
+
+	gd->bg_free_blocks_count -= n;
+	sb->u.ext2.sb.s_free_blocks_count -= n;
+	sb->state |= SUPERBLOCK_DIRTY;
+	bwrite(buf);
+
+	superblock_unlock(sb);
+	*count = n;
+	return found + (bg * EXT2_BLOCKS_PER_GROUP(sb)) + first_data;
+}
@@ -73,6 +73,9 @@ int ext2_file_open(struct inode *i, struct fd *f)
 
 int ext2_file_close(struct inode *i, struct fd *f)
 {
+	inode_lock(i);
+	ext2_discard_prealloc(i);
+	inode_unlock(i);
 	return 0;
 }
 
@@ -81,7 +84,7 @@ int ext2_file_write(struct inode *i, struct fd *f, const char *buffer, __size_t
 	__blk_t block;
 	__size_t total_written;
 	unsigned int boffset, bytes;
-	int blksize, retval;
+	int blksize, retval, nblocks, failed;
 	struct buffer *buf;
 	struct device *d;
 	struct blk_request brh, *br, *tmp;
@@ -101,6 +104,15 @@ int ext2_file_write(struct inode *i, struct fd *f, const char *buffer, __size_t
 	}
 	offset = f->offset;
 
+	/*
+	 * Reserve a contiguous run for the blocks beyond the end of file
+	 * (plus their indirect blocks) before any of them gets allocated.
+	 */
+	if(offset + count > i->i_size) {
+		nblocks = ((offset + count + blksize - 1) >> EXT2_BLOCK_SIZE_BITS(i->sb)) - (MAX(offset, i->i_size) >> EXT2_BLOCK_SIZE_BITS(i->sb));
+		ext2_prealloc(i, nblocks + (nblocks / (blksize / sizeof(__blk_t))) + 1);
+	}
+
 	if(count > blksize) {
 		if(!(d = get_device(BLK_DEV, i->dev))) {
 			printk("WARNING: %s(): device major %d not found!\n", __FUNCTION__, MAJOR(i->dev));
@@ -115,13 +127,20 @@ int ext2_file_write(struct inode *i, struct fd *f, const char *buffer, __size_t
 				retval = -ENOMEM;
 				break;
 			}
-			if((block = bmap(i, offset, FOR_WRITING)) < 0) {
+			boffset = offset & (blksize - 1);	/* mod blksize */
+			bytes = blksize - boffset;
+			bytes = MIN(bytes, (count - total_written));
+
+			/* a block that will be entirely overwritten needs no I/O */
+			if((block = bmap(i, offset, bytes == blksize ? FOR_OVERWRITING : FOR_WRITING)) < 0) {
+				kfree((unsigned int)br);
 				retval = block;
 				break;
 			}
 			memset_b(br, 0, sizeof(struct blk_request));
 			br->dev = i->dev;
 			br->block = block;
+			br->flags = bytes == blksize ? BRF_NOREAD : 0;
 			br->size = blksize;
 			br->device = d;
 			br->fn = d->fsop->read_block;
@@ -132,30 +151,42 @@ int ext2_file_write(struct inode *i, struct fd *f, const char *buffer, __size_t
 				tmp->next_group = br;
 			}
 			tmp = br;
-			boffset = offset & (blksize - 1);	/* mod blksize */
-			bytes = blksize - boffset;
-			bytes = MIN(bytes, (count - total_written));
 			total_written += bytes;
 			offset += bytes;
 		}
-		if(!retval) {
-			retval = gbread(d, &brh);
+		/*
+		 * The blocks mapped so far are written even if a later one
+		 * couldn't be, so the write just comes up short.
+		 */
+		if(brh.next_group) {
+			gbread(d, &brh);
 		}
 		br = brh.next_group;
 		offset = f->offset;
 		total_written = 0;
+		failed = 0;
 		while(br) {
-			if(!retval) {
+			if(br->errno < 0) {
+				retval = br->errno;
+				failed = 1;
+			}
+			if(!failed) {
 				boffset = offset & (blksize - 1);	/* mod blksize */
 				bytes = blksize - boffset;
 				bytes = MIN(bytes, (count - total_written));
 				memcpy_b(br->buffer->data + boffset, buffer + total_written, bytes);
-				update_page_cache(i, offset, buffer + total_written, bytes);
+				if(update_page_cache(i, offset, buffer + total_written, bytes)) {
+					br->buffer->flags |= BUFFER_DATA;
+				}
 				bwrite(br->buffer);
 				total_written += bytes;
 				offset += bytes;
-			} else {
-				if(br->buffer) {
+			} else if(br->buffer) {
+				/* a block mapped for overwriting still has stale data */
+				if(br->flags & BRF_NOREAD) {
+					memset_b(br->buffer->data, 0, blksize);
+					bwrite(br->buffer);
+				} else {
 					brelse(br->buffer);
 				}
 			}
@@ -166,25 +197,36 @@ int ext2_file_write(struct inode *i, struct fd *f, const char *buffer, __size_t
 	} else {
 		while(total_written < count) {
 			boffset = offset & (blksize - 1);	/* mod blksize */
-			if((block = bmap(i, offset, FOR_WRITING)) < 0) {
-				retval = block;
-				break;
-			}
 			bytes = blksize - boffset;
 			bytes = MIN(bytes, (count - total_written));
-			if(!(buf = bread(i->dev, block, blksize))) {
+			if(bytes == blksize) {
+				if((block = bmap(i, offset, FOR_OVERWRITING)) < 0) {
+					retval = block;
+					break;
+				}
+				buf = getblk(i->dev, block, blksize);
+			} else {
+				if((block = bmap(i, offset, FOR_WRITING)) < 0) {
+					retval = block;
+					break;
+				}
+				buf = bread(i->dev, block, blksize);
+			}
+			if(!buf) {
 				retval = -EIO;
 				break;
 			}
 			memcpy_b(buf->data + boffset, buffer + total_written, bytes);
-			update_page_cache(i, offset, buffer + total_written, bytes);
+			if(update_page_cache(i, offset, buffer + total_written, bytes)) {
+				buf->flags |= BUFFER_DATA;
+			}
 			bwrite(buf);
 			total_written += bytes;
 			offset += bytes;
 		}
 	}
 
-	if(!retval) {
+	if(total_written) {
 		f->offset = offset;
 		if(f->offset > i->i_size) {
 			i->i_size = f->offset;
@@ -196,10 +238,7 @@ int ext2_file_write(struct inode *i, struct fd *f, const char *buffer, __size_t
 
 	inode_unlock(i);
 
-	if(retval) {
-		return retval;
-	}
-	return total_written;
+	return total_written ? total_written : retval;
 }
 
 __loff_t ext2_file_llseek(struct inode *i, __loff_t offset)
@@ -80,6 +80,22 @@ static int free_indblock(struct inode *i, int block, int offset)
 	return 0;
 }
 
+/*
+ * Takes the next block from the run reserved by ext2_prealloc(), so that the
+ * blocks of a file being written sequentially end up contiguous on disk.
+ */
+static int new_block(struct inode *i)
+{
+	int count;
+
+	if(i->u.ext2.i_prealloc_count) {
+		i->u.ext2.i_prealloc_count--;
+		return i->u.ext2.i_prealloc_block++;
+	}
+	count = 1;
+	return ext2_balloc_run(i->sb, i->u.ext2.i_prealloc_block, &count);
+}
+
 static int get_group_desc(struct superblock *sb, __blk_t block_group, struct ext2_group_desc *gd)
 {
 	__blk_t group_desc_block;
@@ -251,17 +267,19 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 	}
 
 	if(level < EXT2_NDIR_BLOCKS) {
-		if(!i->u.ext2.i_data[block] && mode == FOR_WRITING) {
-			if((newblock = ext2_balloc(i->sb)) < 0) {
+		if(!i->u.ext2.i_data[block] && mode != FOR_READING) {
+			if((newblock = new_block(i)) < 0) {
 				return -ENOSPC;
 			}
 			/* initialize the new block */
-			if(!(buf = bread(i->dev, newblock, blksize))) {
-				ext2_bfree(i->sb, newblock);
-				return -EIO;
+			if(mode == FOR_WRITING) {
+				if(!(buf = bread(i->dev, newblock, blksize))) {
+					ext2_bfree(i->sb, newblock);
+					return -EIO;
+				}
+				memset_b(buf->data, 0, blksize);
+				bwrite(buf);
 			}
-			memset_b(buf->data, 0, blksize);
-			bwrite(buf);
 			i->u.ext2.i_data[block] = newblock;
 			i->i_blocks += blksize / 512;
 		}
@@ -269,8 +287,8 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 	}
 
 	if(!i->u.ext2.i_data[level]) {
-		if(mode == FOR_WRITING) {
-			if((newblock = ext2_balloc(i->sb)) < 0) {
+		if(mode != FOR_READING) {
+			if((newblock = new_block(i)) < 0) {
 				return -ENOSPC;
 			}
 			/* initialize the new block */
@@ -301,19 +319,21 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 	}
 
 	if(!indblock[block]) {
-		if(mode == FOR_WRITING) {
-			if((newblock = ext2_balloc(i->sb)) < 0) {
+		if(mode != FOR_READING) {
+			if((newblock = new_block(i)) < 0) {
 				brelse(buf);
 				return -ENOSPC;
 			}
 			/* initialize the new block */
-			if(!(buf2 = bread(i->dev, newblock, blksize))) {
-				ext2_bfree(i->sb, newblock);
-				brelse(buf);
-				return -EIO;
+			if(level != EXT2_IND_BLOCK || mode == FOR_WRITING) {
+				if(!(buf2 = bread(i->dev, newblock, blksize))) {
+					ext2_bfree(i->sb, newblock);
+					brelse(buf);
+					return -EIO;
+				}
+				memset_b(buf2->data, 0, blksize);
+				bwrite(buf2);
 			}
-			memset_b(buf2->data, 0, blksize);
-			bwrite(buf2);
 			indblock[block] = newblock;
 			i->i_blocks += blksize / 512;
 			if(level == EXT2_IND_BLOCK) {
@@ -342,8 +362,8 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 		tblock -= BLOCKS_PER_DIND_BLOCK(i->sb) * block;
 		block = tindblock[tblock / BLOCKS_PER_IND_BLOCK(i->sb)];
 		if(!block) {
-			if(mode == FOR_WRITING) {
-				if((newblock = ext2_balloc(i->sb)) < 0) {
+			if(mode != FOR_READING) {
+				if((newblock = new_block(i)) < 0) {
 					brelse(buf);
 					brelse(buf3);
 					return -ENOSPC;
@@ -386,8 +406,8 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 
 	dindblock = (__blk_t *)buf2->data;
 	block = dindblock[dblock - (iblock * BLOCKS_PER_IND_BLOCK(i->sb))];
-	if(!block && mode == FOR_WRITING) {
-		if((newblock = ext2_balloc(i->sb)) < 0) {
+	if(!block && mode != FOR_READING) {
+		if((newblock = new_block(i)) < 0) {
 			brelse(buf);
 			if(level == EXT2_TIND_BLOCK) {
 				brelse(buf3);
@@ -396,17 +416,19 @@ int ext2_bmap(struct inode *i, __off_t offset, int mode)
 			return -ENOSPC;
 		}
 		/* initialize the new block */
-		if(!(buf4 = bread(i->dev, newblock, blksize))) {
-			ext2_bfree(i->sb, newblock);
-			brelse(buf);
-			if(level == EXT2_TIND_BLOCK) {
-				brelse(buf3);
+		if(mode == FOR_WRITING) {
+			if(!(buf4 = bread(i->dev, newblock, blksize))) {
+				ext2_bfree(i->sb, newblock);
+				brelse(buf);
+				if(level == EXT2_TIND_BLOCK) {
+					brelse(buf3);
+				}
+				brelse(buf2);
+				return -EIO;
 			}
-			brelse(buf2);
-			return -EIO;
+			memset_b(buf4->data, 0, blksize);
+			bwrite(buf4);
 		}
-		memset_b(buf4->data, 0, blksize);
-		bwrite(buf4);
 		dindblock[dblock - (iblock * BLOCKS_PER_IND_BLOCK(i->sb))] = newblock;
 		i->i_blocks += blksize / 512;
 		buf2->flags |= (BUFFER_DIRTY | BUFFER_VALID);
@@ -433,6 +455,8 @@ int ext2_truncate(struct inode *i, __off_t length)
 		return -EINVAL;
 	}
 
+	ext2_discard_prealloc(i);
+
 	if(block < EXT2_NDIR_BLOCKS) {
 		for(n = block; n < EXT2_NDIR_BLOCKS; n++) {
 			if(i->u.ext2.i_data[n]) {
@@ -522,3 +546,37 @@ int ext2_truncate(struct inode *i, __off_t length)
 
 	return 0;
 }
+
+/*
+ * Reserves a contiguous run of at least 'nblocks' blocks that will be handed
+ * out by ext2_bmap() as the file grows. The run starts right after the last
+ * block reserved for this inode, so that consecutive writes keep extending
+ * the same area of the disk.
+ */
+void ext2_prealloc(struct inode *i, int nblocks)
+{
+	__blk_t goal;
+	int block, count;
+
+	if(i->u.ext2.i_prealloc_count >= nblocks) {
+		return;
+	}
+	goal = i->u.ext2.i_prealloc_block;
+	ext2_discard_prealloc(i);
+
+	count = MAX(nblocks, EXT2_PREALLOC_BLOCKS);
+	if((block = ext2_balloc_run(i->sb, goal, &count)) < 0) {
+		return;
+	}
+	i->u.ext2.i_prealloc_block = block;
+	i->u.ext2.i_prealloc_count = count;
+}
+
+/* gives back to the filesystem the reserved blocks not used */
+void ext2_discard_prealloc(struct inode *i)
+{
+	while(i->u.ext2.i_prealloc_count) {
+		i->u.ext2.i_prealloc_count--;
+		ext2_bfree(i->sb, i->u.ext2.i_prealloc_block + i->u.ext2.i_prealloc_count);
+	}
+}
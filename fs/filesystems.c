@@ -84,6 +84,16 @@ void fs_init(void)
 		printk("%s(): unable to register 'sockfs' filesystem.\n", __FUNCTION__);
 	}
 #endif /* CONFIG_NET */
+#ifdef CONFIG_FS_TMPFS
+	if(tmpfs_init()) {
+		printk("%s(): unable to register 'tmpfs' filesystem.\n", __FUNCTION__);
+	}
+#endif /* CONFIG_FS_TMPFS */
+#ifdef CONFIG_POSIX_MQUEUE
+	if(mqueue_init()) {
+		printk("%s(): unable to register 'mqueue' filesystem.\n", __FUNCTION__);
+	}
+#endif /* CONFIG_POSIX_MQUEUE */
 #ifdef CONFIG_UNIX98_PTYS
 	if(devpts_init()) {
 		printk("%s(): unable to register 'devpts' filesystem.\n", __FUNCTION__);
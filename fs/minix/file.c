@@ -106,7 +106,9 @@ int minix_file_write(struct inode *i, struct fd *f, const char *buffer, __size_t
 			return -EIO;
 		}
 		memcpy_b(buf->data + boffset, buffer + total_written, bytes);
-		update_page_cache(i, f->offset, buffer + total_written, bytes);
+		if(update_page_cache(i, f->offset, buffer + total_written, bytes)) {
+			buf->flags |= BUFFER_DATA;
+		}
 		bwrite(buf);
 		total_written += bytes;
 		f->offset += bytes;
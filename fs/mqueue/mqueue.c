@@ -0,0 +1,343 @@
+/*
+ * fiwix/fs/mqueue/mqueue.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_mqueue.h>
+#include <fiwix/stat.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/sleep.h>
+#include <fiwix/sched.h>
+#include <fiwix/process.h>
+#include <fiwix/timer.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_POSIX_MQUEUE
+struct mqueue_name {
+	char *name;
+	struct inode *inode;		/* the name holds a reference */
+};
+
+static struct mqueue_name mqueue_table[NR_MQUEUES];
+static struct resource mqueue_resource = { 0, 0 };
+
+static struct mqueue_name *find_name(const char *name)
+{
+	int n;
+
+	for(n = 0; n < NR_MQUEUES; n++) {
+		if(mqueue_table[n].name && !strcmp(mqueue_table[n].name, name)) {
+			return &mqueue_table[n];
+		}
+	}
+	return NULL;
+}
+
+static int check_name(const char *name)
+{
+	const char *p;
+
+	if(!*name) {
+		return -ENOENT;
+	}
+	for(p = name; *p; p++) {
+		if(*p == '/') {
+			return -EACCES;
+		}
+	}
+	if(p - name > NAME_MAX) {
+		return -ENAMETOOLONG;
+	}
+	return 0;
+}
+
+static struct inode *create_queue(const char *name, __mode_t mode, struct mq_attr *attr, int *errno)
+{
+	struct filesystems *fs;
+	struct mqueue_name *mn;
+	struct inode *i;
+	int n;
+
+	if(attr) {
+		if(attr->mq_maxmsg <= 0 || attr->mq_maxmsg > MQ_MAXMSG_MAX) {
+			*errno = -EINVAL;
+			return NULL;
+		}
+		if(attr->mq_msgsize <= 0 || attr->mq_msgsize > MQ_MSGSIZE_MAX) {
+			*errno = -EINVAL;
+			return NULL;
+		}
+	}
+
+	mn = NULL;
+	for(n = 0; n < NR_MQUEUES; n++) {
+		if(!mqueue_table[n].name) {
+			mn = &mqueue_table[n];
+			break;
+		}
+	}
+	if(!mn) {
+		*errno = -ENOSPC;
+		return NULL;
+	}
+
+	if(!(fs = get_filesystem("mqueue"))) {
+		printk("WARNING: %s(): mqueue filesystem is not registered!\n", __FUNCTION__);
+		*errno = -EINVAL;
+		return NULL;
+	}
+	if(!(mn->name = (char *)kmalloc(strlen(name) + 1))) {
+		*errno = -ENOMEM;
+		return NULL;
+	}
+	if(!(i = ialloc(&fs->mp->sb, S_IFREG | (mode & ~current->umask & (S_IRWXU | S_IRWXG | S_IRWXO))))) {
+		kfree((unsigned int)mn->name);
+		mn->name = NULL;
+		*errno = -ENOMEM;
+		return NULL;
+	}
+	strcpy(mn->name, name);
+	mn->inode = i;
+	i->i_nlink = 1;
+	i->u.mqueue.i_maxmsg = attr ? attr->mq_maxmsg : MQ_MAXMSG_DEF;
+	i->u.mqueue.i_msgsize = attr ? attr->mq_msgsize : MQ_MSGSIZE_DEF;
+	return i;
+}
+
+/*
+ * Sleeps on 'address' until a wakeup, a signal or the absolute time in
+ * 'abs_timeout' is reached. It must be called with interrupts disabled so
+ * that the wakeup can't be lost between the test and the sleep.
+ */
+static int mqueue_sleep(void *address, const struct timespec *abs_timeout)
+{
+	int ticks;
+
+	if(abs_timeout) {
+		if(abs_timeout->tv_sec < CURRENT_TIME) {
+			return -ETIMEDOUT;
+		}
+		ticks = (abs_timeout->tv_sec - CURRENT_TIME) * HZ;
+		ticks += abs_timeout->tv_nsec / (1000000000L / HZ);
+		ticks -= CURRENT_TICKS % HZ;
+		if(ticks <= 0) {
+			return -ETIMEDOUT;
+		}
+		current->timeout = ticks;
+	}
+	if(sleep(address, PROC_INTERRUPTIBLE)) {
+		current->timeout = 0;
+		return -EINTR;
+	}
+	if(abs_timeout && !current->timeout) {
+		return -ETIMEDOUT;
+	}
+	current->timeout = 0;
+	return 0;
+}
+
+int mqueue_open(const char *name, int oflag, __mode_t mode, struct mq_attr *attr)
+{
+	struct mqueue_name *mn;
+	struct inode *i;
+	int fd, ufd, mask;
+	int errno;
+
+	if((errno = check_name(name))) {
+		return errno;
+	}
+	switch(oflag & O_ACCMODE) {
+		case O_RDONLY:
+			mask = TO_READ;
+			break;
+		case O_WRONLY:
+			mask = TO_WRITE;
+			break;
+		case O_RDWR:
+			mask = TO_READ | TO_WRITE;
+			break;
+		default:
+			return -EINVAL;
+	}
+
+	lock_resource(&mqueue_resource);
+	if((mn = find_name(name))) {
+		if((oflag & O_CREAT) && (oflag & O_EXCL)) {
+			unlock_resource(&mqueue_resource);
+			return -EEXIST;
+		}
+		i = mn->inode;
+		if((errno = check_permission(mask, i))) {
+			unlock_resource(&mqueue_resource);
+			return errno;
+		}
+	} else {
+		if(!(oflag & O_CREAT)) {
+			unlock_resource(&mqueue_resource);
+			return -ENOENT;
+		}
+		if(!(i = create_queue(name, mode, attr, &errno))) {
+			unlock_resource(&mqueue_resource);
+			return errno;
+		}
+	}
+	i->count++;
+	unlock_resource(&mqueue_resource);
+
+	if((fd = get_new_fd(i)) < 0) {
+		iput(i);
+		return -ENFILE;
+	}
+	if((ufd = get_new_user_fd(0)) < 0) {
+		release_fd(fd);
+		iput(i);
+		return -EMFILE;
+	}
+	current->files->fd[ufd] = fd;
+	current->files->fd_flags[ufd] |= FD_CLOEXEC;
+	fd_table[fd].flags = oflag & (O_ACCMODE | O_NONBLOCK);
+	return ufd;
+}
+
+int mqueue_unlink(const char *name)
+{
+	struct mqueue_name *mn;
+	struct inode *i;
+	int errno;
+
+	if((errno = check_name(name))) {
+		return errno;
+	}
+
+	lock_resource(&mqueue_resource);
+	if(!(mn = find_name(name))) {
+		unlock_resource(&mqueue_resource);
+		return -ENOENT;
+	}
+	i = mn->inode;
+	if(check_user_permission(i)) {
+		unlock_resource(&mqueue_resource);
+		return -EACCES;
+	}
+	kfree((unsigned int)mn->name);
+	mn->name = NULL;
+	mn->inode = NULL;
+	unlock_resource(&mqueue_resource);
+
+	/* the messages are freed once the last descriptor is closed */
+	i->i_nlink = 0;
+	iput(i);
+	return 0;
+}
+
+int mqueue_send(struct fd *f, const char *buffer, __size_t len, unsigned int prio, const struct timespec *abs_timeout)
+{
+	struct inode *i;
+	struct mq_msg *m, **h;
+	unsigned int flags;
+	int errno;
+
+	i = f->inode;
+	if((f->flags & O_ACCMODE) == O_RDONLY) {
+		return -EBADF;
+	}
+	if(len > i->u.mqueue.i_msgsize) {
+		return -EMSGSIZE;
+	}
+	if(prio >= MQ_PRIO_MAX) {
+		return -EINVAL;
+	}
+
+	/* the text is copied before waiting for room in the queue */
+	if(!(m = (struct mq_msg *)kmalloc(sizeof(struct mq_msg) + len))) {
+		return -ENOMEM;
+	}
+	m->prio = prio;
+	m->len = len;
+	memcpy_b(m + 1, buffer, len);
+
+	SAVE_FLAGS(flags); CLI();
+	while(i->u.mqueue.i_curmsgs >= i->u.mqueue.i_maxmsg) {
+		if(f->flags & O_NONBLOCK) {
+			errno = -EAGAIN;
+		} else {
+			errno = mqueue_sleep(MQ_SEND_WAIT(i), abs_timeout);
+		}
+		if(errno) {
+			RESTORE_FLAGS(flags);
+			kfree((unsigned int)m);
+			return errno;
+		}
+	}
+
+	/* behind all the messages of the same or higher priority */
+	h = &i->u.mqueue.i_msgs;
+	while(*h && (*h)->prio >= prio) {
+		h = &(*h)->next;
+	}
+	m->next = *h;
+	*h = m;
+	i->u.mqueue.i_curmsgs++;
+	i->i_mtime = CURRENT_TIME;
+	RESTORE_FLAGS(flags);
+
+	wakeup(MQ_RECV_WAIT(i));
+	wakeup(&do_select);
+	return 0;
+}
+
+int mqueue_receive(struct fd *f, char *buffer, __size_t len, unsigned int *prio, const struct timespec *abs_timeout)
+{
+	struct inode *i;
+	struct mq_msg *m;
+	unsigned int flags;
+	int errno;
+
+	i = f->inode;
+	if((f->flags & O_ACCMODE) == O_WRONLY) {
+		return -EBADF;
+	}
+	if(len < i->u.mqueue.i_msgsize) {
+		return -EMSGSIZE;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	while(!i->u.mqueue.i_msgs) {
+		if(f->flags & O_NONBLOCK) {
+			errno = -EAGAIN;
+		} else {
+			errno = mqueue_sleep(MQ_RECV_WAIT(i), abs_timeout);
+		}
+		if(errno) {
+			RESTORE_FLAGS(flags);
+			return errno;
+		}
+	}
+	m = i->u.mqueue.i_msgs;
+	i->u.mqueue.i_msgs = m->next;
+	i->u.mqueue.i_curmsgs--;
+	i->i_atime = CURRENT_TIME;
+	RESTORE_FLAGS(flags);
+
+	wakeup(MQ_SEND_WAIT(i));
+	wakeup(&do_select);
+
+	memcpy_b(buffer, m + 1, m->len);
+	if(prio) {
+		*prio = m->prio;
+	}
+	len = m->len;
+	kfree((unsigned int)m);
+	return len;
+}
+#endif /* CONFIG_POSIX_MQUEUE */
@@ -0,0 +1,138 @@
+/*
+ * fiwix/fs/mqueue/super.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_mqueue.h>
+#include <fiwix/stat.h>
+#include <fiwix/process.h>
+#include <fiwix/mm.h>
+#include <fiwix/sched.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_POSIX_MQUEUE
+static unsigned int i_counter;
+
+struct fs_operations mqueue_fsop = {
+	FSOP_KERN_MOUNT,
+	MQUEUE_DEV,
+
+	NULL,			/* open */
+	mqueue_close,
+	NULL,			/* read */
+	NULL,			/* write */
+	NULL,			/* ioctl */
+	NULL,			/* llseek */
+	NULL,			/* readdir */
+	NULL,			/* readdir64 */
+	NULL,			/* mmap */
+	mqueue_select,
+
+	NULL,			/* readlink */
+	NULL,			/* followlink */
+	NULL,			/* bmap */
+	NULL,			/* lookup */
+	NULL,			/* rmdir */
+	NULL,			/* link */
+	NULL,			/* unlink */
+	NULL,			/* symlink */
+	NULL,			/* mkdir */
+	NULL,			/* mknod */
+	NULL,			/* truncate */
+	NULL,			/* create */
+	NULL,			/* rename */
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	NULL,			/* read_inode */
+	NULL,			/* write_inode */
+	mqueue_ialloc,
+	mqueue_ifree,
+	NULL,			/* statfs */
+	mqueue_read_superblock,
+	NULL,			/* remount_fs */
+	NULL,			/* write_superblock */
+	NULL			/* release_superblock */
+};
+
+int mqueue_close(struct inode *i, struct fd *f)
+{
+	return 0;
+}
+
+int mqueue_select(struct inode *i, struct fd *f, int flag)
+{
+	switch(flag) {
+		case SEL_R:
+			if(i->u.mqueue.i_curmsgs) {
+				return 1;
+			}
+			break;
+		case SEL_W:
+			if(i->u.mqueue.i_curmsgs < i->u.mqueue.i_maxmsg) {
+				return 1;
+			}
+			break;
+	}
+	return 0;
+}
+
+int mqueue_ialloc(struct inode *i, int mode)
+{
+	struct superblock *sb = i->sb;
+
+	superblock_lock(sb);
+	i_counter++;
+	superblock_unlock(sb);
+
+	i->i_mode = mode;
+	i->dev = i->rdev = sb->dev;
+	i->fsop = &mqueue_fsop;
+	i->inode = i_counter;
+	i->count = 1;
+	i->i_uid = current->euid;
+	i->i_gid = current->egid;
+	i->i_atime = CURRENT_TIME;
+	i->i_mtime = CURRENT_TIME;
+	i->i_ctime = CURRENT_TIME;
+	memset_b(&i->u.mqueue, 0, sizeof(struct mqueue_inode));
+	return 0;
+}
+
+/* the queue goes away once it has no name and nobody has it open */
+void mqueue_ifree(struct inode *i)
+{
+	struct mq_msg *m;
+
+	while((m = i->u.mqueue.i_msgs)) {
+		i->u.mqueue.i_msgs = m->next;
+		kfree((unsigned int)m);
+	}
+	i->u.mqueue.i_curmsgs = 0;
+}
+
+int mqueue_read_superblock(__dev_t dev, struct superblock *sb)
+{
+	superblock_lock(sb);
+	sb->dev = dev;
+	sb->fsop = &mqueue_fsop;
+	sb->s_blocksize = BLKSIZE_1K;
+	i_counter = 0;
+	superblock_unlock(sb);
+	return 0;
+}
+
+int mqueue_init(void)
+{
+	return register_filesystem("mqueue", &mqueue_fsop);
+}
+#endif /* CONFIG_POSIX_MQUEUE */
@@ -15,106 +15,332 @@
 #include <fiwix/ioctl.h>
 #include <fiwix/sleep.h>
 #include <fiwix/sched.h>
+#include <fiwix/process.h>
+#include <fiwix/mm.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
-static struct resource pipe_resource = { 0, 0 };
+/* rounds up the size to a power of 2 number of pages */
+static unsigned int ring_size(unsigned int size)
+{
+	unsigned int n;
+
+	for(n = PAGE_SIZE; n < size; n <<= 1);
+	return n;
+}
+
+static int ring_alloc(struct pipefs_inode *p, unsigned int size)
+{
+	unsigned int nr_bufs;
+
+	size = ring_size(size);
+	nr_bufs = size >> PAGE_SHIFT;
+	if(!(p->i_bufs = (struct pipe_buffer *)kmalloc(nr_bufs * sizeof(struct pipe_buffer)))) {
+		return -ENOMEM;
+	}
+	memset_b(p->i_bufs, 0, nr_bufs * sizeof(struct pipe_buffer));
+	p->i_bufsize = size;
+	p->i_curbuf = 0;
+	p->i_nrbufs = 0;
+	p->i_reserved = 0;
+	return 0;
+}
+
+static void ring_free(struct pipefs_inode *p)
+{
+	unsigned int n, mask;
+
+	if(!p->i_bufs) {
+		return;
+	}
+	mask = (p->i_bufsize >> PAGE_SHIFT) - 1;
+	for(n = 0; n < p->i_nrbufs; n++) {
+		release_page(p->i_bufs[(p->i_curbuf + n) & mask].page);
+	}
+	kfree((unsigned int)p->i_bufs);
+	p->i_bufs = NULL;
+	p->i_nrbufs = 0;
+}
+
+/* returns the number of bytes that can be written without sleeping */
+static unsigned int pipe_space(struct inode *i)
+{
+	struct pipe_buffer *buf;
+	unsigned int space;
+
+	space = PIPE_FREE_BUFS(i) << PAGE_SHIFT;
+	if(i->u.pipefs.i_nrbufs) {
+		buf = &i->u.pipefs.i_bufs[PIPE_BUF_IDX(i, i->u.pipefs.i_nrbufs - 1)];
+		if(buf->flags & PIPE_BUF_PRIVATE) {
+			space += PAGE_SIZE - (buf->offset + buf->len);
+		}
+	}
+	return space;
+}
+
+/*
+ * Appends 'count' bytes to the pipe, filling first the room left in the last
+ * buffer if the page is owned by the pipe. The caller must make sure that
+ * they fit.
+ */
+static int pipe_copy_in(struct inode *i, const char *buffer, unsigned int count)
+{
+	struct pipe_buffer *buf;
+	unsigned int addr, n, done;
+
+	for(done = 0; done < count; done += n) {
+		buf = NULL;
+		if(i->u.pipefs.i_nrbufs) {
+			buf = &i->u.pipefs.i_bufs[PIPE_BUF_IDX(i, i->u.pipefs.i_nrbufs - 1)];
+			if(!(buf->flags & PIPE_BUF_PRIVATE) || buf->offset + buf->len == PAGE_SIZE) {
+				buf = NULL;
+			}
+		}
+		if(!buf) {
+			if(!(addr = kmalloc(PAGE_SIZE))) {
+				return done ? done : -ENOMEM;
+			}
+			buf = &i->u.pipefs.i_bufs[PIPE_BUF_IDX(i, i->u.pipefs.i_nrbufs)];
+			buf->page = &page_table[V2P(addr) >> PAGE_SHIFT];
+			buf->offset = 0;
+			buf->len = 0;
+			buf->flags = PIPE_BUF_PRIVATE;
+			i->u.pipefs.i_nrbufs++;
+		}
+		n = MIN(PAGE_SIZE - (buf->offset + buf->len), count - done);
+		memcpy_b(buf->page->data + buf->offset + buf->len, buffer + done, n);
+		buf->len += n;
+		i->i_size += n;
+	}
+	return done;
+}
+
+static int pipe_copy_out(struct inode *i, char *buffer, unsigned int count)
+{
+	struct pipe_buffer *buf;
+	unsigned int n, done;
+
+	for(done = 0; done < count && i->u.pipefs.i_nrbufs; done += n) {
+		buf = &i->u.pipefs.i_bufs[i->u.pipefs.i_curbuf];
+		n = MIN(buf->len, count - done);
+		memcpy_b(buffer + done, buf->page->data + buf->offset, n);
+		pipe_consume(i, n);
+	}
+	return done;
+}
+
+/*
+ * Waits until there is data in the pipe and returns 1 with the pipe locked,
+ * 0 if there are no writers left, or a negative error.
+ */
+int pipe_lock_data(struct inode *i, int nonblock)
+{
+	for(;;) {
+		lock_resource(&i->u.pipefs.i_lock);
+		if(i->u.pipefs.i_nrbufs) {
+			return 1;
+		}
+		unlock_resource(&i->u.pipefs.i_lock);
+		if(!i->u.pipefs.i_writers) {
+			return 0;
+		}
+		if(nonblock) {
+			return -EAGAIN;
+		}
+		if(sleep(PIPE_READ_WAIT(i), PROC_INTERRUPTIBLE)) {
+			/* don't lose a wakeup that might have been for us */
+			wakeup_one(PIPE_READ_WAIT(i));
+			return -EINTR;
+		}
+	}
+}
+
+/*
+ * Waits until there is a free buffer in the pipe and returns 1 with the pipe
+ * locked, or a negative error.
+ */
+int pipe_lock_space(struct inode *i, int nonblock)
+{
+	for(;;) {
+		if(!i->u.pipefs.i_readers) {
+			send_sig(current, SIGPIPE);
+			return -EPIPE;
+		}
+		lock_resource(&i->u.pipefs.i_lock);
+		if(PIPE_FREE_BUFS(i)) {
+			return 1;
+		}
+		unlock_resource(&i->u.pipefs.i_lock);
+		if(nonblock) {
+			return -EAGAIN;
+		}
+		if(sleep(PIPE_WRITE_WAIT(i), PROC_INTERRUPTIBLE)) {
+			wakeup_one(PIPE_WRITE_WAIT(i));
+			return -EINTR;
+		}
+	}
+}
+
+/*
+ * Queues a reference to 'len' bytes of the page 'pg' at the tail of the pipe.
+ * The caller holds the pipe locked with a free buffer, and hands over its
+ * reference to the page.
+ */
+void pipe_add_page(struct inode *i, struct page *pg, unsigned int offset, unsigned int len, unsigned int flags)
+{
+	struct pipe_buffer *buf;
+
+	buf = &i->u.pipefs.i_bufs[PIPE_BUF_IDX(i, i->u.pipefs.i_nrbufs)];
+	buf->page = pg;
+	buf->offset = offset;
+	buf->len = len;
+	buf->flags = flags;
+	i->u.pipefs.i_nrbufs++;
+	i->i_size += len;
+}
+
+/* discards 'count' bytes from the head of the pipe */
+void pipe_consume(struct inode *i, unsigned int count)
+{
+	struct pipe_buffer *buf;
+	unsigned int n;
+
+	while(count && i->u.pipefs.i_nrbufs) {
+		buf = &i->u.pipefs.i_bufs[i->u.pipefs.i_curbuf];
+		n = MIN(buf->len, count);
+		buf->offset += n;
+		buf->len -= n;
+		i->i_size -= n;
+		count -= n;
+		if(!buf->len) {
+			release_page(buf->page);
+			i->u.pipefs.i_curbuf = PIPE_BUF_IDX(i, 1);
+			i->u.pipefs.i_nrbufs--;
+		}
+	}
+}
+
+int pipefs_alloc(struct inode *i, unsigned int size)
+{
+	return ring_alloc(&i->u.pipefs, size);
+}
+
+void pipefs_free(struct inode *i)
+{
+	ring_free(&i->u.pipefs);
+}
+
+static int set_size(struct inode *i, unsigned int size)
+{
+	struct pipefs_inode new;
+	unsigned int n;
+	int errno;
+
+	if(size > PIPE_MAX_SIZE && !IS_SUPERUSER) {
+		return -EPERM;
+	}
+	/* the ring is limited by the size of its array of buffers */
+	if(!size || size > (PAGE_SIZE / sizeof(struct pipe_buffer)) * PAGE_SIZE) {
+		return -EINVAL;
+	}
+
+	lock_resource(&i->u.pipefs.i_lock);
+	if((ring_size(size) >> PAGE_SHIFT) < i->u.pipefs.i_nrbufs + i->u.pipefs.i_reserved) {
+		unlock_resource(&i->u.pipefs.i_lock);
+		return -EBUSY;
+	}
+	if((errno = ring_alloc(&new, size))) {
+		unlock_resource(&i->u.pipefs.i_lock);
+		return errno;
+	}
+
+	/* move the buffers to the beginning of the new ring */
+	for(n = 0; n < i->u.pipefs.i_nrbufs; n++) {
+		new.i_bufs[n] = i->u.pipefs.i_bufs[PIPE_BUF_IDX(i, n)];
+	}
+	kfree((unsigned int)i->u.pipefs.i_bufs);
+	i->u.pipefs.i_bufs = new.i_bufs;
+	i->u.pipefs.i_bufsize = new.i_bufsize;
+	i->u.pipefs.i_curbuf = 0;
+	unlock_resource(&i->u.pipefs.i_lock);
+	wakeup(PIPE_WRITE_WAIT(i));
+	return new.i_bufsize;
+}
+
+/* F_SETPIPE_SZ and F_GETPIPE_SZ for fcntl() and fcntl64() */
+int pipefs_fcntl(struct inode *i, int cmd, unsigned int arg)
+{
+	if(!S_ISFIFO(i->i_mode)) {
+		return -EBADF;
+	}
+	if(cmd == F_GETPIPE_SZ) {
+		return i->u.pipefs.i_bufsize;
+	}
+	return set_size(i, arg);
+}
 
 int pipefs_close(struct inode *i, struct fd *f)
 {
 	if((f->flags & O_ACCMODE) == O_RDONLY) {
 		if(!--i->u.pipefs.i_readers) {
 			wakeup(&do_select);
-			wakeup(&pipefs_write);
+			wakeup(PIPE_WRITE_WAIT(i));
 		}
 	}
 	if((f->flags & O_ACCMODE) == O_WRONLY) {
 		if(!--i->u.pipefs.i_writers) {
 			wakeup(&do_select);
-			wakeup(&pipefs_read);
+			wakeup(PIPE_READ_WAIT(i));
 		}
 	}
 	if((f->flags & O_ACCMODE) == O_RDWR) {
 		if(!--i->u.pipefs.i_readers) {
 			wakeup(&do_select);
-			wakeup(&pipefs_write);
+			wakeup(PIPE_WRITE_WAIT(i));
 		}
 		if(!--i->u.pipefs.i_writers) {
 			wakeup(&do_select);
-			wakeup(&pipefs_read);
+			wakeup(PIPE_READ_WAIT(i));
 		}
 	}
+
+	/* the data left in a FIFO is discarded on its last close */
+	if(!i->u.pipefs.i_readers && !i->u.pipefs.i_writers) {
+		pipefs_free(i);
+		i->i_size = 0;
+	}
 	return 0;
 }
 
 int pipefs_read(struct inode *i, struct fd *f, char *buffer, __size_t count)
 {
-	__size_t bytes_read;
-	__size_t n, limit;
-	char *data;
+	int n;
 
-	bytes_read = 0;
-	data = i->u.pipefs.i_data;
+	if(!count) {
+		return 0;
+	}
 
-	while(count) {
-		if(i->u.pipefs.i_writeoff) {
-			if(i->u.pipefs.i_readoff >= i->u.pipefs.i_writeoff) {
-				limit = PIPE_BUF - i->u.pipefs.i_readoff;
-			} else {
-				limit = i->u.pipefs.i_writeoff - i->u.pipefs.i_readoff;
-			}
-		} else {
-			limit = PIPE_BUF - i->u.pipefs.i_readoff;
-		}
-		n = MIN(limit, count);
-		if(i->i_size && n) {
-			lock_resource(&pipe_resource);
-			memcpy_b(buffer + bytes_read, data + i->u.pipefs.i_readoff, n);
-			bytes_read += n;
-			i->u.pipefs.i_readoff += n;
-			i->i_size -= n;
-			if(i->u.pipefs.i_writeoff >= PIPE_BUF) {
-				i->u.pipefs.i_writeoff = 0;
-			}
-			unlock_resource(&pipe_resource);
-			wakeup(&do_select);
-			wakeup(&pipefs_write);
-			break;
-		} else {
-			if(i->u.pipefs.i_writers) {
-				if(f->flags & O_NONBLOCK) {
-					return -EAGAIN;
-				}
-				if(sleep(&pipefs_read, PROC_INTERRUPTIBLE)) {
-					return -EINTR;
-				}
-			} else {
-				if(i->i_size) {
-					if(i->u.pipefs.i_readoff >= PIPE_BUF) {
-						i->u.pipefs.i_readoff = 0;
-						continue;
-					}
-				}
-				break;
-			}
-		}
+	if((n = pipe_lock_data(i, f->flags & O_NONBLOCK)) <= 0) {
+		return n;
 	}
-	if(!i->i_size) {
-		i->u.pipefs.i_readoff = 0;
-		i->u.pipefs.i_writeoff = 0;
+	n = pipe_copy_out(i, buffer, count);
+	if(i->u.pipefs.i_nrbufs) {
+		/* pass the remaining data to the next reader */
+		wakeup_one(PIPE_READ_WAIT(i));
 	}
-	return bytes_read;
+	unlock_resource(&i->u.pipefs.i_lock);
+	wakeup(&do_select);
+	wakeup_one(PIPE_WRITE_WAIT(i));
+	return n;
 }
 
 int pipefs_write(struct inode *i, struct fd *f, const char *buffer, __size_t count)
 {
 	__size_t bytes_written;
-	__size_t n;
-	char *data;
-	int limit;
+	__size_t n, left, space, last_space;
+	int errno;
 
-	bytes_written = 0;
-	data = i->u.pipefs.i_data;
+	bytes_written = last_space = 0;
 
 	while(bytes_written < count) {
 		/* if there are no readers then send signal and return */
@@ -123,47 +349,50 @@ int pipefs_write(struct inode *i, struct fd *f, const char *buffer, __size_t cou
 			return -EPIPE;
 		}
 
-		if(i->u.pipefs.i_readoff) {
-			if(i->u.pipefs.i_writeoff <= i->u.pipefs.i_readoff) {
-				limit = i->u.pipefs.i_readoff;
-			} else {
-				limit = PIPE_BUF;
-			}
-		} else {
-			limit = PIPE_BUF;
-		}
-
-		n = MIN((count - bytes_written), (limit - i->u.pipefs.i_writeoff));
+		lock_resource(&i->u.pipefs.i_lock);
+		left = count - bytes_written;
+		space = pipe_space(i);
 
 		/*
 		 * POSIX requires that any write operation involving less than
 		 * or equal to PIPE_BUF bytes, must be automatically executed
 		 * and finished without being interleaved with write operations
 		 * of other processes to the same pipe.
-		*/
-		if(n && n <= PIPE_BUF) {
-			lock_resource(&pipe_resource);
-			memcpy_b(data + i->u.pipefs.i_writeoff, buffer + bytes_written, n);
-			bytes_written += n;
-			i->u.pipefs.i_writeoff += n;
-			i->i_size += n;
-			if(i->u.pipefs.i_readoff >= PIPE_BUF) {
-				i->u.pipefs.i_readoff = 0;
+		 */
+		if(space && (left > PIPE_BUF || left <= space)) {
+			n = MIN(left, space);
+			errno = pipe_copy_in(i, buffer + bytes_written, n);
+			unlock_resource(&i->u.pipefs.i_lock);
+			if(errno > 0) {
+				bytes_written += errno;
+				wakeup(&do_select);
+				wakeup_one(PIPE_READ_WAIT(i));
+			}
+			if(errno < (int)n) {
+				return bytes_written ? bytes_written : errno;
 			}
-			unlock_resource(&pipe_resource);
-			wakeup(&do_select);
-			wakeup(&pipefs_read);
 			continue;
 		}
+		unlock_resource(&i->u.pipefs.i_lock);
+
+		/*
+		 * The space freed is not enough for this atomic write but it
+		 * might be for another writer, so pass the wakeup on. Doing it
+		 * only when the space has changed keeps two writers that don't
+		 * fit from waking up each other forever.
+		 */
+		if(space && space != last_space) {
+			wakeup_one(PIPE_WRITE_WAIT(i));
+		}
+		last_space = space;
 
-		wakeup(&do_select);
-		wakeup(&pipefs_read);
 		if(!(f->flags & O_NONBLOCK)) {
-			if(sleep(&pipefs_write, PROC_INTERRUPTIBLE)) {
-				return -EINTR;
+			if(sleep(PIPE_WRITE_WAIT(i), PROC_INTERRUPTIBLE)) {
+				wakeup_one(PIPE_WRITE_WAIT(i));
+				return bytes_written ? bytes_written : -EINTR;
 			}
 		} else {
-			return -EAGAIN;
+			return bytes_written ? bytes_written : -EAGAIN;
 		}
 	}
 	return bytes_written;
@@ -205,10 +434,10 @@ int pipefs_select(struct inode *i, struct fd *f, int flag)
 			break;
 		case SEL_W:
 			/*
-			 * if i->i_size == PIPE_BUF && !i->u.pipefs.i_readers
+			 * if the pipe is full && !i->u.pipefs.i_readers
 			 * should also return 1?
 			 */
-			if(i->i_size < PIPE_BUF || !i->u.pipefs.i_readers) {
+			if(pipe_space(i) || !i->u.pipefs.i_readers) {
 				return 1;
 			}
 			break;
@@ -0,0 +1,392 @@
+/*
+ * fiwix/fs/pipefs/splice.c
+ *
+ * Copyright 2018-2022, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_pipe.h>
+#include <fiwix/stat.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/sleep.h>
+#include <fiwix/sched.h>
+#include <fiwix/process.h>
+#include <fiwix/segments.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+/* always lock two pipes in the same order to avoid deadlocks */
+static void lock_pipes(struct inode *a, struct inode *b)
+{
+	if(a < b) {
+		lock_resource(&a->u.pipefs.i_lock);
+		lock_resource(&b->u.pipefs.i_lock);
+	} else {
+		lock_resource(&b->u.pipefs.i_lock);
+		lock_resource(&a->u.pipefs.i_lock);
+	}
+}
+
+static void unlock_pipes(struct inode *a, struct inode *b)
+{
+	unlock_resource(&a->u.pipefs.i_lock);
+	unlock_resource(&b->u.pipefs.i_lock);
+}
+
+/* returns the page mapped at the user address 'addr', if any */
+static struct page *get_user_page(unsigned int addr)
+{
+	unsigned int *pgdir;
+	unsigned int pte;
+	struct page *pg;
+
+	pgdir = (unsigned int *)P2V(current->tss.cr3);
+	if(!(pgdir[GET_PGDIR(addr)] & PAGE_PRESENT)) {
+		return NULL;
+	}
+	pte = get_mapped_addr(current, addr);
+	if(!(pte & PAGE_PRESENT) || !is_valid_page(pte >> PAGE_SHIFT)) {
+		return NULL;
+	}
+	pg = &page_table[pte >> PAGE_SHIFT];
+	if(pg->flags & PAGE_RESERVED) {
+		return NULL;
+	}
+	return pg;
+}
+
+/*
+ * Moves (or duplicates if 'dup' is set) up to 'len' bytes from the pipe 'i'
+ * to the pipe 'o' without copying any data, just the references to their
+ * pages.
+ */
+static int move_buffers(struct inode *i, struct inode *o, __size_t len, int nonblock, int dup)
+{
+	struct pipe_buffer *buf;
+	unsigned int n, idx;
+	int total;
+
+	for(;;) {
+		lock_pipes(i, o);
+		if(!i->u.pipefs.i_nrbufs) {
+			unlock_pipes(i, o);
+			if(!i->u.pipefs.i_writers) {
+				return 0;
+			}
+			if(nonblock) {
+				return -EAGAIN;
+			}
+			if(sleep(PIPE_READ_WAIT(i), PROC_INTERRUPTIBLE)) {
+				wakeup_one(PIPE_READ_WAIT(i));
+				return -EINTR;
+			}
+			continue;
+		}
+		if(!o->u.pipefs.i_readers) {
+			unlock_pipes(i, o);
+			send_sig(current, SIGPIPE);
+			return -EPIPE;
+		}
+		if(!PIPE_FREE_BUFS(o)) {
+			unlock_pipes(i, o);
+			if(nonblock) {
+				return -EAGAIN;
+			}
+			if(sleep(PIPE_WRITE_WAIT(o), PROC_INTERRUPTIBLE)) {
+				wakeup_one(PIPE_WRITE_WAIT(o));
+				return -EINTR;
+			}
+			continue;
+		}
+		break;
+	}
+
+	total = idx = 0;
+	while(len && idx < i->u.pipefs.i_nrbufs && PIPE_FREE_BUFS(o)) {
+		buf = &i->u.pipefs.i_bufs[PIPE_BUF_IDX(i, idx)];
+		n = MIN(buf->len, len);
+
+		/*
+		 * Only a whole buffer that is moved keeps the ownership of its
+		 * page, in any other case the page ends up being shared.
+		 */
+		buf->page->count++;
+		pipe_add_page(o, buf->page, buf->offset, n, (!dup && n == buf->len) ? buf->flags : 0);
+		if(dup) {
+			idx++;
+		} else {
+			pipe_consume(i, n);
+		}
+		total += n;
+		len -= n;
+	}
+	if(i->u.pipefs.i_nrbufs) {
+		wakeup_one(PIPE_READ_WAIT(i));
+	}
+	unlock_pipes(i, o);
+	wakeup(&do_select);
+	wakeup_one(PIPE_READ_WAIT(o));
+	if(!dup) {
+		wakeup_one(PIPE_WRITE_WAIT(i));
+	}
+	return total;
+}
+
+/*
+ * Fills the pipe 'o' with data from the file 'f'. Regular files that use the
+ * page cache just hand over references to their pages, the rest are read
+ * directly into new pages of the pipe.
+ */
+static int splice_to_pipe(struct fd *f, struct inode *o, __size_t len, int nonblock)
+{
+	struct inode *i;
+	struct page *pg;
+	unsigned int addr, poffset, n;
+	int total, errno;
+
+	i = f->inode;
+	if(!i->fsop || !i->fsop->read) {
+		return -EINVAL;
+	}
+
+	total = 0;
+	while(len) {
+		/* don't block once some data has been transferred */
+		if((errno = pipe_lock_space(o, nonblock || total)) < 0) {
+			return total ? total : errno;
+		}
+		if(S_ISREG(i->i_mode) && i->fsop->read == file_read) {
+			inode_lock(i);
+			if(f->offset >= i->i_size) {
+				inode_unlock(i);
+				unlock_resource(&o->u.pipefs.i_lock);
+				break;
+			}
+			poffset = f->offset & (PAGE_SIZE - 1);
+			n = MIN(PAGE_SIZE - poffset, len);
+			n = MIN(n, i->i_size - f->offset);
+			if((errno = get_file_page(i, f->offset & PAGE_MASK, &pg))) {
+				inode_unlock(i);
+				unlock_resource(&o->u.pipefs.i_lock);
+				return total ? total : errno;
+			}
+			f->offset += n;
+			inode_unlock(i);
+			pipe_add_page(o, pg, poffset, n, 0);
+		} else {
+			if(!(addr = kmalloc(PAGE_SIZE))) {
+				unlock_resource(&o->u.pipefs.i_lock);
+				return total ? total : -ENOMEM;
+			}
+			pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+
+			/*
+			 * The read may block for as long as the other end wants,
+			 * so it's done with the pipe unlocked and a buffer kept
+			 * reserved for the data.
+			 */
+			o->u.pipefs.i_reserved++;
+			unlock_resource(&o->u.pipefs.i_lock);
+			errno = i->fsop->read(i, f, pg->data, MIN(len, PAGE_SIZE));
+			lock_resource(&o->u.pipefs.i_lock);
+			o->u.pipefs.i_reserved--;
+			if(errno <= 0) {
+				kfree(addr);
+				unlock_resource(&o->u.pipefs.i_lock);
+				wakeup_one(PIPE_WRITE_WAIT(o));
+				return total ? total : errno;
+			}
+			n = errno;
+			pipe_add_page(o, pg, 0, n, PIPE_BUF_PRIVATE);
+		}
+		unlock_resource(&o->u.pipefs.i_lock);
+		wakeup(&do_select);
+		wakeup_one(PIPE_READ_WAIT(o));
+		total += n;
+		len -= n;
+	}
+	return total;
+}
+
+/*
+ * Drains the pipe 'i' into the file 'f', writing straight from its pages.
+ * The write may block for as long as the other end wants, so the data is
+ * taken out of the pipe and written with the pipe unlocked. Its buffer is
+ * kept reserved to put back at the head whatever couldn't be written.
+ */
+static int splice_from_pipe(struct inode *i, struct fd *f, __size_t len, int nonblock)
+{
+	struct pipe_buffer *buf, tmp;
+	struct inode *o;
+	unsigned int n, done;
+	int total, errno;
+
+	o = f->inode;
+	if(!o->fsop || !o->fsop->write) {
+		return -EINVAL;
+	}
+
+	total = 0;
+	while(len) {
+		if((errno = pipe_lock_data(i, nonblock || total)) <= 0) {
+			return total ? total : errno;
+		}
+		buf = &i->u.pipefs.i_bufs[i->u.pipefs.i_curbuf];
+		n = MIN(buf->len, len);
+		tmp = *buf;
+		tmp.page->count++;
+		pipe_consume(i, n);
+		i->u.pipefs.i_reserved++;
+		unlock_resource(&i->u.pipefs.i_lock);
+
+		errno = o->fsop->write(o, f, tmp.page->data + tmp.offset, n);
+
+		lock_resource(&i->u.pipefs.i_lock);
+		i->u.pipefs.i_reserved--;
+		if(errno < (int)n) {
+			done = errno > 0 ? errno : 0;
+			i->u.pipefs.i_curbuf = PIPE_BUF_IDX(i, PIPE_NR_BUFS(i) - 1);
+			buf = &i->u.pipefs.i_bufs[i->u.pipefs.i_curbuf];
+			buf->page = tmp.page;
+			buf->offset = tmp.offset + done;
+			buf->len = n - done;
+			buf->flags = 0;
+			i->u.pipefs.i_nrbufs++;
+			i->i_size += n - done;
+			wakeup_one(PIPE_READ_WAIT(i));
+		} else {
+			release_page(tmp.page);
+		}
+		unlock_resource(&i->u.pipefs.i_lock);
+		if(errno > 0) {
+			wakeup(&do_select);
+			wakeup_one(PIPE_WRITE_WAIT(i));
+			total += errno;
+			len -= errno;
+		}
+		if(errno < (int)n) {
+			return total ? total : errno;
+		}
+	}
+	return total;
+}
+
+int pipefs_splice(struct fd *fin, __loff_t *off_in, struct fd *fout, __loff_t *off_out, __size_t len, unsigned int flags)
+{
+	struct inode *i, *o;
+	struct fd fdt;
+	int nonblock, retval;
+
+	i = fin->inode;
+	o = fout->inode;
+	nonblock = flags & SPLICE_F_NONBLOCK;
+
+	if(S_ISFIFO(i->i_mode) && S_ISFIFO(o->i_mode)) {
+		if(i == o) {
+			return -EINVAL;
+		}
+		return move_buffers(i, o, len, nonblock, 0);
+	}
+
+	/* use a private file position if an offset was given */
+	if(S_ISFIFO(o->i_mode)) {
+		if(!off_in) {
+			return splice_to_pipe(fin, o, len, nonblock);
+		}
+		fdt = *fin;
+		fdt.offset = *off_in;
+		retval = splice_to_pipe(&fdt, o, len, nonblock);
+		*off_in = fdt.offset;
+		return retval;
+	}
+	if(S_ISFIFO(i->i_mode)) {
+		if(fout->flags & O_APPEND) {
+			return -EINVAL;
+		}
+		if(!off_out) {
+			return splice_from_pipe(i, fout, len, nonblock);
+		}
+		fdt = *fout;
+		fdt.offset = *off_out;
+		retval = splice_from_pipe(i, &fdt, len, nonblock);
+		*off_out = fdt.offset;
+		return retval;
+	}
+	return -EINVAL;
+}
+
+int pipefs_tee(struct inode *i, struct inode *o, __size_t len, unsigned int flags)
+{
+	if(!S_ISFIFO(i->i_mode) || !S_ISFIFO(o->i_mode) || i == o) {
+		return -EINVAL;
+	}
+	return move_buffers(i, o, len, flags & SPLICE_F_NONBLOCK, 1);
+}
+
+/*
+ * With SPLICE_F_GIFT the user pages are queued into the pipe by reference,
+ * and the process must not modify them afterwards. Otherwise, and also for
+ * the pages not present in memory, the data is copied as with writev().
+ */
+int pipefs_vmsplice(struct fd *f, const struct iovec *iov, unsigned int nr_segs, unsigned int flags)
+{
+	struct inode *i;
+	struct page *pg;
+	struct fd fdt;
+	unsigned int addr, n, seg;
+	__size_t left;
+	int total, errno;
+
+	i = f->inode;
+	fdt = *f;
+	if(flags & SPLICE_F_NONBLOCK) {
+		fdt.flags |= O_NONBLOCK;
+	}
+
+	total = 0;
+	for(seg = 0; seg < nr_segs; seg++) {
+		addr = (unsigned int)iov[seg].iov_base;
+		left = iov[seg].iov_len;
+		while(left) {
+			if((fdt.flags & O_ACCMODE) == O_RDONLY) {
+				errno = pipefs_read(i, &fdt, (char *)addr, left);
+			} else if((flags & SPLICE_F_GIFT) && (pg = get_user_page(addr))) {
+				n = MIN(PAGE_SIZE - (addr & (PAGE_SIZE - 1)), left);
+				if((errno = pipe_lock_space(i, (fdt.flags & O_NONBLOCK) || total)) > 0) {
+					pg->count++;
+					pipe_add_page(i, pg, addr & (PAGE_SIZE - 1), n, 0);
+					unlock_resource(&i->u.pipefs.i_lock);
+					wakeup(&do_select);
+					wakeup_one(PIPE_READ_WAIT(i));
+					errno = n;
+				}
+			} else {
+				n = PAGE_SIZE - (addr & (PAGE_SIZE - 1));
+				if(flags & SPLICE_F_GIFT) {
+					/* copy just this page, the next one might be present */
+					n = MIN(n, left);
+				} else {
+					n = left;
+				}
+				errno = pipefs_write(i, &fdt, (char *)addr, n);
+			}
+			if(errno <= 0) {
+				return total ? total : errno;
+			}
+			total += errno;
+			addr += errno;
+			left -= errno;
+
+			/* once some data has been read don't block anymore */
+			if((fdt.flags & O_ACCMODE) == O_RDONLY) {
+				fdt.flags |= O_NONBLOCK;
+			}
+		}
+	}
+	return total;
+}
@@ -74,11 +74,9 @@ int pipefs_ialloc(struct inode *i, int mode)
 	i->fsop = &pipefs_fsop;
 	i->inode = i_counter;
 	i->count = 2;
-	if(!(i->u.pipefs.i_data = (void *)kmalloc(PAGE_SIZE))) {
+	if(pipefs_alloc(i, PIPE_DEF_SIZE)) {
 		return -ENOMEM;
 	}
-	i->u.pipefs.i_readoff = 0;
-	i->u.pipefs.i_writeoff = 0;
 	i->u.pipefs.i_readers = 1;
 	i->u.pipefs.i_writers = 1;
 	return 0;
@@ -91,9 +89,7 @@ void pipefs_ifree(struct inode *i)
 		 * We need to ask before to kfree() because this function is
 		 * also called to free removed (with sys_unlink) fifo files.
 		 */
-		if(i->u.pipefs.i_data) {
-			kfree((unsigned int)i->u.pipefs.i_data);
-		}
+		pipefs_free(i);
 	}
 }
 
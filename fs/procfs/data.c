@@ -13,6 +13,9 @@
 #include <fiwix/cmos.h>
 #include <fiwix/dma.h>
 #include <fiwix/ata.h>
+#include <fiwix/blk_queue.h>
+#include <fiwix/floppy.h>
+#include <fiwix/ramdisk.h>
 #include <fiwix/fs.h>
 #include <fiwix/filesystems.h>
 #include <fiwix/devices.h>
@@ -27,6 +30,7 @@
 #include <fiwix/utsname.h>
 #include <fiwix/version.h>
 #include <fiwix/socket.h>
+#include <fiwix/net/device.h>
 #include <fiwix/pci.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
@@ -143,6 +147,89 @@ int data_proc_devices(char *buffer, __pid_t pid)
 	return size;
 }
 
+static void add_blk_stats(struct blk_stats *total, struct blk_stats *bs)
+{
+	int n;
+
+	for(n = 0; n < 2; n++) {
+		total->ios[n] += bs->ios[n];
+		total->merges[n] += bs->merges[n];
+		total->sectors[n] += bs->sectors[n];
+		total->ticks[n] += bs->ticks[n];
+	}
+	total->in_flight += bs->in_flight;
+	total->io_ticks += bs->io_ticks;
+	total->time_in_queue += bs->time_in_queue;
+}
+
+static int sprintk_blk_stats(char *buffer, int major, int minor, char *name, int part, struct blk_stats *bs)
+{
+	char dev_name[16];
+
+	if(part) {
+		sprintk(dev_name, "%s%d", name, part);
+	} else {
+		sprintk(dev_name, "%s", name);
+	}
+	return sprintk(buffer, "%4d %7d %s %u %u %u %u %u %u %u %u %u %u %u\n",
+		major, minor, dev_name,
+		bs->ios[0], bs->merges[0], bs->sectors[0], TICKS2MS(bs->ticks[0]),
+		bs->ios[1], bs->merges[1], bs->sectors[1], TICKS2MS(bs->ticks[1]),
+		bs->in_flight, TICKS2MS(bs->io_ticks), TICKS2MS(bs->time_in_queue));
+}
+
+int data_proc_diskstats(char *buffer, __pid_t pid)
+{
+	int n, ctrl, drv, size;
+	int minor, major;
+	struct ide *ide;
+	struct ata_drv *drive;
+	struct blk_stats *bs, total, none;
+
+	size = 0;
+	memset_b(&none, 0, sizeof(struct blk_stats));
+
+	for(n = 0; n < NR_BLK_STATS; n++) {
+		bs = &blk_stats_table[n];
+		if(MAJOR(bs->dev) == RAMDISK_MAJOR) {
+			size += sprintk_blk_stats(buffer + size, RAMDISK_MAJOR, MINOR(bs->dev), "ram", 0, bs);
+		}
+		if(MAJOR(bs->dev) == FDC_MAJOR) {
+			size += sprintk_blk_stats(buffer + size, FDC_MAJOR, MINOR(bs->dev), "fd", 0, bs);
+		}
+	}
+
+	for(ctrl = 0; ctrl < NR_IDE_CTRLS; ctrl++) {
+		ide = &ide_table[ctrl];
+		for(drv = 0; drv < NR_ATA_DRVS; drv++) {
+			drive = &ide->drive[drv];
+			if(!drive->nr_sects || !(drive->flags & DRIVE_IS_DISK)) {
+				continue;
+			}
+			major = (int)drive->major;
+			minor = drive->num ? 1 << IDE_SLAVE_MSF : 0;
+
+			/* the whole disk also accounts the I/O of its partitions */
+			memset_b(&total, 0, sizeof(struct blk_stats));
+			for(n = 0; n <= NR_PARTITIONS; n++) {
+				if((bs = find_blk_stats(MKDEV(major, minor + n)))) {
+					add_blk_stats(&total, bs);
+				}
+			}
+			size += sprintk_blk_stats(buffer + size, major, minor, drive->dev_name, 0, &total);
+			for(n = 0; n < NR_PARTITIONS; n++) {
+				if(drive->part_table[n].type) {
+					if(!(bs = find_blk_stats(MKDEV(major, minor + n + 1)))) {
+						bs = &none;
+					}
+					size += sprintk_blk_stats(buffer + size, major, minor + n + 1, drive->dev_name, n + 1, bs);
+				}
+			}
+		}
+	}
+	return size;
+}
+
 int data_proc_dma(char *buffer, __pid_t pid)
 {
 	int n, size;
@@ -193,6 +280,19 @@ int data_proc_interrupts(char *buffer, __pid_t pid)
 	return size;
 }
 
+#ifdef CONFIG_LATENCY_TRACER
+int data_proc_latency(char *buffer, __pid_t pid)
+{
+	int size;
+
+	size = sprintk(buffer, "max latency:  %u usecs\n", latency.max_usecs);
+	size += sprintk(buffer + size, "process:      %d\n", latency.pid);
+	size += sprintk(buffer + size, "given up at:  0x%08x\n", latency.eip);
+	size += sprintk(buffer + size, "samples:      %u\n", latency.samples);
+	return size;
+}
+#endif /* CONFIG_LATENCY_TRACER */
+
 int data_proc_loadavg(char *buffer, __pid_t pid)
 {
 	int a, b, c;
@@ -478,6 +578,32 @@ int data_proc_unix(char *buffer, __pid_t pid)
 #endif /* CONFIG_NET */
 }
 
+int data_proc_net_dev(char *buffer, __pid_t pid)
+{
+#ifdef CONFIG_NET
+	struct net_device *d;
+	int size;
+
+	size = sprintk(buffer, "Inter-|   Receive                                                |  Transmit\n");
+	size += sprintk(buffer + size, " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n");
+	for(d = net_device_head; d; d = d->next) {
+		size += sprintk(buffer + size, "%s: %u %u %u %u 0 0 0 0 %u %u %u %u 0 0 0 0\n",
+			d->name,
+			d->stats.rx_bytes,
+			d->stats.rx_packets,
+			d->stats.rx_errors,
+			d->stats.rx_dropped,
+			d->stats.tx_bytes,
+			d->stats.tx_packets,
+			d->stats.tx_errors,
+			d->stats.tx_dropped);
+	}
+	return size;
+#else
+	return 0;
+#endif /* CONFIG_NET */
+}
+
 int data_proc_pci_devices(char *buffer, __pid_t pid)
 {
 #ifdef CONFIG_PCI
@@ -577,6 +703,26 @@ int data_proc_dirty_background_ratio(char *buffer, __pid_t pid)
 	return sprintk(buffer, "%d\n", BUFFER_DIRTY_RATIO);
 }
 
+int data_proc_dirty_expire_centisecs(char *buffer, __pid_t pid)
+{
+	return sprintk(buffer, "%d\n", BUFFER_DIRTY_EXPIRE);
+}
+
+int data_proc_dirty_ratio(char *buffer, __pid_t pid)
+{
+	return sprintk(buffer, "%d\n", BUFFER_THROTTLE_RATIO);
+}
+
+int data_proc_dirty_writeback_centisecs(char *buffer, __pid_t pid)
+{
+	return sprintk(buffer, "%d\n", BUFFER_WRITEBACK);
+}
+
+int data_proc_pipe_max_size(char *buffer, __pid_t pid)
+{
+	return sprintk(buffer, "%d\n", PIPE_MAX_SIZE);
+}
+
 
 /*
  * PID directory related functions
@@ -591,7 +737,7 @@ int data_proc_pid_fd(char *buffer, __pid_t pid, __ino_t inode)
 	size = 0;
 	ufd = inode & 0xFFF;
 	if((p = get_proc_by_pid(pid))) {
-		i = fd_table[p->fd[ufd]].inode;
+		i = fd_table[p->files->fd[ufd]].inode;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->dev), MINOR(i->dev), i->inode);
 	}
 	return size;
@@ -690,11 +836,11 @@ int data_proc_pid_exe(char *buffer, __pid_t pid)
 		 * This assumes that the first entry in the vma_table
 		 * contains the program's inode.
 		 */
-		if(!p->vma_table || !p->vma_table->inode) {
+		if(!p->mm->vma_table || !p->mm->vma_table->inode) {
 			return -ENOENT;
 		}
 
-		i = p->vma_table->inode;
+		i = p->mm->vma_table->inode;
 		size = sprintk(buffer, "[%02d%02d]:%d", MAJOR(i->rdev), MINOR(i->rdev), i->inode);
 	}
 	return size;
@@ -712,7 +858,7 @@ int data_proc_pid_maps(char *buffer, __pid_t pid)
 
 	size = 0;
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 		while(vma) {
 			r = vma->prot & PROT_READ ? 'r' : '-';
 			w = vma->prot & PROT_WRITE ? 'w' : '-';
@@ -737,6 +883,8 @@ int data_proc_pid_maps(char *buffer, __pid_t pid)
 						break;
 				case P_MMAP:	section = "mmap";
 						break;
+				case P_VDSO:	section = "vdso";
+						break;
 				case P_SHM:	section = "shm";
 						break;
 				default:
@@ -816,7 +964,7 @@ int data_proc_pid_stat(char *buffer, __pid_t pid)
 	vma_start = vma_end = 0;
 
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 
 		/*
 		 * This assumes that the first entry in the vma_table
@@ -849,10 +997,10 @@ int data_proc_pid_stat(char *buffer, __pid_t pid)
 
 		sigignored = sigcaught = 0;
 		for(signum = 0, mask = 1; signum < NSIG; signum++, mask <<= 1) {
-			if(p->sigaction[signum].sa_handler == SIG_IGN) {
+			if(p->sighand->sigaction[signum].sa_handler == SIG_IGN) {
 				sigignored |= mask;
 			}
-			if(p->sigaction[signum].sa_handler == SIG_DFL) {
+			if(p->sighand->sigaction[signum].sa_handler == SIG_DFL) {
 				sigcaught |= mask;
 			}
 		}
@@ -908,7 +1056,7 @@ int data_proc_pid_statm(char *buffer, __pid_t pid)
 
 	size = text = data = stack = mmap = 0;
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 		while(vma) {
 			switch(vma->s_type) {
 				case P_TEXT:
@@ -950,7 +1098,7 @@ int data_proc_pid_status(char *buffer, __pid_t pid)
 
 	size = text = data = stack = mmap = 0;
 	if((p = get_proc_by_pid(pid))) {
-		vma = p->vma_table;
+		vma = p->mm->vma_table;
 		while(vma) {
 			switch(vma->s_type) {
 				case P_TEXT:
@@ -987,10 +1135,10 @@ int data_proc_pid_status(char *buffer, __pid_t pid)
 		size += sprintk(buffer + size, "SigBlk:\t%08x\n", p->sigblocked);
 		sigignored = sigcaught = 0;
 		for(signum = 0, mask = 1; signum < NSIG; signum++, mask <<= 1) {
-			if(p->sigaction[signum].sa_handler == SIG_IGN) {
+			if(p->sighand->sigaction[signum].sa_handler == SIG_IGN) {
 				sigignored |= mask;
 			}
-			if(p->sigaction[signum].sa_handler == SIG_DFL) {
+			if(p->sighand->sigaction[signum].sa_handler == SIG_DFL) {
 				sigcaught |= mask;
 			}
 		}
@@ -121,7 +121,7 @@ static int proc_listfd(struct inode *i, char *buffer, int count)
 
 	p = get_proc_by_pid((i->inode >> 12) & 0xFFFF);
 	for(n = 0; n < OPEN_MAX; n++) {
-		if(p->fd[n]) {
+		if(p->files->fd[n]) {
 			d.inode = PROC_FD_INO + (p->pid << 12) + n;
 			d.mode = S_IFLNK | S_IRWXU;
 			d.nlink = 1;
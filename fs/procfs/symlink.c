@@ -126,8 +126,8 @@ int procfs_followlink(struct inode *dir, struct inode *i, struct inode **i_res)
 
 	if((i->inode & 0xF0000000) == PROC_FD_INO) {
 		ufd = i->inode & 0xFFF;
-		*i_res = fd_table[p->fd[ufd]].inode;
-		fd_table[p->fd[ufd]].inode->count++;
+		*i_res = fd_table[p->files->fd[ufd]].inode;
+		fd_table[p->files->fd[ufd]].inode->count++;
 		iput(i);
 		return 0;
 	}
@@ -146,11 +146,11 @@ int procfs_followlink(struct inode *dir, struct inode *i, struct inode **i_res)
 			 * This assumes that the first entry in the vma_table
 			 * contains the program's inode.
 			 */
-			if(!p->vma_table || !p->vma_table->inode) {
+			if(!p->mm->vma_table || !p->mm->vma_table->inode) {
 				return -ENOENT;
 			}
-			*i_res = p->vma_table->inode;
-			p->vma_table->inode->count++;
+			*i_res = p->mm->vma_table->inode;
+			p->mm->vma_table->inode->count++;
 			iput(i);
 			break;
 		case PROC_PID_ROOT:
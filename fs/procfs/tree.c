@@ -31,15 +31,19 @@ struct procfs_dir_entry procfs_array[][PROC_ARRAY_ENTRIES + 1] = {
 	{ 2,     DIR,    2, 0, 2,  "..",  NULL },
 	{ 3,     DIR,    3, 3, 3,  "bus", NULL },
 	{ 4,     DIR,    2, 4, 3,  "net", NULL },
-	{ 5,     DIR,    4, 5, 3,  "sys", NULL },
+	{ 5,     DIR,    5, 5, 3,  "sys", NULL },
 	{ 6,             REG,    1, 0, 9,  "buddyinfo",  data_proc_buddyinfo },
 	{ 7,             REG,    1, 0, 7,  "cmdline",    data_proc_cmdline },
 	{ 8,             REG,    1, 0, 7,  "cpuinfo",    data_proc_cpuinfo },
 	{ 9,             REG,    1, 0, 7,  "devices",    data_proc_devices },
+	{ 25,            REG,    1, 0, 9,  "diskstats",  data_proc_diskstats },
 	{ 10,            REG,    1, 0, 3,  "dma",        data_proc_dma },
 	{ 11,            REG,    1, 0, 11, "filesystems",data_proc_filesystems },
 	{ 12,            REG,    1, 0, 10, "interrupts", data_proc_interrupts },
 	{ PROC_KMSG_INO, REGUSR, 1, 0, 4,  "kmsg",       NULL },
+#ifdef CONFIG_LATENCY_TRACER
+	{ 26,            REG,    1, 0, 7,  "latency",    data_proc_latency },
+#endif /* CONFIG_LATENCY_TRACER */
 	{ 14,            REG,    1, 0, 7,  "loadavg",    data_proc_loadavg },
 	{ 15,            REG,    1, 0, 5,  "locks",      data_proc_locks },
 	{ 16,            REG,    1, 0, 7,  "meminfo",    data_proc_meminfo },
@@ -85,12 +89,14 @@ struct procfs_dir_entry procfs_array[][PROC_ARRAY_ENTRIES + 1] = {
    {	/* [lev 4] /net/ */
 	{ 4,     DIR,  2, 4, 1,  ".",   NULL },
 	{ 1,     DIR,  2, 0, 2,  "..",  NULL },
+	{ 4002,  REG,  1, 4, 3, "dev",  data_proc_net_dev },
 	{ 4001,  REG,  1, 4, 4, "unix", data_proc_unix },
 	{ 0, 0, 0, 0, 0, NULL, NULL }
    },
    {	/* [lev 5] /sys/ */
 	{ 5,     DIR,  2, 5, 1,  ".",       NULL },
 	{ 1,     DIR,  2, 0, 2,  "..",      NULL },
+	{ 5003,  DIR,  2, 9, 2,  "fs",      NULL },
 	{ 5001,  DIR,  2, 7, 6,  "kernel",  NULL },
 	{ 5002,  DIR,  2, 8, 2,  "vm",      NULL },
 	{ 0, 0, 0, 0, 0, NULL, NULL }
@@ -120,6 +126,15 @@ struct procfs_dir_entry procfs_array[][PROC_ARRAY_ENTRIES + 1] = {
 	{ 5002,  DIR,  2, 8, 1,  ".",   NULL },
 	{ 5,     DIR,  2, 3, 2,  "..",  NULL },
 	{ 8001,  REG,  1, 8, 22, "dirty_background_ratio", data_proc_dirty_background_ratio },
+	{ 8002,  REG,  1, 8, 22, "dirty_expire_centisecs", data_proc_dirty_expire_centisecs },
+	{ 8003,  REG,  1, 8, 11, "dirty_ratio", data_proc_dirty_ratio },
+	{ 8004,  REG,  1, 8, 25, "dirty_writeback_centisecs", data_proc_dirty_writeback_centisecs },
+	{ 0, 0, 0, 0, 0, NULL, NULL }
+   },
+   {	/* [5003] /sys/fs/ */
+	{ 5003,  DIR,  2, 9, 1,  ".",   NULL },
+	{ 5,     DIR,  2, 3, 2,  "..",  NULL },
+	{ 9001,  REG,  1, 9, 13, "pipe-max-size", data_proc_pipe_max_size },
 	{ 0, 0, 0, 0, 0, NULL, NULL }
    }
 };
@@ -13,6 +13,7 @@
 #include <fiwix/fs.h>
 #include <fiwix/stat.h>
 #include <fiwix/filesystems.h>
+#include <fiwix/devices.h>
 #include <fiwix/sleep.h>
 #include <fiwix/sched.h>
 #include <fiwix/stdio.h>
@@ -169,6 +170,19 @@ struct superblock *get_superblock(__dev_t dev)
 	return NULL;
 }
 
+/* returns a free device number for a filesystem not backed by a device */
+__dev_t get_unnamed_dev(void)
+{
+	int minor;
+
+	for(minor = 1; minor < MAX_MINORS; minor++) {
+		if(!get_superblock(MKDEV(UNNAMED_MAJOR, minor))) {
+			return MKDEV(UNNAMED_MAJOR, minor);
+		}
+	}
+	return 0;
+}
+
 void sync_superblocks(__dev_t dev)
 {
 	struct superblock *sb;
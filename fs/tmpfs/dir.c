@@ -0,0 +1,138 @@
+/*
+ * fiwix/fs/tmpfs/dir.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/dirent.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct fs_operations tmpfs_dir_fsop = {
+	0,
+	0,
+
+	tmpfs_dir_open,
+	tmpfs_dir_close,
+	tmpfs_dir_read,
+	NULL,			/* write */
+	NULL,			/* ioctl */
+	NULL,			/* llseek */
+	tmpfs_readdir,
+	NULL,			/* readdir64 */
+	NULL,			/* mmap */
+	NULL,			/* select */
+
+	NULL,			/* readlink */
+	NULL,			/* followlink */
+	NULL,			/* bmap */
+	tmpfs_lookup,
+	tmpfs_rmdir,
+	tmpfs_link,
+	tmpfs_unlink,
+	tmpfs_symlink,
+	tmpfs_mkdir,
+	tmpfs_mknod,
+	NULL,			/* truncate */
+	tmpfs_create,
+	tmpfs_rename,
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	NULL,			/* read_inode */
+	NULL,			/* write_inode */
+	NULL,			/* ialloc */
+	NULL,			/* ifree */
+	NULL,			/* statfs */
+	NULL,			/* read_superblock */
+	NULL,			/* remount_fs */
+	NULL,			/* write_superblock */
+	NULL			/* release_superblock */
+};
+
+int tmpfs_dir_open(struct inode *i, struct fd *f)
+{
+	f->offset = 0;
+	return 0;
+}
+
+int tmpfs_dir_close(struct inode *i, struct fd *f)
+{
+	return 0;
+}
+
+int tmpfs_dir_read(struct inode *i, struct fd *f, char *buffer, __size_t count)
+{
+	return -EISDIR;
+}
+
+/* the offset is the position of the entry, after '.' and '..' */
+int tmpfs_readdir(struct inode *i, struct fd *f, struct dirent *dirent, __size_t count)
+{
+	struct tmpfs_node *node;
+	struct tmpfs_dir_entry *d;
+	unsigned int offset, n;
+	int rec_len, name_len;
+	__size_t total_read;
+	int base_dirent_len;
+	char *name;
+
+	if(!(node = tmpfs_get_node(i->sb, i->inode))) {
+		return -ENOENT;
+	}
+
+	base_dirent_len = sizeof(dirent->d_ino) + sizeof(dirent->d_off) + sizeof(dirent->d_reclen);
+
+	offset = f->offset;
+	total_read = 0;
+
+	inode_lock(i);
+	d = node->entries;
+	for(n = 2; d && n < offset; n++) {
+		d = d->next;
+	}
+
+	for(;;) {
+		if(offset == 0) {
+			name = ".";
+			dirent->d_ino = node->ino;
+		} else if(offset == 1) {
+			name = "..";
+			dirent->d_ino = node->parent->ino;
+		} else {
+			if(!d) {
+				break;
+			}
+			name = d->name;
+			dirent->d_ino = d->node->ino;
+		}
+		name_len = strlen(name);
+		rec_len = (base_dirent_len + (name_len + 1)) + 3;
+		rec_len &= ~3;	/* round up */
+		if(total_read + rec_len >= count) {
+			break;
+		}
+		dirent->d_off = offset;
+		dirent->d_reclen = rec_len;
+		memcpy_b(dirent->d_name, name, name_len);
+		dirent->d_name[name_len] = 0;
+		dirent = (struct dirent *)((char *)dirent + rec_len);
+		total_read += rec_len;
+		if(offset > 1) {
+			d = d->next;
+		}
+		offset++;
+	}
+	inode_unlock(i);
+	f->offset = offset;
+	return total_read;
+}
+#endif /* CONFIG_FS_TMPFS */
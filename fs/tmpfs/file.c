@@ -0,0 +1,232 @@
+/*
+ * fiwix/fs/tmpfs/file.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/mm.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct fs_operations tmpfs_file_fsop = {
+	0,
+	0,
+
+	tmpfs_file_open,
+	tmpfs_file_close,
+	file_read,
+	tmpfs_file_write,
+	NULL,			/* ioctl */
+	tmpfs_file_llseek,
+	NULL,			/* readdir */
+	NULL,			/* readdir64 */
+	NULL,			/* mmap */
+	NULL,			/* select */
+
+	NULL,			/* readlink */
+	NULL,			/* followlink */
+	NULL,			/* bmap */
+	NULL,			/* lookup */
+	NULL,			/* rmdir */
+	NULL,			/* link */
+	NULL,			/* unlink */
+	NULL,			/* symlink */
+	NULL,			/* mkdir */
+	NULL,			/* mknod */
+	tmpfs_truncate,
+	NULL,			/* create */
+	NULL,			/* rename */
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	NULL,			/* read_inode */
+	NULL,			/* write_inode */
+	NULL,			/* ialloc */
+	NULL,			/* ifree */
+	NULL,			/* statfs */
+	NULL,			/* read_superblock */
+	NULL,			/* remount_fs */
+	NULL,			/* write_superblock */
+	NULL			/* release_superblock */
+};
+
+/*
+ * Allocates a zeroed page for the file data at 'offset' and places it in the
+ * page cache, where the file keeps a reference to it. The caller gets another
+ * one.
+ */
+static int new_page(struct inode *i, __off_t offset, struct page **pg)
+{
+	struct superblock *sb = i->sb;
+
+	if(sb->u.tmpfs.max_pages && sb->u.tmpfs.nr_pages >= sb->u.tmpfs.max_pages) {
+		return -ENOSPC;
+	}
+	if(!(*pg = get_free_page())) {
+		return -ENOMEM;
+	}
+	memset_b((*pg)->data, 0, PAGE_SIZE);
+	add_page_to_cache(*pg, i, offset);
+	(*pg)->count++;
+	sb->u.tmpfs.nr_pages++;
+	i->i_blocks += PAGE_SIZE / 512;
+	return 0;
+}
+
+/* files are never sparse, so every page up to 'size' must exist */
+static int grow_file(struct inode *i, __off_t size)
+{
+	struct page *pg;
+	__off_t start, offset;
+	int errno;
+
+	start = PAGE_ALIGN(i->i_size);
+	for(offset = start; offset < size; offset += PAGE_SIZE) {
+		if((errno = new_page(i, offset, &pg))) {
+			tmpfs_release_pages(i, start, offset);
+			return errno;
+		}
+		release_page(pg);
+	}
+	return 0;
+}
+
+/* drops the pages of the file data from 'start' (page aligned) to 'end' */
+void tmpfs_release_pages(struct inode *i, __off_t start, __off_t end)
+{
+	struct page *pg;
+	__off_t offset;
+
+	for(offset = start; offset < end; offset += PAGE_SIZE) {
+		if((pg = search_page_hash(i, offset))) {
+			remove_page_from_cache(pg);
+			release_page(pg);
+			release_page(pg);
+			i->sb->u.tmpfs.nr_pages--;
+			i->i_blocks -= PAGE_SIZE / 512;
+		}
+	}
+}
+
+int tmpfs_file_open(struct inode *i, struct fd *f)
+{
+	f->offset = 0;
+	if(f->flags & O_TRUNC) {
+		tmpfs_truncate(i, 0);
+	}
+	return 0;
+}
+
+int tmpfs_file_close(struct inode *i, struct fd *f)
+{
+	return 0;
+}
+
+int tmpfs_file_write(struct inode *i, struct fd *f, const char *buffer, __size_t count)
+{
+	__size_t total_written;
+	unsigned int poffset, bytes;
+	struct page *pg;
+	int errno;
+#ifdef CONFIG_OFFSET64
+	__loff_t offset;
+#else
+	__off_t offset;
+#endif /* CONFIG_OFFSET64 */
+
+	inode_lock(i);
+
+	if(f->flags & O_APPEND) {
+		f->offset = i->i_size;
+	}
+	offset = f->offset;
+	errno = total_written = 0;
+
+	if(offset > i->i_size) {
+		if((errno = grow_file(i, offset))) {
+			inode_unlock(i);
+			return errno;
+		}
+		i->i_size = offset;
+	}
+
+	while(total_written < count) {
+		poffset = offset & (PAGE_SIZE - 1);	/* mod PAGE_SIZE */
+		bytes = PAGE_SIZE - poffset;
+		bytes = MIN(bytes, (count - total_written));
+		if(!(pg = search_page_hash(i, offset & PAGE_MASK))) {
+			if((errno = new_page(i, offset & PAGE_MASK, &pg))) {
+				break;
+			}
+		}
+		page_lock(pg);
+		memcpy_b(pg->data + poffset, buffer + total_written, bytes);
+		page_unlock(pg);
+		release_page(pg);
+		total_written += bytes;
+		offset += bytes;
+		if(offset > i->i_size) {
+			i->i_size = offset;
+		}
+	}
+
+	if(total_written) {
+		f->offset = offset;
+		i->i_ctime = CURRENT_TIME;
+		i->i_mtime = CURRENT_TIME;
+	}
+	i->state |= INODE_DIRTY;
+
+	inode_unlock(i);
+
+	if(!total_written) {
+		return errno;
+	}
+	return total_written;
+}
+
+__loff_t tmpfs_file_llseek(struct inode *i, __loff_t offset)
+{
+	return offset;
+}
+
+int tmpfs_truncate(struct inode *i, __off_t length)
+{
+	struct page *pg;
+	int errno;
+
+	if(length > i->i_size) {
+		if((errno = grow_file(i, length))) {
+			return errno;
+		}
+	} else {
+		tmpfs_release_pages(i, PAGE_ALIGN(length), i->i_size);
+
+		/* a later extension must find zeros past the end of file */
+		if(length & (PAGE_SIZE - 1)) {
+			if((pg = search_page_hash(i, length & PAGE_MASK))) {
+				page_lock(pg);
+				memset_b(pg->data + (length & (PAGE_SIZE - 1)), 0, PAGE_SIZE - (length & (PAGE_SIZE - 1)));
+				page_unlock(pg);
+				release_page(pg);
+			}
+		}
+	}
+
+	i->i_size = length;
+	i->i_mtime = CURRENT_TIME;
+	i->i_ctime = CURRENT_TIME;
+	i->state |= INODE_DIRTY;
+	return 0;
+}
+#endif /* CONFIG_FS_TMPFS */
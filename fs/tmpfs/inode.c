@@ -0,0 +1,183 @@
+/*
+ * fiwix/fs/tmpfs/inode.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/stat.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct tmpfs_node *tmpfs_get_node(struct superblock *sb, __ino_t inode)
+{
+	struct tmpfs_node *node;
+
+	if(!sb->u.tmpfs.hash) {
+		return NULL;
+	}
+	node = sb->u.tmpfs.hash[TMPFS_HASH(inode)];
+	while(node) {
+		if(node->ino == inode) {
+			return node;
+		}
+		node = node->next_hash;
+	}
+	return NULL;
+}
+
+int tmpfs_read_inode(struct inode *i)
+{
+	struct tmpfs_node *node;
+
+	if(!(node = tmpfs_get_node(i->sb, i->inode))) {
+		return -ENOENT;
+	}
+
+	i->i_mode = node->mode;
+	i->i_uid = node->uid;
+	i->i_size = node->size;
+	i->i_atime = node->atime;
+	i->i_ctime = node->ctime;
+	i->i_mtime = node->mtime;
+	i->i_gid = node->gid;
+	i->i_nlink = node->nlink;
+	i->i_blocks = node->blocks;
+	i->i_flags = 0;
+	i->count = 1;
+	switch(i->i_mode & S_IFMT) {
+		case S_IFCHR:
+			i->fsop = &def_chr_fsop;
+			i->rdev = node->rdev;
+			break;
+		case S_IFBLK:
+			i->fsop = &def_blk_fsop;
+			i->rdev = node->rdev;
+			break;
+		case S_IFIFO:
+			i->fsop = &pipefs_fsop;
+			/* it's a union so we need to clear pipefs_inode */
+			memset_b(&i->u.pipefs, 0, sizeof(struct pipefs_inode));
+			break;
+		case S_IFDIR:
+			i->fsop = &tmpfs_dir_fsop;
+			break;
+		case S_IFREG:
+			i->fsop = &tmpfs_file_fsop;
+			break;
+		case S_IFLNK:
+			i->fsop = &tmpfs_symlink_fsop;
+			break;
+		case S_IFSOCK:
+#ifdef CONFIG_NET
+			i->fsop = &sockfs_fsop;
+			/* it's a union so we need to clear sockfs_inode */
+			memset_b(&i->u.sockfs, 0, sizeof(struct sockfs_inode));
+#else
+			i->fsop = NULL;
+#endif /* CONFIG_NET */
+			break;
+		default:
+			printk("WARNING: %s(): invalid inode (%d) mode %08o.\n", __FUNCTION__, i->inode, i->i_mode);
+			return -ENOENT;
+	}
+	return 0;
+}
+
+int tmpfs_write_inode(struct inode *i)
+{
+	struct tmpfs_node *node;
+
+	/* the node is already gone if the inode was freed */
+	if((node = tmpfs_get_node(i->sb, i->inode))) {
+		node->mode = i->i_mode;
+		node->uid = i->i_uid;
+		node->size = i->i_size;
+		node->atime = i->i_atime;
+		node->ctime = i->i_ctime;
+		node->mtime = i->i_mtime;
+		node->gid = i->i_gid;
+		node->nlink = i->i_nlink;
+		node->blocks = i->i_blocks;
+		if(S_ISCHR(i->i_mode) || S_ISBLK(i->i_mode)) {
+			node->rdev = i->rdev;
+		}
+	}
+	i->state &= ~INODE_DIRTY;
+	return 0;
+}
+
+int tmpfs_ialloc(struct inode *i, int mode)
+{
+	struct superblock *sb = i->sb;
+	struct tmpfs_node *node;
+	int n;
+
+	superblock_lock(sb);
+	if(sb->u.tmpfs.max_inodes && sb->u.tmpfs.nr_inodes >= sb->u.tmpfs.max_inodes) {
+		superblock_unlock(sb);
+		return -ENOSPC;
+	}
+	if(!(node = (struct tmpfs_node *)kmalloc(sizeof(struct tmpfs_node)))) {
+		superblock_unlock(sb);
+		return -ENOMEM;
+	}
+	memset_b(node, 0, sizeof(struct tmpfs_node));
+	node->ino = ++sb->u.tmpfs.last_ino;
+	node->mode = mode;
+	n = TMPFS_HASH(node->ino);
+	node->next_hash = sb->u.tmpfs.hash[n];
+	sb->u.tmpfs.hash[n] = node;
+	sb->u.tmpfs.nr_inodes++;
+	superblock_unlock(sb);
+
+	i->i_mode = mode;
+	i->inode = node->ino;
+	i->count = 1;
+	i->i_atime = CURRENT_TIME;
+	i->i_mtime = CURRENT_TIME;
+	i->i_ctime = CURRENT_TIME;
+	return 0;
+}
+
+void tmpfs_ifree(struct inode *i)
+{
+	struct superblock *sb = i->sb;
+	struct tmpfs_node **h, *node;
+
+	if(!sb->u.tmpfs.hash) {
+		return;
+	}
+
+	if(S_ISREG(i->i_mode)) {
+		tmpfs_release_pages(i, 0, i->i_size);
+	}
+
+	superblock_lock(sb);
+	h = &sb->u.tmpfs.hash[TMPFS_HASH(i->inode)];
+	while((node = *h)) {
+		if(node->ino == i->inode) {
+			*h = node->next_hash;
+			if(node->symlink) {
+				kfree((unsigned int)node->symlink);
+			}
+			kfree((unsigned int)node);
+			sb->u.tmpfs.nr_inodes--;
+			break;
+		}
+		h = &node->next_hash;
+	}
+	superblock_unlock(sb);
+
+	i->i_size = 0;
+	i->i_blocks = 0;
+}
+#endif /* CONFIG_FS_TMPFS */
@@ -0,0 +1,462 @@
+/*
+ * fiwix/fs/tmpfs/namei.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/process.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stat.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+/* finds an entry in 'dir' based on the 'name' and/or on the 'node' */
+static struct tmpfs_dir_entry **find_dir_entry(struct tmpfs_node *dir, struct tmpfs_node *node, const char *name)
+{
+	struct tmpfs_dir_entry **d;
+
+	for(d = &dir->entries; *d; d = &(*d)->next) {
+		if(node && (*d)->node != node) {
+			continue;
+		}
+		if(!name || !strcmp((*d)->name, name)) {
+			return d;
+		}
+	}
+	return NULL;
+}
+
+/* entries are appended so that readdir() keeps the creation order */
+static int add_dir_entry(struct tmpfs_node *dir, struct tmpfs_node *node, const char *name)
+{
+	struct tmpfs_dir_entry **d, *new;
+
+	if(!(new = (struct tmpfs_dir_entry *)kmalloc(sizeof(struct tmpfs_dir_entry)))) {
+		return -ENOMEM;
+	}
+	if(!(new->name = (char *)kmalloc(strlen(name) + 1))) {
+		kfree((unsigned int)new);
+		return -ENOMEM;
+	}
+	strcpy(new->name, name);
+	new->node = node;
+	new->next = NULL;
+	for(d = &dir->entries; *d; d = &(*d)->next);
+	*d = new;
+	return 0;
+}
+
+static void del_dir_entry(struct tmpfs_dir_entry **d)
+{
+	struct tmpfs_dir_entry *old;
+
+	old = *d;
+	*d = old->next;
+	kfree((unsigned int)old->name);
+	kfree((unsigned int)old);
+}
+
+static int is_subdir(struct inode *dir_new, struct inode *i_old)
+{
+	struct tmpfs_node *node, *old;
+
+	node = tmpfs_get_node(dir_new->sb, dir_new->inode);
+	old = tmpfs_get_node(i_old->sb, i_old->inode);
+	while(node) {
+		if(node == old) {
+			return 1;
+		}
+		if(node->parent == node) {
+			break;
+		}
+		node = node->parent;
+	}
+	return 0;
+}
+
+/* allocates a new inode of type 'mode' and links it into 'dir' as 'name' */
+static int new_dir_entry(struct inode *dir, char *name, __mode_t mode, struct inode **i_res)
+{
+	struct tmpfs_node *d_node;
+	struct inode *i;
+	int errno;
+
+	if(!(d_node = tmpfs_get_node(dir->sb, dir->inode))) {
+		return -ENOENT;
+	}
+
+	/* check again to know if this filename already exists */
+	if(find_dir_entry(d_node, NULL, name)) {
+		return -EEXIST;
+	}
+
+	if(!(i = ialloc(dir->sb, mode & S_IFMT))) {
+		return -ENOSPC;
+	}
+
+	if((errno = add_dir_entry(d_node, tmpfs_get_node(dir->sb, i->inode), name))) {
+		iput(i);
+		return errno;
+	}
+
+	i->i_mode = mode;
+	i->i_uid = current->euid;
+	i->i_gid = current->egid;
+	i->i_nlink = 1;
+	i->state |= INODE_DIRTY;
+
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+	dir->state |= INODE_DIRTY;
+
+	*i_res = i;
+	return 0;
+}
+
+int tmpfs_lookup(const char *name, struct inode *dir, struct inode **i_res)
+{
+	struct tmpfs_node *d_node;
+	struct tmpfs_dir_entry **d;
+	__ino_t inode;
+
+	if(!(d_node = tmpfs_get_node(dir->sb, dir->inode))) {
+		iput(dir);
+		return -ENOENT;
+	}
+
+	inode = 0;
+	if(name[0] == '.' && name[1] == '\0') {
+		inode = dir->inode;
+	} else if(name[0] == '.' && name[1] == '.' && name[2] == '\0') {
+		inode = d_node->parent->ino;
+	} else if((d = find_dir_entry(d_node, NULL, name))) {
+		inode = (*d)->node->ino;
+	}
+
+	if(!inode) {
+		iput(dir);
+		return -ENOENT;
+	}
+
+	/*
+	 * This prevents a deadlock in iget() when trying to lock '.' when
+	 * 'dir' is the same directory (ls -lai <dir>).
+	 */
+	if(inode == dir->inode) {
+		*i_res = dir;
+		return 0;
+	}
+
+	if(!(*i_res = iget(dir->sb, inode))) {
+		iput(dir);
+		return -EACCES;
+	}
+	iput(dir);
+	return 0;
+}
+
+int tmpfs_rmdir(struct inode *dir, struct inode *i)
+{
+	struct tmpfs_node *d_node, *node;
+	struct tmpfs_dir_entry **d;
+
+	inode_lock(i);
+
+	node = tmpfs_get_node(i->sb, i->inode);
+	if(node && node->entries) {
+		inode_unlock(i);
+		return -ENOTEMPTY;
+	}
+
+	inode_lock(dir);
+
+	d_node = tmpfs_get_node(dir->sb, dir->inode);
+	if(!node || !d_node || !(d = find_dir_entry(d_node, node, NULL))) {
+		inode_unlock(i);
+		inode_unlock(dir);
+		return -ENOENT;
+	}
+
+	del_dir_entry(d);
+	i->i_nlink = 0;
+	dir->i_nlink--;
+
+	i->i_ctime = CURRENT_TIME;
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+
+	i->state |= INODE_DIRTY;
+	dir->state |= INODE_DIRTY;
+
+	inode_unlock(i);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_link(struct inode *i_old, struct inode *dir_new, char *name)
+{
+	struct tmpfs_node *d_node;
+	int errno;
+
+	inode_lock(i_old);
+	inode_lock(dir_new);
+
+	if(!(d_node = tmpfs_get_node(dir_new->sb, dir_new->inode))) {
+		errno = -ENOENT;
+	} else if(find_dir_entry(d_node, NULL, name)) {
+		errno = -EEXIST;
+	} else {
+		errno = add_dir_entry(d_node, tmpfs_get_node(i_old->sb, i_old->inode), name);
+	}
+	if(errno) {
+		inode_unlock(i_old);
+		inode_unlock(dir_new);
+		return errno;
+	}
+
+	i_old->i_nlink++;
+	i_old->i_ctime = CURRENT_TIME;
+	dir_new->i_mtime = CURRENT_TIME;
+	dir_new->i_ctime = CURRENT_TIME;
+
+	i_old->state |= INODE_DIRTY;
+	dir_new->state |= INODE_DIRTY;
+
+	inode_unlock(i_old);
+	inode_unlock(dir_new);
+	return 0;
+}
+
+int tmpfs_unlink(struct inode *dir, struct inode *i, char *name)
+{
+	struct tmpfs_node *d_node;
+	struct tmpfs_dir_entry **d;
+
+	inode_lock(dir);
+	inode_lock(i);
+
+	d_node = tmpfs_get_node(dir->sb, dir->inode);
+	if(!d_node || !(d = find_dir_entry(d_node, tmpfs_get_node(i->sb, i->inode), name))) {
+		inode_unlock(dir);
+		inode_unlock(i);
+		return -ENOENT;
+	}
+
+	del_dir_entry(d);
+	i->i_nlink--;
+
+	i->i_ctime = CURRENT_TIME;
+	dir->i_mtime = CURRENT_TIME;
+	dir->i_ctime = CURRENT_TIME;
+
+	i->state |= INODE_DIRTY;
+	dir->state |= INODE_DIRTY;
+
+	inode_unlock(dir);
+	inode_unlock(i);
+	return 0;
+}
+
+int tmpfs_symlink(struct inode *dir, char *name, char *oldname)
+{
+	struct inode *i;
+	char *data;
+	int errno;
+
+	if(!(data = (char *)kmalloc(strlen(oldname) + 1))) {
+		return -ENOMEM;
+	}
+	strcpy(data, oldname);
+
+	inode_lock(dir);
+
+	if((errno = new_dir_entry(dir, name, S_IFLNK | (S_IRWXU | S_IRWXG | S_IRWXO), &i))) {
+		kfree((unsigned int)data);
+		inode_unlock(dir);
+		return errno;
+	}
+
+	tmpfs_get_node(i->sb, i->inode)->symlink = data;
+	i->i_size = strlen(data);
+	i->fsop = &tmpfs_symlink_fsop;
+
+	iput(i);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_mkdir(struct inode *dir, char *name, __mode_t mode)
+{
+	struct inode *i;
+	int errno;
+
+	inode_lock(dir);
+
+	mode = (mode & (S_IRWXU | S_IRWXG | S_IRWXO)) & ~current->umask;
+	if((errno = new_dir_entry(dir, name, S_IFDIR | mode, &i))) {
+		inode_unlock(dir);
+		return errno;
+	}
+
+	tmpfs_get_node(i->sb, i->inode)->parent = tmpfs_get_node(dir->sb, dir->inode);
+	i->i_nlink++;
+	i->fsop = &tmpfs_dir_fsop;
+	dir->i_nlink++;
+
+	iput(i);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_mknod(struct inode *dir, char *name, __mode_t mode, __dev_t dev)
+{
+	struct inode *i;
+	int errno;
+
+	inode_lock(dir);
+
+	if((errno = new_dir_entry(dir, name, (mode & S_IFMT) | ((mode & ~current->umask) & ~S_IFMT), &i))) {
+		inode_unlock(dir);
+		return errno;
+	}
+
+	switch(mode & S_IFMT) {
+		case S_IFCHR:
+			i->fsop = &def_chr_fsop;
+			i->rdev = dev;
+			break;
+		case S_IFBLK:
+			i->fsop = &def_blk_fsop;
+			i->rdev = dev;
+			break;
+		case S_IFIFO:
+			i->fsop = &pipefs_fsop;
+			/* it's a union so we need to clear pipefs_inode */
+			memset_b(&i->u.pipefs, 0, sizeof(struct pipefs_inode));
+			break;
+#ifdef CONFIG_NET
+		case S_IFSOCK:
+			i->fsop = &sockfs_fsop;
+			/* it's a union so we need to clear sockfs_inode */
+			memset_b(&i->u.sockfs, 0, sizeof(struct sockfs_inode));
+			break;
+#endif /* CONFIG_NET */
+	}
+
+	iput(i);
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_create(struct inode *dir, char *name, int flags, __mode_t mode, struct inode **i_res)
+{
+	struct inode *i;
+	int errno;
+
+	if(IS_RDONLY_FS(dir)) {
+		return -EROFS;
+	}
+
+	inode_lock(dir);
+
+	if((errno = new_dir_entry(dir, name, S_IFREG | ((mode & ~current->umask) & ~S_IFMT), &i))) {
+		inode_unlock(dir);
+		return errno;
+	}
+	i->fsop = &tmpfs_file_fsop;
+
+	*i_res = i;
+	inode_unlock(dir);
+	return 0;
+}
+
+int tmpfs_rename(struct inode *i_old, struct inode *dir_old, struct inode *i_new, struct inode *dir_new, char *oldpath, char *newpath)
+{
+	struct tmpfs_node *d_old_node, *d_new_node, *node;
+	struct tmpfs_dir_entry **d_old, **d_new;
+	int errno;
+
+	errno = 0;
+
+	if(is_subdir(dir_new, i_old)) {
+		return -EINVAL;
+	}
+
+	inode_lock(i_old);
+	inode_lock(dir_old);
+	if(dir_old != dir_new) {
+		inode_lock(dir_new);
+	}
+
+	node = tmpfs_get_node(i_old->sb, i_old->inode);
+	d_old_node = tmpfs_get_node(dir_old->sb, dir_old->inode);
+	d_new_node = tmpfs_get_node(dir_new->sb, dir_new->inode);
+	if(!node || !d_old_node || !d_new_node || !find_dir_entry(d_old_node, node, oldpath)) {
+		errno = -ENOENT;
+		goto end;
+	}
+
+	if(i_new) {
+		if(S_ISDIR(i_old->i_mode)) {
+			if(tmpfs_get_node(i_new->sb, i_new->inode)->entries) {
+				errno = -ENOTEMPTY;
+				goto end;
+			}
+		}
+		if(!(d_new = find_dir_entry(d_new_node, tmpfs_get_node(i_new->sb, i_new->inode), newpath))) {
+			errno = -ENOENT;
+			goto end;
+		}
+		(*d_new)->node = node;
+		if(S_ISDIR(i_new->i_mode)) {
+			/* the '..' of the replaced directory is gone as well */
+			i_new->i_nlink = 0;
+			dir_new->i_nlink--;
+		} else {
+			i_new->i_nlink--;
+		}
+		i_new->i_ctime = CURRENT_TIME;
+		i_new->state |= INODE_DIRTY;
+	} else {
+		if((errno = add_dir_entry(d_new_node, node, newpath))) {
+			goto end;
+		}
+	}
+	if(S_ISDIR(i_old->i_mode)) {
+		dir_old->i_nlink--;
+		dir_new->i_nlink++;
+		node->parent = d_new_node;
+	}
+
+	/* the entry might have moved if both are in the same directory */
+	d_old = find_dir_entry(d_old_node, node, oldpath);
+	del_dir_entry(d_old);
+
+	dir_new->i_mtime = CURRENT_TIME;
+	dir_new->i_ctime = CURRENT_TIME;
+	dir_new->state |= INODE_DIRTY;
+
+	dir_old->i_mtime = CURRENT_TIME;
+	dir_old->i_ctime = CURRENT_TIME;
+	i_old->i_ctime = CURRENT_TIME;
+	i_old->state |= INODE_DIRTY;
+	dir_old->state |= INODE_DIRTY;
+
+end:
+	inode_unlock(i_old);
+	inode_unlock(dir_old);
+	if(dir_old != dir_new) {
+		inode_unlock(dir_new);
+	}
+	return errno;
+}
+#endif /* CONFIG_FS_TMPFS */
@@ -0,0 +1,279 @@
+/*
+ * fiwix/fs/tmpfs/super.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/statfs.h>
+#include <fiwix/stat.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct fs_operations tmpfs_fsop = {
+	FSOP_NO_BACKING,
+	0,
+
+	NULL,			/* open */
+	NULL,			/* close */
+	NULL,			/* read */
+	NULL,			/* write */
+	NULL,			/* ioctl */
+	NULL,			/* llseek */
+	NULL,			/* readdir */
+	NULL,			/* readdir64 */
+	NULL,			/* mmap */
+	NULL,			/* select */
+
+	NULL,			/* readlink */
+	NULL,			/* followlink */
+	NULL,			/* bmap */
+	NULL,			/* lookup */
+	NULL,			/* rmdir */
+	NULL,			/* link */
+	NULL,			/* unlink */
+	NULL,			/* symlink */
+	NULL,			/* mkdir */
+	NULL,			/* mknod */
+	NULL,			/* truncate */
+	NULL,			/* create */
+	NULL,			/* rename */
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	tmpfs_read_inode,
+	tmpfs_write_inode,
+	tmpfs_ialloc,
+	tmpfs_ifree,
+	tmpfs_statfs,
+	tmpfs_read_superblock,
+	tmpfs_remount_fs,
+	NULL,			/* write_superblock */
+	tmpfs_release_superblock
+};
+
+static unsigned int get_number(char **str, int base)
+{
+	unsigned int n;
+
+	n = 0;
+	while(**str >= '0' && **str < '0' + base) {
+		n = (n * base) + (**str - '0');
+		(*str)++;
+	}
+	return n;
+}
+
+/*
+ * Parses the mount options 'size=N[k|m|g|%]', 'nr_inodes=N' and 'mode=N'.
+ * A size or a number of inodes of 0 means no limit.
+ */
+static int parse_options(char *options, unsigned int *pages, unsigned int *inodes, __mode_t *mode)
+{
+	char *p;
+	unsigned int n;
+
+	if(!(p = options)) {
+		return 0;
+	}
+
+	while(*p) {
+		if(!strncmp(p, "size=", 5)) {
+			p += 5;
+			n = get_number(&p, 10);
+			switch(*p) {
+				case 'k':
+				case 'K':
+					n = (n + (PAGE_SIZE / 1024) - 1) / (PAGE_SIZE / 1024);
+					p++;
+					break;
+				case 'm':
+				case 'M':
+					n <<= 20 - PAGE_SHIFT;
+					p++;
+					break;
+				case 'g':
+				case 'G':
+					n <<= 30 - PAGE_SHIFT;
+					p++;
+					break;
+				case '%':
+					n = (kstat.total_mem_pages * MIN(n, 100)) / 100;
+					p++;
+					break;
+				default:
+					n = (n + PAGE_SIZE - 1) >> PAGE_SHIFT;
+					break;
+			}
+			*pages = n;
+		} else if(!strncmp(p, "nr_inodes=", 10)) {
+			p += 10;
+			*inodes = get_number(&p, 10);
+		} else if(!strncmp(p, "mode=", 5)) {
+			p += 5;
+			*mode = get_number(&p, 8) & (S_ISUID | S_ISGID | S_ISVTX | S_IRWXU | S_IRWXG | S_IRWXO);
+		} else {
+			printk("WARNING: %s(): unknown option '%s'.\n", __FUNCTION__, p);
+			return -EINVAL;
+		}
+		if(*p == ',') {
+			p++;
+		} else if(*p) {
+			printk("WARNING: %s(): invalid value in '%s'.\n", __FUNCTION__, options);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+void tmpfs_statfs(struct superblock *sb, struct statfs *statfsbuf)
+{
+	statfsbuf->f_type = TMPFS_MAGIC;
+	statfsbuf->f_bsize = PAGE_SIZE;
+	statfsbuf->f_blocks = sb->u.tmpfs.max_pages;
+	statfsbuf->f_bfree = 0;
+	if(sb->u.tmpfs.max_pages > sb->u.tmpfs.nr_pages) {
+		statfsbuf->f_bfree = sb->u.tmpfs.max_pages - sb->u.tmpfs.nr_pages;
+	}
+	statfsbuf->f_bavail = statfsbuf->f_bfree;
+	statfsbuf->f_files = sb->u.tmpfs.max_inodes;
+	statfsbuf->f_ffree = 0;
+	if(sb->u.tmpfs.max_inodes > sb->u.tmpfs.nr_inodes) {
+		statfsbuf->f_ffree = sb->u.tmpfs.max_inodes - sb->u.tmpfs.nr_inodes;
+	}
+	/* statfsbuf->f_fsid = ? */
+	statfsbuf->f_namelen = NAME_MAX;
+}
+
+int tmpfs_read_superblock(__dev_t dev, struct superblock *sb)
+{
+	struct tmpfs_node *root;
+	int errno;
+
+	superblock_lock(sb);
+	sb->dev = dev;
+	sb->fsop = &tmpfs_fsop;
+	sb->s_blocksize = PAGE_SIZE;
+
+	/* by default it can take up to half of the physical memory */
+	sb->u.tmpfs.max_pages = kstat.total_mem_pages / 2;
+	sb->u.tmpfs.max_inodes = kstat.total_mem_pages / 2;
+	sb->u.tmpfs.root_mode = S_ISVTX | S_IRWXU | S_IRWXG | S_IRWXO;
+	if((errno = parse_options(sb->options, &sb->u.tmpfs.max_pages, &sb->u.tmpfs.max_inodes, &sb->u.tmpfs.root_mode))) {
+		superblock_unlock(sb);
+		return errno;
+	}
+
+	if(!(sb->u.tmpfs.hash = (struct tmpfs_node **)kmalloc(TMPFS_HASH_SIZE * sizeof(struct tmpfs_node *)))) {
+		superblock_unlock(sb);
+		return -ENOMEM;
+	}
+	memset_b(sb->u.tmpfs.hash, 0, TMPFS_HASH_SIZE * sizeof(struct tmpfs_node *));
+
+	if(!(root = (struct tmpfs_node *)kmalloc(sizeof(struct tmpfs_node)))) {
+		kfree((unsigned int)sb->u.tmpfs.hash);
+		sb->u.tmpfs.hash = NULL;
+		superblock_unlock(sb);
+		return -ENOMEM;
+	}
+	memset_b(root, 0, sizeof(struct tmpfs_node));
+	root->ino = TMPFS_ROOT_INO;
+	root->mode = S_IFDIR | sb->u.tmpfs.root_mode;
+	root->nlink = 2;
+	root->atime = root->ctime = root->mtime = CURRENT_TIME;
+	root->parent = root;
+	sb->u.tmpfs.hash[TMPFS_HASH(root->ino)] = root;
+	sb->u.tmpfs.last_ino = TMPFS_ROOT_INO;
+	sb->u.tmpfs.nr_inodes = 1;
+
+	if(!(sb->root = iget(sb, TMPFS_ROOT_INO))) {
+		printk("WARNING: %s(): unable to get root inode.\n", __FUNCTION__);
+		kfree((unsigned int)root);
+		kfree((unsigned int)sb->u.tmpfs.hash);
+		sb->u.tmpfs.hash = NULL;
+		superblock_unlock(sb);
+		return -EINVAL;
+	}
+	superblock_unlock(sb);
+	return 0;
+}
+
+int tmpfs_remount_fs(struct superblock *sb, int flags)
+{
+	unsigned int pages, inodes;
+	__mode_t mode;
+	int errno;
+
+	pages = sb->u.tmpfs.max_pages;
+	inodes = sb->u.tmpfs.max_inodes;
+	mode = sb->u.tmpfs.root_mode;
+	if((errno = parse_options(sb->options, &pages, &inodes, &mode))) {
+		return errno;
+	}
+
+	/* the new limits can't be below the current usage */
+	if((pages && pages < sb->u.tmpfs.nr_pages) || (inodes && inodes < sb->u.tmpfs.nr_inodes)) {
+		return -EINVAL;
+	}
+
+	superblock_lock(sb);
+	sb->u.tmpfs.max_pages = pages;
+	sb->u.tmpfs.max_inodes = inodes;
+	superblock_unlock(sb);
+	return 0;
+}
+
+/* all the files go away with the filesystem */
+void tmpfs_release_superblock(struct superblock *sb)
+{
+	struct tmpfs_node *node;
+	struct tmpfs_dir_entry *d;
+	struct inode dummy_i;
+	int n;
+
+	if(!sb->u.tmpfs.hash) {
+		return;
+	}
+
+	superblock_lock(sb);
+	memset_b(&dummy_i, 0, sizeof(struct inode));
+	dummy_i.dev = sb->dev;
+	dummy_i.sb = sb;
+	for(n = 0; n < TMPFS_HASH_SIZE; n++) {
+		while((node = sb->u.tmpfs.hash[n])) {
+			sb->u.tmpfs.hash[n] = node->next_hash;
+			if(S_ISREG(node->mode)) {
+				dummy_i.inode = node->ino;
+				tmpfs_release_pages(&dummy_i, 0, node->size);
+			}
+			while((d = node->entries)) {
+				node->entries = d->next;
+				kfree((unsigned int)d->name);
+				kfree((unsigned int)d);
+			}
+			if(node->symlink) {
+				kfree((unsigned int)node->symlink);
+			}
+			kfree((unsigned int)node);
+		}
+	}
+	kfree((unsigned int)sb->u.tmpfs.hash);
+	sb->u.tmpfs.hash = NULL;
+	sb->u.tmpfs.nr_inodes = 0;
+	superblock_unlock(sb);
+}
+
+int tmpfs_init(void)
+{
+	return register_filesystem("tmpfs", &tmpfs_fsop);
+}
+#endif /* CONFIG_FS_TMPFS */
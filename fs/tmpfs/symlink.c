@@ -0,0 +1,116 @@
+/*
+ * fiwix/fs/tmpfs/symlink.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/process.h>
+#include <fiwix/stat.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_FS_TMPFS
+struct fs_operations tmpfs_symlink_fsop = {
+	0,
+	0,
+
+	NULL,			/* open */
+	NULL,			/* close */
+	NULL,			/* read */
+	NULL,			/* write */
+	NULL,			/* ioctl */
+	NULL,			/* llseek */
+	NULL,			/* readdir */
+	NULL,			/* readdir64 */
+	NULL,			/* mmap */
+	NULL,			/* select */
+
+	tmpfs_readlink,
+	tmpfs_followlink,
+	NULL,			/* bmap */
+	NULL,			/* lookup */
+	NULL,			/* rmdir */
+	NULL,			/* link */
+	NULL,			/* unlink */
+	NULL,			/* symlink */
+	NULL,			/* mkdir */
+	NULL,			/* mknod */
+	NULL,			/* truncate */
+	NULL,			/* create */
+	NULL,			/* rename */
+
+	NULL,			/* read_block */
+	NULL,			/* write_block */
+
+	NULL,			/* read_inode */
+	NULL,			/* write_inode */
+	NULL,			/* ialloc */
+	NULL,			/* ifree */
+	NULL,			/* statfs */
+	NULL,			/* read_superblock */
+	NULL,			/* remount_fs */
+	NULL,			/* write_superblock */
+	NULL			/* release_superblock */
+};
+
+int tmpfs_readlink(struct inode *i, char *buffer, __size_t count)
+{
+	struct tmpfs_node *node;
+
+	if(!S_ISLNK(i->i_mode)) {
+		printk("%s(): Oops, inode '%d' is not a symlink (!?).\n", __FUNCTION__, i->inode);
+		return 0;
+	}
+
+	inode_lock(i);
+	count = MIN(count, i->i_size);
+	if(!count || !(node = tmpfs_get_node(i->sb, i->inode))) {
+		inode_unlock(i);
+		return 0;
+	}
+	memcpy_b(buffer, node->symlink, count);
+	buffer[count] = 0;
+	inode_unlock(i);
+	return count;
+}
+
+int tmpfs_followlink(struct inode *dir, struct inode *i, struct inode **i_res)
+{
+	struct tmpfs_node *node;
+	__ino_t errno;
+
+	if(!i) {
+		return -ENOENT;
+	}
+
+	if(!S_ISLNK(i->i_mode)) {
+		printk("%s(): Oops, inode '%d' is not a symlink (!?).\n", __FUNCTION__, i->inode);
+		return 0;
+	}
+
+	if(current->loopcnt > MAX_SYMLINKS) {
+		iput(i);
+		printk("%s(): too many nested symbolic links!\n", __FUNCTION__);
+		return -ELOOP;
+	}
+
+	if(!(node = tmpfs_get_node(i->sb, i->inode))) {
+		iput(i);
+		return -ENOENT;
+	}
+
+	/* 'i' is kept until the end, since its node owns the name */
+	current->loopcnt++;
+	errno = parse_namei(node->symlink, dir, i_res, NULL, FOLLOW_LINKS);
+	current->loopcnt--;
+	iput(i);
+	return errno;
+}
+#endif /* CONFIG_FS_TMPFS */
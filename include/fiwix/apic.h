@@ -0,0 +1,128 @@
+/*
+ * fiwix/include/fiwix/apic.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_APIC_H
+#define _FIWIX_APIC_H
+
+#include <fiwix/config.h>
+#include <fiwix/sigcontext.h>
+
+#ifdef CONFIG_SMP
+
+#define LAPIC_DEF_ADDR		0xFEE00000	/* default local APIC address */
+#define IOAPIC_DEF_ADDR		0xFEC00000	/* default I/O APIC address */
+
+/* local APIC registers (offsets) */
+#define LAPIC_ID		0x020	/* local APIC ID */
+#define LAPIC_VER		0x030	/* local APIC version */
+#define LAPIC_TPR		0x080	/* task priority */
+#define LAPIC_EOI		0x0B0	/* end of interrupt */
+#define LAPIC_SVR		0x0F0	/* spurious interrupt vector */
+#define LAPIC_ESR		0x280	/* error status */
+#define LAPIC_ICR_LO		0x300	/* interrupt command (bits 0-31) */
+#define LAPIC_ICR_HI		0x310	/* interrupt command (bits 32-63) */
+#define LAPIC_LVT_TIMER		0x320	/* LVT timer */
+#define LAPIC_LVT_LINT0		0x350	/* LVT LINT0 */
+#define LAPIC_LVT_LINT1		0x360	/* LVT LINT1 */
+#define LAPIC_LVT_ERROR		0x370	/* LVT error */
+#define LAPIC_TIMER_ICR		0x380	/* timer initial count */
+#define LAPIC_TIMER_CCR		0x390	/* timer current count */
+#define LAPIC_TIMER_DCR		0x3E0	/* timer divide configuration */
+
+#define LAPIC_SVR_ENABLE	0x00000100	/* APIC software enable */
+#define LAPIC_DM_NMI		0x00000400	/* NMI delivery mode */
+#define LAPIC_DM_EXTINT		0x00000700	/* ExtINT delivery mode */
+#define LAPIC_LVT_MASKED	0x00010000	/* interrupt masked */
+#define LAPIC_TIMER_PERIODIC	0x00020000	/* periodic timer mode */
+#define LAPIC_TIMER_DIV16	0x03		/* divide the bus clock by 16 */
+
+/* interrupt command register */
+#define ICR_FIXED		0x00000000
+#define ICR_INIT		0x00000500
+#define ICR_STARTUP		0x00000600
+#define ICR_PENDING		0x00001000	/* delivery status */
+#define ICR_ASSERT		0x00004000
+#define ICR_LEVEL		0x00008000
+
+/* interrupt vectors used by the local APICs */
+#define LAPIC_TIMER_VECTOR	0xF0
+#define RESCHED_VECTOR		0xF1
+#define SPURIOUS_VECTOR		0xFF
+
+/* Intel MultiProcessor Specification v1.4 */
+#define MP_FLOAT_SIGNATURE	0x5F504D5F	/* "_MP_" */
+#define MP_CONFIG_SIGNATURE	0x504D4350	/* "PCMP" */
+
+#define MP_PROCESSOR		0
+#define MP_BUS			1
+#define MP_IOAPIC		2
+#define MP_IOINTERRUPT		3
+#define MP_LOCALINTERRUPT	4
+
+#define MP_CPU_ENABLED		0x01
+#define MP_CPU_BSP		0x02
+
+struct mp_float {
+	unsigned int signature;
+	unsigned int config_addr;	/* physical address of the table */
+	unsigned char length;		/* in 16 bytes units */
+	unsigned char spec_rev;
+	unsigned char checksum;
+	unsigned char feature[5];
+} __attribute__((packed));
+
+struct mp_config {
+	unsigned int signature;
+	unsigned short int length;
+	unsigned char spec_rev;
+	unsigned char checksum;
+	char oem_id[8];
+	char product_id[12];
+	unsigned int oem_table_addr;
+	unsigned short int oem_table_size;
+	unsigned short int entry_count;
+	unsigned int lapic_addr;
+	unsigned short int ext_table_length;
+	unsigned char ext_table_checksum;
+	unsigned char reserved;
+} __attribute__((packed));
+
+struct mp_processor {
+	unsigned char type;
+	unsigned char lapic_id;
+	unsigned char lapic_version;
+	unsigned char flags;
+	unsigned int signature;
+	unsigned int features;
+	unsigned int reserved[2];
+} __attribute__((packed));
+
+struct mp_ioapic {
+	unsigned char type;
+	unsigned char id;
+	unsigned char version;
+	unsigned char flags;
+	unsigned int addr;
+} __attribute__((packed));
+
+extern unsigned int lapic_addr;
+extern unsigned int ioapic_addr;
+
+#define lapic_read(reg)		(*(volatile unsigned int *)(lapic_addr + (reg)))
+#define lapic_write(reg, v)	(*(volatile unsigned int *)(lapic_addr + (reg)) = (v))
+
+int mp_init(void);
+void lapic_init(void);
+void lapic_eoi(void);
+void lapic_send_ipi(int, unsigned int);
+void lapic_timer_calibrate(void);
+void lapic_timer_init(void);
+void lapic_timer_irq(struct sigcontext);
+
+#endif /* CONFIG_SMP */
+
+#endif /* _FIWIX_APIC_H */
@@ -58,12 +58,31 @@ extern void irq13(void);
 extern void irq14(void);
 extern void irq15(void);
 extern void unknown_irq(void);
+extern void lapic_timer(void);
+extern void resched_irq(void);
+extern void spurious_irq(void);
 
 extern void switch_to_user_mode(void);
 extern void sighandler_trampoline(void);
 extern void end_sighandler_trampoline(void);
 extern void syscall(void);
+extern void sysenter_entry(void);
+extern void vsyscall_int80(void);
+extern void end_vsyscall_int80(void);
+extern void vsyscall_sysenter(void);
+extern void vsyscall_sysenter_return(void);
+extern void end_vsyscall_sysenter(void);
+extern void vdso_text(void);
+extern void vdso_clock_gettime(void);
+extern void vdso_gettimeofday(void);
+extern void vdso_time(void);
+extern void end_vdso_text(void);
 extern void return_from_syscall(void);
+extern void ret_from_fork(void);
+extern void ap_trampoline(void);
+extern void ap_trampoline_end(void);
+extern unsigned int ap_tramp_cr3;
+extern unsigned int ap_tramp_esp;
 extern void do_switch(unsigned int *, unsigned int *, unsigned int, unsigned int, unsigned int, unsigned short int);
 
 int cpuid(void);
@@ -89,16 +108,20 @@ void load_idt(unsigned int);
 void activate_kpage_dir(void);
 void load_tr(unsigned int);
 unsigned long long int get_rdtsc(void);
+void wrmsr(unsigned int, unsigned int, unsigned int);
 void invalidate_tlb(void);
 
 #define CLI() __asm__ __volatile__ ("cli":::"memory")
 #define STI() __asm__ __volatile__ ("sti":::"memory")
 #define NOP() __asm__ __volatile__ ("nop":::"memory")
 #define HLT() __asm__ __volatile__ ("hlt":::"memory")
+#define BARRIER() __asm__ __volatile__ ("":::"memory")
+#define MB() __asm__ __volatile__ ("lock; addl $0, 0(%%esp)":::"memory")
 
 #define GET_CR2(cr2) __asm__ __volatile__ ("movl %%cr2, %0" : "=r" (cr2));
 #define GET_ESP(esp) __asm__ __volatile__ ("movl %%esp, %0" : "=r" (esp));
 #define SET_ESP(esp) __asm__ __volatile__ ("movl %0, %%esp" :: "r" (esp));
+#define SET_CR3(cr3) __asm__ __volatile__ ("movl %0, %%cr3" :: "r" (cr3) : "memory");
 
 #define SAVE_FLAGS(flags)			\
 	__asm__ __volatile__(			\
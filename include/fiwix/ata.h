@@ -109,6 +109,14 @@
 #define ATA_READ_DMA		0xC8	/* read data using DMA */
 #define ATA_WRITE_DMA		0xCA	/* write data using DMA */
 
+/* ATA I/O commands (48 bit LBA) */
+#define ATA_READ_PIO_EXT	0x24	/* read sector(s) */
+#define ATA_READ_DMA_EXT	0x25	/* read data using DMA */
+#define ATA_READ_MULTIPLE_EXT	0x29	/* read multiple sectors */
+#define ATA_WRITE_PIO_EXT	0x34	/* write sector(s) */
+#define ATA_WRITE_DMA_EXT	0x35	/* write data using DMA */
+#define ATA_WRITE_MULTIPLE_EXT	0x39	/* write multiple sectors */
+
 /* ATA config commands */
 #define ATA_SET_MULTIPLE_MODE	0xC6
 #define ATA_PACKET		0xA0
@@ -141,6 +149,11 @@
 #define ATA_HAS_DMA		0x100	/* device supports Multi-word DMA */
 #define ATA_HAS_LBA		0x200
 #define ATA_MIN_LBA		16514064/* sectors limit for using CHS */
+#define ATA_MAX_LBA28		0x0FFFFFFF	/* last sector using LBA28 */
+#define ATA_MAX_SECCNT28	256	/* max. sectors per LBA28 command */
+
+/* command set supported bits (word 83) */
+#define ATA_HAS_LBA48		0x400	/* 48-bit Address feature set */
 
 /* general configuration bits */
 #define ATA_HAS_CURR_VALUES	0x01	/* current logical values are valid */
@@ -165,6 +178,12 @@
 #define DRIVE_HAS_RW_MULTIPLE	0x20
 #define DRIVE_HAS_DMA		0x40
 #define DRIVE_HAS_DATA32	0x80
+#define DRIVE_HAS_LBA48		0x100
+
+/* LBA48 is only used when the transfer can't be expressed with LBA28 */
+#define NEEDS_LBA48(drive, offset, nrsectors)				\
+	(((drive)->flags & DRIVE_HAS_LBA48) &&				\
+	((offset) + (nrsectors) > ATA_MAX_LBA28 || (nrsectors) > ATA_MAX_SECCNT28))
 
 #define PRDT_MARK_END		0x8000
 #define WAKEUP_AND_RETURN	1
@@ -232,7 +251,9 @@ struct ata_drv_ident {
 	unsigned short int reserved89;
 	unsigned short int reserved90;
 	unsigned short int curapm;		/* current APM values */
-	unsigned short int reserved92_126[35];
+	unsigned short int reserved92_99[8];
+	unsigned short int lba48_sectors[4];	/* sectors (LBA48 only) */
+	unsigned short int reserved104_126[23];
 	unsigned short int r_status_notif;	/* removable media status notif. */
 	unsigned short int security_status;	/* security status */
 	unsigned short int vendor_spec129_159[31];
@@ -252,6 +273,9 @@ struct xfer_data {
 	__blk_t block;
 	char *buffer;
 	int blksize;
+	struct blk_segment *seg;	/* segments list of the transfer */
+	int nr_segs;
+	int cur_seg;			/* segment being transferred (PIO) */
 	int sectors_to_io;
 	__off_t offset;
 	int minor;
@@ -271,8 +295,10 @@ struct ata_xfer {
 	int read_cmd;
 	void (*copy_write_fn)(unsigned int, void *, unsigned int);
 	int write_cmd;
+	int read_cmd48;
+	int write_cmd48;
 	char copy_raw_factor;		/* 2 for 16bit, 4 for 32bit */
-	struct prd prd_table;		/* Physical Region Descriptor table */
+	struct prd *prd_table;		/* Physical Region Descriptor table */
 	unsigned char bm_command;	/* bus master command register */
 	unsigned char bm_status;	/* bus master status register */
 	unsigned char bm_prd_addr;	/* bus master PRD table address */
@@ -343,6 +369,9 @@ int ata_open(struct inode *, struct fd *);
 int ata_close(struct inode *, struct fd *);
 int ata_read(__dev_t, __blk_t, char *, int);
 int ata_write(__dev_t, __blk_t, char *, int);
+int ata_read_segments(__dev_t, __blk_t, struct blk_segment *, int);
+int ata_write_segments(__dev_t, __blk_t, struct blk_segment *, int);
+int ata_max_segments(__dev_t);
 int ata_ioctl(struct inode *, struct fd *, int, unsigned int);
 __loff_t ata_llseek(struct inode *, __loff_t);
 void ata_init(void);
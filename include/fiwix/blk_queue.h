@@ -16,6 +16,19 @@
 #define BR_COMPLETED	2
 
 #define BRF_NOBLOCK	1
+#define BRF_NOREAD	2	/* block will be overwritten, don't read it */
+#define BRF_NOCACHE	4	/* read into br->buffer, bypassing the cache */
+
+#define BLK_MAX_SEGMENTS	32		/* max. requests merged in one */
+#define BLK_MAX_MERGE		(128 * 1024)	/* max. bytes of a merged request */
+
+#define NR_BLK_STATS		32	/* max. devices with I/O statistics */
+
+/* a piece of memory that takes part of a (merged) transfer */
+struct blk_segment {
+	char *data;
+	int size;
+};
 
 struct blk_request {
 	int status;
@@ -28,13 +41,33 @@ struct blk_request {
 	struct device *device;
 	int (*fn)(__dev_t, __blk_t, char *, int);
 	int left;
+	int nr_merged;			/* requests merged after this one */
+	unsigned int start_ticks;	/* when it was queued */
 	struct blk_request *next;
 	struct blk_request *next_group;
 	struct blk_request *head_group;
 };
 
+/* I/O statistics, in the same order as in /proc/diskstats */
+struct blk_stats {
+	__dev_t dev;
+	unsigned int ios[2];		/* completed requests (read, write) */
+	unsigned int merges[2];		/* requests merged into another one */
+	unsigned int sectors[2];	/* sectors transferred */
+	unsigned int ticks[2];		/* time spent by the requests */
+	unsigned int in_flight;		/* requests queued or in progress */
+	unsigned int io_ticks;		/* time with requests in flight */
+	unsigned int time_in_queue;	/* io_ticks weighted by in_flight */
+	unsigned int stamp;		/* last update of io_ticks */
+};
+
+extern struct blk_stats blk_stats_table[NR_BLK_STATS];
+
+struct blk_stats *find_blk_stats(__dev_t);
+struct blk_stats *get_blk_stats(__dev_t);
 void add_blk_request(struct blk_request *);
 int do_blk_request(struct device *, void *, struct buffer *);
 void run_blk_request(struct device *);
+void end_blk_request(struct blk_request *);
 
 #endif /* _FIWIX_BLKQUEUE_H */
@@ -16,6 +16,7 @@
 #define BUFFER_VALID	0x01
 #define BUFFER_LOCKED	0x02
 #define BUFFER_DIRTY	0x04
+#define BUFFER_DATA	0x08	/* file data also held by the page cache */
 
 #define BLK_READ	1
 #define BLK_WRITE	2
@@ -27,6 +28,8 @@ struct buffer {
 	int flags;
 	char *data;			/* block contents */
 	unsigned int mark;		/* a mark to identify a buffer */
+	unsigned int dirtied;		/* when it was marked as dirty (ticks) */
+	unsigned int dirty_seq;		/* order in which it was marked as dirty */
 	struct buffer *prev;
 	struct buffer *next;
 	struct buffer *prev_hash;
@@ -45,10 +48,12 @@ extern struct buffer **buffer_hash_table;
 /* value to be determined during system startup */
 extern unsigned int buffer_hash_table_size;	/* size in bytes */
 
+struct buffer *getblk(__dev_t, __blk_t, int);
 int gbread(struct device *, struct blk_request *);
 struct buffer *bread(__dev_t, __blk_t, int);
 void bwrite(struct buffer *);
 void brelse(struct buffer *);
+void bforget(struct buffer *);
 void sync_buffers(__dev_t);
 void invalidate_buffers(__dev_t);
 int reclaim_buffers(void);
@@ -10,7 +10,10 @@
 
 /* kernel tuning options */
 #define NR_PROCS		64	/* max. number of processes */
+#define NR_CPUS			8	/* max. number of processors (SMP) */
 #define NR_CALLOUTS		NR_PROCS	/* max. active callouts */
+#define NR_PTIMERS		NR_PROCS	/* max. number of POSIX timers */
+#define NR_PTIMERS_PROC		(NR_PTIMERS / 4)	/* max. POSIX timers per process */
 #define NR_MOUNT_POINTS		8	/* max. number of mounted filesystems */
 #define NR_OPENS		1024	/* max. number of opened files */
 #define NR_FLOCKS		(NR_PROCS * 5)	/* max. number of flocks */
@@ -24,6 +27,13 @@
 					   size of the buffer table */
 #define NR_BUF_RECLAIM		250	/* buffers reclaimed in a single shot */
 #define BUFFER_DIRTY_RATIO	5	/* % of dirty buffers in buffer cache */
+#define BUFFER_THROTTLE_RATIO	10	/* % of dirty buffers to throttle writers */
+#define BUFFER_DIRTY_EXPIRE	3000	/* centisecs a buffer can stay dirty */
+#define BUFFER_WRITEBACK	500	/* centisecs between kbdflushd runs */
+#define EXT2_PREALLOC_BLOCKS	8	/* min. blocks reserved on ext2 writes */
+#define ELF_PREFAULT_PAGES	8	/* pages of each ELF segment read on exec */
+#define PIPE_DEF_SIZE		(64 * 1024)	/* default size of a pipe */
+#define PIPE_MAX_SIZE		(1024 * 1024)	/* max. size of a pipe (users) */
 #define INODE_PERCENTAGE	5	/* % of memory for the inode table and
 					   hash table */
 #define INODE_HASH_PERCENTAGE	10	/* % of hash buckets relative to the
@@ -43,22 +53,28 @@
 #define CONFIG_PCI_NAMES
 #undef CONFIG_SYSCALL_6TH_ARG
 #define CONFIG_SYSVIPC
+#define CONFIG_POSIX_MQUEUE
 #define CONFIG_LAZY_USER_ADDR_CHECK
 #define CONFIG_BGA
 #undef CONFIG_KEXEC
 #define CONFIG_OFFSET64
 #undef CONFIG_VM_SPLIT22
 #undef CONFIG_FS_MINIX
+#define CONFIG_FS_TMPFS
 #undef CONFIG_MMAP2
 #define CONFIG_NET
+#define CONFIG_VIRTIO_NET
 #define CONFIG_PRINTK64
 #define CONFIG_PSAUX
 #define CONFIG_UNIX98_PTYS
+#undef CONFIG_SMP
+#undef CONFIG_PREEMPT
 
 
 /* configuration options to help debugging */
 #define CONFIG_VERBOSE_SEGFAULTS
 #undef CONFIG_QEMU_DEBUGCON
+#undef CONFIG_LATENCY_TRACER
 
 
 #ifdef CUSTOM_CONFIG_H
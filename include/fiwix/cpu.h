@@ -43,6 +43,11 @@
 
 #define RESERVED_DESC	0x80000000	/* TLB descriptor reserved */
 
+/* Model Specific Registers */
+#define MSR_SYSENTER_CS		0x174
+#define MSR_SYSENTER_ESP	0x175
+#define MSR_SYSENTER_EIP	0x176
+
 struct cpu {
 	char *vendor_id;
 	char family;
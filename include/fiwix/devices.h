@@ -16,12 +16,15 @@
 #define BLK_DEV		1	/* block device */
 #define CHR_DEV		2	/* character device */
 #define MAX_MINORS	256	/* maximum number of minors per device */
+#define UNNAMED_MAJOR	0	/* filesystems not backed by a device */
 #define MINOR_BITS	(MAX_MINORS / (sizeof(unsigned int) * 8))
 
 #define SET_MINOR(minors, bit)   ((minors[(bit) / 32]) |= (1 << ((bit) % 32)))
 #define CLEAR_MINOR(minors, bit) ((minors[(bit) / 32]) &= ~(1 << ((bit) % 32)))
 #define TEST_MINOR(minors, bit)	 ((minors[(bit) / 32]) & (1 << ((bit) % 32)))
 
+struct blk_segment;
+
 struct device {
 	char *name;
 	unsigned char major;
@@ -32,6 +35,11 @@ struct device {
 	void *requests_queue;
 	void *xfer_data;
 	struct device *next;
+
+	/* optional, for block devices that accept merged requests */
+	int (*read_segments)(__dev_t, __blk_t, struct blk_segment *, int);
+	int (*write_segments)(__dev_t, __blk_t, struct blk_segment *, int);
+	int (*max_segments)(__dev_t);
 };
 
 extern struct device *chr_device_table[NR_CHRDEV];
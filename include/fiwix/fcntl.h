@@ -40,11 +40,19 @@
 #define F_SETLK64	13
 #define F_SETLKW64	14
 #define F_DUPFD_CLOEXEC	1030	/* duplicate file descriptor with close-on-exec*/
+#define F_SETPIPE_SZ	1031	/* set the size of a pipe */
+#define F_GETPIPE_SZ	1032	/* get the size of a pipe */
 
 /* get/set process or process group ID to receive SIGURG signals */
 #define F_SETOWN	8	/* for sockets only */
 #define F_GETOWN	9	/* for sockets only */
 
+/* for splice(), tee() and vmsplice() */
+#define SPLICE_F_MOVE		1	/* move pages instead of copying */
+#define SPLICE_F_NONBLOCK	2	/* don't block on pipe I/O */
+#define SPLICE_F_MORE		4	/* more data will be coming */
+#define SPLICE_F_GIFT		8	/* pages passed in are a gift */
+
 /* for F_[GET|SET]FL */
 #define FD_CLOEXEC	1	/* close the file descriptor upon exec() */
 
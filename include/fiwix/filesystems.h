@@ -11,7 +11,7 @@
 #include <fiwix/types.h>
 #include <fiwix/limits.h>
 
-#define NR_FILESYSTEMS		6	/* supported filesystems */
+#define NR_FILESYSTEMS		8	/* supported filesystems */
 
 /* special device numbers for nodev filesystems */
 enum {
@@ -20,6 +20,7 @@ enum {
 	PIPE_DEV,
 	PROC_DEV,
 	SOCK_DEV,
+	MQUEUE_DEV,
 };
 
 struct filesystems {
@@ -45,6 +46,7 @@ struct filesystems *get_filesystem(const char *);
 void fs_init(void);
 
 struct superblock *get_superblock(__dev_t);
+__dev_t get_unnamed_dev(void);
 void sync_superblocks(__dev_t);
 int kern_mount(__dev_t, struct filesystems *);
 int mount_root(void);
@@ -104,6 +106,8 @@ int ext2_symlink(struct inode *, char *, char *);
 int ext2_mkdir(struct inode *, char *, __mode_t);
 int ext2_mknod(struct inode *, char *, __mode_t, __dev_t);
 int ext2_truncate(struct inode *, __off_t);
+void ext2_prealloc(struct inode *, int);
+void ext2_discard_prealloc(struct inode *);
 int ext2_create(struct inode *, char *, int, __mode_t, struct inode **);
 int ext2_rename(struct inode *, struct inode *, struct inode *, struct inode *, char *, char *);
 int ext2_read_inode(struct inode *);
@@ -119,12 +123,18 @@ int ext2_init(void);
 
 /* pipefs prototypes */
 int fifo_open(struct inode *, struct fd *);
+int pipefs_alloc(struct inode *, unsigned int);
+void pipefs_free(struct inode *);
+int pipefs_fcntl(struct inode *, int, unsigned int);
 int pipefs_close(struct inode *, struct fd *);
 int pipefs_read(struct inode *, struct fd *, char *, __size_t);
 int pipefs_write(struct inode *, struct fd *, const char *, __size_t);
 int pipefs_ioctl(struct inode *, struct fd *, int, unsigned int);
 __loff_t pipefs_llseek(struct inode *, __loff_t);
 int pipefs_select(struct inode *, struct fd *, int);
+int pipefs_splice(struct fd *, __loff_t *, struct fd *, __loff_t *, __size_t, unsigned int);
+int pipefs_tee(struct inode *, struct inode *, __size_t, unsigned int);
+int pipefs_vmsplice(struct fd *, const struct iovec *, unsigned int, unsigned int);
 int pipefs_ialloc(struct inode *, int);
 void pipefs_ifree(struct inode *);
 int pipefs_read_superblock(__dev_t, struct superblock *);
@@ -180,6 +190,54 @@ int sockfs_read_superblock(__dev_t, struct superblock *);
 int sockfs_init(void);
 #endif /* CONFIG_NET */
 
+#ifdef CONFIG_FS_TMPFS
+/* tmpfs prototypes */
+int tmpfs_file_open(struct inode *, struct fd *);
+int tmpfs_file_close(struct inode *, struct fd *);
+int tmpfs_file_write(struct inode *, struct fd *, const char *, __size_t);
+__loff_t tmpfs_file_llseek(struct inode *, __loff_t);
+int tmpfs_dir_open(struct inode *, struct fd *);
+int tmpfs_dir_close(struct inode *, struct fd *);
+int tmpfs_dir_read(struct inode *, struct fd *, char *, __size_t);
+int tmpfs_readdir(struct inode *, struct fd *, struct dirent *, __size_t);
+int tmpfs_readlink(struct inode *, char *, __size_t);
+int tmpfs_followlink(struct inode *, struct inode *, struct inode **);
+int tmpfs_lookup(const char *, struct inode *, struct inode **);
+int tmpfs_rmdir(struct inode *, struct inode *);
+int tmpfs_link(struct inode *, struct inode *, char *);
+int tmpfs_unlink(struct inode *, struct inode *, char *);
+int tmpfs_symlink(struct inode *, char *, char *);
+int tmpfs_mkdir(struct inode *, char *, __mode_t);
+int tmpfs_mknod(struct inode *, char *, __mode_t, __dev_t);
+int tmpfs_truncate(struct inode *, __off_t);
+int tmpfs_create(struct inode *, char *, int, __mode_t, struct inode **);
+int tmpfs_rename(struct inode *, struct inode *, struct inode *, struct inode *, char *, char *);
+int tmpfs_read_inode(struct inode *);
+int tmpfs_write_inode(struct inode *);
+int tmpfs_ialloc(struct inode *, int);
+void tmpfs_ifree(struct inode *);
+void tmpfs_statfs(struct superblock *, struct statfs *);
+int tmpfs_read_superblock(__dev_t, struct superblock *);
+int tmpfs_remount_fs(struct superblock *, int);
+void tmpfs_release_superblock(struct superblock *);
+int tmpfs_init(void);
+#endif /* CONFIG_FS_TMPFS */
+
+#ifdef CONFIG_POSIX_MQUEUE
+/* mqueue prototypes */
+int mqueue_close(struct inode *, struct fd *);
+int mqueue_select(struct inode *, struct fd *, int);
+int mqueue_ialloc(struct inode *, int);
+void mqueue_ifree(struct inode *);
+int mqueue_read_superblock(__dev_t, struct superblock *);
+int mqueue_init(void);
+
+int mqueue_open(const char *, int, __mode_t, struct mq_attr *);
+int mqueue_unlink(const char *);
+int mqueue_send(struct fd *, const char *, __size_t, unsigned int, const struct timespec *);
+int mqueue_receive(struct fd *, char *, __size_t, unsigned int *, const struct timespec *);
+#endif /* CONFIG_POSIX_MQUEUE */
+
 #ifdef CONFIG_UNIX98_PTYS
 /* devpts prototypes */
 int devpts_dir_open(struct inode *, struct fd *);
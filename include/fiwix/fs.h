@@ -19,6 +19,8 @@
 #include <fiwix/fs_iso9660.h>
 #include <fiwix/fs_proc.h>
 #include <fiwix/fs_sock.h>
+#include <fiwix/fs_tmpfs.h>
+#include <fiwix/fs_mqueue.h>
 
 #define BPS			512	/* bytes per sector */
 #define BLKSIZE_1K		1024	/* 1KB block size */
@@ -48,6 +50,7 @@
 
 #define FOR_READING	0
 #define FOR_WRITING	1
+#define FOR_OVERWRITING	2	/* the whole block will be overwritten */
 
 #define VERIFY_READ	1
 #define VERIFY_WRITE	2
@@ -98,6 +101,9 @@ struct inode {
 #ifdef CONFIG_NET
 		struct sockfs_inode sockfs;
 #endif /* CONFIG_NET */
+#ifdef CONFIG_POSIX_MQUEUE
+		struct mqueue_inode mqueue;
+#endif /* CONFIG_POSIX_MQUEUE */
 	} u;
 };
 extern struct inode *inode_table;
@@ -118,18 +124,23 @@ struct superblock {
 	struct fs_operations *fsop;
 	__u32 s_blocksize;
 	unsigned char s_blocksize_bits;
+	char *options;			/* only while (re)mounting */
 	union {
 #ifdef CONFIG_FS_MINIX
 		struct minix_sb_info minix;
 #endif /* CONFIG_FS_MINIX */
 		struct ext2_sb_info ext2;
 		struct iso9660_sb_info iso9660;
+#ifdef CONFIG_FS_TMPFS
+		struct tmpfs_sb_info tmpfs;
+#endif /* CONFIG_FS_TMPFS */
 	} u;
 };
 
 
 #define FSOP_REQUIRES_DEV	1	/* requires a block device */
 #define FSOP_KERN_MOUNT		2	/* mounted by kernel */
+#define FSOP_NO_BACKING		4	/* data lives only in the page cache */
 
 struct fs_operations {
 	int flags;
@@ -199,6 +210,7 @@ extern struct fs_operations ext2_file_fsop;
 extern struct fs_operations ext2_dir_fsop;
 extern struct fs_operations ext2_symlink_fsop;
 extern int ext2_balloc(struct superblock *);
+extern int ext2_balloc_run(struct superblock *, __blk_t, int *);
 extern void ext2_bfree(struct superblock *, int);
 
 /* fs_proc.h prototypes */
@@ -223,6 +235,21 @@ void check_rrip_inode(struct iso9660_directory_record *, struct inode *);
 int get_rrip_filename(struct iso9660_directory_record *, struct inode *, char *);
 int get_rrip_symlink(struct inode *, char *);
 
+#ifdef CONFIG_FS_TMPFS
+/* fs_tmpfs.h prototypes */
+extern struct fs_operations tmpfs_fsop;
+extern struct fs_operations tmpfs_file_fsop;
+extern struct fs_operations tmpfs_dir_fsop;
+extern struct fs_operations tmpfs_symlink_fsop;
+struct tmpfs_node *tmpfs_get_node(struct superblock *, __ino_t);
+void tmpfs_release_pages(struct inode *, __off_t, __off_t);
+#endif /* CONFIG_FS_TMPFS */
+
+#ifdef CONFIG_POSIX_MQUEUE
+/* fs_mqueue.h prototypes */
+extern struct fs_operations mqueue_fsop;
+#endif /* CONFIG_POSIX_MQUEUE */
+
 /* fs_devpts.h prototypes */
 extern struct fs_operations devpts_fsop;
 extern struct fs_operations devpts_dir_fsop;
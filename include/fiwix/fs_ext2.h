@@ -256,6 +256,8 @@ struct ext2_sb_info {
 struct ext2_i_info {
 	__u32	i_data[EXT2_N_BLOCKS];	/* Pointers to blocks */
 	__u32	i_dtime;
+	__u32	i_prealloc_block;	/* first block of the reserved run */
+	__u32	i_prealloc_count;	/* blocks left in the reserved run */
 };
 
 #endif	/* _FIWIX_FS_EXT2_H */
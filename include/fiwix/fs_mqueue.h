@@ -0,0 +1,51 @@
+/*
+ * fiwix/include/fiwix/fs_mqueue.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifdef CONFIG_POSIX_MQUEUE
+
+#ifndef _FIWIX_FS_MQUEUE_H
+#define _FIWIX_FS_MQUEUE_H
+
+#include <fiwix/types.h>
+#include <fiwix/time.h>
+
+#define NR_MQUEUES		64	/* max. number of named queues */
+#define MQ_PRIO_MAX		32768	/* priorities go from 0 to MQ_PRIO_MAX-1 */
+#define MQ_MAXMSG_DEF		10	/* default max. number of messages */
+#define MQ_MAXMSG_MAX		256	/* max. number of messages per queue */
+#define MQ_MSGSIZE_DEF		1024	/* default max. size of a message */
+#define MQ_MSGSIZE_MAX		(PAGE_SIZE - sizeof(struct mq_msg))
+
+/* sleep addresses of the processes waiting on a queue */
+#define MQ_RECV_WAIT(i)		(&(i)->u.mqueue.i_msgs)
+#define MQ_SEND_WAIT(i)		(&(i)->u.mqueue.i_curmsgs)
+
+struct mq_attr {
+	long int mq_flags;		/* 0 or O_NONBLOCK */
+	long int mq_maxmsg;		/* max. number of messages */
+	long int mq_msgsize;		/* max. size of a message */
+	long int mq_curmsgs;		/* number of messages in queue */
+	long int __reserved[4];
+};
+
+/* the message text follows the header in the same allocation */
+struct mq_msg {
+	struct mq_msg *next;
+	unsigned int prio;
+	__size_t len;
+};
+
+struct mqueue_inode {
+	struct mq_msg *i_msgs;		/* highest priority first, then FIFO */
+	unsigned int i_maxmsg;
+	unsigned int i_msgsize;
+	unsigned int i_curmsgs;
+};
+
+#endif /* _FIWIX_FS_MQUEUE_H */
+
+#endif /* CONFIG_POSIX_MQUEUE */
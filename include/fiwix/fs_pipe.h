@@ -8,14 +8,41 @@
 #ifndef _FIWIX_FS_PIPE_H
 #define _FIWIX_FS_PIPE_H
 
+#include <fiwix/sleep.h>
+
+/* sleep addresses of the processes waiting on a pipe */
+#define PIPE_READ_WAIT(i)	(&(i)->u.pipefs.i_readers)
+#define PIPE_WRITE_WAIT(i)	(&(i)->u.pipefs.i_writers)
+
+#define PIPE_NR_BUFS(i)		((i)->u.pipefs.i_bufsize >> PAGE_SHIFT)
+#define PIPE_BUF_IDX(i, n)	(((i)->u.pipefs.i_curbuf + (n)) & (PIPE_NR_BUFS(i) - 1))
+#define PIPE_FREE_BUFS(i)	(PIPE_NR_BUFS(i) - (i)->u.pipefs.i_nrbufs - (i)->u.pipefs.i_reserved)
+
+#define PIPE_BUF_PRIVATE	0x01	/* page owned by the pipe (appendable) */
+
 extern struct fs_operations pipefs_fsop;
 
+struct pipe_buffer {
+	struct page *page;		/* page holding the data */
+	unsigned int offset;		/* offset of the data in the page */
+	unsigned int len;		/* length of the data */
+	unsigned int flags;
+};
+
 struct pipefs_inode {
-	char *i_data;			/* buffer */
-	unsigned int i_readoff;		/* offset for reads */
-	unsigned int i_writeoff;	/* offset for writes */
+	struct pipe_buffer *i_bufs;	/* ring of page buffers */
+	unsigned int i_bufsize;		/* size of the pipe (power of 2) */
+	unsigned int i_curbuf;		/* first buffer with data */
+	unsigned int i_nrbufs;		/* number of buffers with data */
+	unsigned int i_reserved;	/* buffers held by splices in progress */
 	unsigned int i_readers;		/* number of readers */
 	unsigned int i_writers;		/* number of writers */
+	struct resource i_lock;		/* serializes access to the ring */
 };
 
+int pipe_lock_data(struct inode *, int);
+int pipe_lock_space(struct inode *, int);
+void pipe_add_page(struct inode *, struct page *, unsigned int, unsigned int, unsigned int);
+void pipe_consume(struct inode *, unsigned int);
+
 #endif /* _FIWIX_FS_PIPE_H */
@@ -8,6 +8,7 @@
 #ifndef _FIWIX_FS_PROC_H
 #define _FIWIX_FS_PROC_H
 
+#include <fiwix/config.h>
 #include <fiwix/types.h>
 
 #define PROC_ROOT_INO		1	/* root inode */
@@ -20,7 +21,7 @@
 #define PROC_FD_INO		0x50000000	/* base for FD inodes */
 #define PROC_FD_LEV		2	/* array level for FDs */
 
-#define PROC_ARRAY_ENTRIES	25
+#define PROC_ARRAY_ENTRIES	26
 
 enum pid_dir_inodes {
 	PROC_PID_FD = PROC_PID_INO + 1001,
@@ -57,9 +58,13 @@ int data_proc_buddyinfo(char *, __pid_t);
 int data_proc_cmdline(char *, __pid_t);
 int data_proc_cpuinfo(char *, __pid_t);
 int data_proc_devices(char *, __pid_t);
+int data_proc_diskstats(char *, __pid_t);
 int data_proc_dma(char *, __pid_t);
 int data_proc_filesystems(char *, __pid_t);
 int data_proc_interrupts(char *, __pid_t);
+#ifdef CONFIG_LATENCY_TRACER
+int data_proc_latency(char *, __pid_t);
+#endif /* CONFIG_LATENCY_TRACER */
 int data_proc_loadavg(char *, __pid_t);
 int data_proc_locks(char *, __pid_t);
 int data_proc_meminfo(char *, __pid_t);
@@ -72,6 +77,7 @@ int data_proc_stat(char *, __pid_t);
 int data_proc_uptime(char *, __pid_t);
 int data_proc_fullversion(char *, __pid_t);
 int data_proc_unix(char *, __pid_t);
+int data_proc_net_dev(char *, __pid_t);
 int data_proc_pci_devices(char *, __pid_t);
 int data_proc_buffernr(char *, __pid_t);
 int data_proc_domainname(char *, __pid_t);
@@ -84,6 +90,10 @@ int data_proc_osrelease(char *, __pid_t);
 int data_proc_ostype(char *, __pid_t);
 int data_proc_version(char *, __pid_t);
 int data_proc_dirty_background_ratio(char *, __pid_t);
+int data_proc_dirty_expire_centisecs(char *, __pid_t);
+int data_proc_dirty_ratio(char *, __pid_t);
+int data_proc_dirty_writeback_centisecs(char *, __pid_t);
+int data_proc_pipe_max_size(char *, __pid_t);
 
 /* PID related functions */
 int data_proc_pid_fd(char *, __pid_t, __ino_t);
@@ -0,0 +1,61 @@
+/*
+ * fiwix/include/fiwix/fs_tmpfs.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifdef CONFIG_FS_TMPFS
+
+#ifndef _FIWIX_FS_TMPFS_H
+#define _FIWIX_FS_TMPFS_H
+
+#include <fiwix/types.h>
+
+#define TMPFS_ROOT_INO		1	/* root inode */
+#define TMPFS_MAGIC		0x01021994	/* same as in Linux */
+
+#define TMPFS_HASH_SIZE		256	/* must be a power of 2 */
+#define TMPFS_HASH(ino)		((ino) & (TMPFS_HASH_SIZE - 1))
+
+struct tmpfs_dir_entry {
+	struct tmpfs_node *node;
+	char *name;
+	struct tmpfs_dir_entry *next;
+};
+
+/*
+ * The contents of an inode while it is not in the inode table. Data pages
+ * live in the page cache, where they are pinned as long as the file exists.
+ */
+struct tmpfs_node {
+	__ino_t ino;
+	__mode_t mode;
+	__u32 uid;
+	__u32 gid;
+	__size_t size;
+	__u32 atime;
+	__u32 ctime;
+	__u32 mtime;
+	__nlink_t nlink;
+	__blk_t blocks;
+	__dev_t rdev;				/* device files */
+	char *symlink;				/* symbolic links */
+	struct tmpfs_dir_entry *entries;	/* directories */
+	struct tmpfs_node *parent;		/* directories */
+	struct tmpfs_node *next_hash;
+};
+
+struct tmpfs_sb_info {
+	struct tmpfs_node **hash;	/* nodes indexed by inode number */
+	__ino_t last_ino;
+	unsigned int max_pages;		/* 'size=' */
+	unsigned int nr_pages;
+	unsigned int max_inodes;	/* 'nr_inodes=' */
+	unsigned int nr_inodes;
+	__mode_t root_mode;		/* 'mode=' */
+};
+
+#endif /* _FIWIX_FS_TMPFS_H */
+
+#endif /* CONFIG_FS_TMPFS */
@@ -0,0 +1,65 @@
+/*
+ * fiwix/include/fiwix/futex.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_FUTEX_H
+#define _FIWIX_FUTEX_H
+
+#include <fiwix/types.h>
+#include <fiwix/time.h>
+
+#define FUTEX_WAIT		0
+#define FUTEX_WAKE		1
+#define FUTEX_FD		2	/* not supported */
+#define FUTEX_REQUEUE		3
+#define FUTEX_CMP_REQUEUE	4
+#define FUTEX_WAKE_OP		5
+
+#define FUTEX_PRIVATE_FLAG	128
+#define FUTEX_CLOCK_REALTIME	256
+#define FUTEX_CMD_MASK		~(FUTEX_PRIVATE_FLAG | FUTEX_CLOCK_REALTIME)
+
+/* FUTEX_WAKE_OP operations */
+#define FUTEX_OP_SET		0	/* *uaddr2 = oparg */
+#define FUTEX_OP_ADD		1	/* *uaddr2 += oparg */
+#define FUTEX_OP_OR		2	/* *uaddr2 |= oparg */
+#define FUTEX_OP_ANDN		3	/* *uaddr2 &= ~oparg */
+#define FUTEX_OP_XOR		4	/* *uaddr2 ^= oparg */
+#define FUTEX_OP_OPARG_SHIFT	8	/* use (1 << oparg) as operand */
+
+/* FUTEX_WAKE_OP comparisons */
+#define FUTEX_OP_CMP_EQ		0
+#define FUTEX_OP_CMP_NE		1
+#define FUTEX_OP_CMP_LT		2
+#define FUTEX_OP_CMP_LE		3
+#define FUTEX_OP_CMP_GT		4
+#define FUTEX_OP_CMP_GE		5
+
+#define FUTEX_HASH_SIZE		64	/* must be a power of 2 */
+
+/*
+ * Private futexes are identified by the address space and the virtual
+ * address, shared ones by the physical page and the offset within it.
+ */
+struct futex_key {
+	unsigned int word;		/* page directory or physical page */
+	unsigned int offset;		/* virtual address or page offset */
+};
+
+struct futex_waiter {
+	struct futex_key key;
+	struct proc *p;
+	int woken;
+	struct futex_waiter *prev;
+	struct futex_waiter *next;
+};
+
+int futex_wait(int *, int, unsigned int, int);
+int futex_wake(int *, int, int);
+int futex_requeue(int *, int *, int, int, int, int, int);
+int futex_wake_op(int *, int *, int, int, int, int);
+
+#endif /* _FIWIX_FUTEX_H */
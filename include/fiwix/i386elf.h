@@ -233,6 +233,8 @@ typedef struct elf32_rela{
 #define AT_EUID   12	/* effective uid */
 #define AT_GID    13	/* real gid */
 #define AT_EGID   14	/* effective gid */
+#define AT_SYSINFO 32	/* entry point of the vsyscall page */
+#define AT_SYSINFO_EHDR 33	/* address of the vDSO */
 
 
 typedef struct dynamic{
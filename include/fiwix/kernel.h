@@ -94,6 +94,7 @@ struct kernel_stat {
 	int cached;			/* memory used to cache file pages */
 	int shared;			/* pages with count > 1 */
 	int max_dirty_buffers;		/* max. number of dirty buffers */
+	int throttle_dirty_buffers;	/* dirty buffers to throttle writers */
 	int dirty_buffers;		/* dirty buffers (in KB) */
 	int nr_dirty_buffers;		/* current dirty buffers */
 	unsigned int random_seed;	/* next random seed */
@@ -9,7 +9,7 @@
 #define _FIWIX_LIMITS_H
 
 #define DEVNAME_MAX	50	/* device name length in mount table */
-#define ARG_MAX		32	/* length (in pages) of argv+env in 'execve' */
+#define ARG_MAX		32	/* min. length (in pages) of argv+env in 'execve' */
 #define CHILD_MAX	64	/* simultaneous processes per real user ID */
 #define LINK_MAX	255	/* maximum number of links to a file */
 #define MAX_CANON	255	/* bytes in a terminal canonical input queue */
@@ -90,17 +90,26 @@ void kfree(unsigned int);
 void page_lock(struct page *);
 void page_unlock(struct page *);
 struct page *get_free_page(void);
+struct page *get_free_contig_pages(int);
 struct page *search_page_hash(struct inode *, __off_t);
+void add_page_to_cache(struct page *, struct inode *, __off_t);
+void remove_page_from_cache(struct page *);
 void release_page(struct page *);
 int is_valid_page(int);
 void invalidate_inode_pages(struct inode *);
-void update_page_cache(struct inode *, __off_t, const char *, int);
+int update_page_cache(struct inode *, __off_t, const char *, int);
 int write_page(struct page *, struct inode *, __off_t, unsigned int);
+int bread_pages(struct page **, int, struct inode *, __off_t, char, char);
 int bread_page(struct page *, struct inode *, __off_t, char, char);
+int get_file_page(struct inode *, __off_t, struct page **);
 int file_read(struct inode *, struct fd *, char *, __size_t);
+int do_sendfile(struct fd *, struct fd *, __loff_t *, __size_t);
 void reserve_pages(unsigned int, unsigned int);
 void page_init(int);
 
+/* fault.c */
+void prefault_vma(struct vma *, int);
+
 /* memory.c */
 unsigned int map_kaddr(unsigned int *,unsigned int, unsigned int, unsigned int, int);
 void bss_init(void);
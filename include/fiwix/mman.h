@@ -43,6 +43,7 @@
 #define P_STACK		5	/* stack section */
 #define P_MMAP		6	/* mmap() section */
 #define P_SHM		7	/* shared memory section */
+#define P_VDSO		8	/* vsyscall page */
 
 /* compatibility flags */
 #define MAP_ANON	MAP_ANONYMOUS
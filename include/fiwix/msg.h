@@ -19,6 +19,8 @@
 #define MSGMNB		16384		/* total size of message queue */
 #define MSGTQL		1024		/* max. number of messages */
 
+#define MSG_TYPE_HASH	16		/* must be a power of 2 */
+
 #define MSG_STAT	11
 #define MSG_INFO	12
 
@@ -63,8 +65,36 @@ struct msg {
 	char *msg_spot;			/* message text address */
 	__time_t msg_stime;		/* msgsnd time */
 	short int msg_ts;		/* message text size */
+	struct msg *msg_prev;		/* previous message on queue */
+	struct msg *msg_tnext;		/* next message of the same type */
+};
+
+/* sub-queue with the messages of the same type, in order of arrival */
+struct msg_type {
+	int type;
+	struct msg *first;
+	struct msg *last;
+	struct msg_type *next;		/* next type (in ascending order) */
+	struct msg_type *next_hash;
+};
+
+/* a receiver sleeping until a message matches its type filter */
+struct msg_waiter {
+	int type;
+	int flags;
+	struct msg_waiter *next;
+};
+
+/* kernel-only part of a message queue */
+struct msg_queue {
+	struct msqid_ds ds;		/* must be the first member */
+	struct msg_type *types;
+	struct msg_type *hash[MSG_TYPE_HASH];
+	struct msg_waiter *waiters;
 };
 
+#define MSG_QUEUE(mq)	((struct msg_queue *)(mq))
+
 extern struct msqid_ds *msgque[];
 extern unsigned int num_queues;
 extern unsigned int num_msgs;
@@ -76,6 +106,12 @@ struct msqid_ds *msg_get_new_mq(void);
 void msg_release_mq(struct msqid_ds *);
 struct msg *msg_get_new_md(void);
 void msg_release_md(struct msg *);
+int msg_enqueue(struct msqid_ds *, struct msg *);
+struct msg *msg_find(struct msqid_ds *, int, int);
+void msg_dequeue(struct msqid_ds *, struct msg *);
+void msg_add_waiter(struct msqid_ds *, struct msg_waiter *);
+void msg_del_waiter(struct msqid_ds *, struct msg_waiter *);
+void msg_wakeup_receivers(struct msqid_ds *, int);
 int sys_msgsnd(int, const void *, __size_t, int);
 int sys_msgrcv(int, void *, __size_t, int, int);
 int sys_msgget(key_t, int);
@@ -13,7 +13,9 @@
 #include <fiwix/types.h>
 #include <fiwix/socket.h>
 #include <fiwix/fd.h>
+#include <fiwix/time.h>
 #include <fiwix/net/unix.h>
+#include <fiwix/net/inet.h>
 
 #define SYS_SOCKET	1
 #define SYS_BIND	2
@@ -30,8 +32,10 @@
 #define SYS_SHUTDOWN	13
 #define SYS_SETSOCKOPT	14
 #define SYS_GETSOCKOPT	15
-
-typedef unsigned int	socklen_t;
+#define SYS_SENDMSG	16
+#define SYS_RECVMSG	17
+#define SYS_RECVMMSG	19
+#define SYS_SENDMMSG	20
 
 struct socket {
 	short int state;
@@ -45,6 +49,7 @@ struct socket {
 	struct socket *next_queue;	/* next connection in queue */
 	union {
 		struct unix_info unix_info;
+		struct inet_info inet_info;
 	} u;
 };
 
@@ -66,6 +71,8 @@ struct proto_ops {
 	int (*recv)(struct socket *, struct fd *, char *, __size_t, int);
 	int (*sendto)(struct socket *, struct fd *, const char *, __size_t, int, const struct sockaddr *, int);
 	int (*recvfrom)(struct socket *, struct fd *, char *, __size_t, int, struct sockaddr *, int *);
+	int (*sendmsg)(struct socket *, struct fd *, const struct msghdr *, int);
+	int (*recvmsg)(struct socket *, struct fd *, struct msghdr *, int);
 	int (*read)(struct socket *, struct fd *, char *, __size_t);
 	int (*write)(struct socket *, struct fd *, const char *, __size_t);
 	int (*select)(struct socket *, int);
@@ -90,6 +97,10 @@ int send(int, const void *, __size_t, int);
 int recv(int, void *, __size_t, int);
 int sendto(int, const void *, __size_t, int, const struct sockaddr *, int);
 int recvfrom(int, void *, __size_t, int, struct sockaddr *, int *);
+int sendmsg(int, const struct msghdr *, int);
+int recvmsg(int, struct msghdr *, int);
+int sendmmsg(int, struct mmsghdr *, unsigned int, int);
+int recvmmsg(int, struct mmsghdr *, unsigned int, int, struct timespec *);
 int shutdown(int, int);
 int setsockopt(int, int, int, const void *, socklen_t);
 int getsockopt(int, int, int, void *, socklen_t *);
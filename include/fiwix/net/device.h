@@ -0,0 +1,63 @@
+/*
+ * fiwix/include/fiwix/net/device.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifdef CONFIG_NET
+
+#ifndef _FIWIX_NET_DEVICE_H
+#define _FIWIX_NET_DEVICE_H
+
+#define NETDEV_NAME_LEN		8
+#define NETDEV_ADDR_LEN		6	/* Ethernet hardware address */
+
+#define ETH_HLEN		14	/* Ethernet header length */
+#define ETH_DATA_LEN		1500	/* default Ethernet MTU */
+#define ETH_FRAME_LEN		(ETH_HLEN + ETH_DATA_LEN)
+
+/* flags */
+#define IFF_UP			0x01
+#define IFF_LOOPBACK		0x08
+#define IFF_RUNNING		0x40	/* link is up */
+
+/* features */
+#define NETIF_F_HW_CSUM		0x01	/* device computes the TX checksums */
+#define NETIF_F_RXCSUM		0x02	/* device verifies the RX checksums */
+
+#define NETIF_NO_CSUM		-1	/* 'csum_start' when no offload is requested */
+
+struct net_device_stats {
+	unsigned int rx_packets;
+	unsigned int tx_packets;
+	unsigned int rx_bytes;
+	unsigned int tx_bytes;
+	unsigned int rx_errors;
+	unsigned int tx_errors;
+	unsigned int rx_dropped;
+	unsigned int tx_dropped;
+};
+
+struct net_device {
+	char name[NETDEV_NAME_LEN];
+	int flags;
+	int mtu;
+	struct net_device_stats stats;
+	int features;
+	unsigned char addr[NETDEV_ADDR_LEN];
+	int (*xmit)(struct net_device *, const char *, int, int, int);
+	void *priv;			/* driver private data */
+	struct net_device *next;
+};
+
+extern struct net_device *net_device_head;
+extern struct net_device loopback_dev;
+
+void register_netdevice(struct net_device *);
+int dev_queue_xmit(struct net_device *, const char *, int, int, int);
+void netif_rx(struct net_device *, const char *, int, int);
+
+#endif /* _FIWIX_NET_DEVICE_H */
+
+#endif /* CONFIG_NET */
@@ -0,0 +1,93 @@
+/*
+ * fiwix/include/fiwix/net/inet.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifdef CONFIG_NET
+
+#ifndef _FIWIX_NET_INET_H
+#define _FIWIX_NET_INET_H
+
+#include <fiwix/types.h>
+#include <fiwix/sleep.h>
+#include <fiwix/net/packet.h>
+
+#define htons(x)	__bswap16(x)
+#define ntohs(x)	__bswap16(x)
+#define htonl(x)	__bswap32(x)
+#define ntohl(x)	__bswap32(x)
+
+/* 127.0.0.0/8 */
+#define IS_LOOPBACK(addr)	((ntohl(addr) >> 24) == 127)
+
+#define INET_PORT_FIRST		32768	/* range of ephemeral ports */
+#define INET_PORT_LAST		60999
+#define INET_PORT_RESERVED	1024	/* only the superuser can bind below */
+
+#define INET_DEF_SNDBUF		(64 * 1024)
+#define INET_DEF_RCVBUF		(64 * 1024)
+#define INET_MIN_BUF		2048
+#define INET_MAX_BUF		(1024 * 1024)
+#define INET_MAX_SEGMENT	(PAGE_SIZE - sizeof(struct packet))
+#define INET_MAX_DGRAM		PAGE_SIZE
+
+/* options */
+#define INET_REUSEADDR		0x01
+#define INET_KEEPALIVE		0x02
+#define INET_NODELAY		0x04
+
+/* shutdown */
+#define INET_RCV_SHUTDOWN	0x01
+#define INET_SND_SHUTDOWN	0x02
+
+/* AF_INET */
+struct inet_info {
+	struct socket *socket;
+	unsigned int laddr;		/* local address */
+	unsigned short int lport;	/* local port (0 if not bound) */
+	unsigned int faddr;		/* foreign address */
+	unsigned short int fport;	/* foreign port (0 if not connected) */
+	int options;
+	int shutdown;
+	int error;			/* pending error (SO_ERROR) */
+	struct packet *packet_queue;	/* received data */
+	struct resource lock;		/* protects the queues */
+	int sndbuf;			/* SO_SNDBUF */
+	int rcvbuf;			/* SO_RCVBUF (TCP receive window) */
+	int rcv_queued;			/* bytes in the packet queue */
+	struct packet *backlog;		/* TCP data sent before the accept() */
+	int backlog_len;
+	struct socket *listener;	/* listening socket until accepted */
+	struct inet_info *peer;		/* other end of a TCP connection */
+	struct inet_info *next;
+};
+
+extern struct inet_info *inet_socket_head;
+
+extern struct proto_ops inet_ops;
+
+int inet_create(struct socket *);
+void inet_free(struct socket *);
+int inet_bind(struct socket *, const struct sockaddr *, int);
+int inet_connect(struct socket *, const struct sockaddr *, int);
+int inet_accept(struct socket *, struct socket *);
+int inet_getname(struct socket *, struct sockaddr *, int *, int);
+int inet_send(struct socket *, struct fd *, const char *, __size_t, int);
+int inet_recv(struct socket *, struct fd *, char *, __size_t, int);
+int inet_sendto(struct socket *, struct fd *, const char *, __size_t, int, const struct sockaddr *, int);
+int inet_recvfrom(struct socket *, struct fd *, char *, __size_t, int, struct sockaddr *, int *);
+int inet_sendmsg(struct socket *, struct fd *, const struct msghdr *, int);
+int inet_recvmsg(struct socket *, struct fd *, struct msghdr *, int);
+int inet_read(struct socket *, struct fd *, char *, __size_t);
+int inet_write(struct socket *, struct fd *, const char *, __size_t);
+int inet_select(struct socket *, int);
+int inet_shutdown(struct socket *, int);
+int inet_setsockopt(struct socket *, int, int, const void *, unsigned int);
+int inet_getsockopt(struct socket *, int, int, void *, unsigned int *);
+int inet_init(void);
+
+#endif /* _FIWIX_NET_INET_H */
+
+#endif /* CONFIG_NET */
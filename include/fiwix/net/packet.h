@@ -11,16 +11,35 @@
 #define _FIWIX_NET_PACKET_H
 
 #include <fiwix/types.h>
+#include <fiwix/socket.h>
+
+#define PACKET_SLOT_SIZE	256	/* size of a packet in the pool */
+#define PACKET_POOL_PAGES	16	/* max. number of pages in the pool */
+
+/* flags */
+#define PACKET_POOL	0x01	/* packet (and its data) belongs to the pool */
+#define PACKET_EXTDATA	0x02	/* data was allocated separately */
 
 struct packet {
 	char *data;
 	int len;
 	__off_t offset;
+	int flags;
 	struct socket *socket;
+	struct ucred cred;		/* credentials of the sender */
+	unsigned int addr;		/* source address (AF_INET) */
+	unsigned short int port;	/* source port (AF_INET) */
+	int nr_fds;			/* descriptors in flight (SCM_RIGHTS) */
+	int *fds;			/* indexes in fd_table */
 	struct packet *prev;
 	struct packet *next;
 };
 
+#define PACKET_INLINE_SIZE	(PACKET_SLOT_SIZE - sizeof(struct packet))
+
+struct packet *packet_alloc(int);
+void packet_free(struct packet *);
+int packet_msg_size(const struct msghdr *, int);
 struct packet *peek_packet(struct packet *);
 struct packet *remove_packet_from_queue(struct packet **);
 void append_packet_to_queue(struct packet *, struct packet **);
@@ -11,8 +11,15 @@
 #define _FIWIX_NET_UNIX_H
 
 #include <fiwix/types.h>
+#include <fiwix/sleep.h>
 #include <fiwix/net/packet.h>
 
+#define UNIX_DEF_SNDBUF		(64 * 1024)	/* default datagram buffer sizes */
+#define UNIX_DEF_RCVBUF		(64 * 1024)
+#define UNIX_MIN_BUF		2048
+#define UNIX_MAX_BUF		(1024 * 1024)
+#define UNIX_MAX_DGRAM		PAGE_SIZE	/* max. size of a datagram */
+
 /* AF_UNIX */
 struct unix_info {
 	int count;
@@ -25,6 +32,12 @@ struct unix_info {
 	struct inode *inode;
 	struct socket *socket;
 	struct packet *packet_queue;
+	struct resource lock;		/* protects the packet queue */
+	int sndbuf;			/* SO_SNDBUF */
+	int rcvbuf;			/* SO_RCVBUF */
+	int snd_queued;			/* bytes sent but not yet received */
+	int rcv_queued;			/* bytes in the packet queue */
+	int passcred;			/* SO_PASSCRED */
 	struct unix_info *peer;
 	struct unix_info *next;
 };
@@ -44,6 +57,8 @@ int unix_send(struct socket *, struct fd *, const char *, __size_t, int);
 int unix_recv(struct socket *, struct fd *, char *, __size_t, int);
 int unix_sendto(struct socket *, struct fd *, const char *, __size_t, int, const struct sockaddr *, int);
 int unix_recvfrom(struct socket *, struct fd *, char *, __size_t, int, struct sockaddr *, int *);
+int unix_sendmsg(struct socket *, struct fd *, const struct msghdr *, int);
+int unix_recvmsg(struct socket *, struct fd *, struct msghdr *, int);
 int unix_read(struct socket *, struct fd *, char *, __size_t);
 int unix_write(struct socket *, struct fd *, const char *, __size_t);
 int unix_select(struct socket *, int);
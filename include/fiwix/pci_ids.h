@@ -42,6 +42,9 @@
 #define PCI_VENDOR_ID_REDHAT		0x1b36
 #define PCI_DEVICE_ID_QEMU_16550A	0x0002
 
+#define PCI_VENDOR_ID_QUMRANET		0x1af4
+#define PCI_DEVICE_ID_VIRTIO_NET	0x1000	/* legacy (transitional) device */
+
 #define PCI_VENDOR_ID_INTEL		0x8086
 #define PCI_DEVICE_ID_INTEL_82371SB_1	0x7010
 
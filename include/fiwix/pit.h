@@ -45,6 +45,7 @@
 
 void pit_beep_on(void);
 void pit_beep_off(unsigned int);
+void pit_delay(unsigned int);
 int pit_getcounter0(void);
 void pit_init(unsigned short int);
 
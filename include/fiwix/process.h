@@ -30,6 +30,8 @@ struct vma {
 #include <fiwix/time.h>
 #include <fiwix/resource.h>
 #include <fiwix/tty.h>
+#include <fiwix/segments.h>
+#include <fiwix/smp.h>
 
 #define IDLE		0		/* PID of idle */
 #define INIT		1		/* PID of /sbin/init */
@@ -41,6 +43,25 @@ struct vma {
 #define PF_PEXEC	0x00000002	/* has performed a sys_execve() */
 #define PF_USEREAL	0x00000004	/* use real UID in permission checks */
 #define PF_NOTINTERRUPT	0x00000008	/* non-interruptible sleeping */
+#define PF_VFORK	0x00000010	/* parent waits until exec or exit */
+#define PF_GROUPEXIT	0x00000020	/* killed by exit_group() */
+
+/* clone() flags */
+#define CSIGNAL			0x000000FF	/* signal sent to parent on exit */
+#define CLONE_VM		0x00000100	/* share the address space */
+#define CLONE_FS		0x00000200	/* (not supported) */
+#define CLONE_FILES		0x00000400	/* share the file descriptors */
+#define CLONE_SIGHAND		0x00000800	/* share the signal handlers */
+#define CLONE_PTRACE		0x00002000	/* (not supported) */
+#define CLONE_VFORK		0x00004000	/* parent sleeps until exec or exit */
+#define CLONE_PARENT		0x00008000	/* same parent as the caller */
+#define CLONE_THREAD		0x00010000	/* same thread group */
+#define CLONE_SYSVSEM		0x00040000	/* (not supported) */
+#define CLONE_SETTLS		0x00080000	/* set a TLS descriptor */
+#define CLONE_PARENT_SETTID	0x00100000	/* store TID in the parent */
+#define CLONE_CHILD_CLEARTID	0x00200000	/* clear TID in the child on exit */
+#define CLONE_DETACHED		0x00400000	/* (ignored) */
+#define CLONE_CHILD_SETTID	0x01000000	/* store TID in the child */
 
 #define MMAP_START	0x40000000	/* mmap()s start at 1GB */
 #define IS_SUPERUSER	(current->euid == 0)
@@ -48,10 +69,11 @@ struct vma {
 #define IO_BITMAP_SIZE	8192		/* 8192*8bit = all I/O address space */
 
 #define PG_LEADER(p)	((p)->pid == (p)->pgid)
+#define TG_LEADER(p)	((p)->pid == (p)->tgid)
 #define SESS_LEADER(p)	((p)->pid == (p)->pgid && (p)->pid == (p)->sid)
 
 #define FOR_EACH_PROCESS(p)		p = proc_table_head->next ; while(p)
-#define FOR_EACH_PROCESS_RUNNING(p)	p = proc_run_head ; while(p)
+#define FOR_EACH_PROCESS_RUNNING(cpu, p)	p = (cpu)->run_head ; while(p)
 
 /* value to be determined during system startup */
 extern unsigned int proc_table_size;	/* size in bytes */
@@ -62,7 +84,8 @@ extern __pid_t lastpid;
 extern struct proc *proc_table_head;
 
 struct binargs {
-	unsigned int page[ARG_MAX];
+	unsigned int *page;		/* pages holding the strings */
+	int pages;			/* size of page[] */
 	int argc;
 	int argv_len;
 	int envc;
@@ -70,6 +93,28 @@ struct binargs {
 	int offset;
 };
 
+/*
+ * Resources that can be shared between the processes created with clone().
+ * Each one is released when the last process using it is removed.
+ */
+struct mm_struct {
+	int count;			/* number of processes sharing it */
+	struct vma *vma_table;		/* virtual memory-map addresses */
+	unsigned int brk_lower;		/* lower limit of the heap section */
+	unsigned int brk;		/* current limit of the heap */
+};
+
+struct files_struct {
+	int count;			/* number of processes sharing it */
+	unsigned short int fd[OPEN_MAX];
+	unsigned char fd_flags[OPEN_MAX];
+};
+
+struct sighand_struct {
+	int count;			/* number of processes sharing it */
+	struct sigaction sigaction[NSIG];
+};
+
 /* Intel 386 Task Switch State */
 struct i386tss {
 	unsigned int prev_tss;
@@ -106,6 +151,7 @@ struct proc {
 	struct i386tss tss;
 	struct proc *ppid;		/* pointer to parent process */
 	__pid_t pid;			/* process ID */
+	__pid_t tgid;			/* thread group ID */
 	__pid_t pgid;			/* process group ID */
 	__pid_t sid;			/* session ID */
 	int flags;
@@ -115,6 +161,13 @@ struct proc {
 	int state;			/* process state */
 	int priority;
 	int cpu_count;			/* time of process running */
+	int cpu;			/* CPU whose run queue holds it */
+#ifdef CONFIG_SMP
+	int lock_depth;			/* nesting of the kernel lock */
+#endif /* CONFIG_SMP */
+#ifdef CONFIG_PREEMPT
+	int preempt_count;		/* preemption is allowed only if zero */
+#endif /* CONFIG_PREEMPT */
 	__time_t start_time;
 	int exit_code;	
 	void *sleep_address;
@@ -124,8 +177,7 @@ struct proc {
 	unsigned short int egid;	/* effective group ID */
 	unsigned short int suid;	/* saved user ID */
 	unsigned short int sgid;	/* saved group ID */
-	unsigned short int fd[OPEN_MAX];
-	unsigned char fd_flags[OPEN_MAX];
+	struct files_struct *files;	/* file descriptors */
 	struct inode *root;
 	struct inode *pwd;		/* process working directory */
 	unsigned int entry_address;
@@ -135,13 +187,11 @@ struct proc {
 	int envc;
 	char **envp;
 	char pidstr[5];			/* PID number converted to string */
-	struct vma *vma_table;		/* virtual memory-map addresses */
-	unsigned int brk_lower;		/* lower limit of the heap section */
-	unsigned int brk;		/* current limit of the heap */
+	struct mm_struct *mm;		/* address space */
 	__sigset_t sigpending;
 	__sigset_t sigblocked;
 	__sigset_t sigexecuting;
-	struct sigaction sigaction[NSIG];
+	struct sighand_struct *sighand;	/* signal handlers */
 	struct sigcontext sc[NSIG];	/* each signal has its own context */
 	unsigned int sp;		/* current process' stack frame */
 	struct rusage usage;		/* process resource usage */
@@ -154,6 +204,9 @@ struct proc {
 	unsigned int rss;
 	__mode_t umask;
 	unsigned char loopcnt;		/* nested symlinks counter */
+	int *set_child_tid;		/* CLONE_CHILD_SETTID */
+	int *clear_child_tid;		/* CLONE_CHILD_CLEARTID */
+	struct seg_desc tls[NR_TLS_ENTRIES];	/* thread-local storage */
 #ifdef CONFIG_SYSVIPC
 	struct sem_undo *semundo;
 #endif /* CONFIG_SYSVIPC */
@@ -165,8 +218,13 @@ struct proc {
 	struct proc *next_run;
 };
 
-extern struct proc *current;
+/* the process running in this CPU */
+#define current		(THIS_CPU->current_proc)
+
 extern struct proc *proc_table;
+extern struct mm_struct kernel_mm;
+extern struct files_struct kernel_files;
+extern struct sighand_struct kernel_sighand;
 
 int can_signal(struct proc *);
 int send_sig(struct proc *, __sigset_t);
@@ -174,6 +232,7 @@ int send_sig(struct proc *, __sigset_t);
 void add_crusage(struct proc *, struct rusage *);
 void get_rusage(struct proc *, struct rusage *);
 void add_rusage(struct proc *);
+int has_live_threads(struct proc *);
 struct proc *get_next_zombie(struct proc *);
 __pid_t remove_zombie(struct proc *);
 int is_orphaned_pgrp(__pid_t);
@@ -181,12 +240,21 @@ struct proc *get_proc_free(void);
 void release_proc(struct proc *);
 int get_unused_pid(void);
 struct proc *get_proc_by_pid(__pid_t);
+struct mm_struct *get_mm(void);
+void release_mm(struct proc *);
+struct files_struct *get_files(void);
+void release_files(struct proc *);
+struct sighand_struct *get_sighand(void);
+void release_sighand(struct proc *);
+void release_vfork(struct proc *);
+void reap_threads(struct proc *);
 
 struct proc *kernel_process(const char *, int (*fn)(void));
 void proc_slot_init(struct proc *);
 void proc_init(void);
 
 int elf_load(struct inode *, struct binargs *, struct sigcontext *, char *);
+void release_resident_interp(__dev_t);
 int script_load(char *, char *, char *);
 
 #endif /* _FIWIX_PROCESS_H */
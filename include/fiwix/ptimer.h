@@ -0,0 +1,36 @@
+/*
+ * fiwix/include/fiwix/ptimer.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_PTIMER_H
+#define _FIWIX_PTIMER_H
+
+#include <fiwix/types.h>
+#include <fiwix/time.h>
+#include <fiwix/signal.h>
+
+/* a POSIX per-process timer */
+struct ptimer {
+	__pid_t tgid;			/* owner process (0 = free slot) */
+	__pid_t pid;			/* thread to be signaled */
+	__pid_t tid;			/* thread that created it */
+	__clockid_t clock;
+	int signum;			/* 0 for SIGEV_NONE */
+	int overrun;			/* expirations while the signal was pending */
+	unsigned int value;		/* ticks until the next expiration */
+	unsigned int interval;		/* ticks between expirations */
+};
+
+int ptimer_create(__clockid_t, struct sigevent *);
+int ptimer_settime(__timer_t, int, const struct itimerspec *, struct itimerspec *);
+int ptimer_gettime(__timer_t, struct itimerspec *);
+int ptimer_getoverrun(__timer_t);
+int ptimer_delete(__timer_t);
+void release_ptimers(__pid_t);
+void run_ptimers(void);
+void account_ptimers(void);
+
+#endif /* _FIWIX_PTIMER_H */
@@ -27,6 +27,35 @@
 
 extern int need_resched;
 
+#ifdef CONFIG_LATENCY_TRACER
+struct latency_trace {
+	unsigned long long int start;	/* when the pending reschedule began */
+	unsigned int max_usecs;		/* longest wait for a reschedule */
+	__pid_t pid;			/* process that held the CPU meanwhile */
+	unsigned int eip;		/* where the CPU was finally given up */
+	unsigned int samples;
+};
+extern struct latency_trace latency;
+
+void latency_start(void);
+#define set_need_resched()						\
+	do { if(!need_resched) latency_start(); need_resched = 1; } while(0)
+#else
+#define set_need_resched()	do { need_resched = 1; } while(0)
+#endif /* CONFIG_LATENCY_TRACER */
+
+/*
+ * The code between preempt_disable() and preempt_enable() can't be preempted
+ * by an interrupt, though it still can sleep or call do_sched() voluntarily.
+ */
+#ifdef CONFIG_PREEMPT
+#define preempt_disable()	do { current->preempt_count++; } while(0)
+#define preempt_enable()	do { current->preempt_count--; } while(0)
+#else
+#define preempt_disable()	do { } while(0)
+#define preempt_enable()	do { } while(0)
+#endif /* CONFIG_PREEMPT */
+
 #define SI_LOAD_SHIFT   16
 
 /*
@@ -49,7 +78,12 @@ extern unsigned int avenrun[3];		/* Load averages */
 
 
 void do_sched(void);
+void cond_resched(void);
+#ifdef CONFIG_PREEMPT
+void preempt_irq(struct sigcontext *);
+#endif /* CONFIG_PREEMPT */
 void set_tss(struct proc *);
+void schedule_tail(void);
 void sched_init(void);
 
 #endif /* _FIWIX_SCHED_H */
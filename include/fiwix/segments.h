@@ -15,6 +15,7 @@
 #define USER_CS		0x18	/* user code segment */
 #define USER_DS		0x20	/* user data segment */
 #define TSS		0x28	/* TSS segment */
+#define PERCPU_DS	0x48	/* per-CPU data segment (SMP) */
 
 #define USER_PL		0x03	/* User Privilege Level 3 */
 
@@ -28,12 +29,15 @@
 
 #include <fiwix/types.h>
 
-#define NR_GDT_ENTRIES	6	/* entries in GDT descriptor */
+#define NR_GDT_ENTRIES	10	/* entries in GDT descriptor */
+#define TLS_ENTRY_MIN	6	/* first GDT entry for thread-local storage */
+#define NR_TLS_ENTRIES	3	/* GDT entries for thread-local storage */
 #define NR_IDT_ENTRIES	256	/* entries in IDT descriptor */
 
 /* low flags of Segment Descriptors */
 #define SD_CODE		0x0A	/* CODE Exec/Read */
 #define SD_DATA		0x02	/* DATA Read/Write */
+#define SD_EXPDOWN	0x04	/* DATA expand-down */
 
 #define SD_32INTRGATE	0x0E	/* 32-bit Interrupt Gate (0D110) */
 #define SD_32TRAPGATE	0x0F	/* 32-bit Trap Gate (0D111) */
@@ -46,11 +50,13 @@
 /* high flags Segment Descriptors */
 #define SD_OPSIZE32	0x04	/* 32-bit code and data segments */
 #define SD_PAGE4KB	0x08	/* page granularity (4KB) */
+#define SD_AVL		0x01	/* available for use by system software */
 
 /* low flags of the TSS Descriptors */
 #define SD_TSSPRESENT	0x89	/* TSS present and not busy flag */
 
 /* EFLAGS */
+#define EF_IF		9	/* IF bit */
 #define EF_IOPL		12	/* IOPL bit */
 
 struct desc_r {
@@ -74,6 +80,21 @@ struct gate_desc {
 	unsigned gd_hioffset: 16;	/* offset 16-31 bits */
 } __attribute__((packed));
 
+/* descriptor passed by set_thread_area() and get_thread_area() */
+struct user_desc {
+	unsigned int entry_number;
+	unsigned int base_addr;
+	unsigned int limit;
+	unsigned int seg_32bit:1;
+	unsigned int contents:2;
+	unsigned int read_exec_only:1;
+	unsigned int limit_in_pages:1;
+	unsigned int seg_not_present:1;
+	unsigned int useable:1;
+};
+
+void load_tls(struct seg_desc *);
+void set_tls_desc(struct seg_desc *, struct user_desc *);
 void gdt_init(void);
 void idt_init(void);
 
@@ -86,6 +86,28 @@ struct sigaction {
 
 #define SIG_MASK(sig)	(~(1 << ((sig) - 1)))
 
+/* notification types in 'sigevent' */
+#define SIGEV_SIGNAL	0	/* send a signal to the process */
+#define SIGEV_NONE	1	/* no notification */
+#define SIGEV_THREAD	2	/* (implemented by the C library) */
+#define SIGEV_THREAD_ID	4	/* send a signal to a specific thread */
+
+typedef union sigval {
+	int sival_int;
+	void *sival_ptr;
+} __sigval_t;
+
+struct sigevent {
+	__sigval_t sigev_value;
+	int sigev_signo;
+	int sigev_notify;
+	union {
+		int _pad[13];
+		int _tid;
+	} _sigev_un;
+};
+#define sigev_notify_thread_id	_sigev_un._tid
+
 #define	KERNEL		1	/* kernel is who has sent the signal */
 #define	USER		2	/* user is who has sent the signal */
 
@@ -8,24 +8,31 @@
 #ifndef _FIWIX_SLEEP_H
 #define _FIWIX_SLEEP_H
 
+/* defined before including process.h as some inodes embed a resource */
+struct resource {
+	char locked;
+	char wanted;
+};
+
 #include <fiwix/process.h>
 
 #define AREA_BH			0x00000001
 #define AREA_CALLOUT		0x00000002
 #define AREA_TTY_READ		0x00000004
 #define AREA_SERIAL_READ	0x00000008
+#define AREA_NET_POLL		0x00000010
 
-extern struct proc *proc_run_head;
-
-struct resource {
-	char locked;
-	char wanted;
-};
+/* process.h might be still incomplete at this point */
+struct proc;
+struct cpu_data;
 
+void rq_add(struct cpu_data *, struct proc *);
+void rq_del(struct cpu_data *, struct proc *);
 void runnable(struct proc *);
 void not_runnable(struct proc *, int);
 int sleep(void *, int);
 void wakeup(void *);
+void wakeup_one(void *);
 void wakeup_proc(struct proc *);
 
 void lock_resource(struct resource *);
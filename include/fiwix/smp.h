@@ -0,0 +1,74 @@
+/*
+ * fiwix/include/fiwix/smp.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_SMP_H
+#define _FIWIX_SMP_H
+
+#define SMP_TRAMPOLINE_ADDR	0x8000	/* real mode entry point of the APs */
+
+#ifndef ASM_FILE
+
+#include <fiwix/config.h>
+#include <fiwix/segments.h>
+#include <fiwix/spinlock.h>
+
+struct proc;
+
+/* per-CPU data */
+struct cpu_data {
+	struct cpu_data *self;		/* must be the first member */
+	int id;				/* logical CPU number */
+	int apic_id;			/* local APIC ID */
+	int online;
+	struct proc *current_proc;	/* process running in this CPU */
+	struct proc *idle;		/* idle process of this CPU */
+	struct spinlock rq_lock;	/* protects the run queue */
+	struct proc *run_head;		/* run queue */
+	int nr_running;			/* processes in the run queue */
+	int lock_depth;			/* nesting of the kernel lock */
+	struct seg_desc *gdt;		/* GDT of this CPU */
+};
+
+extern struct cpu_data cpu_data[NR_CPUS];
+extern int nr_cpus;
+
+#ifdef CONFIG_SMP
+/*
+ * In kernel mode the FS register selects a GDT descriptor based on the
+ * cpu_data of the processor, whose first member points to itself.
+ */
+static __inline__ struct cpu_data *this_cpu(void)
+{
+	struct cpu_data *cpu;
+
+	__asm__ __volatile__ ("movl %%fs:0, %0" : "=r" (cpu));
+	return cpu;
+}
+#define THIS_CPU	(this_cpu())
+#else
+#define THIS_CPU	(&cpu_data[0])
+#endif /* CONFIG_SMP */
+
+#define FOR_EACH_CPU(cpu)	for(cpu = &cpu_data[0]; cpu < &cpu_data[nr_cpus]; cpu++)
+
+void cpu_data_init(void);
+struct cpu_data *select_cpu(struct proc *);
+
+#ifdef CONFIG_SMP
+void gdt_init_ap(struct cpu_data *);
+void lock_kernel(void);
+void unlock_kernel(void);
+void smp_send_resched(struct cpu_data *);
+int smp_balance(void);
+void smp_resched_irq(void);
+void smp_ap_entry(void);
+void smp_init(void);
+#endif /* CONFIG_SMP */
+
+#endif /* ! ASM_FILE */
+
+#endif /* _FIWIX_SMP_H */
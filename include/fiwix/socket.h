@@ -14,10 +14,12 @@
 
 /* domains (families) */
 #define AF_UNIX		1	/* UNIX domain socket */
+#define AF_INET		2	/* Internet IP protocol */
 
 /* types */
 #define SOCK_STREAM	1
 #define SOCK_DGRAM	2
+#define SOCK_SEQPACKET	5
 
 /* maximum queue length specifiable by listen() */
 #define SOMAXCONN	128
@@ -31,11 +33,38 @@
 /* flags */
 #define SO_ACCEPTCONN		0x10000
 
+/* how for shutdown() */
+#define SHUT_RD			0
+#define SHUT_WR			1
+#define SHUT_RDWR		2
+
 /* flags for send() and recv() */
 #define MSG_PEEK		0x02
+#define MSG_CTRUNC		0x08
+#define MSG_TRUNC		0x20
 #define MSG_DONTWAIT		0x40
+#define MSG_NOSIGNAL		0x4000	/* no SIGPIPE on a broken stream */
+#define MSG_WAITFORONE		0x10000	/* recvmmsg() */
+#define MSG_CMSG_CLOEXEC	0x40000000 /* close-on-exec for SCM_RIGHTS */
+
+/* levels and options for setsockopt() and getsockopt() */
+#define SOL_SOCKET		1
+#define SO_REUSEADDR		2
+#define SO_TYPE			3
+#define SO_ERROR		4
+#define SO_SNDBUF		7
+#define SO_RCVBUF		8
+#define SO_KEEPALIVE		9
+#define SO_PASSCRED		16
+
+/* types of ancillary data (SOL_SOCKET level) */
+#define SCM_RIGHTS		1	/* file descriptors */
+#define SCM_CREDENTIALS		2	/* process credentials */
+
+#define SCM_MAX_FD		253	/* max. descriptors in a SCM_RIGHTS */
 
 typedef unsigned short int sa_family_t;
+typedef unsigned int socklen_t;
 
 
 /* generic socket address structure */
@@ -50,6 +79,66 @@ struct sockaddr_un {
         char sun_path[108];		/* socket filename */
 };
 
+/* Internet address */
+struct in_addr {
+	unsigned int s_addr;		/* network byte order */
+};
+
+/* Internet socket address structure */
+struct sockaddr_in {
+	sa_family_t sin_family;		/* AF_INET */
+	unsigned short int sin_port;	/* port, network byte order */
+	struct in_addr sin_addr;	/* Internet address */
+	char sin_zero[8];		/* pad to sizeof(struct sockaddr) */
+};
+
+#define INADDR_ANY		0x00000000
+#define INADDR_LOOPBACK		0x7F000001	/* 127.0.0.1 */
+
+/* protocols */
+#define IPPROTO_IP		0
+#define IPPROTO_TCP		6
+#define IPPROTO_UDP		17
+
+/* options for the IPPROTO_TCP level */
+#define TCP_NODELAY		1
+
+/* message header used by sendmsg() and recvmsg() */
+struct msghdr {
+	void *msg_name;			/* optional address */
+	socklen_t msg_namelen;		/* size of address */
+	struct iovec *msg_iov;		/* scatter/gather array */
+	__size_t msg_iovlen;		/* number of elements in msg_iov */
+	void *msg_control;		/* ancillary data */
+	__size_t msg_controllen;	/* ancillary data buffer length */
+	int msg_flags;			/* flags on received message */
+};
+
+/* header of each ancillary data object in msg_control */
+struct cmsghdr {
+	__size_t cmsg_len;		/* length including this header */
+	int cmsg_level;			/* originating protocol */
+	int cmsg_type;			/* protocol-specific type */
+};
+
+#define CMSG_ALIGN(len)	(((len) + sizeof(int) - 1) & ~(sizeof(int) - 1))
+#define CMSG_DATA(cmsg)	((unsigned char *)((struct cmsghdr *)(cmsg) + 1))
+#define CMSG_LEN(len)	(CMSG_ALIGN(sizeof(struct cmsghdr)) + (len))
+#define CMSG_SPACE(len)	(CMSG_ALIGN(sizeof(struct cmsghdr)) + CMSG_ALIGN(len))
+
+/* SCM_CREDENTIALS */
+struct ucred {
+	__pid_t pid;
+	unsigned int uid;
+	unsigned int gid;
+};
+
+/* array element used by sendmmsg() and recvmmsg() */
+struct mmsghdr {
+	struct msghdr msg_hdr;
+	unsigned int msg_len;		/* number of bytes transmitted */
+};
+
 #endif /* _FIWIX_SOCKET_H */
 
 #endif /* CONFIG_NET */
@@ -0,0 +1,53 @@
+/*
+ * fiwix/include/fiwix/spinlock.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_SPINLOCK_H
+#define _FIWIX_SPINLOCK_H
+
+#include <fiwix/config.h>
+#include <fiwix/asm.h>
+
+struct spinlock {
+	volatile unsigned int locked;
+};
+
+#define SPINLOCK_INIT	{ 0 }
+
+#ifdef CONFIG_SMP
+static __inline__ void spin_lock(struct spinlock *l)
+{
+	unsigned int v;
+
+	for(;;) {
+		v = 1;
+		__asm__ __volatile__ ("xchgl %0, %1" : "+r" (v), "+m" (l->locked) :: "memory");
+		if(!v) {
+			return;
+		}
+		while(l->locked) {
+			__asm__ __volatile__ ("pause" ::: "memory");
+		}
+	}
+}
+
+static __inline__ void spin_unlock(struct spinlock *l)
+{
+	BARRIER();
+	l->locked = 0;
+}
+#else
+/* on uniprocessor disabling the interrupts is enough */
+#define spin_lock(l)	do { } while(0)
+#define spin_unlock(l)	do { } while(0)
+#endif /* CONFIG_SMP */
+
+#define spin_lock_irqsave(l, flags)					\
+	do { SAVE_FLAGS(flags); CLI(); spin_lock(l); } while(0)
+#define spin_unlock_irqrestore(l, flags)				\
+	do { spin_unlock(l); RESTORE_FLAGS(flags); } while(0)
+
+#endif /* _FIWIX_SPINLOCK_H */
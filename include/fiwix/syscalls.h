@@ -24,6 +24,7 @@
 #include <fiwix/sigcontext.h>
 #include <fiwix/mman.h>
 #include <fiwix/ipc.h>
+#include <fiwix/fs_mqueue.h>
 
 #define NR_SYSCALLS	(sizeof(syscall_table) / sizeof(unsigned int))
 
@@ -35,6 +36,7 @@ int do_syscall(unsigned int, int, int, int, int, int, struct sigcontext);
 
 int sys_exit(int);
 void do_exit(int);
+int do_fork(unsigned int, unsigned int, int *, struct user_desc *, int *, struct sigcontext *);
 #ifdef CONFIG_SYSCALL_6TH_ARG
 int sys_fork(int, int, int, int, int, int, struct sigcontext *);
 #else
@@ -151,6 +153,11 @@ int sys_sigreturn(unsigned int, int, int, int, int, int, struct sigcontext *);
 #else
 int sys_sigreturn(unsigned int, int, int, int, int, struct sigcontext *);
 #endif /* CONFIG_SYSCALL_6TH_ARG */
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_clone(unsigned int, unsigned int, int *, struct user_desc *, int *, int, struct sigcontext *);
+#else
+int sys_clone(unsigned int, unsigned int, int *, struct user_desc *, int *, struct sigcontext *);
+#endif /* CONFIG_SYSCALL_6TH_ARG */
 int sys_setdomainname(const char *, int);
 int sys_newuname(struct new_utsname *);
 int sys_mprotect(unsigned int, __size_t, int);
@@ -171,6 +178,13 @@ int sys_fdatasync(int);
 int sys_nanosleep(const struct timespec *, struct timespec *);
 int sys_chown(const char *, __uid_t, __gid_t);
 int sys_getcwd(char *, __size_t);
+int do_sendfile_ufd(int, int, __loff_t *, __size_t);
+int sys_sendfile(int, int, __off_t *, __size_t);
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_vfork(int, int, int, int, int, int, struct sigcontext *);
+#else
+int sys_vfork(int, int, int, int, int, struct sigcontext *);
+#endif /* CONFIG_SYSCALL_6TH_ARG */
 #ifdef CONFIG_MMAP2
 int sys_mmap2(unsigned int, unsigned int, unsigned int, unsigned int, int, unsigned int);
 #endif /* CONFIG_MMAP2 */
@@ -182,6 +196,40 @@ int sys_fstat64(unsigned int, struct stat64 *);
 int sys_chown32(const char *, unsigned int, unsigned int);
 int sys_getdents64(unsigned int, struct dirent64 *, unsigned int);
 int sys_fcntl64(unsigned int, int, unsigned int);
+int sys_gettid(void);
+int sys_sendfile64(int, int, __loff_t *, __size_t);
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_futex(int *, int, int, const struct timespec *, int *, int);
+#else
+int sys_futex(int *, int, int, const struct timespec *, int *, struct sigcontext *);
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+int sys_set_thread_area(struct user_desc *);
+int sys_get_thread_area(struct user_desc *);
+int sys_exit_group(int);
+int sys_set_tid_address(int *);
+int sys_timer_create(__clockid_t, struct sigevent *, __timer_t *);
+int sys_timer_settime(__timer_t, int, const struct itimerspec *, struct itimerspec *);
+int sys_timer_gettime(__timer_t, struct itimerspec *);
+int sys_timer_getoverrun(__timer_t);
+int sys_timer_delete(__timer_t);
+int sys_clock_settime(__clockid_t, const struct timespec *);
+int sys_clock_gettime(__clockid_t, struct timespec *);
+int sys_clock_getres(__clockid_t, struct timespec *);
+int sys_clock_nanosleep(__clockid_t, int, const struct timespec *, struct timespec *);
 int sys_utimes(const char *, struct timeval times[2]);
+#ifdef CONFIG_POSIX_MQUEUE
+int sys_mq_open(const char *, int, __mode_t, struct mq_attr *);
+int sys_mq_unlink(const char *);
+int sys_mq_timedsend(int, const char *, __size_t, unsigned int, const struct timespec *);
+int sys_mq_timedreceive(int, char *, __size_t, unsigned int *, const struct timespec *);
+int sys_mq_getsetattr(int, const struct mq_attr *, struct mq_attr *);
+#endif /* CONFIG_POSIX_MQUEUE */
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_splice(int, __loff_t *, int, __loff_t *, __size_t, unsigned int);
+#else
+int sys_splice(int, __loff_t *, int, __loff_t *, __size_t, struct sigcontext *);
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+int sys_tee(int, int, __size_t, unsigned int);
+int sys_vmsplice(int, const struct iovec *, unsigned int, unsigned int);
 
 #endif /* _FIWIX_SYSCALLS_H */
@@ -8,10 +8,20 @@
 #ifndef _FIWIX_TIME_H
 #define _FIWIX_TIME_H
 
+#include <fiwix/types.h>
+
 #define ITIMER_REAL	0
 #define ITIMER_VIRTUAL	1
 #define ITIMER_PROF	2
 
+#define CLOCK_REALTIME			0
+#define CLOCK_MONOTONIC			1
+#define CLOCK_PROCESS_CPUTIME_ID	2
+#define CLOCK_THREAD_CPUTIME_ID		3
+
+/* flags for clock_nanosleep() and timer_settime() */
+#define TIMER_ABSTIME	0x01
+
 struct timespec {
 	int tv_sec;		/* seconds since 00:00:00, 1 Jan 1970 UTC */
 	int tv_nsec;		/* nanoseconds (1000000000ns = 1sec) */
@@ -32,6 +42,11 @@ struct itimerval {
 	struct timeval it_value;
 };
 
+struct itimerspec {
+	struct timespec it_interval;
+	struct timespec it_value;
+};
+
 struct mt {
 	int mt_sec;
 	int mt_min;
@@ -43,6 +58,13 @@ struct mt {
 
 unsigned int tv2ticks(const struct timeval *);
 void ticks2tv(int, struct timeval *);
+unsigned int ts2ticks(const struct timespec *);
+void ticks2ts(int, struct timespec *);
+void ts_sub(struct timespec *, const struct timespec *);
+unsigned int timeout_ticks(const struct timespec *);
+void timeout_ts(unsigned int, struct timespec *);
+int do_clock_gettime(__clockid_t, struct timespec *);
+int do_clock_getres(__clockid_t, struct timespec *);
 int setitimer(int, const struct itimerval *, struct itimerval *);
 unsigned int mktime(struct mt *);
 
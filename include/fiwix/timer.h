@@ -14,6 +14,7 @@
 #define TIMER_IRQ	0
 #define HZ		100	/* kernel's Hertz rate (100 = 10ms) */
 #define TICK		(1000000 / HZ)
+#define TICKS2MS(t)	((t) * (1000 / HZ))
 
 #define UNIX_EPOCH	1970
 
@@ -41,6 +42,7 @@ struct callout_req {
 void add_callout(struct callout_req *, unsigned int);
 void del_callout(struct callout_req *);
 void irq_timer(int, struct sigcontext *);
+void account_process_tick(struct sigcontext *);
 void irq_timer_bh(struct sigcontext *);
 void do_callouts_bh(struct sigcontext *);
 void get_system_time(void);
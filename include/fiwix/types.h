@@ -29,6 +29,8 @@ typedef __s32 __ssize_t;
 typedef __u32 __size_t;
 typedef __u32 __clock_t;
 typedef __u32 __time_t;
+typedef __s32 __clockid_t;
+typedef __s32 __timer_t;
 typedef __u16 __dev_t;
 typedef __u16 __key_t;
 typedef __s32 __blk_t;		/* must be signed in order to return error */
@@ -59,6 +61,12 @@ struct iovec {
 #define __FD_CLR(d, set)	((set)->fds_bits[__FDELT(d)] &= ~__FDMASK(d))
 #define __FD_ISSET(d, set)	((set)->fds_bits[__FDELT(d)] & __FDMASK(d))
 
+#define __bswap16(x) \
+	((unsigned short int)(			\
+		(((x) & 0xFF) << 8) |		\
+		(((x) >> 8) & 0xFF)		\
+	))
+
 #define __bswap32(x) \
 	((unsigned int)(			\
 		((x & 0xFF) << 24) |		\
@@ -221,6 +221,8 @@
 #define SYS_getdents64		220
 #define SYS_fcntl64		221
 
+#define SYS_clock_gettime	265
+
 #define SYS_utimes		271
 
 #endif /* _FIWIX_UNISTD_H */
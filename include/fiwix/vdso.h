@@ -0,0 +1,63 @@
+/*
+ * fiwix/include/fiwix/vdso.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifndef _FIWIX_VDSO_H
+#define _FIWIX_VDSO_H
+
+#define VDSO_ADDR	0x3FFFF000	/* just below the mmap()s */
+#define VVAR_ADDR	0x3FFFE000	/* just below the vDSO */
+
+#define VDSO_TSC_SHIFT	22		/* scale of 'tsc_mult' */
+
+/* offsets in the vvar page (struct vdso_data) */
+#define VD_SEQ		(VVAR_ADDR + 0x00)
+#define VD_SEC		(VVAR_ADDR + 0x04)
+#define VD_MONO_SEC	(VVAR_ADDR + 0x08)
+#define VD_NSEC		(VVAR_ADDR + 0x0C)
+#define VD_TSC_LOW	(VVAR_ADDR + 0x10)
+#define VD_TSC_HIGH	(VVAR_ADDR + 0x14)
+#define VD_TSC_MULT	(VVAR_ADDR + 0x18)
+#define VD_TZ_MINWEST	(VVAR_ADDR + 0x1C)
+#define VD_TZ_DSTTIME	(VVAR_ADDR + 0x20)
+#define VD_TICK_NSEC	(VVAR_ADDR + 0x24)
+
+#ifndef ASM_FILE
+
+#include <fiwix/sigcontext.h>
+
+/*
+ * This is the vvar page, which is read-only for the user. The kernel updates
+ * it at every tick and 'seq' is odd meanwhile, so the vDSO reads it again if
+ * 'seq' was odd or has changed.
+ */
+struct vdso_data {
+	unsigned int seq;
+	unsigned int sec;		/* CURRENT_TIME at the last tick */
+	unsigned int mono_sec;		/* seconds since boot */
+	unsigned int nsec;		/* nanoseconds at the last tick */
+	unsigned int tsc_low;		/* TSC at the last tick */
+	unsigned int tsc_high;
+	unsigned int tsc_mult;		/* ns per cycle << VDSO_TSC_SHIFT */
+	int tz_minuteswest;
+	int tz_dsttime;
+	unsigned int tick_nsec;		/* nanoseconds per tick */
+};
+
+extern unsigned int vsyscall_entry;
+extern unsigned int sysenter_return;
+
+int sysenter_ebp(struct sigcontext *);
+void sysenter_init(void);
+void vdso_update(void);
+int vdso_uses_tsc(void);
+unsigned int vdso_tick_offset(void);
+int map_vdso(void);
+void vdso_init(void);
+
+#endif /* ! ASM_FILE */
+
+#endif /* _FIWIX_VDSO_H */
@@ -0,0 +1,144 @@
+/*
+ * fiwix/include/fiwix/virtio_net.h
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#ifdef CONFIG_PCI
+#ifdef CONFIG_VIRTIO_NET
+
+#ifndef _FIWIX_VIRTIO_NET_H
+#define _FIWIX_VIRTIO_NET_H
+
+#include <fiwix/types.h>
+#include <fiwix/pci.h>
+#include <fiwix/net/device.h>
+
+/* legacy virtio PCI registers (I/O space) */
+#define VIRTIO_PCI_HOST_FEATURES	0x00	/* 32 bits */
+#define VIRTIO_PCI_GUEST_FEATURES	0x04	/* 32 bits */
+#define VIRTIO_PCI_QUEUE_PFN		0x08	/* 32 bits */
+#define VIRTIO_PCI_QUEUE_NUM		0x0C	/* 16 bits */
+#define VIRTIO_PCI_QUEUE_SEL		0x0E	/* 16 bits */
+#define VIRTIO_PCI_QUEUE_NOTIFY		0x10	/* 16 bits */
+#define VIRTIO_PCI_STATUS		0x12	/*  8 bits */
+#define VIRTIO_PCI_ISR			0x13	/*  8 bits */
+#define VIRTIO_PCI_CONFIG		0x14	/* device configuration (no MSI-X) */
+
+#define VIRTIO_PCI_ISR_QUEUE		0x01	/* a queue has been used */
+#define VIRTIO_PCI_ISR_CONFIG		0x02	/* configuration has changed */
+
+#define VIRTIO_PCI_VRING_ALIGN		4096
+
+/* device status */
+#define VIRTIO_STATUS_ACKNOWLEDGE	0x01
+#define VIRTIO_STATUS_DRIVER		0x02
+#define VIRTIO_STATUS_DRIVER_OK		0x04
+#define VIRTIO_STATUS_FAILED		0x80
+
+/* virtio-net features */
+#define VIRTIO_NET_F_CSUM		(1 << 0)	/* host handles partial csum */
+#define VIRTIO_NET_F_GUEST_CSUM		(1 << 1)	/* guest handles partial csum */
+#define VIRTIO_NET_F_MAC		(1 << 5)	/* host has given a MAC */
+#define VIRTIO_NET_F_STATUS		(1 << 16)	/* link status available */
+
+/* virtio-net configuration */
+#define VIRTIO_NET_CFG_MAC		0x00
+#define VIRTIO_NET_CFG_STATUS		0x06	/* 16 bits */
+#define VIRTIO_NET_S_LINK_UP		0x01
+
+#define VIRTIO_NET_RXQ			0
+#define VIRTIO_NET_TXQ			1
+
+#define VIRTQ_MAX_SIZE			1024
+
+/* vring descriptor flags */
+#define VRING_DESC_F_NEXT		0x01
+#define VRING_DESC_F_WRITE		0x02	/* write-only for the device */
+
+#define VRING_AVAIL_F_NO_INTERRUPT	0x01
+#define VRING_USED_F_NO_NOTIFY		0x01
+
+struct vring_desc {
+	__u64 addr;			/* physical address */
+	unsigned int len;
+	unsigned short int flags;
+	unsigned short int next;
+};
+
+struct vring_avail {
+	unsigned short int flags;
+	unsigned short int idx;
+	unsigned short int ring[VIRTQ_MAX_SIZE];
+};
+
+struct vring_used_elem {
+	unsigned int id;		/* head of the descriptor chain */
+	unsigned int len;		/* bytes written by the device */
+};
+
+struct vring_used {
+	unsigned short int flags;
+	unsigned short int idx;
+	struct vring_used_elem ring[VIRTQ_MAX_SIZE];
+};
+
+struct virtqueue {
+	unsigned short int index;
+	unsigned short int num;		/* size of the ring (power of 2) */
+	struct vring_desc *desc;
+	struct vring_avail *avail;
+	struct vring_used *used;
+	unsigned short int last_used;	/* last used entry already processed */
+	unsigned short int pending;	/* buffers added but not notified */
+};
+
+/* header prepended to every frame */
+#define VIRTIO_NET_HDR_F_NEEDS_CSUM	0x01
+#define VIRTIO_NET_HDR_F_DATA_VALID	0x02
+#define VIRTIO_NET_HDR_GSO_NONE		0x00
+
+struct virtio_net_hdr {
+	unsigned char flags;
+	unsigned char gso_type;
+	unsigned short int hdr_len;
+	unsigned short int gso_size;
+	unsigned short int csum_start;
+	unsigned short int csum_offset;
+};
+
+/*
+ * Every buffer is a chain of two descriptors: the header and the frame. Each
+ * one occupies a half of a page, with the header placed at its beginning.
+ */
+#define VIRTIO_NET_BUF_SIZE		(PAGE_SIZE / 2)
+#define VIRTIO_NET_HDR_SPACE		16
+#define VIRTIO_NET_RX_BUFS		64
+#define VIRTIO_NET_TX_BUFS		32
+
+/* max. number of frames processed in each poll before yielding the CPU */
+#define VIRTIO_NET_BUDGET		32
+
+struct virtio_net {
+	struct pci_device *pci_dev;
+	unsigned int ioaddr;
+	int irq;
+	unsigned int features;
+	struct virtqueue rxq;
+	struct virtqueue txq;
+	char *rx_buf[VIRTIO_NET_RX_BUFS];
+	char *tx_buf[VIRTIO_NET_TX_BUFS];
+	int nr_rx_bufs;
+	int nr_tx_bufs;
+	unsigned short int tx_free[VIRTIO_NET_TX_BUFS];
+	int tx_nr_free;
+	struct net_device dev;
+};
+
+void virtio_net_init(void);
+
+#endif /* _FIWIX_VIRTIO_NET_H */
+
+#endif /* CONFIG_VIRTIO_NET */
+#endif /* CONFIG_PCI */
@@ -0,0 +1,185 @@
+/*
+ * fiwix/kernel/apic.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/apic.h>
+#include <fiwix/smp.h>
+#include <fiwix/pit.h>
+#include <fiwix/timer.h>
+#include <fiwix/sigcontext.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_SMP
+unsigned int lapic_addr = 0;
+unsigned int ioapic_addr = 0;
+
+/* bus clock ticks (divided by 16) of the local APIC timer per 1/HZ */
+static unsigned int lapic_timer_count = 0;
+
+static int checksum(unsigned char *addr, int len)
+{
+	int sum;
+
+	sum = 0;
+	while(len--) {
+		sum += *addr++;
+	}
+	return sum & 0xFF;
+}
+
+static struct mp_float *mp_scan(unsigned int start, unsigned int len)
+{
+	struct mp_float *mpf;
+	unsigned int addr;
+
+	for(addr = start; addr < start + len; addr += 16) {
+		mpf = (struct mp_float *)P2V(addr);
+		if(mpf->signature == MP_FLOAT_SIGNATURE) {
+			if(!checksum((unsigned char *)mpf, mpf->length * 16)) {
+				return mpf;
+			}
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Looks for the MP Floating Pointer Structure in the first KB of the EBDA,
+ * in the last KB of the base memory and in the BIOS ROM, and then walks the
+ * MP Configuration Table to find out the processors and the I/O APIC.
+ */
+int mp_init(void)
+{
+	struct mp_float *mpf;
+	struct mp_config *mpc;
+	struct mp_processor *mpp;
+	struct mp_ioapic *mpio;
+	struct cpu_data *cpu;
+	unsigned char *entry;
+	unsigned int ebda;
+	int n;
+
+	mpf = NULL;
+	if((ebda = *(unsigned short int *)P2V(0x40E) << 4)) {
+		mpf = mp_scan(ebda, 1024);
+	}
+	if(!mpf) {
+		mpf = mp_scan(0x9FC00, 1024);
+	}
+	if(!mpf) {
+		mpf = mp_scan(0xF0000, 0x10000);
+	}
+	if(!mpf) {
+		return 0;
+	}
+
+	/* the default configurations (without table) are not supported */
+	if(!mpf->config_addr) {
+		printk("WARNING: %s(): MP default configuration %d is not supported.\n", __FUNCTION__, mpf->feature[0]);
+		return 0;
+	}
+	mpc = (struct mp_config *)P2V(mpf->config_addr);
+	if(mpc->signature != MP_CONFIG_SIGNATURE || checksum((unsigned char *)mpc, mpc->length)) {
+		printk("WARNING: %s(): invalid MP configuration table.\n", __FUNCTION__);
+		return 0;
+	}
+	lapic_addr = mpc->lapic_addr;
+
+	entry = (unsigned char *)(mpc + 1);
+	for(n = 0; n < mpc->entry_count; n++) {
+		switch(*entry) {
+			case MP_PROCESSOR:
+				mpp = (struct mp_processor *)entry;
+				if(mpp->flags & MP_CPU_ENABLED) {
+					if(mpp->flags & MP_CPU_BSP) {
+						cpu_data[0].apic_id = mpp->lapic_id;
+					} else if(nr_cpus < NR_CPUS) {
+						cpu = &cpu_data[nr_cpus];
+						cpu->self = cpu;
+						cpu->id = nr_cpus++;
+						cpu->apic_id = mpp->lapic_id;
+					}
+				}
+				entry += sizeof(struct mp_processor);
+				break;
+			case MP_IOAPIC:
+				mpio = (struct mp_ioapic *)entry;
+				if((mpio->flags & 1) && !ioapic_addr) {
+					ioapic_addr = mpio->addr;
+				}
+				entry += sizeof(struct mp_ioapic);
+				break;
+			default:
+				/* the rest of entries are 8 bytes long */
+				entry += 8;
+				break;
+		}
+	}
+	return nr_cpus;
+}
+
+/*
+ * The 8259 PIC keeps delivering the external interrupts through the LINT0
+ * of the BSP (virtual wire mode), so the rest of the CPUs mask them.
+ */
+void lapic_init(void)
+{
+	lapic_write(LAPIC_TPR, 0);
+	lapic_write(LAPIC_SVR, LAPIC_SVR_ENABLE | SPURIOUS_VECTOR);
+	if(!THIS_CPU->id) {
+		lapic_write(LAPIC_LVT_LINT0, LAPIC_DM_EXTINT);
+		lapic_write(LAPIC_LVT_LINT1, LAPIC_DM_NMI);
+	} else {
+		lapic_write(LAPIC_LVT_LINT0, LAPIC_LVT_MASKED);
+		lapic_write(LAPIC_LVT_LINT1, LAPIC_LVT_MASKED);
+	}
+	lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_LVT_ERROR, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_ESR, 0);
+	lapic_write(LAPIC_EOI, 0);
+}
+
+void lapic_eoi(void)
+{
+	lapic_write(LAPIC_EOI, 0);
+}
+
+void lapic_send_ipi(int apic_id, unsigned int icr)
+{
+	lapic_write(LAPIC_ICR_HI, apic_id << 24);
+	lapic_write(LAPIC_ICR_LO, icr);
+	while(lapic_read(LAPIC_ICR_LO) & ICR_PENDING);
+}
+
+/* measures the local APIC timer against one tick of the PIT channel 2 */
+void lapic_timer_calibrate(void)
+{
+	lapic_write(LAPIC_TIMER_DCR, LAPIC_TIMER_DIV16);
+	lapic_write(LAPIC_LVT_TIMER, LAPIC_LVT_MASKED);
+	lapic_write(LAPIC_TIMER_ICR, 0xFFFFFFFF);
+	pit_delay(1000000 / HZ);
+	lapic_timer_count = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CCR);
+	lapic_write(LAPIC_TIMER_ICR, 0);
+}
+
+/* the APs use their local APIC timer to preempt the processes they run */
+void lapic_timer_init(void)
+{
+	lapic_write(LAPIC_TIMER_DCR, LAPIC_TIMER_DIV16);
+	lapic_write(LAPIC_LVT_TIMER, LAPIC_TIMER_PERIODIC | LAPIC_TIMER_VECTOR);
+	lapic_write(LAPIC_TIMER_ICR, lapic_timer_count);
+}
+
+void lapic_timer_irq(struct sigcontext sc)
+{
+	lapic_eoi();
+	account_process_tick(&sc);
+}
+#endif /* CONFIG_SMP */
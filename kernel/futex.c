@@ -0,0 +1,268 @@
+/*
+ * fiwix/kernel/futex.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/futex.h>
+#include <fiwix/sleep.h>
+#include <fiwix/sched.h>
+#include <fiwix/process.h>
+#include <fiwix/mman.h>
+#include <fiwix/mm.h>
+#include <fiwix/string.h>
+
+#define FUTEX_HASH(key)	((((key)->word >> PAGE_SHIFT) ^ ((key)->offset >> 2)) & (FUTEX_HASH_SIZE - 1))
+
+static struct futex_waiter *futex_hash[FUTEX_HASH_SIZE];
+
+/*
+ * Only the pages mapped with MAP_SHARED can be seen by other address spaces
+ * through a different virtual address. Everything else, including the
+ * copy-on-write pages after a fork(), is keyed by its virtual address so that
+ * a write fault between FUTEX_WAIT and FUTEX_WAKE can't change the key.
+ */
+static void get_futex_key(int *uaddr, int private, struct futex_key *key)
+{
+	struct vma *vma;
+	unsigned int addr;
+
+	addr = (unsigned int)uaddr;
+	if(!private && (vma = find_vma_region(addr)) && (vma->flags & MAP_SHARED)) {
+		key->word = get_mapped_addr(current, addr) & PAGE_MASK;
+		key->offset = addr & ~PAGE_MASK;
+		return;
+	}
+	key->word = current->tss.cr3;
+	key->offset = addr;
+}
+
+static int match_key(struct futex_key *k1, struct futex_key *k2)
+{
+	return k1->word == k2->word && k1->offset == k2->offset;
+}
+
+/* interrupts must be disabled while the hash is being used */
+static void queue_waiter(struct futex_waiter *w)
+{
+	struct futex_waiter **h;
+
+	h = &futex_hash[FUTEX_HASH(&w->key)];
+	w->prev = NULL;
+	if((w->next = *h)) {
+		(*h)->prev = w;
+	}
+	*h = w;
+}
+
+static void unqueue_waiter(struct futex_waiter *w)
+{
+	struct futex_waiter **h;
+
+	h = &futex_hash[FUTEX_HASH(&w->key)];
+	if(w->next) {
+		w->next->prev = w->prev;
+	}
+	if(w->prev) {
+		w->prev->next = w->next;
+	} else {
+		*h = w->next;
+	}
+	w->prev = w->next = NULL;
+}
+
+/* wakes up to 'nr' waiters on 'key' and returns how many were woken up */
+static int wake_key(struct futex_key *key, int nr)
+{
+	struct futex_waiter *w, *next;
+	int count;
+
+	count = 0;
+	w = futex_hash[FUTEX_HASH(key)];
+	while(w && count < nr) {
+		next = w->next;
+		if(match_key(&w->key, key)) {
+			unqueue_waiter(w);
+			w->woken = 1;
+			wakeup(w);
+			count++;
+		}
+		w = next;
+	}
+	return count;
+}
+
+/*
+ * Sleeps as long as '*uaddr' still contains 'val'. The test and the queueing
+ * are done with interrupts disabled so that a FUTEX_WAKE issued right after
+ * the user-space store can't be lost.
+ */
+int futex_wait(int *uaddr, int val, unsigned int ticks, int private)
+{
+	struct futex_waiter w;
+	unsigned int flags;
+	int errno;
+
+	/* touch the page before looking at the page tables */
+	if(*uaddr != val) {
+		return -EAGAIN;
+	}
+	get_futex_key(uaddr, private, &w.key);
+	w.p = current;
+	w.woken = 0;
+
+	SAVE_FLAGS(flags); CLI();
+	if(*uaddr != val) {
+		RESTORE_FLAGS(flags);
+		return -EAGAIN;
+	}
+	queue_waiter(&w);
+	current->timeout = ticks;
+	errno = 0;
+	if(sleep(&w, PROC_INTERRUPTIBLE)) {
+		errno = -EINTR;
+	} else if(ticks && !current->timeout) {
+		errno = -ETIMEDOUT;
+	}
+	current->timeout = 0;
+	if(!w.woken) {
+		unqueue_waiter(&w);
+	} else {
+		errno = 0;
+	}
+	RESTORE_FLAGS(flags);
+	return errno;
+}
+
+int futex_wake(int *uaddr, int nr, int private)
+{
+	struct futex_key key;
+	unsigned int flags;
+	int count;
+
+	get_futex_key(uaddr, private, &key);
+	SAVE_FLAGS(flags); CLI();
+	count = wake_key(&key, nr);
+	RESTORE_FLAGS(flags);
+	return count;
+}
+
+/*
+ * Wakes up to 'nr_wake' waiters on 'uaddr' and moves up to 'nr_requeue' of
+ * the rest to 'uaddr2' without waking them up, which avoids the thundering
+ * herd of a condition variable broadcast. If 'cmp' is set the operation is
+ * done only if '*uaddr' still contains 'val'.
+ */
+int futex_requeue(int *uaddr, int *uaddr2, int nr_wake, int nr_requeue, int cmp, int val, int private)
+{
+	struct futex_key key, key2;
+	struct futex_waiter *w, *next;
+	unsigned int flags;
+	int count;
+
+	get_futex_key(uaddr, private, &key);
+	get_futex_key(uaddr2, private, &key2);
+
+	SAVE_FLAGS(flags); CLI();
+	if(cmp && *uaddr != val) {
+		RESTORE_FLAGS(flags);
+		return -EAGAIN;
+	}
+	count = wake_key(&key, nr_wake);
+	w = futex_hash[FUTEX_HASH(&key)];
+	while(w && nr_requeue > 0) {
+		next = w->next;
+		if(match_key(&w->key, &key)) {
+			unqueue_waiter(w);
+			w->key = key2;
+			queue_waiter(w);
+			nr_requeue--;
+			count++;
+		}
+		w = next;
+	}
+	RESTORE_FLAGS(flags);
+	return count;
+}
+
+/*
+ * Applies the operation encoded in 'encoded_op' to '*uaddr2', wakes up to
+ * 'nr_wake' waiters on 'uaddr' and, if the old value of '*uaddr2' passes the
+ * comparison, up to 'nr_wake2' waiters on 'uaddr2'.
+ */
+int futex_wake_op(int *uaddr, int *uaddr2, int nr_wake, int nr_wake2, int encoded_op, int private)
+{
+	struct futex_key key, key2;
+	unsigned int flags;
+	int op, cmp, oparg, cmparg;
+	int oldval, count;
+
+	op = (encoded_op >> 28) & 7;
+	cmp = (encoded_op >> 24) & 15;
+	oparg = (encoded_op << 8) >> 20;
+	cmparg = (encoded_op << 20) >> 20;
+	if((encoded_op >> 28) & FUTEX_OP_OPARG_SHIFT) {
+		oparg = 1 << oparg;
+	}
+	if(op > FUTEX_OP_XOR || cmp > FUTEX_OP_CMP_GE) {
+		return -ENOSYS;
+	}
+
+	/* touch the page so it can't fault with interrupts disabled */
+	oldval = *uaddr2;
+	*uaddr2 = oldval;
+
+	get_futex_key(uaddr, private, &key);
+	get_futex_key(uaddr2, private, &key2);
+
+	SAVE_FLAGS(flags); CLI();
+	oldval = *uaddr2;
+	switch(op) {
+		case FUTEX_OP_SET:
+			*uaddr2 = oparg;
+			break;
+		case FUTEX_OP_ADD:
+			*uaddr2 = oldval + oparg;
+			break;
+		case FUTEX_OP_OR:
+			*uaddr2 = oldval | oparg;
+			break;
+		case FUTEX_OP_ANDN:
+			*uaddr2 = oldval & ~oparg;
+			break;
+		case FUTEX_OP_XOR:
+			*uaddr2 = oldval ^ oparg;
+			break;
+	}
+	count = wake_key(&key, nr_wake);
+	switch(cmp) {
+		case FUTEX_OP_CMP_EQ:
+			cmp = oldval == cmparg;
+			break;
+		case FUTEX_OP_CMP_NE:
+			cmp = oldval != cmparg;
+			break;
+		case FUTEX_OP_CMP_LT:
+			cmp = oldval < cmparg;
+			break;
+		case FUTEX_OP_CMP_LE:
+			cmp = oldval <= cmparg;
+			break;
+		case FUTEX_OP_CMP_GT:
+			cmp = oldval > cmparg;
+			break;
+		case FUTEX_OP_CMP_GE:
+			cmp = oldval >= cmparg;
+			break;
+	}
+	if(cmp) {
+		count += wake_key(&key2, nr_wake2);
+	}
+	RESTORE_FLAGS(flags);
+	return count;
+}
@@ -10,6 +10,7 @@
 #include <fiwix/segments.h>
 #include <fiwix/process.h>
 #include <fiwix/limits.h>
+#include <fiwix/smp.h>
 #include <fiwix/string.h>
 
 struct seg_desc gdt[NR_GDT_ENTRIES];
@@ -19,35 +20,116 @@ struct desc_r gdtr = {
 	(unsigned int)&gdt
 };
 
-static void gdt_set_entry(int num, unsigned int base_addr, unsigned int limit, char loflags, char hiflags)
+#ifdef CONFIG_SMP
+/* each AP has its own GDT, they only differ in the TSS and per-CPU entries */
+static struct seg_desc ap_gdt[NR_CPUS][NR_GDT_ENTRIES];
+static struct desc_r ap_gdtr[NR_CPUS];
+#endif /* CONFIG_SMP */
+
+static void gdt_set_entry(struct seg_desc *g, int num, unsigned int base_addr, unsigned int limit, char loflags, char hiflags)
 {
 	num /= sizeof(struct seg_desc);
-	gdt[num].sd_lolimit = limit & 0xFFFF;
-	gdt[num].sd_lobase = base_addr & 0xFFFFFF;
-	gdt[num].sd_loflags = loflags;
-	gdt[num].sd_hilimit = (limit >> 16) & 0x0F;
-	gdt[num].sd_hiflags = hiflags;
-	gdt[num].sd_hibase = (base_addr >> 24) & 0xFF;
+	g[num].sd_lolimit = limit & 0xFFFF;
+	g[num].sd_lobase = base_addr & 0xFFFFFF;
+	g[num].sd_loflags = loflags;
+	g[num].sd_hilimit = (limit >> 16) & 0x0F;
+	g[num].sd_hiflags = hiflags;
+	g[num].sd_hibase = (base_addr >> 24) & 0xFF;
+}
+
+/* installs the TLS descriptors of a process in the GDT of this CPU */
+void load_tls(struct seg_desc *tls)
+{
+	memcpy_b(&THIS_CPU->gdt[TLS_ENTRY_MIN], tls, sizeof(struct seg_desc) * NR_TLS_ENTRIES);
+}
+
+/* builds a TLS descriptor from the information passed by the user */
+void set_tls_desc(struct seg_desc *sd, struct user_desc *u)
+{
+	unsigned char loflags, hiflags;
+
+	if(!u->base_addr && !u->limit && u->read_exec_only && u->seg_not_present) {
+		memset_b(sd, 0, sizeof(struct seg_desc));
+		return;
+	}
+
+	loflags = SD_CD | SD_DPL3;
+	if(u->contents == 2) {
+		loflags |= SD_CODE;
+	} else {
+		loflags |= SD_DATA;
+		if(u->contents == 1) {
+			loflags |= SD_EXPDOWN;
+		}
+	}
+	if(u->read_exec_only) {
+		loflags &= ~SD_DATA;
+	}
+	if(!u->seg_not_present) {
+		loflags |= SD_PRESENT;
+	}
+	hiflags = 0;
+	if(u->seg_32bit) {
+		hiflags |= SD_OPSIZE32;
+	}
+	if(u->limit_in_pages) {
+		hiflags |= SD_PAGE4KB;
+	}
+	if(u->useable) {
+		hiflags |= SD_AVL;
+	}
+
+	sd->sd_lolimit = u->limit & 0xFFFF;
+	sd->sd_lobase = u->base_addr & 0xFFFFFF;
+	sd->sd_loflags = loflags;
+	sd->sd_hilimit = (u->limit >> 16) & 0x0F;
+	sd->sd_hiflags = hiflags;
+	sd->sd_hibase = (u->base_addr >> 24) & 0xFF;
 }
 
+#ifdef CONFIG_SMP
+void gdt_init_ap(struct cpu_data *cpu)
+{
+	unsigned char loflags;
+	struct seg_desc *g;
+
+	g = ap_gdt[cpu->id];
+	memcpy_b(g, gdt, sizeof(gdt));
+	loflags = SD_DATA | SD_CD | SD_DPL0 | SD_PRESENT;
+	gdt_set_entry(g, PERCPU_DS, (unsigned int)cpu, sizeof(struct cpu_data) - 1, loflags, SD_OPSIZE32);
+	cpu->gdt = g;
+
+	ap_gdtr[cpu->id].limit = sizeof(gdt) - 1;
+	ap_gdtr[cpu->id].base_addr = (unsigned int)g;
+	load_gdt((unsigned int)&ap_gdtr[cpu->id]);
+}
+#endif /* CONFIG_SMP */
+
 void gdt_init(void)
 {
 	unsigned char loflags;
 
-	gdt_set_entry(0, 0, 0, 0, 0);	/* null descriptor */
+	cpu_data_init();
+
+	gdt_set_entry(gdt, 0, 0, 0, 0, 0);	/* null descriptor */
 
 	loflags = SD_CODE | SD_CD | SD_DPL0 | SD_PRESENT;
-	gdt_set_entry(KERNEL_CS, 0, 0xFFFFFFFF, loflags, SD_OPSIZE32 | SD_PAGE4KB);
+	gdt_set_entry(gdt, KERNEL_CS, 0, 0xFFFFFFFF, loflags, SD_OPSIZE32 | SD_PAGE4KB);
 	loflags = SD_DATA | SD_CD | SD_DPL0 | SD_PRESENT;
-	gdt_set_entry(KERNEL_DS, 0, 0xFFFFFFFF, loflags, SD_OPSIZE32 | SD_PAGE4KB);
+	gdt_set_entry(gdt, KERNEL_DS, 0, 0xFFFFFFFF, loflags, SD_OPSIZE32 | SD_PAGE4KB);
 
 	loflags = SD_CODE | SD_CD | SD_DPL3 | SD_PRESENT;
-	gdt_set_entry(USER_CS, 0, 0xFFFFFFFF, loflags, SD_OPSIZE32 | SD_PAGE4KB);
+	gdt_set_entry(gdt, USER_CS, 0, 0xFFFFFFFF, loflags, SD_OPSIZE32 | SD_PAGE4KB);
 	loflags = SD_DATA | SD_CD | SD_DPL3 | SD_PRESENT;
-	gdt_set_entry(USER_DS, 0, 0xFFFFFFFF, loflags, SD_OPSIZE32 | SD_PAGE4KB);
+	gdt_set_entry(gdt, USER_DS, 0, 0xFFFFFFFF, loflags, SD_OPSIZE32 | SD_PAGE4KB);
 
 	loflags = SD_TSSPRESENT;
-	gdt_set_entry(TSS, 0, sizeof(struct i386tss), loflags, SD_OPSIZE32);
+	gdt_set_entry(gdt, TSS, 0, sizeof(struct i386tss), loflags, SD_OPSIZE32);
+
+#ifdef CONFIG_SMP
+	loflags = SD_DATA | SD_CD | SD_DPL0 | SD_PRESENT;
+	gdt_set_entry(gdt, PERCPU_DS, (unsigned int)&cpu_data[0], sizeof(struct cpu_data) - 1, loflags, SD_OPSIZE32);
+#endif /* CONFIG_SMP */
 
 	load_gdt((unsigned int)&gdtr);
 }
@@ -8,6 +8,8 @@
 #include <fiwix/asm.h>
 #include <fiwix/types.h>
 #include <fiwix/segments.h>
+#include <fiwix/config.h>
+#include <fiwix/apic.h>
 #include <fiwix/string.h>
 
 struct gate_desc idt[NR_IDT_ENTRIES];
@@ -56,5 +58,11 @@ void idt_init(void)
 
 	set_idt_entry(0x80, (__off_t)&syscall, SD_32TRAPGATE | SD_DPL3 | SD_PRESENT);
 
+#ifdef CONFIG_SMP
+	set_idt_entry(LAPIC_TIMER_VECTOR, (__off_t)&lapic_timer, SD_32INTRGATE | SD_PRESENT);
+	set_idt_entry(RESCHED_VECTOR, (__off_t)&resched_irq, SD_32INTRGATE | SD_PRESENT);
+	set_idt_entry(SPURIOUS_VECTOR, (__off_t)&spurious_irq, SD_32INTRGATE | SD_PRESENT);
+#endif /* CONFIG_SMP */
+
 	load_idt((unsigned int)&idtr);
 }
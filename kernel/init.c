@@ -63,8 +63,12 @@ void init_init(void)
 	init->rss++;
 	memcpy_b(pgdir, kpage_dir, PAGE_SIZE);
 	init->tss.cr3 = V2P((unsigned int)pgdir);
+	if(!(init->mm = get_mm())) {
+		goto init_init__die;
+	}
 
 	init->ppid = &proc_table[IDLE];
+	init->tgid = init->pid;
 	init->pgid = 0;
 	init->sid = 0;
 	init->flags = 0;
@@ -75,8 +79,9 @@ void init_init(void)
 	init->uid = init->gid = 0;
 	init->euid = init->egid = 0;
 	init->suid = init->sgid = 0;
-	memset_b(init->fd, 0, sizeof(init->fd));
-	memset_b(init->fd_flags, 0, sizeof(init->fd_flags));
+	if(!(init->files = get_files())) {
+		goto init_init__die;
+	}
 	init->root = current->root;
 	init->pwd = current->pwd;
 	strcpy(init->argv0, init_argv[0]);
@@ -85,7 +90,9 @@ void init_init(void)
 	init->sigpending = 0;
 	init->sigblocked = 0;
 	init->sigexecuting = 0;
-	memset_b(init->sigaction, 0, sizeof(init->sigaction));
+	if(!(init->sighand = get_sighand())) {
+		goto init_init__die;
+	}
 	memset_b(&init->usage, 0, sizeof(struct rusage));
 	memset_b(&init->cusage, 0, sizeof(struct rusage));
 	init->timeout = 0;
@@ -14,6 +14,8 @@
 #include <fiwix/string.h>
 #include <fiwix/sigcontext.h>
 #include <fiwix/sleep.h>
+#include <fiwix/sched.h>
+#include <fiwix/smp.h>
 
 struct interrupt *irq_table[NR_IRQS];
 static struct bh *bh_table = NULL;
@@ -126,6 +128,15 @@ void do_bh(struct sigcontext sc)
 	struct bh *b;
 	void (*fn)(struct sigcontext *);
 
+#ifdef CONFIG_SMP
+	/* the external interrupts and their bottom halves stay in the BSP */
+	if(THIS_CPU->id) {
+		return;
+	}
+#endif /* CONFIG_SMP */
+
+	/* the bottom halves run to completion */
+	preempt_disable();
 	b = bh_table;
 	while(b) {
 		if(b->flags & BH_ACTIVE) {
@@ -135,6 +146,7 @@ void do_bh(struct sigcontext sc)
 		}
 		b = b->next;
 	}
+	preempt_enable();
 }
 
 void irq_init(void)
@@ -30,10 +30,12 @@
 #include <fiwix/ps2.h>
 #include <fiwix/keyboard.h>
 #include <fiwix/sched.h>
+#include <fiwix/smp.h>
 #include <fiwix/mm.h>
 #include <fiwix/ipc.h>
 #include <fiwix/kexec.h>
 #include <fiwix/sysconsole.h>
+#include <fiwix/vdso.h>
 
 struct kernel_params kparms;
 struct kernel_stat kstat;
@@ -125,24 +127,35 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 	 * IDLE is now the current process (created manually as PID 0),
 	 * it won't be placed in the running queue.
 	 */
-	current = get_proc_free();
+	current = cpu_data[0].idle = get_proc_free();
 	proc_slot_init(current);
 	set_tss(current);
 	load_tr(TSS);
 	current->tss.cr3 = V2P((unsigned int)kpage_dir);
 	current->flags |= PF_KPROC;
+	current->mm = &kernel_mm;
+	current->files = &kernel_files;
+	current->sighand = &kernel_sighand;
 	sprintk(current->argv0, "%s", "idle");
+	vdso_init();
 
 	/* PID 1 is for the INIT process */
 	init = get_proc_free();
 	proc_slot_init(init);
-	init->pid = get_unused_pid();
+	init->pid = init->tgid = get_unused_pid();
+	init->mm = &kernel_mm;
+	init->files = &kernel_files;
+	init->sighand = &kernel_sighand;
 
 	kernel_process("kswapd", kswapd);	/* PID 2 */
 	kernel_process("kbdflushd", kbdflushd);	/* PID 3 */
 
+#ifdef CONFIG_SMP
+	smp_init();
+#endif /* CONFIG_SMP */
+
 	/* kswapd will take over the rest of the kernel initialization */
-	need_resched = 1;
+	set_need_resched();
 
 	STI();		/* let's rock! */
 	cpu_idle();
@@ -150,15 +163,18 @@ void start_kernel(unsigned int magic, unsigned int info, unsigned int last_boot_
 
 void stop_kernel(void)
 {
+	struct cpu_data *cpu;
 	struct proc *p, *next;
 	int n;
 
 	/* put all processes to sleep and reset all pending signals */
-	FOR_EACH_PROCESS_RUNNING(p) {
-		next = p->next_run;
-		not_runnable(p, PROC_SLEEPING);
-		p->sigpending = 0;
-		p = next;
+	FOR_EACH_CPU(cpu) {
+		FOR_EACH_PROCESS_RUNNING(cpu, p) {
+			next = p->next_run;
+			not_runnable(p, PROC_SLEEPING);
+			p->sigpending = 0;
+			p = next;
+		}
 	}
 
 #ifdef CONFIG_KEXEC
@@ -198,9 +214,22 @@ void stop_kernel(void)
 void cpu_idle()
 {
 	for(;;) {
+#ifdef CONFIG_SMP
+		if(need_resched || THIS_CPU->run_head || smp_balance()) {
+			do_sched();
+		}
+
+		/* the kernel lock is released while waiting for an interrupt */
+		CLI();
+		unlock_kernel();
+		STI();
+		HLT();
+		lock_kernel();
+#else
 		if(need_resched) {
 			do_sched();
 		}
 		HLT();
+#endif /* CONFIG_SMP */
 	}
 }
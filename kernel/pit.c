@@ -21,6 +21,27 @@ void pit_beep_off(unsigned int unused)
 	outport_b(PS2_SYSCTRL_B, inport_b(PS2_SYSCTRL_B) & ~(ENABLE_SDATA | ENABLE_TMR2G));
 }
 
+/* busy-waits 'usecs' microseconds (up to 54ms) using the channel 2 */
+void pit_delay(unsigned int usecs)
+{
+	unsigned int count;
+
+	count = ((OSCIL / 1000) * usecs) / 1000;
+	if(!count) {
+		count = 1;
+	}
+	if(count > 0xFFFF) {
+		count = 0xFFFF;
+	}
+	outport_b(PS2_SYSCTRL_B, inport_b(PS2_SYSCTRL_B) & ~(ENABLE_SDATA | ENABLE_TMR2G));
+	outport_b(MODEREG, SEL_CHAN2 | LSB_MSB | TERM_COUNT | BINARY_CTR);
+	outport_b(CHANNEL2, count & 0xFF);	/* LSB */
+	outport_b(CHANNEL2, count >> 8);	/* MSB */
+	outport_b(PS2_SYSCTRL_B, inport_b(PS2_SYSCTRL_B) | ENABLE_TMR2G);
+	while(!(inport_b(PS2_SYSCTRL_B) & 0x20));
+	outport_b(PS2_SYSCTRL_B, inport_b(PS2_SYSCTRL_B) & ~ENABLE_TMR2G);
+}
+
 int pit_getcounter0(void)
 {
 	int count;
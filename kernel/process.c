@@ -17,7 +17,6 @@
 #include <fiwix/stddef.h>
 
 struct proc *proc_table;
-struct proc *current;
 
 struct proc *proc_pool_head;
 struct proc *proc_table_head;
@@ -27,6 +26,11 @@ unsigned int free_proc_slots = 0;
 static struct resource slot_resource = { 0, 0 };
 static struct resource pid_resource = { 0, 0 };
 
+/* the kernel processes share these and never release them */
+struct mm_struct kernel_mm;
+struct files_struct kernel_files;
+struct sighand_struct kernel_sighand;
+
 int nr_processes = 0;
 __pid_t lastpid = 0;
 
@@ -70,7 +74,7 @@ void get_rusage(struct proc *p, struct rusage *ru)
 	 * then the child statistics should not be added to the values returned
 	 * by RUSAGE_CHILDREN.
 	 */
-	if(current->sigaction[SIGCHLD - 1].sa_handler == SIG_IGN) {
+	if(current->sighand->sigaction[SIGCHLD - 1].sa_handler == SIG_IGN) {
 		return;
 	}
 
@@ -112,13 +116,29 @@ void add_rusage(struct proc *p)
 	current->cusage.ru_nivcsw += cru.ru_nivcsw;
 }
 
+/* returns 1 if a thread group leader still has running threads */
+int has_live_threads(struct proc *leader)
+{
+	struct proc *t;
+
+	FOR_EACH_PROCESS(t) {
+		if(t != leader && t->tgid == leader->tgid && t->state != PROC_ZOMBIE) {
+			return 1;
+		}
+		t = t->next;
+	}
+	return 0;
+}
+
 struct proc *get_next_zombie(struct proc *parent)
 {
 	struct proc *p;
 
 	FOR_EACH_PROCESS(p) {
-		if(p->ppid == parent && p->state == PROC_ZOMBIE) {
-			return p;
+		if(p->ppid == parent && TG_LEADER(p) && p->state == PROC_ZOMBIE) {
+			if(!has_live_threads(p)) {
+				return p;
+			}
 		}
 		p = p->next;
 	}
@@ -130,20 +150,39 @@ __pid_t remove_zombie(struct proc *p)
 {
 	struct proc *pp;
 	__pid_t pid;
+	int leader;
 
 	pid = p->pid;
+	if((leader = TG_LEADER(p))) {
+		reap_threads(p);
+	}
 	kfree(p->tss.esp0);
 	p->rss--;
-	kfree(P2V(p->tss.cr3));
-	p->rss--;
+	release_mm(p);
+	release_files(p);
+	release_sighand(p);
 	pp = p->ppid;
 	release_proc(p);
-	if(pp) {
+	if(pp && leader) {
 		pp->children--;
 	}
 	return pid;
 }
 
+/* removes the threads of 'p' that have already exited */
+void reap_threads(struct proc *p)
+{
+	struct proc *t, *next;
+
+	FOR_EACH_PROCESS(t) {
+		next = t->next;
+		if(t != p && t->tgid == p->tgid && !TG_LEADER(t) && t->state == PROC_ZOMBIE) {
+			remove_zombie(t);
+		}
+		t = next;
+	}
+}
+
 /*
  * An orphaned process group is a process group in which the parent of every
  * member is either itself a member of the group or is not a member of the
@@ -273,15 +312,106 @@ struct proc *get_proc_by_pid(__pid_t pid)
 	return NULL;
 }
 
+struct mm_struct *get_mm(void)
+{
+	struct mm_struct *mm;
+
+	if(!(mm = (struct mm_struct *)kmalloc(sizeof(struct mm_struct)))) {
+		return NULL;
+	}
+	memset_b(mm, 0, sizeof(struct mm_struct));
+	mm->count = 1;
+	return mm;
+}
+
+/* the page directory goes away with the last process using it */
+void release_mm(struct proc *p)
+{
+	struct mm_struct *mm;
+
+	if(!(mm = p->mm) || mm == &kernel_mm) {
+		return;
+	}
+	p->mm = NULL;
+	if(--mm->count) {
+		return;
+	}
+	kfree(P2V(p->tss.cr3));
+	p->rss--;
+	kfree((unsigned int)mm);
+}
+
+struct files_struct *get_files(void)
+{
+	struct files_struct *files;
+
+	if(!(files = (struct files_struct *)kmalloc(sizeof(struct files_struct)))) {
+		return NULL;
+	}
+	memset_b(files, 0, sizeof(struct files_struct));
+	files->count = 1;
+	return files;
+}
+
+void release_files(struct proc *p)
+{
+	struct files_struct *files;
+
+	if(!(files = p->files) || files == &kernel_files) {
+		return;
+	}
+	p->files = NULL;
+	if(!--files->count) {
+		kfree((unsigned int)files);
+	}
+}
+
+struct sighand_struct *get_sighand(void)
+{
+	struct sighand_struct *sighand;
+
+	if(!(sighand = (struct sighand_struct *)kmalloc(sizeof(struct sighand_struct)))) {
+		return NULL;
+	}
+	memset_b(sighand, 0, sizeof(struct sighand_struct));
+	sighand->count = 1;
+	return sighand;
+}
+
+void release_sighand(struct proc *p)
+{
+	struct sighand_struct *sighand;
+
+	if(!(sighand = p->sighand) || sighand == &kernel_sighand) {
+		return;
+	}
+	p->sighand = NULL;
+	if(!--sighand->count) {
+		kfree((unsigned int)sighand);
+	}
+}
+
+/* gives the address space back to the parent sleeping in vfork() */
+void release_vfork(struct proc *p)
+{
+	if(p->flags & PF_VFORK) {
+		p->flags &= ~PF_VFORK;
+		wakeup(p);
+	}
+}
+
 struct proc *kernel_process(const char *name, int (*fn)(void))
 {
 	struct proc *p;
 
 	p = get_proc_free();
 	proc_slot_init(p);
-	p->pid = get_unused_pid();
+	p->pid = p->tgid = get_unused_pid();
 	p->ppid = &proc_table[IDLE];
 	p->flags |= PF_KPROC;
+	p->mm = &kernel_mm;
+	p->files = &kernel_files;
+	p->sighand = &kernel_sighand;
 	p->priority = DEF_PRIORITY;
 	if(!(p->tss.esp0 = kmalloc(PAGE_SIZE))) {
 		release_proc(p);
@@ -324,6 +454,14 @@ void proc_slot_init(struct proc *p)
 
 	p->tss.io_bitmap[IO_BITMAP_SIZE] = ~0;	/* extra byte must be all 1's */
 	p->state = PROC_IDLE;
+	p->cpu = 0;
+#ifdef CONFIG_SMP
+	/* a new process starts running with the kernel lock held */
+	p->lock_depth = 1;
+#endif /* CONFIG_SMP */
+#ifdef CONFIG_PREEMPT
+	p->preempt_count = 0;
+#endif /* CONFIG_PREEMPT */
 }
 
 void proc_init(void)
@@ -0,0 +1,284 @@
+/*
+ * fiwix/kernel/ptimer.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/ptimer.h>
+#include <fiwix/timer.h>
+#include <fiwix/time.h>
+#include <fiwix/signal.h>
+#include <fiwix/sched.h>
+#include <fiwix/process.h>
+#include <fiwix/string.h>
+
+#define IS_CPU_CLOCK(c)	((c) == CLOCK_PROCESS_CPUTIME_ID || (c) == CLOCK_THREAD_CPUTIME_ID)
+
+static struct ptimer ptimer_table[NR_PTIMERS];
+static int nr_ptimers = 0;
+
+/* returns the timer only if it belongs to the current process */
+static struct ptimer *get_ptimer(__timer_t id)
+{
+	if(id < 0 || id >= NR_PTIMERS || ptimer_table[id].tgid != current->tgid) {
+		return NULL;
+	}
+	return &ptimer_table[id];
+}
+
+/*
+ * Reloads the timer and sends its signal. If the signal from a previous
+ * expiration is still pending it counts as an overrun instead.
+ */
+static void expire_ptimer(struct ptimer *t)
+{
+	struct proc *p;
+
+	t->value = t->interval;
+	if(!t->signum) {
+		return;
+	}
+
+	/* the signal goes to the process if the thread is gone */
+	p = get_proc_by_pid(t->pid);
+	if(!p || p->tgid != t->tgid || p->state == PROC_ZOMBIE) {
+		if(!(p = get_proc_by_pid(t->tgid))) {
+			return;
+		}
+	}
+	if(p->sigpending & (1 << (t->signum - 1))) {
+		t->overrun++;
+		return;
+	}
+	t->overrun = 0;
+	send_sig(p, t->signum);
+}
+
+int ptimer_create(__clockid_t clock, struct sigevent *sev)
+{
+	struct ptimer *t;
+	struct proc *p;
+	unsigned int flags;
+	int n, id, owned;
+
+	if(clock < CLOCK_REALTIME || clock > CLOCK_THREAD_CPUTIME_ID) {
+		return -EINVAL;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	t = NULL;
+	id = owned = 0;
+
+	/* a single process can't take the whole table */
+	for(n = 0; n < NR_PTIMERS; n++) {
+		if(!ptimer_table[n].tgid) {
+			if(!t) {
+				t = &ptimer_table[n];
+				id = n;
+			}
+		} else if(ptimer_table[n].tgid == current->tgid) {
+			owned++;
+		}
+	}
+	if(!t || owned >= NR_PTIMERS_PROC) {
+		RESTORE_FLAGS(flags);
+		return -EAGAIN;
+	}
+	memset_b(t, 0, sizeof(struct ptimer));
+	t->pid = current->tgid;
+	t->tid = current->pid;
+	t->signum = SIGALRM;
+
+	if(sev) {
+		switch(sev->sigev_notify) {
+			case SIGEV_NONE:
+				t->signum = 0;
+				break;
+			case SIGEV_THREAD_ID:
+				p = get_proc_by_pid(sev->sigev_notify_thread_id);
+				if(!p || p->tgid != current->tgid) {
+					RESTORE_FLAGS(flags);
+					return -EINVAL;
+				}
+				t->pid = p->pid;
+				/* fall through */
+			case SIGEV_SIGNAL:
+				if(sev->sigev_signo <= 0 || sev->sigev_signo >= NSIG) {
+					RESTORE_FLAGS(flags);
+					return -EINVAL;
+				}
+				t->signum = sev->sigev_signo;
+				break;
+			default:
+				RESTORE_FLAGS(flags);
+				return -EINVAL;
+		}
+	}
+	t->tgid = current->tgid;
+	t->clock = clock;
+	nr_ptimers++;
+	RESTORE_FLAGS(flags);
+	return id;
+}
+
+static void get_itimerspec(struct ptimer *t, struct itimerspec *curr)
+{
+	ticks2ts(t->interval, &curr->it_interval);
+	curr->it_value.tv_sec = curr->it_value.tv_nsec = 0;
+	if(t->value) {
+		if(IS_CPU_CLOCK(t->clock)) {
+			ticks2ts(t->value, &curr->it_value);
+		} else {
+			timeout_ts(t->value, &curr->it_value);
+		}
+		/* an armed timer never shows zero */
+		if(!curr->it_value.tv_sec && !curr->it_value.tv_nsec) {
+			curr->it_value.tv_nsec = 1;
+		}
+	}
+}
+
+/*
+ * The timers are driven by the tick, so an absolute expiration time is
+ * converted into a relative one now. Changes of the system time that come
+ * later don't move an armed CLOCK_REALTIME timer.
+ */
+int ptimer_settime(__timer_t id, int tflags, const struct itimerspec *new, struct itimerspec *old)
+{
+	struct ptimer *t;
+	struct timespec ts, now;
+	unsigned int value, interval, flags;
+
+	if(!(t = get_ptimer(id))) {
+		return -EINVAL;
+	}
+
+	value = 0;
+	if(new->it_value.tv_sec || new->it_value.tv_nsec) {
+		ts = new->it_value;
+		if(tflags & TIMER_ABSTIME) {
+			do_clock_gettime(t->clock, &now);
+			ts_sub(&ts, &now);
+			if(ts.tv_sec < 0) {
+				ts.tv_sec = ts.tv_nsec = 0;
+			}
+		}
+		if(IS_CPU_CLOCK(t->clock)) {
+			value = ts2ticks(&ts);
+		} else {
+			value = timeout_ticks(&ts);
+		}
+		if(!value) {
+			value = 1;
+		}
+	}
+	interval = ts2ticks(&new->it_interval);
+
+	SAVE_FLAGS(flags); CLI();
+	if(old) {
+		get_itimerspec(t, old);
+	}
+	t->value = value;
+	t->interval = interval;
+	t->overrun = 0;
+	RESTORE_FLAGS(flags);
+	return 0;
+}
+
+int ptimer_gettime(__timer_t id, struct itimerspec *curr)
+{
+	struct ptimer *t;
+	unsigned int flags;
+
+	if(!(t = get_ptimer(id))) {
+		return -EINVAL;
+	}
+	SAVE_FLAGS(flags); CLI();
+	get_itimerspec(t, curr);
+	RESTORE_FLAGS(flags);
+	return 0;
+}
+
+int ptimer_getoverrun(__timer_t id)
+{
+	struct ptimer *t;
+
+	if(!(t = get_ptimer(id))) {
+		return -EINVAL;
+	}
+	return t->overrun;
+}
+
+int ptimer_delete(__timer_t id)
+{
+	struct ptimer *t;
+	unsigned int flags;
+
+	if(!(t = get_ptimer(id))) {
+		return -EINVAL;
+	}
+	SAVE_FLAGS(flags); CLI();
+	t->tgid = 0;
+	nr_ptimers--;
+	RESTORE_FLAGS(flags);
+	return 0;
+}
+
+/* called when the last thread of a process exits or it calls execve() */
+void release_ptimers(__pid_t tgid)
+{
+	unsigned int flags;
+	int n;
+
+	SAVE_FLAGS(flags); CLI();
+	for(n = 0; n < NR_PTIMERS && nr_ptimers; n++) {
+		if(ptimer_table[n].tgid == tgid) {
+			ptimer_table[n].tgid = 0;
+			nr_ptimers--;
+		}
+	}
+	RESTORE_FLAGS(flags);
+}
+
+/* called at every tick from the timer bottom half */
+void run_ptimers(void)
+{
+	struct ptimer *t;
+
+	if(!nr_ptimers) {
+		return;
+	}
+	for(t = &ptimer_table[0]; t < &ptimer_table[NR_PTIMERS]; t++) {
+		if(t->tgid && t->value && !IS_CPU_CLOCK(t->clock)) {
+			if(!--t->value) {
+				expire_ptimer(t);
+			}
+		}
+	}
+}
+
+/* called at every tick charged to the current process */
+void account_ptimers(void)
+{
+	struct ptimer *t;
+
+	if(!nr_ptimers) {
+		return;
+	}
+	for(t = &ptimer_table[0]; t < &ptimer_table[NR_PTIMERS]; t++) {
+		if(!t->tgid || !t->value) {
+			continue;
+		}
+		if((t->clock == CLOCK_PROCESS_CPUTIME_ID && t->tgid == current->tgid) ||
+		   (t->clock == CLOCK_THREAD_CPUTIME_ID && t->tid == current->pid)) {
+			if(!--t->value) {
+				expire_ptimer(t);
+			}
+		}
+	}
+}
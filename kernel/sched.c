@@ -10,15 +10,62 @@
 #include <fiwix/sched.h>
 #include <fiwix/process.h>
 #include <fiwix/sleep.h>
+#include <fiwix/smp.h>
 #include <fiwix/segments.h>
 #include <fiwix/timer.h>
 #include <fiwix/pic.h>
+#include <fiwix/cpu.h>
+#include <fiwix/vdso.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
-extern struct seg_desc gdt[NR_GDT_ENTRIES];
 int need_resched = 0;
 
+#ifdef CONFIG_LATENCY_TRACER
+struct latency_trace latency;
+
+/* the TSC is preferred since the timer ticks are too coarse for this */
+static unsigned long long int latency_clock(void)
+{
+	if((_cpuflags & CPU_TSC) && cpu_table.hz >= 1000000) {
+		return get_rdtsc();
+	}
+	return kstat.ticks;
+}
+
+void latency_start(void)
+{
+	latency.start = latency_clock();
+}
+
+/*
+ * Measures how long the reschedule request has been waiting for a chance to
+ * be attended and keeps the longest one. If the current process is allowed to
+ * keep the CPU the measure starts again from here.
+ */
+static void latency_check(unsigned int eip)
+{
+	unsigned long long int delta;
+	unsigned int usecs;
+
+	delta = latency_clock() - latency.start;
+	if(delta >> 32) {
+		usecs = ~0;
+	} else if((_cpuflags & CPU_TSC) && cpu_table.hz >= 1000000) {
+		usecs = (unsigned int)delta / (cpu_table.hz / 1000000);
+	} else {
+		usecs = (unsigned int)delta * (1000000 / HZ);
+	}
+	latency.samples++;
+	if(usecs > latency.max_usecs) {
+		latency.max_usecs = usecs;
+		latency.pid = current->pid;
+		latency.eip = eip;
+	}
+	latency_start();
+}
+#endif /* CONFIG_LATENCY_TRACER */
+
 static void context_switch(struct proc *next)
 {
 	struct proc *prev;
@@ -28,6 +75,12 @@ static void context_switch(struct proc *next)
 	prev = current;
 	set_tss(next);
 	current = next;
+	load_tls(next->tls);
+#ifdef CONFIG_SMP
+	/* the kernel lock is handed over with its nesting level */
+	prev->lock_depth = THIS_CPU->lock_depth;
+	THIS_CPU->lock_depth = next->lock_depth;
+#endif /* CONFIG_SMP */
 	do_switch(&prev->tss.esp, &prev->tss.eip, next->tss.esp, next->tss.eip, next->tss.cr3, TSS);
 	STI();
 }
@@ -36,30 +89,62 @@ void set_tss(struct proc *p)
 {
 	struct seg_desc *g;
 
-	g = &gdt[TSS / sizeof(struct seg_desc)];
+	g = &THIS_CPU->gdt[TSS / sizeof(struct seg_desc)];
 
 	g->sd_lobase = (unsigned int)&p->tss;
 	g->sd_loflags = SD_TSSPRESENT;
 	g->sd_hibase = (char)(((unsigned int)&p->tss) >> 24);
+
+	/* 'sysenter' doesn't read the kernel stack from the TSS */
+	if(sysenter_return) {
+		wrmsr(MSR_SYSENTER_ESP, p->tss.esp0, 0);
+	}
+}
+
+/* the first thing a new process created with CLONE_CHILD_SETTID does */
+void schedule_tail(void)
+{
+	STI();
+	if(current->set_child_tid) {
+		*current->set_child_tid = current->pid;
+		current->set_child_tid = NULL;
+	}
 }
 
 /* Round Robin algorithm */
 void do_sched(void)
 {
 	int count;
+	struct cpu_data *cpu;
 	struct proc *p, *selected;
+	unsigned int flags;
+
+#ifdef CONFIG_LATENCY_TRACER
+	if(need_resched) {
+		latency_check((unsigned int)__builtin_return_address(0));
+	}
+#endif /* CONFIG_LATENCY_TRACER */
 
 	/* let the current running process consume its time slice */
 	if(current->state == PROC_RUNNING && current->cpu_count > 0) {
 		return;
 	}
 
+	preempt_disable();
 	need_resched = 0;
+	cpu = THIS_CPU;
+#ifdef CONFIG_SMP
+	if(!cpu->run_head) {
+		smp_balance();
+	}
+#endif /* CONFIG_SMP */
+
+	spin_lock_irqsave(&cpu->rq_lock, flags);
 	for(;;) {
 		count = -1;
-		selected = &proc_table[IDLE];
+		selected = cpu->idle;
 
-		FOR_EACH_PROCESS_RUNNING(p) {
+		FOR_EACH_PROCESS_RUNNING(cpu, p) {
 			if(p->cpu_count > count) {
 				count = p->cpu_count;
 				selected = p;
@@ -71,15 +156,47 @@ void do_sched(void)
 		}
 
 		/* reassigns new quantum to all running processes */
-		FOR_EACH_PROCESS_RUNNING(p) {
+		FOR_EACH_PROCESS_RUNNING(cpu, p) {
 			p->cpu_count = p->priority;
 			p = p->next_run;
 		}
 	}
+	spin_unlock_irqrestore(&cpu->rq_lock, flags);
+
 	if(current != selected) {
 		context_switch(selected);
 	}
+	preempt_enable();
+}
+
+/*
+ * A voluntary preemption point for the long loops in the kernel. It must be
+ * called with no locks held that other processes might need to make progress.
+ */
+void cond_resched(void)
+{
+	if(need_resched) {
+		do_sched();
+	}
+}
+
+#ifdef CONFIG_PREEMPT
+/*
+ * Called on the way back from an interrupt or exception that arrived while
+ * the CPU was in kernel mode. The interrupted code is preempted only if it
+ * had the interrupts enabled and it's not inside a preempt_disable() section.
+ */
+void preempt_irq(struct sigcontext *sc)
+{
+	if(!need_resched || current->preempt_count) {
+		return;
+	}
+	if(!(sc->eflags & (1 << EF_IF))) {
+		return;
+	}
+	do_sched();
 }
+#endif /* CONFIG_PREEMPT */
 
 void sched_init(void)
 {
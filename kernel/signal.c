@@ -34,8 +34,8 @@ int send_sig(struct proc *p, __sigset_t signum)
 		return -EINVAL;
 	}
 
-	/* kernel processes can't receive signals */
-	if(p->flags & PF_KPROC) {
+	/* kernel processes and zombies can't receive signals */
+	if((p->flags & PF_KPROC) || p->state == PROC_ZOMBIE) {
 		return 0;
 	}
 
@@ -46,7 +46,7 @@ int send_sig(struct proc *p, __sigset_t signum)
 		case SIGCONT:
 			if(p->state == PROC_STOPPED) {
 				runnable(p);
-				need_resched = 1;
+				set_need_resched();
 			}
 			/* discard all pending stop signals */
 			p->sigpending &= SIG_MASK(SIGSTOP);
@@ -72,13 +72,13 @@ int send_sig(struct proc *p, __sigset_t signum)
 	switch(signum) {
 		case SIGFPE:
 		case SIGSEGV:
-			if(p->sigaction[signum - 1].sa_handler == SIG_IGN) {
-				p->sigaction[signum - 1].sa_handler = SIG_DFL;
+			if(p->sighand->sigaction[signum - 1].sa_handler == SIG_IGN) {
+				p->sighand->sigaction[signum - 1].sa_handler = SIG_DFL;
 			}
 			break;
 	}
 
-	if(p->sigaction[signum - 1].sa_handler == SIG_DFL) {
+	if(p->sighand->sigaction[signum - 1].sa_handler == SIG_DFL) {
 		/*
 		 * INIT process is special, it only gets signals that have the
 		 * signal handler installed. This avoids to bring down the
@@ -98,7 +98,7 @@ int send_sig(struct proc *p, __sigset_t signum)
 		}
 	}
 
-	if(p->sigaction[signum - 1].sa_handler == SIG_IGN) {
+	if(p->sighand->sigaction[signum - 1].sa_handler == SIG_IGN) {
 		/* if SIGCHLD is ignored reap its children (prevent zombies) */
 		if(signum == SIGCHLD) {
 			while(sys_waitpid(-1, NULL, WNOHANG) > 0) {
@@ -132,18 +132,18 @@ int issig(void)
 	for(signum = 1, mask = 1; signum < NSIG; signum++, mask <<= 1) {
 		if(current->sigpending & mask) {
 			if(signum == SIGCHLD) {
-				if(current->sigaction[signum - 1].sa_handler == SIG_IGN) {
+				if(current->sighand->sigaction[signum - 1].sa_handler == SIG_IGN) {
 					/* this process ignores SIGCHLD */
 					while((p = get_next_zombie(current))) {
 						remove_zombie(p);
 					}
 				} else {
-					if(current->sigaction[signum - 1].sa_handler != SIG_DFL) {
+					if(current->sighand->sigaction[signum - 1].sa_handler != SIG_DFL) {
 						return signum;
 					}
 				}
 			} else {
-				if(current->sigaction[signum - 1].sa_handler != SIG_IGN) {
+				if(current->sighand->sigaction[signum - 1].sa_handler != SIG_IGN) {
 					return signum;
 				}
 			}
@@ -166,7 +166,7 @@ void psig(unsigned int stack)
 		if(current->sigpending & mask) {
 			current->sigpending &= ~mask;
 
-			if((unsigned int)current->sigaction[signum - 1].sa_handler) {
+			if((unsigned int)current->sighand->sigaction[signum - 1].sa_handler) {
 
 				/*
 				 * page_not_present() may have raised a SIGSEGV if it
@@ -183,7 +183,7 @@ void psig(unsigned int stack)
 				}
 
 				current->sigexecuting = mask;
-				if(!(current->sigaction[signum - 1].sa_flags & SA_NODEFER)) {
+				if(!(current->sighand->sigaction[signum - 1].sa_flags & SA_NODEFER)) {
 					current->sigblocked |= mask;
 				}
 
@@ -195,20 +195,20 @@ void psig(unsigned int stack)
 				sc->oldesp -= 4;
 				sc->oldesp &= ~3;	/* round up */
 				memcpy_b((void *)sc->oldesp, sighandler_trampoline, len);
-				sc->ecx = (unsigned int)current->sigaction[signum - 1].sa_handler;
+				sc->ecx = (unsigned int)current->sighand->sigaction[signum - 1].sa_handler;
 				sc->eax= signum;
 				sc->eip = sc->oldesp;
 
-				if(current->sigaction[signum - 1].sa_flags & SA_RESETHAND) {
-					current->sigaction[signum - 1].sa_handler = SIG_DFL;
+				if(current->sighand->sigaction[signum - 1].sa_flags & SA_RESETHAND) {
+					current->sighand->sigaction[signum - 1].sa_handler = SIG_DFL;
 				}
 				return;
 			}
-			if(current->sigaction[signum - 1].sa_handler == SIG_DFL) {
+			if(current->sighand->sigaction[signum - 1].sa_handler == SIG_DFL) {
 				switch(signum) {
 					case SIGCONT:
 						runnable(current);
-						need_resched = 1;
+						set_need_resched();
 						break;
 					case SIGSTOP:
 					case SIGTSTP:
@@ -216,16 +216,22 @@ void psig(unsigned int stack)
 					case SIGTTOU:
 						current->exit_code = signum;
 						not_runnable(current, PROC_STOPPED);
-						if(!(current->sigaction[signum - 1].sa_flags & SA_NOCLDSTOP)) {
+						if(!(current->sighand->sigaction[signum - 1].sa_flags & SA_NOCLDSTOP)) {
 							p = current->ppid;
 							send_sig(p, SIGCHLD);
 							/* needed for job control */
 							wakeup(&sys_wait4);
 						}
-						need_resched = 1;
+						set_need_resched();
 						break;
 					case SIGCHLD:
 						break;
+					case SIGKILL:
+						/* exit_group() left the exit code */
+						if(current->flags & PF_GROUPEXIT) {
+							do_exit(current->exit_code);
+						}
+						do_exit(signum);
 					default:
 						do_exit(signum);
 				}
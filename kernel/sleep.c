@@ -12,6 +12,7 @@
 #include <fiwix/sched.h>
 #include <fiwix/signal.h>
 #include <fiwix/process.h>
+#include <fiwix/smp.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
@@ -19,11 +20,38 @@
 #define SLEEP_HASH(addr)	((addr) % (NR_BUCKETS))
 
 struct proc *sleep_hash_table[NR_BUCKETS];
-struct proc *proc_run_head;
 static unsigned int area = 0;
 
+/* the run queue lock of 'cpu' must be held */
+void rq_add(struct cpu_data *cpu, struct proc *p)
+{
+	if(cpu->run_head) {
+		p->next_run = cpu->run_head;
+		cpu->run_head->prev_run = p;
+	}
+	cpu->run_head = p;
+	cpu->nr_running++;
+}
+
+/* the run queue lock of 'cpu' must be held */
+void rq_del(struct cpu_data *cpu, struct proc *p)
+{
+	if(p->next_run) {
+		p->next_run->prev_run = p->prev_run;
+	}
+	if(p->prev_run) {
+		p->prev_run->next_run = p->next_run;
+	}
+	if(p == cpu->run_head) {
+		cpu->run_head = p->next_run;
+	}
+	p->prev_run = p->next_run = NULL;
+	cpu->nr_running--;
+}
+
 void runnable(struct proc *p)
 {
+	struct cpu_data *cpu;
 	unsigned int flags;
 
 	if(p->state == PROC_RUNNING) {
@@ -31,33 +59,30 @@ void runnable(struct proc *p)
 		return;
 	}
 
-	SAVE_FLAGS(flags); CLI();
-	if(proc_run_head) {
-		p->next_run = proc_run_head;
-		proc_run_head->prev_run = p;
-	}
-	proc_run_head = p;
+	cpu = &cpu_data[p->cpu];
+	spin_lock_irqsave(&cpu->rq_lock, flags);
+	rq_add(cpu, p);
 	p->state = PROC_RUNNING;
-	RESTORE_FLAGS(flags);
+	spin_unlock_irqrestore(&cpu->rq_lock, flags);
+
+#ifdef CONFIG_SMP
+	/* an idle CPU won't look at its run queue until the next interrupt */
+	if(cpu != THIS_CPU && cpu->current_proc == cpu->idle) {
+		smp_send_resched(cpu);
+	}
+#endif /* CONFIG_SMP */
 }
 
 void not_runnable(struct proc *p, int state)
 {
+	struct cpu_data *cpu;
 	unsigned int flags;
 
-	SAVE_FLAGS(flags); CLI();
-	if(p->next_run) {
-		p->next_run->prev_run = p->prev_run;
-	}
-	if(p->prev_run) {
-		p->prev_run->next_run = p->next_run;
-	}
-	if(p == proc_run_head) {
-		proc_run_head = p->next_run;
-	}
-	p->prev_run = p->next_run = NULL;
+	cpu = &cpu_data[p->cpu];
+	spin_lock_irqsave(&cpu->rq_lock, flags);
+	rq_del(cpu, p);
 	p->state = state;
-	RESTORE_FLAGS(flags);
+	spin_unlock_irqrestore(&cpu->rq_lock, flags);
 }
 
 int sleep(void *address, int state)
@@ -128,7 +153,7 @@ void wakeup(void *address)
 			(*h)->flags &= ~PF_NOTINTERRUPT;
 			(*h)->cpu_count = (*h)->priority;
 			runnable(*h);
-			need_resched = 1;
+			set_need_resched();
 			if((*h)->next_sleep) {
 				(*h)->next_sleep->prev_sleep = (*h)->prev_sleep;
 			}
@@ -145,6 +170,40 @@ void wakeup(void *address)
 	RESTORE_FLAGS(flags);
 }
 
+/*
+ * Wakes up only the process that has been sleeping the longest on 'address'
+ * (the last one in the chain, since processes are inserted in the head).
+ */
+void wakeup_one(void *address)
+{
+	unsigned int flags;
+	struct proc *p, *found;
+
+	SAVE_FLAGS(flags); CLI();
+	found = NULL;
+	for(p = sleep_hash_table[SLEEP_HASH((unsigned int)address)]; p; p = p->next_sleep) {
+		if(p->sleep_address == address) {
+			found = p;
+		}
+	}
+	if(found) {
+		if(found->next_sleep) {
+			found->next_sleep->prev_sleep = found->prev_sleep;
+		}
+		if(found->prev_sleep) {
+			found->prev_sleep->next_sleep = found->next_sleep;
+		} else {
+			sleep_hash_table[SLEEP_HASH((unsigned int)address)] = found->next_sleep;
+		}
+		found->sleep_address = NULL;
+		found->flags &= ~PF_NOTINTERRUPT;
+		found->cpu_count = found->priority;
+		runnable(found);
+		set_need_resched();
+	}
+	RESTORE_FLAGS(flags);
+}
+
 void wakeup_proc(struct proc *p)
 {
 	unsigned int flags;
@@ -181,7 +240,7 @@ void wakeup_proc(struct proc *p)
 	p->sleep_address = NULL;
 	p->cpu_count = p->priority;
 	runnable(p);
-	need_resched = 1;
+	set_need_resched();
 
 	RESTORE_FLAGS(flags);
 }
@@ -245,6 +304,5 @@ int unlock_area(unsigned int type)
 
 void sleep_init(void)
 {
-	proc_run_head = NULL;
 	memset_b(sleep_hash_table, 0, sizeof(sleep_hash_table));
 }
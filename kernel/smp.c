@@ -0,0 +1,289 @@
+/*
+ * fiwix/kernel/smp.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/smp.h>
+#include <fiwix/apic.h>
+#include <fiwix/segments.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/pit.h>
+#include <fiwix/cpu.h>
+#include <fiwix/vdso.h>
+#include <fiwix/mm.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+#include <fiwix/stddef.h>
+
+extern struct seg_desc gdt[NR_GDT_ENTRIES];
+
+struct cpu_data cpu_data[NR_CPUS];
+int nr_cpus = 1;
+
+#ifdef CONFIG_SMP
+extern struct desc_r idtr;
+
+/*
+ * Linux 2.0 style Big Kernel Lock: only one CPU at a time runs kernel code,
+ * so the sections protected with SAVE_FLAGS(); CLI(); are still atomic. The
+ * BSP boots holding it and releases it the first time it becomes idle.
+ */
+static struct spinlock kernel_lock = { 1 };
+
+/* the threads of a process share the TLB, so they never leave its CPU */
+static int can_migrate(struct proc *p)
+{
+	return (p->flags & PF_KPROC) || p->mm->count == 1;
+}
+
+static struct proc *ap_idle_init(struct cpu_data *cpu)
+{
+	struct proc *p;
+
+	if(!(p = get_proc_free())) {
+		return NULL;
+	}
+	memset_b(p, 0, sizeof(struct proc));
+	if(!(p->tss.esp0 = kmalloc(PAGE_SIZE))) {
+		release_proc(p);
+		return NULL;
+	}
+	p->tss.esp0 += PAGE_SIZE - 4;
+	p->tss.esp = p->tss.esp0;
+	p->tss.ss0 = KERNEL_DS;
+	p->tss.cr3 = V2P((unsigned int)kpage_dir);
+	p->tss.io_bitmap_addr = offsetof(struct i386tss, io_bitmap);
+	memset_l(&p->tss.io_bitmap, ~0, IO_BITMAP_SIZE / sizeof(unsigned int));
+	p->tss.io_bitmap[IO_BITMAP_SIZE] = ~0;
+	p->state = PROC_IDLE;
+	p->flags = PF_KPROC;
+	p->cpu = cpu->id;
+	p->ppid = &proc_table[IDLE];
+	p->mm = &kernel_mm;
+	p->files = &kernel_files;
+	p->sighand = &kernel_sighand;
+	sprintk(p->argv0, "idle/%d", cpu->id);
+	return p;
+}
+
+static void boot_ap(struct cpu_data *cpu)
+{
+	unsigned int *esp;
+	int n;
+
+	esp = (unsigned int *)P2V(SMP_TRAMPOLINE_ADDR + ((unsigned int)&ap_tramp_esp - (unsigned int)ap_trampoline));
+	*esp = cpu->idle->tss.esp;
+
+	/* INIT-SIPI-SIPI sequence */
+	lapic_send_ipi(cpu->apic_id, ICR_INIT | ICR_ASSERT | ICR_LEVEL);
+	pit_delay(10000);
+	lapic_send_ipi(cpu->apic_id, ICR_INIT | ICR_LEVEL);
+	for(n = 0; n < 2 && !cpu->online; n++) {
+		lapic_send_ipi(cpu->apic_id, ICR_STARTUP | (SMP_TRAMPOLINE_ADDR >> PAGE_SHIFT));
+		pit_delay(200);
+	}
+
+	/* give it up to 100ms to come up */
+	for(n = 0; n < 100 && !cpu->online; n++) {
+		pit_delay(1000);
+	}
+	if(!cpu->online) {
+		printk("WARNING: %s(): CPU %d (APIC ID %d) is not responding.\n", __FUNCTION__, cpu->id, cpu->apic_id);
+	}
+}
+
+void lock_kernel(void)
+{
+	struct cpu_data *cpu;
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	cpu = THIS_CPU;
+	if(!cpu->lock_depth++) {
+		spin_lock(&kernel_lock);
+	}
+	RESTORE_FLAGS(flags);
+}
+
+void unlock_kernel(void)
+{
+	struct cpu_data *cpu;
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	cpu = THIS_CPU;
+	if(!--cpu->lock_depth) {
+		spin_unlock(&kernel_lock);
+	}
+	RESTORE_FLAGS(flags);
+}
+
+void smp_send_resched(struct cpu_data *cpu)
+{
+	if(cpu->online) {
+		lapic_send_ipi(cpu->apic_id, ICR_FIXED | RESCHED_VECTOR);
+	}
+}
+
+void smp_resched_irq(void)
+{
+	lapic_eoi();
+	set_need_resched();
+}
+
+/*
+ * Pulls a process waiting in the run queue of the busiest CPU when this one
+ * has nothing to run. The run queue locks are always taken in CPU order.
+ */
+int smp_balance(void)
+{
+	struct cpu_data *this, *cpu, *busiest, *first, *second;
+	struct proc *p;
+	unsigned int flags;
+
+	this = THIS_CPU;
+	busiest = NULL;
+	FOR_EACH_CPU(cpu) {
+		if(cpu == this || !cpu->online || cpu->nr_running < 2) {
+			continue;
+		}
+		if(!busiest || cpu->nr_running > busiest->nr_running) {
+			busiest = cpu;
+		}
+	}
+	if(!busiest) {
+		return 0;
+	}
+
+	first = this < busiest ? this : busiest;
+	second = this < busiest ? busiest : this;
+	SAVE_FLAGS(flags); CLI();
+	spin_lock(&first->rq_lock);
+	spin_lock(&second->rq_lock);
+	FOR_EACH_PROCESS_RUNNING(busiest, p) {
+		if(p != busiest->current_proc && can_migrate(p)) {
+			rq_del(busiest, p);
+			p->cpu = this->id;
+			rq_add(this, p);
+			break;
+		}
+		p = p->next_run;
+	}
+	spin_unlock(&second->rq_lock);
+	spin_unlock(&first->rq_lock);
+	RESTORE_FLAGS(flags);
+	return p != NULL;
+}
+
+/* the APs land here from the trampoline, running on the stack of their idle */
+void smp_ap_entry(void)
+{
+	struct cpu_data *cpu;
+	int apic_id;
+
+	apic_id = lapic_read(LAPIC_ID) >> 24;
+	FOR_EACH_CPU(cpu) {
+		if(cpu->apic_id == apic_id) {
+			break;
+		}
+	}
+
+	gdt_init_ap(cpu);
+	load_idt((unsigned int)&idtr);
+	lapic_init();
+	cpu->current_proc = cpu->idle;
+	set_tss(cpu->idle);
+	load_tr(TSS);
+	sysenter_init();
+	lapic_timer_init();
+	cpu->online = 1;
+
+	/* wait until the BSP becomes idle for the first time */
+	lock_kernel();
+	STI();
+	cpu_idle();
+}
+
+void smp_init(void)
+{
+	struct cpu_data *cpu;
+	unsigned int *cr3;
+	int n;
+
+	if(!(cpu_table.flags & CPU_APIC) || mp_init() < 2) {
+		nr_cpus = 1;
+		return;
+	}
+	map_kaddr(kpage_dir, lapic_addr, lapic_addr + PAGE_SIZE, 0, PAGE_PRESENT | PAGE_RW);
+	lapic_init();
+	lapic_timer_calibrate();
+
+	/* the trampoline needs the low memory identity mapped to enable paging */
+	kpage_dir[0] = kpage_dir[GET_PGDIR(PAGE_OFFSET)];
+	memcpy_b((void *)P2V(SMP_TRAMPOLINE_ADDR), ap_trampoline, (unsigned int)ap_trampoline_end - (unsigned int)ap_trampoline);
+	cr3 = (unsigned int *)P2V(SMP_TRAMPOLINE_ADDR + ((unsigned int)&ap_tramp_cr3 - (unsigned int)ap_trampoline));
+	*cr3 = V2P((unsigned int)kpage_dir);
+
+	for(n = 1; n < nr_cpus; n++) {
+		cpu = &cpu_data[n];
+		if(!(cpu->idle = ap_idle_init(cpu))) {
+			printk("WARNING: %s(): unable to create the idle process of CPU %d.\n", __FUNCTION__, n);
+			break;
+		}
+		boot_ap(cpu);
+	}
+
+	kpage_dir[0] = 0;
+	invalidate_tlb();
+
+	n = 0;
+	FOR_EACH_CPU(cpu) {
+		n += cpu->online;
+	}
+	printk("apic      0x%08x        -\t%d/%d CPUs online, I/O APIC at 0x%08x\n", lapic_addr, n, nr_cpus, ioapic_addr);
+}
+#endif /* CONFIG_SMP */
+
+void cpu_data_init(void)
+{
+	struct cpu_data *cpu;
+
+	memset_b(cpu_data, 0, sizeof(cpu_data));
+	cpu = &cpu_data[0];
+	cpu->self = cpu;
+	cpu->online = 1;
+	cpu->gdt = gdt;
+#ifdef CONFIG_SMP
+	cpu->lock_depth = 1;
+#endif /* CONFIG_SMP */
+}
+
+/*
+ * Picks the CPU for a new child of the current process: the least loaded
+ * one, unless it shares the address space with its parent.
+ */
+struct cpu_data *select_cpu(struct proc *child)
+{
+#ifdef CONFIG_SMP
+	struct cpu_data *cpu, *selected;
+
+	selected = &cpu_data[current->cpu];
+	if(child->mm->count > 1 && !(child->flags & PF_KPROC)) {
+		return selected;
+	}
+	FOR_EACH_CPU(cpu) {
+		if(cpu->online && cpu->nr_running < selected->nr_running) {
+			selected = cpu;
+		}
+	}
+	return selected;
+#else
+	return &cpu_data[0];
+#endif /* CONFIG_SMP */
+}
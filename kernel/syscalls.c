@@ -31,7 +31,7 @@ static int verify_address(int type, const void *addr, unsigned int size)
 	 * calls sys_open() and sys_execve() from init_trampoline(),
 	 * but these calls are trusted.
 	 */
-	if(!current->vma_table) {
+	if(!current->mm->vma_table) {
 		return 0;
 	}
 
@@ -43,7 +43,7 @@ static int verify_address(int type, const void *addr, unsigned int size)
 		 * and let 'do_page_fault()' to handle the imminent page
 		 * fault as soon as the kernel will try to access it.
 		 */
-		vma = current->vma_table->prev;
+		vma = current->mm->vma_table->prev;
 		if(vma) {
 			if(vma->s_type == P_STACK) {
 				if(start < vma->start && start > vma->prev->end) {
@@ -316,7 +316,7 @@ void *syscall_table[] = {
 #endif /* CONFIG_SYSVIPC */
 	sys_fsync,
 	sys_sigreturn,
-	NULL,	/* sys_clone */		/* 120 */
+	sys_clone,			/* 120 */
 	sys_setdomainname,
 	sys_newuname,
 	NULL,	/* sys_modify_ldt */
@@ -383,10 +383,10 @@ void *syscall_table[] = {
 	NULL,
 	NULL,				/* 185 */
 	NULL,
+	sys_sendfile,
 	NULL,
 	NULL,
-	NULL,
-	sys_fork,			/* 190 (sys_vfork) */
+	sys_vfork,			/* 190 */
 	NULL,
 #ifdef CONFIG_MMAP2
 	sys_mmap2,
@@ -424,7 +424,7 @@ void *syscall_table[] = {
 	sys_fcntl64,
 	NULL,
 	NULL,
-	NULL,
+	sys_gettid,
 	NULL,				/* 225 */
 	NULL,
 	NULL,
@@ -439,39 +439,93 @@ void *syscall_table[] = {
 	NULL,
 	NULL,
 	NULL,
+	sys_sendfile64,
+	sys_futex,			/* 240 */
 	NULL,
-	NULL,				/* 240 */
 	NULL,
+	sys_set_thread_area,
+	sys_get_thread_area,
+	NULL,				/* 245 */
 	NULL,
 	NULL,
 	NULL,
-	NULL,				/* 245 */
 	NULL,
+	NULL,				/* 250 */
 	NULL,
+	sys_exit_group,
 	NULL,
 	NULL,
-	NULL,				/* 250 */
+	NULL,				/* 255 */
 	NULL,
 	NULL,
+	sys_set_tid_address,
+	sys_timer_create,
+	sys_timer_settime,		/* 260 */
+	sys_timer_gettime,
+	sys_timer_getoverrun,
+	sys_timer_delete,
+	sys_clock_settime,
+	sys_clock_gettime,		/* 265 */
+	sys_clock_getres,
+	sys_clock_nanosleep,
 	NULL,
 	NULL,
-	NULL,				/* 255 */
+	NULL,				/* 270 */
+	sys_utimes,
 	NULL,
 	NULL,
 	NULL,
+	NULL,				/* 275 */
 	NULL,
-	NULL,				/* 260 */
+#ifdef CONFIG_POSIX_MQUEUE
+	sys_mq_open,
+	sys_mq_unlink,
+	sys_mq_timedsend,
+	sys_mq_timedreceive,		/* 280 */
+	NULL,	/* sys_mq_notify */
+	sys_mq_getsetattr,
+#else
+	NULL,	/* sys_mq_open */
+	NULL,	/* sys_mq_unlink */
+	NULL,	/* sys_mq_timedsend */
+	NULL,	/* sys_mq_timedreceive */	/* 280 */
+	NULL,	/* sys_mq_notify */
+	NULL,	/* sys_mq_getsetattr */
+#endif /* CONFIG_POSIX_MQUEUE */
 	NULL,
 	NULL,
+	NULL,				/* 285 */
 	NULL,
 	NULL,
-	NULL,				/* 265 */
 	NULL,
 	NULL,
+	NULL,				/* 290 */
 	NULL,
 	NULL,
-	NULL,				/* 270 */
-	sys_utimes,
+	NULL,
+	NULL,
+	NULL,				/* 295 */
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,				/* 300 */
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,				/* 305 */
+	NULL,
+	NULL,
+	NULL,
+	NULL,
+	NULL,				/* 310 */
+	NULL,
+	NULL,
+	sys_splice,
+	NULL,
+	sys_tee,			/* 315 */
+	sys_vmsplice,
 };
 
 static void do_bad_syscall(unsigned int num)
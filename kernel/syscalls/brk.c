@@ -22,36 +22,36 @@ int sys_brk(unsigned int brk)
 	printk("(pid %d) sys_brk(0x%08x) -> ", current->pid, brk);
 #endif /*__DEBUG__ */
 
-	if(!brk || brk < current->brk_lower) {
+	if(!brk || brk < current->mm->brk_lower) {
 #ifdef __DEBUG__
-		printk("0x%08x\n", current->brk);
+		printk("0x%08x\n", current->mm->brk);
 #endif /*__DEBUG__ */
-		return current->brk;
+		return current->mm->brk;
 	}
 
 	newbrk = PAGE_ALIGN(brk);
-	if(newbrk == current->brk || newbrk < current->brk_lower) {
+	if(newbrk == current->mm->brk || newbrk < current->mm->brk_lower) {
 #ifdef __DEBUG__
-		printk("0x%08x\n", current->brk);
+		printk("0x%08x\n", current->mm->brk);
 #endif /*__DEBUG__ */
 		return brk;
 	}
 
-	if(brk < current->brk) {
-		do_munmap(newbrk, current->brk - newbrk);
-		current->brk = brk;
+	if(brk < current->mm->brk) {
+		do_munmap(newbrk, current->mm->brk - newbrk);
+		current->mm->brk = brk;
 #ifdef __DEBUG__
-		printk("0x%08x\n", current->brk);
+		printk("0x%08x\n", current->mm->brk);
 #endif /*__DEBUG__ */
-		return current->brk;
+		return current->mm->brk;
 	}
 	if(!expand_heap(newbrk)) {
-		current->brk = brk;
+		current->mm->brk = brk;
 	} else {
 		return -ENOMEM;
 	}
 #ifdef __DEBUG__
-	printk("0x%08x\n", current->brk);
+	printk("0x%08x\n", current->mm->brk);
 #endif /*__DEBUG__ */
-	return current->brk;
+	return current->mm->brk;
 }
@@ -0,0 +1,37 @@
+/*
+ * fiwix/kernel/syscalls/clock_getres.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/time.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_clock_getres(__clockid_t clock, struct timespec *res)
+{
+	struct timespec ts;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_clock_getres(%d, 0x%08x)\n", current->pid, clock, (unsigned int)res);
+#endif /*__DEBUG__ */
+
+	if((errno = do_clock_getres(clock, &ts))) {
+		return errno;
+	}
+	if(res) {
+		if((errno = check_user_area(VERIFY_WRITE, res, sizeof(struct timespec)))) {
+			return errno;
+		}
+		*res = ts;
+	}
+	return 0;
+}
@@ -0,0 +1,30 @@
+/*
+ * fiwix/kernel/syscalls/clock_gettime.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/time.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_clock_gettime(__clockid_t clock, struct timespec *tp)
+{
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_clock_gettime(%d, 0x%08x)\n", current->pid, clock, (unsigned int)tp);
+#endif /*__DEBUG__ */
+
+	if((errno = check_user_area(VERIFY_WRITE, tp, sizeof(struct timespec)))) {
+		return errno;
+	}
+	return do_clock_gettime(clock, tp);
+}
@@ -0,0 +1,79 @@
+/*
+ * fiwix/kernel/syscalls/clock_nanosleep.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/time.h>
+#include <fiwix/timer.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_clock_nanosleep(__clockid_t clock, int flags, const struct timespec *req, struct timespec *rem)
+{
+	struct timespec ts, now;
+	unsigned int timeout, sflags;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_clock_nanosleep(%d, %d, 0x%08x, 0x%08x)\n", current->pid, clock, flags, (unsigned int)req, (unsigned int)rem);
+#endif /*__DEBUG__ */
+
+	switch(clock) {
+		case CLOCK_REALTIME:
+		case CLOCK_MONOTONIC:
+			break;
+		case CLOCK_PROCESS_CPUTIME_ID:
+		case CLOCK_THREAD_CPUTIME_ID:
+			return -EOPNOTSUPP;
+		default:
+			return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_READ, req, sizeof(struct timespec)))) {
+		return errno;
+	}
+	if(req->tv_sec < 0 || req->tv_nsec < 0 || req->tv_nsec >= 1000000000L) {
+		return -EINVAL;
+	}
+
+	ts = *req;
+	if(flags & TIMER_ABSTIME) {
+		do_clock_gettime(clock, &now);
+		ts_sub(&ts, &now);
+		if(ts.tv_sec < 0) {
+			return 0;
+		}
+	}
+	if(!(timeout = timeout_ticks(&ts))) {
+		return 0;
+	}
+
+	/* see the comment in sys_nanosleep() */
+	SAVE_FLAGS(sflags); CLI();
+	current->timeout = timeout;
+	if(sleep(&sys_clock_nanosleep, PROC_INTERRUPTIBLE)) {
+		timeout = current->timeout;
+		current->timeout = 0;
+		RESTORE_FLAGS(sflags);
+		if(rem && !(flags & TIMER_ABSTIME)) {
+			if((errno = check_user_area(VERIFY_WRITE, rem, sizeof(struct timespec)))) {
+				return errno;
+			}
+			timeout_ts(timeout, rem);
+		}
+		return -EINTR;
+	}
+	current->timeout = 0;
+	RESTORE_FLAGS(sflags);
+	return 0;
+}
@@ -0,0 +1,43 @@
+/*
+ * fiwix/kernel/syscalls/clock_settime.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/time.h>
+#include <fiwix/timer.h>
+#include <fiwix/process.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_clock_settime(__clockid_t clock, const struct timespec *tp)
+{
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_clock_settime(%d, 0x%08x)\n", current->pid, clock, (unsigned int)tp);
+#endif /*__DEBUG__ */
+
+	if(clock != CLOCK_REALTIME) {
+		return -EINVAL;
+	}
+	if(!IS_SUPERUSER) {
+		return -EPERM;
+	}
+	if((errno = check_user_area(VERIFY_READ, tp, sizeof(struct timespec)))) {
+		return errno;
+	}
+	if(tp->tv_sec < 0 || tp->tv_nsec < 0 || tp->tv_nsec >= 1000000000L) {
+		return -EINVAL;
+	}
+	CURRENT_TIME = tp->tv_sec;
+	set_system_time(CURRENT_TIME);
+	return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * fiwix/kernel/syscalls/clone.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/segments.h>
+#include <fiwix/sigcontext.h>
+#include <fiwix/process.h>
+#include <fiwix/syscalls.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_clone(unsigned int flags, unsigned int newsp, int *parent_tid, struct user_desc *tls, int *child_tid, int arg6, struct sigcontext *sc)
+#else
+int sys_clone(unsigned int flags, unsigned int newsp, int *parent_tid, struct user_desc *tls, int *child_tid, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_clone(0x%08x, 0x%08x, 0x%08x, 0x%08x, 0x%08x)\n", current->pid, flags, newsp, (unsigned int)parent_tid, (unsigned int)tls, (unsigned int)child_tid);
+#endif /*__DEBUG__ */
+
+	return do_fork(flags, newsp, parent_tid, tls, child_tid, sc);
+}
@@ -28,15 +28,15 @@ int sys_dup2(unsigned int old_ufd, unsigned int new_ufd)
 	if(old_ufd == new_ufd) {
 		return new_ufd;
 	}
-	if(current->fd[new_ufd]) {
+	if(current->files->fd[new_ufd]) {
 		sys_close(new_ufd);
 	}
 	if((errno = get_new_user_fd(new_ufd)) < 0) {
 		return errno;
 	}
 	new_ufd = errno;
-	current->fd[new_ufd] = current->fd[old_ufd];
-	fd_table[current->fd[new_ufd]].count++;
+	current->files->fd[new_ufd] = current->files->fd[old_ufd];
+	fd_table[current->files->fd[new_ufd]].count++;
 #ifdef __DEBUG__
 	printk(" --> returning %d\n", new_ufd);
 #endif /*__DEBUG__ */
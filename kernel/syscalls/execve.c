@@ -11,6 +11,7 @@
 #include <fiwix/mm.h>
 #include <fiwix/process.h>
 #include <fiwix/fcntl.h>
+#include <fiwix/ptimer.h>
 #include <fiwix/errno.h>
 #include <fiwix/string.h>
 
@@ -18,13 +19,16 @@
 #include <fiwix/stdio.h>
 #endif /*__DEBUG__ */
 
+/*
+ * The arguments and the environment can take up to a quarter of the stack
+ * size limit, as in Linux, but never less than ARG_MAX pages nor more than
+ * the pages that fit in the page[] array of a single page.
+ */
 static int initialize_barg(struct binargs *barg, char *argv[], char *envp[])
 {
 	int n, errno;
+	unsigned int limit;
 
-	for(n = 0; n < ARG_MAX; n++) {
-		barg->page[n] = 0;
-	}
 	barg->argv_len = barg->envp_len = 0;
 
 	for(n = 0; argv[n]; n++) {
@@ -43,6 +47,12 @@ static int initialize_barg(struct binargs *barg, char *argv[], char *envp[])
 	}
 	barg->envc = n;
 
+	limit = current->rlim[RLIMIT_STACK].rlim_cur / 4 / PAGE_SIZE;
+	barg->pages = MIN(MAX(limit, ARG_MAX), PAGE_SIZE / sizeof(unsigned int));
+	if(!(barg->page = (unsigned int *)kmalloc(barg->pages * sizeof(unsigned int)))) {
+		return -ENOMEM;
+	}
+	memset_l(barg->page, 0, barg->pages);
 	return 0;
 }
 
@@ -50,16 +60,77 @@ static void free_barg_pages(struct binargs *barg)
 {
 	int n;
 
-	for(n = 0; n < ARG_MAX; n++) {
+	for(n = 0; n < barg->pages; n++) {
 		if(barg->page[n]) {
 			kfree(barg->page[n]);
 		}
 	}
+	kfree((unsigned int)barg->page);
+}
+
+/*
+ * Places the strings so that they end right below the last 4 bytes of the
+ * stack, and returns in 'p' and 'offset' where the first one begins.
+ */
+static int alloc_barg_pages(struct binargs *barg, int *p, int *offset)
+{
+	unsigned int ae_ptr_len, ae_str_len;
+	int n;
+
+	ae_ptr_len = (1 + (barg->argc + 1) + (barg->envc + 1)) * sizeof(unsigned int);
+	/* the last 4 bytes of the stack pages are not used */
+	ae_str_len = barg->argv_len + barg->envp_len + 4;
+	if(ae_ptr_len + ae_str_len > barg->pages * PAGE_SIZE) {
+		return -E2BIG;
+	}
+	*p = barg->pages - 1;
+	*p -= ae_str_len / PAGE_SIZE;
+	*offset = PAGE_SIZE - (ae_str_len & (PAGE_SIZE - 1));	/* mod PAGE_SIZE */
+	if(*offset == PAGE_SIZE) {
+		*offset = 0;
+		(*p)++;
+	}
+	barg->offset = *offset;
+	for(n = *p; n < barg->pages; n++) {
+		if(!barg->page[n]) {
+			if(!(barg->page[n] = kmalloc(PAGE_SIZE))) {
+				return -ENOMEM;
+			}
+		}
+	}
+
+	/* this page is mapped as is, so nothing must leak from below */
+	memset_b((void *)barg->page[*p], 0, *offset);
+	return 0;
+}
+
+/* copies the string 'str' with its terminating NULL at 'p' and 'offset' */
+static int put_string(struct binargs *barg, int *p, int *offset, const char *str)
+{
+	int len, bytes;
+
+	len = strlen(str) + 1;
+	while(len) {
+		/* the string might have changed since it was measured */
+		if(*p >= barg->pages) {
+			return -EFAULT;
+		}
+		bytes = MIN(len, PAGE_SIZE - *offset);
+		memcpy_b((char *)barg->page[*p] + *offset, str, bytes);
+		str += bytes;
+		len -= bytes;
+		*offset += bytes;
+		if(*offset == PAGE_SIZE) {
+			(*p)++;
+			*offset = 0;
+		}
+	}
+	return 0;
 }
 
 static int add_strings(struct binargs *barg, char *filename, char *interpreter, char *args)
 {
-	int n, p, offset;
+	int p, offset, errno;
 	unsigned int ae_str_len;
 	char *page;
 
@@ -68,7 +139,7 @@ static int add_strings(struct binargs *barg, char *filename, char *interpreter,
 	 * 'filename' supplied in execve(), otherwise the interpreter won't be
 	 * able to find the script file.
 	 */
-	p = ARG_MAX - 1;
+	p = barg->pages - 1;
 	ae_str_len = barg->argv_len + barg->envp_len + 4;
 	p -= ae_str_len / PAGE_SIZE;
 	offset = PAGE_SIZE - (ae_str_len & (PAGE_SIZE - 1));	/* mod PAGE_SIZE */
@@ -89,7 +160,6 @@ static int add_strings(struct binargs *barg, char *filename, char *interpreter,
 	barg->argv_len--;
 
 
-	p = ARG_MAX - 1;
 	barg->argv_len += strlen(interpreter) + 1;
 	barg->argv_len += strlen(args) ? strlen(args) + 1 : 0;
 	barg->argv_len += strlen(filename) + 1;
@@ -97,143 +167,43 @@ static int add_strings(struct binargs *barg, char *filename, char *interpreter,
 	if(*args) {
 		barg->argc++;
 	}
-	ae_str_len = barg->argv_len + barg->envp_len + 4;
-	p -= ae_str_len / PAGE_SIZE;
-	offset = PAGE_SIZE - (ae_str_len & (PAGE_SIZE - 1));	/* mod PAGE_SIZE */
-	if(offset == PAGE_SIZE) {
-		offset = 0;
-		p++;
-	}
-	barg->offset = offset;
-	for(n = p; n < ARG_MAX; n++) {
-		if(!barg->page[n]) {
-			if(!(barg->page[n] = kmalloc(PAGE_SIZE))) {
-				free_barg_pages(barg);
-				return -ENOMEM;
-			}
-		}
+	if((errno = alloc_barg_pages(barg, &p, &offset))) {
+		return errno;
 	}
 
 	/* interpreter */
-	page = (char *)barg->page[p];
-	while(*interpreter) {
-		*(page + offset) = *interpreter;
-		offset++;
-		interpreter++;
-		if(offset == PAGE_SIZE) {
-			p++;
-			offset = 0;
-			page = (char *)barg->page[p];
-		}
-	}
-	*(page + offset++) = 0;
-	if(offset == PAGE_SIZE) {
-		p++;
-		offset = 0;
+	if((errno = put_string(barg, &p, &offset, interpreter))) {
+		return errno;
 	}
 
 	/* args */
-	page = (char *)barg->page[p];
 	if(*args) {
-		while(*args) {
-			*(page + offset) = *args;
-			offset++;
-			args++;
-			if(offset == PAGE_SIZE) {
-				p++;
-				offset = 0;
-				page = (char *)barg->page[p];
-			}
-		}
-		*(page + offset++) = 0;
-		if(offset == PAGE_SIZE) {
-			p++;
-			offset = 0;
+		if((errno = put_string(barg, &p, &offset, args))) {
+			return errno;
 		}
 	}
 
 	/* original script ('filename' with path) at argv[0] */
-	page = (char *)barg->page[p];
-	while(*filename) {
-		*(page + offset) = *filename;
-		offset++;
-		filename++;
-		if(offset == PAGE_SIZE) {
-			p++;
-			offset = 0;
-			page = (char *)barg->page[p];
-		}
-	}
-	*(page + offset) = 0;
-
-	return 0;
+	return put_string(barg, &p, &offset, filename);
 }
 
 static int copy_strings(struct binargs *barg, char *argv[], char *envp[])
 {
-	int n, p, offset;
-	unsigned int ae_ptr_len, ae_str_len;
-	char *page, *str;
+	int n, p, offset, errno;
 
-	p = ARG_MAX - 1;
-	ae_ptr_len = (1 + (barg->argc + 1) + (barg->envc + 1)) * sizeof(unsigned int);
-	/* the last 4 bytes of the stack pages are not used */
-	ae_str_len = barg->argv_len + barg->envp_len + 4;
-	if (ae_ptr_len + ae_str_len > (ARG_MAX * PAGE_SIZE)) {
-		return -E2BIG;
-	}
-	p -= ae_str_len / PAGE_SIZE;
-	offset = PAGE_SIZE - (ae_str_len & (PAGE_SIZE - 1));	/* mod PAGE_SIZE */
-	if(offset == PAGE_SIZE) {
-		offset = 0;
-		p++;
-	}
-	barg->offset = offset;
-	for(n = p; n < ARG_MAX; n++) {
-		if(!(barg->page[n] = kmalloc(PAGE_SIZE))) {
-			free_barg_pages(barg);
-			return -ENOMEM;
-		}
+	if((errno = alloc_barg_pages(barg, &p, &offset))) {
+		return errno;
 	}
 	for(n = 0; n < barg->argc; n++) {
-		str = argv[n];
-		page = (char *)barg->page[p];
-		while(*str) {
-			*(page + offset) = *str;
-			offset++;
-			str++;
-			if(offset == PAGE_SIZE) {
-				p++;
-				offset = 0;
-				page = (char *)barg->page[p];
-			}
-		}
-		*(page + offset++) = 0;
-		if(offset == PAGE_SIZE) {
-			p++;
-			offset = 0;
+		if((errno = put_string(barg, &p, &offset, argv[n]))) {
+			return errno;
 		}
 	}
 	for(n = 0; n < barg->envc; n++) {
-		str = envp[n];
-		page = (char *)barg->page[p];
-		while(*str) {
-			*(page + offset) = *str;
-			offset++;
-			str++;
-			if(offset == PAGE_SIZE) {
-				p++;
-				offset = 0;
-				page = (char *)barg->page[p];
-			}
-		}
-		*(page + offset++) = 0;
-		if(offset == PAGE_SIZE) {
-			p++;
-			offset = 0;
+		if((errno = put_string(barg, &p, &offset, envp[n]))) {
+			return errno;
 		}
 	}
-
 	return 0;
 }
 
@@ -253,10 +223,12 @@ static int do_execve(const char *filename, char *argv[], char *envp[], struct si
 
 	/* save 'argv' and 'envp' into the kernel address space */
 	if((errno = copy_strings(&barg, &(*argv), &(*envp)))) {
+		free_barg_pages(&barg);
 		return errno;
 	}
 
 	if(!(data = (void *)kmalloc(PAGE_SIZE))) {
+		free_barg_pages(&barg);
 		return -ENOMEM;
 	}
 
@@ -337,6 +309,41 @@ loop:
 	return errno;
 }
 
+/*
+ * The new program must not close the file descriptors or change the signal
+ * handlers of the processes it was sharing them with.
+ */
+static int unshare_files_sighand(void)
+{
+	struct files_struct *files;
+	struct sighand_struct *sighand;
+	int n;
+
+	if(current->files->count > 1) {
+		if(!(files = get_files())) {
+			return -ENOMEM;
+		}
+		memcpy_b(files->fd, current->files->fd, sizeof(files->fd));
+		memcpy_b(files->fd_flags, current->files->fd_flags, sizeof(files->fd_flags));
+		for(n = 0; n < OPEN_MAX; n++) {
+			if(files->fd[n]) {
+				fd_table[files->fd[n]].count++;
+			}
+		}
+		release_files(current);
+		current->files = files;
+	}
+	if(current->sighand->count > 1) {
+		if(!(sighand = get_sighand())) {
+			return -ENOMEM;
+		}
+		memcpy_b(sighand->sigaction, current->sighand->sigaction, sizeof(sighand->sigaction));
+		release_sighand(current);
+		current->sighand = sighand;
+	}
+	return 0;
+}
+
 #ifdef CONFIG_SYSCALL_6TH_ARG
 int sys_execve(const char *filename, char *argv[], char *envp[], int arg4, int arg5, int arg6, struct sigcontext *sc)
 #else
@@ -350,6 +357,9 @@ int sys_execve(const char *filename, char *argv[], char *envp[], int arg4, int a
 	printk("(pid %d) sys_execve('%s', ...)\n", current->pid, filename);
 #endif /*__DEBUG__ */
 
+	if((errno = unshare_files_sighand())) {
+		return errno;
+	}
 	if((errno = malloc_name(filename, &tmp_name)) < 0) {
 		return errno;
 	}
@@ -360,7 +370,7 @@ int sys_execve(const char *filename, char *argv[], char *envp[], int arg4, int a
 
 	strncpy(current->argv0, tmp_name, NAME_MAX);
 	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n] && (current->fd_flags[n] & FD_CLOEXEC)) {
+		if(current->files->fd[n] && (current->files->fd_flags[n] & FD_CLOEXEC)) {
 			sys_close(n);
 		}
 	}
@@ -370,14 +380,16 @@ int sys_execve(const char *filename, char *argv[], char *envp[], int arg4, int a
 	current->sigpending = 0;
 	current->sigexecuting = 0;
 	for(n = 0; n < NSIG; n++) {
-		current->sigaction[n].sa_mask = 0;
-		current->sigaction[n].sa_flags = 0;
-		if(current->sigaction[n].sa_handler != SIG_IGN) {
-			current->sigaction[n].sa_handler = SIG_DFL;
+		current->sighand->sigaction[n].sa_mask = 0;
+		current->sighand->sigaction[n].sa_flags = 0;
+		if(current->sighand->sigaction[n].sa_handler != SIG_IGN) {
+			current->sighand->sigaction[n].sa_handler = SIG_DFL;
 		}
 	}
 	current->sleep_address = NULL;
 	current->flags |= PF_PEXEC;
+	release_vfork(current);
+	release_ptimers(current->tgid);
 	free_name(tmp_name);
 	return 0;
 }
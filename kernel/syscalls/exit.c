@@ -16,6 +16,8 @@
 #include <fiwix/string.h>
 #include <fiwix/buffer.h>
 #include <fiwix/filesystems.h>
+#include <fiwix/futex.h>
+#include <fiwix/ptimer.h>
 #ifdef CONFIG_SYSVIPC
 #include <fiwix/sem.h>
 #endif /* CONFIG_SYSVIPC */
@@ -23,6 +25,7 @@
 void do_exit(int exit_code)
 {
 	int n;
+	int mm_users, files_users, sighand_users, threads;
 	struct proc *p, *init;
 
 #ifdef __DEBUG__
@@ -37,7 +40,33 @@ void do_exit(int exit_code)
 	}
 #endif /* CONFIG_SYSVIPC */
 
-	release_binary();
+	/* the resources shared with clone() go away with the last user */
+	mm_users = files_users = sighand_users = threads = 0;
+	FOR_EACH_PROCESS(p) {
+		if(p != current && p->state != PROC_ZOMBIE) {
+			mm_users += p->mm == current->mm;
+			files_users += p->files == current->files;
+			sighand_users += p->sighand == current->sighand;
+			threads += p->tgid == current->tgid;
+		}
+		p = p->next;
+	}
+
+	if(current->clear_child_tid) {
+		if(!check_user_area(VERIFY_WRITE, current->clear_child_tid, sizeof(int))) {
+			*current->clear_child_tid = 0;
+			futex_wake(current->clear_child_tid, 1, 0);
+		}
+		current->clear_child_tid = NULL;
+	}
+	release_vfork(current);
+	if(!threads) {
+		release_ptimers(current->tgid);
+	}
+
+	if(!mm_users) {
+		release_binary();
+	}
 	current->argv = NULL;
 	current->envp = NULL;
 
@@ -53,12 +82,18 @@ void do_exit(int exit_code)
 			}
 		}
 
-		/* make INIT inherit the children of this exiting process */
-		if(p->ppid == current) {
+		/*
+		 * Make INIT inherit the children of this exiting process.
+		 * The threads follow their group leader, which is the only
+		 * one accounted as a child.
+		 */
+		if(p->ppid == current && !TG_LEADER(p)) {
+			p->ppid = init;
+		} else if(p->ppid == current) {
 			p->ppid = init;
 			init->children++;
 			current->children--;
-			if(p->state == PROC_ZOMBIE) {
+			if(p->state == PROC_ZOMBIE && !has_live_threads(p)) {
 				send_sig(init, SIGCHLD);
 				if(init->sleep_address == &sys_wait4) {
 					wakeup_proc(init);
@@ -72,9 +107,11 @@ void do_exit(int exit_code)
 		disassociate_ctty(current->ctty);
 	}
 
-	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n]) {
-			sys_close(n);
+	if(!files_users) {
+		for(n = 0; n < OPEN_MAX; n++) {
+			if(current->files->fd[n]) {
+				sys_close(n);
+			}
 		}
 	}
 
@@ -92,20 +129,27 @@ void do_exit(int exit_code)
 		stop_kernel();
 	}
 
-	/* notify the parent about the child's death */
-	p = current->ppid;
-	send_sig(p, SIGCHLD);
-	if(p->sleep_address == &sys_wait4) {
-		wakeup_proc(p);
+	/*
+	 * Notify the parent about the child's death. A thread group is
+	 * reported only once, when its last thread has exited.
+	 */
+	if(!threads) {
+		p = current->ppid;
+		send_sig(p, SIGCHLD);
+		if(p->sleep_address == &sys_wait4) {
+			wakeup_proc(p);
+		}
 	}
 
 	current->sigpending = 0;
 	current->sigblocked = 0;
 	current->sigexecuting = 0;
-	for(n = 0; n < NSIG; n++) {
-		current->sigaction[n].sa_mask = 0;
-		current->sigaction[n].sa_flags = 0;
-		current->sigaction[n].sa_handler = SIG_IGN;
+	if(!sighand_users) {
+		for(n = 0; n < NSIG; n++) {
+			current->sighand->sigaction[n].sa_mask = 0;
+			current->sighand->sigaction[n].sa_flags = 0;
+			current->sighand->sigaction[n].sa_handler = SIG_IGN;
+		}
 	}
 
 	not_runnable(current, PROC_ZOMBIE);
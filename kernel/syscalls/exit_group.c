@@ -0,0 +1,42 @@
+/*
+ * fiwix/kernel/syscalls/exit_group.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/syscalls.h>
+#include <fiwix/process.h>
+#include <fiwix/sched.h>
+#include <fiwix/signal.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_exit_group(int exit_code)
+{
+	struct proc *p;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_exit_group(%d)\n", current->pid, exit_code);
+#endif /*__DEBUG__ */
+
+	/*
+	 * The rest of the threads will exit on their way back to user mode,
+	 * all of them with the same exit code. It's also given to a leader
+	 * that has already exited, since it's the one that wait4() reports.
+	 */
+	exit_code = (exit_code & 0xFF) << 8;
+	FOR_EACH_PROCESS(p) {
+		if(p != current && p->tgid == current->tgid) {
+			p->exit_code = exit_code;
+			p->flags |= PF_GROUPEXIT;
+			send_sig(p, SIGKILL);
+		}
+		p = p->next;
+	}
+	do_exit(exit_code);
+	return 0;
+}
@@ -23,7 +23,7 @@ int sys_fchdir(unsigned int ufd)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(ufd);
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	if(!S_ISDIR(i->i_mode)) {
 		return -ENOTDIR;
 	}
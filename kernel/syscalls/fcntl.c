@@ -8,6 +8,7 @@
 #include <fiwix/syscalls.h>
 #include <fiwix/fcntl.h>
 #include <fiwix/locks.h>
+#include <fiwix/filesystems.h>
 #include <fiwix/errno.h>
 
 #ifdef __DEBUG__
@@ -33,25 +34,25 @@ int sys_fcntl(unsigned int ufd, int cmd, unsigned int arg)
 			if((new_ufd = get_new_user_fd(arg)) < 0) {
 				return new_ufd;
 			}
-			current->fd[new_ufd] = current->fd[ufd];
+			current->files->fd[new_ufd] = current->files->fd[ufd];
 			if (cmd == F_DUPFD_CLOEXEC) {
-				current->fd_flags[new_ufd] |= FD_CLOEXEC;
+				current->files->fd_flags[new_ufd] |= FD_CLOEXEC;
 			}
-			fd_table[current->fd[new_ufd]].count++;
+			fd_table[current->files->fd[new_ufd]].count++;
 #ifdef __DEBUG__
 			printk("\t--> returning %d\n", new_ufd);
 #endif /*__DEBUG__ */
 			return new_ufd;
 		case F_GETFD:
-			return (current->fd_flags[ufd] & FD_CLOEXEC);
+			return (current->files->fd_flags[ufd] & FD_CLOEXEC);
 		case F_SETFD:
-			current->fd_flags[ufd] = (arg & FD_CLOEXEC);
+			current->files->fd_flags[ufd] = (arg & FD_CLOEXEC);
 			break;
 		case F_GETFL:
-			return fd_table[current->fd[ufd]].flags;
+			return fd_table[current->files->fd[ufd]].flags;
 		case F_SETFL:
-			fd_table[current->fd[ufd]].flags &= ~(O_APPEND | O_NONBLOCK);
-			fd_table[current->fd[ufd]].flags |= arg & (O_APPEND | O_NONBLOCK);
+			fd_table[current->files->fd[ufd]].flags &= ~(O_APPEND | O_NONBLOCK);
+			fd_table[current->files->fd[ufd]].flags |= arg & (O_APPEND | O_NONBLOCK);
 			break;
 		case F_GETLK:
 		case F_SETLK:
@@ -60,6 +61,9 @@ int sys_fcntl(unsigned int ufd, int cmd, unsigned int arg)
 				return errno;
 			}
 			return posix_lock(ufd, cmd, (struct flock *)arg);
+		case F_SETPIPE_SZ:
+		case F_GETPIPE_SZ:
+			return pipefs_fcntl(fd_table[current->files->fd[ufd]].inode, cmd, arg);
 		default:
 			return -EINVAL;
 	}
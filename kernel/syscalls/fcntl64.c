@@ -9,6 +9,7 @@
 #include <fiwix/syscalls.h>
 #include <fiwix/fcntl.h>
 #include <fiwix/locks.h>
+#include <fiwix/filesystems.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/process.h>
@@ -31,31 +32,34 @@ int sys_fcntl64(unsigned int ufd, int cmd, unsigned int arg)
 			if((new_ufd = get_new_user_fd(arg)) < 0) {
 				return new_ufd;
 			}
-			current->fd[new_ufd] = current->fd[ufd];
+			current->files->fd[new_ufd] = current->files->fd[ufd];
 			if (cmd == F_DUPFD_CLOEXEC) {
-				current->fd_flags[new_ufd] |= FD_CLOEXEC;
+				current->files->fd_flags[new_ufd] |= FD_CLOEXEC;
 			}
-			fd_table[current->fd[new_ufd]].count++;
+			fd_table[current->files->fd[new_ufd]].count++;
 #ifdef __DEBUG__
 			printk("\t--> returning %d\n", new_ufd);
 #endif /*__DEBUG__ */
 			return new_ufd;
 		case F_GETFD:
-			return (current->fd_flags[ufd] & FD_CLOEXEC);
+			return (current->files->fd_flags[ufd] & FD_CLOEXEC);
 		case F_SETFD:
-			current->fd_flags[ufd] = (arg & FD_CLOEXEC);
+			current->files->fd_flags[ufd] = (arg & FD_CLOEXEC);
 			break;
 		case F_GETFL:
-			return fd_table[current->fd[ufd]].flags;
+			return fd_table[current->files->fd[ufd]].flags;
 		case F_SETFL:
-			fd_table[current->fd[ufd]].flags &= ~(O_APPEND | O_NONBLOCK);
-			fd_table[current->fd[ufd]].flags |= arg & (O_APPEND | O_NONBLOCK);
+			fd_table[current->files->fd[ufd]].flags &= ~(O_APPEND | O_NONBLOCK);
+			fd_table[current->files->fd[ufd]].flags |= arg & (O_APPEND | O_NONBLOCK);
 			break;
 		case F_GETLK64:
 		case F_SETLK64:
 		case F_SETLKW64:
 			printk("(pid %d) sys_fcntl64: WARNING: locks not implemented!\n", current->pid);
 			return 0;
+		case F_SETPIPE_SZ:
+		case F_GETPIPE_SZ:
+			return pipefs_fcntl(fd_table[current->files->fd[ufd]].inode, cmd, arg);
 		default:
 			return -EINVAL;
 	}
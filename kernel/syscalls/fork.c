@@ -18,35 +18,152 @@
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
-static void free_vma_table(struct proc *p)
+static void free_vma_table(struct mm_struct *mm)
 {
 	struct vma *vma, *tmp;
 
-	vma = p->vma_table;
+	vma = mm->vma_table;
 	while(vma) {
 		tmp = vma;
 		vma = vma->next;
+		if(tmp->inode) {
+			iput(tmp->inode);
+		}
 		kfree((unsigned int)tmp);
 	}
+	mm->vma_table = NULL;
 }
 
-#ifdef CONFIG_SYSCALL_6TH_ARG
-int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
-#else
-int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext *sc)
-#endif /* CONFIG_SYSCALL_6TH_ARG */
+static int copy_vma_table(struct mm_struct *dst, struct mm_struct *src)
+{
+	struct vma *vma, *child_vma;
+
+	vma = src->vma_table;
+	dst->vma_table = NULL;
+	while(vma) {
+		if(!(child_vma = (struct vma *)kmalloc(sizeof(struct vma)))) {
+			free_vma_table(dst);
+			return -ENOMEM;
+		}
+		*child_vma = *vma;
+		child_vma->prev = child_vma->next = NULL;
+		if(child_vma->inode) {
+			child_vma->inode->count++;
+		}
+		if(!dst->vma_table) {
+			dst->vma_table = child_vma;
+		} else {
+			child_vma->prev = dst->vma_table->prev;
+			dst->vma_table->prev->next = child_vma;
+		}
+		dst->vma_table->prev = child_vma;
+		vma = vma->next;
+	}
+	dst->brk_lower = src->brk_lower;
+	dst->brk = src->brk;
+	return 0;
+}
+
+/* gives 'child' its own copy-on-write copy of the address space */
+static int copy_mm(struct proc *child)
 {
-	int count, pages;
-	unsigned int n;
 	unsigned int *child_pgdir;
+	int pages;
+
+	if(!(child->mm = get_mm())) {
+		return -ENOMEM;
+	}
+	if(!(child_pgdir = (void *)kmalloc(PAGE_SIZE))) {
+		kfree((unsigned int)child->mm);
+		child->mm = NULL;
+		return -ENOMEM;
+	}
+	child->rss++;
+	memcpy_b(child_pgdir, kpage_dir, PAGE_SIZE);
+	child->tss.cr3 = V2P((unsigned int)child_pgdir);
+
+	if(copy_vma_table(child->mm, current->mm)) {
+		release_mm(child);
+		return -ENOMEM;
+	}
+	if(!(pages = clone_pages(child))) {
+		printk("WARNING: %s(): not enough memory when cloning pages.\n", __FUNCTION__);
+		free_page_tables(child);
+		free_vma_table(child->mm);
+		release_mm(child);
+		return -ENOMEM;
+	}
+	child->rss += pages;
+	invalidate_tlb();
+	return 0;
+}
+
+static int copy_files(struct proc *child)
+{
+	if(!(child->files = get_files())) {
+		return -ENOMEM;
+	}
+	memcpy_b(child->files->fd, current->files->fd, sizeof(child->files->fd));
+	memcpy_b(child->files->fd_flags, current->files->fd_flags, sizeof(child->files->fd_flags));
+	return 0;
+}
+
+static int copy_sighand(struct proc *child)
+{
+	if(!(child->sighand = get_sighand())) {
+		return -ENOMEM;
+	}
+	memcpy_b(child->sighand->sigaction, current->sighand->sigaction, sizeof(child->sighand->sigaction));
+	return 0;
+}
+
+/*
+ * Creates a new process as a copy of the current one. The 'flags' select
+ * which resources are shared with the caller instead of being copied, so
+ * fork() is just a clone() which shares nothing.
+ */
+int do_fork(unsigned int flags, unsigned int newsp, int *parent_tid, struct user_desc *tls, int *child_tid, struct sigcontext *sc)
+{
+	int count, errno;
+	unsigned int n, sflags;
 	struct sigcontext *stack;
-	struct proc *child, *p;
-	struct vma *vma, *child_vma;
+	struct proc *child, *p, *parent;
 	__pid_t pid;
 
-#ifdef __DEBUG__
-	printk("(pid %d) sys_fork()\n", current->pid);
-#endif /*__DEBUG__ */
+	if((flags & CLONE_SIGHAND) && !(flags & CLONE_VM)) {
+		return -EINVAL;
+	}
+	if((flags & CLONE_THREAD) && !(flags & CLONE_SIGHAND)) {
+		return -EINVAL;
+	}
+	if(flags & CLONE_PARENT_SETTID) {
+		if((errno = check_user_area(VERIFY_WRITE, parent_tid, sizeof(int)))) {
+			return errno;
+		}
+	}
+	if(flags & (CLONE_CHILD_SETTID | CLONE_CHILD_CLEARTID)) {
+		if((errno = check_user_area(VERIFY_WRITE, child_tid, sizeof(int)))) {
+			return errno;
+		}
+	}
+	if(flags & CLONE_SETTLS) {
+		if((errno = check_user_area(VERIFY_READ, tls, sizeof(struct user_desc)))) {
+			return errno;
+		}
+		n = tls->entry_number;
+		if(n < TLS_ENTRY_MIN || n >= TLS_ENTRY_MIN + NR_TLS_ENTRIES) {
+			return -EINVAL;
+		}
+	}
+
+	/* the threads that have already exited don't need their slots */
+	if(flags & CLONE_THREAD) {
+		if(TG_LEADER(current)) {
+			reap_threads(current);
+		} else if((p = get_proc_by_pid(current->tgid))) {
+			reap_threads(p);
+		}
+	}
 
 	/* check the number of processes already allocated by this UID */
 	count = 0;
@@ -78,45 +195,51 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	child->pid = pid;
 	sprintk(child->pidstr, "%d", child->pid);
 
-	if(!(child_pgdir = (void *)kmalloc(PAGE_SIZE))) {
+	child->mm = NULL;
+	child->files = NULL;
+	child->sighand = NULL;
+	errno = -ENOMEM;
+	if(!(child->tss.esp0 = kmalloc(PAGE_SIZE))) {
 		release_proc(child);
 		return -ENOMEM;
 	}
-	child->rss++;
-	memcpy_b(child_pgdir, kpage_dir, PAGE_SIZE);
-	child->tss.cr3 = V2P((unsigned int)child_pgdir);
+	if(flags & CLONE_FILES) {
+		child->files = current->files;
+		child->files->count++;
+	} else if(copy_files(child)) {
+		goto fail;
+	}
+	if(flags & CLONE_SIGHAND) {
+		child->sighand = current->sighand;
+		child->sighand->count++;
+	} else if(copy_sighand(child)) {
+		goto fail;
+	}
+	/* this goes last since it's the only one that can't be undone easily */
+	if(flags & CLONE_VM) {
+		child->mm = current->mm;
+		child->mm->count++;
+	} else if(copy_mm(child)) {
+		goto fail;
+	}
 
-	child->ppid = current;
+	if(flags & CLONE_THREAD) {
+		child->tgid = current->tgid;
+		parent = current->ppid;
+	} else {
+		child->tgid = pid;
+		parent = (flags & CLONE_PARENT) ? current->ppid : current;
+	}
+	child->ppid = parent;
 	child->flags = 0;
+	if(flags & CLONE_VFORK) {
+		child->flags |= PF_VFORK;
+	}
 	child->children = 0;
 	child->cpu_count = (current->cpu_count >>= 1);
 	child->start_time = CURRENT_TICKS;
 	child->sleep_address = NULL;
 
-	vma = current->vma_table;
-	child->vma_table = NULL;
-	while(vma) {
-		if(!(child_vma = (struct vma *)kmalloc(sizeof(struct vma)))) {
-			kfree((unsigned int)child_pgdir);
-			free_vma_table(child);
-			release_proc(child);
-			return -ENOMEM;
-		}
-		*child_vma = *vma;
-		child_vma->prev = child_vma->next = NULL;
-		if(child_vma->inode) {
-			child_vma->inode->count++;
-		}
-		if(!child->vma_table) {
-			child->vma_table = child_vma;
-		} else {
-			child_vma->prev = child->vma_table->prev;
-			child->vma_table->prev->next = child_vma;
-		}
-		child->vma_table->prev = child_vma;
-		vma = vma->next;
-	}
-
 	child->sigpending = 0;
 	child->sigexecuting = 0;
 	memset_b(&child->sc, 0, sizeof(struct sigcontext));
@@ -128,28 +251,21 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	child->it_virt_value = 0;
 	child->it_prof_interval = 0;
 	child->it_prof_value = 0;
+	child->set_child_tid = NULL;
+	child->clear_child_tid = NULL;
 #ifdef CONFIG_SYSVIPC
-	current->semundo = NULL;
+	child->semundo = NULL;
 #endif /* CONFIG_SYSVIPC */
 
-
-	if(!(child->tss.esp0 = kmalloc(PAGE_SIZE))) {
-		kfree((unsigned int)child_pgdir);
-		free_vma_table(child);
-		release_proc(child);
-		return -ENOMEM;
+	if(flags & CLONE_SETTLS) {
+		set_tls_desc(&child->tls[tls->entry_number - TLS_ENTRY_MIN], tls);
 	}
-
-	if(!(pages = clone_pages(child))) {
-		printk("WARNING: %s(): not enough memory when cloning pages.\n", __FUNCTION__);
-		free_page_tables(child);
-		kfree((unsigned int)child_pgdir);
-		free_vma_table(child);
-		release_proc(child);
-		return -ENOMEM;
+	if(flags & CLONE_CHILD_SETTID) {
+		child->set_child_tid = child_tid;
+	}
+	if(flags & CLONE_CHILD_CLEARTID) {
+		child->clear_child_tid = child_tid;
 	}
-	child->rss += pages;
-	invalidate_tlb();
 
 	child->tss.esp0 += PAGE_SIZE - 4;
 	child->rss++;
@@ -158,14 +274,19 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 	memcpy_b((unsigned int *)(child->tss.esp0 & PAGE_MASK), (void *)((unsigned int)(sc) & PAGE_MASK), PAGE_SIZE);
 	stack = (struct sigcontext *)((child->tss.esp0 & PAGE_MASK) + ((unsigned int)(sc) & ~PAGE_MASK));
 
-	child->tss.eip = (unsigned int)return_from_syscall;
+	child->tss.eip = (unsigned int)(child->set_child_tid ? ret_from_fork : return_from_syscall);
 	child->tss.esp = (unsigned int)stack;
 	stack->eax = 0;		/* child returns 0 */
+	if(newsp) {
+		stack->oldesp = newsp;
+	}
 
 	/* increase file descriptors usage */
-	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n]) {
-			fd_table[current->fd[n]].count++;
+	if(!(flags & CLONE_FILES)) {
+		for(n = 0; n < OPEN_MAX; n++) {
+			if(child->files->fd[n]) {
+				fd_table[child->files->fd[n]].count++;
+			}
 		}
 	}
 	if(current->root) {
@@ -175,10 +296,52 @@ int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext
 		current->pwd->count++;
 	}
 
+	if(flags & CLONE_PARENT_SETTID) {
+		*parent_tid = child->pid;
+	}
+
 	kstat.processes++;
 	nr_processes++;
-	current->children++;
+	if(!(flags & CLONE_THREAD) && parent) {
+		parent->children++;
+	}
+	child->cpu = select_cpu(child)->id;
 	runnable(child);
 
-	return child->pid;	/* parent returns child's PID */
+	/*
+	 * The child runs on the parent's address space (and stack), so the
+	 * parent can't return to user mode until the child has called
+	 * execve() or exit(). The PID is checked in case the slot has been
+	 * reused in the meantime.
+	 */
+	if(flags & CLONE_VFORK) {
+		SAVE_FLAGS(sflags); CLI();
+		while(child->pid == pid && (child->flags & PF_VFORK)) {
+			sleep(child, PROC_UNINTERRUPTIBLE);
+		}
+		RESTORE_FLAGS(sflags);
+	}
+
+	return pid;	/* parent returns child's PID */
+
+fail:
+	release_sighand(child);
+	release_files(child);
+	release_mm(child);
+	kfree(child->tss.esp0);
+	release_proc(child);
+	return errno;
+}
+
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
+#else
+int sys_fork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_fork()\n", current->pid);
+#endif /*__DEBUG__ */
+
+	return do_fork(SIGCHLD, 0, NULL, NULL, NULL, sc);
 }
@@ -0,0 +1,89 @@
+/*
+ * fiwix/kernel/syscalls/futex.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/futex.h>
+#include <fiwix/time.h>
+#include <fiwix/timer.h>
+#include <fiwix/process.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+/*
+ * The 'val3' argument is the 6th one, so without CONFIG_SYSCALL_6TH_ARG it
+ * is taken directly from the EBP register of the caller.
+ */
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_futex(int *uaddr, int op, int val, const struct timespec *timeout, int *uaddr2, int val3)
+#else
+int sys_futex(int *uaddr, int op, int val, const struct timespec *timeout, int *uaddr2, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+	unsigned int ticks;
+	int private, errno;
+#ifndef CONFIG_SYSCALL_6TH_ARG
+	int val3;
+
+	val3 = sc->ebp;
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_futex(0x%08x, %d, %d, 0x%08x, 0x%08x, %d)\n", current->pid, (unsigned int)uaddr, op, val, (unsigned int)timeout, (unsigned int)uaddr2, val3);
+#endif /*__DEBUG__ */
+
+	if((unsigned int)uaddr & (sizeof(int) - 1)) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_READ, uaddr, sizeof(int)))) {
+		return errno;
+	}
+	private = op & FUTEX_PRIVATE_FLAG;
+
+	switch(op & FUTEX_CMD_MASK) {
+		case FUTEX_WAIT:
+			ticks = 0;
+			if(timeout) {
+				if((errno = check_user_area(VERIFY_READ, timeout, sizeof(struct timespec)))) {
+					return errno;
+				}
+				if(timeout->tv_sec < 0 || timeout->tv_nsec < 0 || timeout->tv_nsec >= 1000000000L) {
+					return -EINVAL;
+				}
+				ticks = (timeout->tv_sec * HZ) + (timeout->tv_nsec / (1000000000L / HZ));
+				if(!ticks) {
+					ticks = 1;
+				}
+			}
+			return futex_wait(uaddr, val, ticks, private);
+		case FUTEX_WAKE:
+			return futex_wake(uaddr, val, private);
+		case FUTEX_REQUEUE:
+		case FUTEX_CMP_REQUEUE:
+			if((unsigned int)uaddr2 & (sizeof(int) - 1)) {
+				return -EINVAL;
+			}
+			if((errno = check_user_area(VERIFY_READ, uaddr2, sizeof(int)))) {
+				return errno;
+			}
+			/* the number of waiters to requeue is passed in 'timeout' */
+			return futex_requeue(uaddr, uaddr2, val, (int)timeout, (op & FUTEX_CMD_MASK) == FUTEX_CMP_REQUEUE, val3, private);
+		case FUTEX_WAKE_OP:
+			if((unsigned int)uaddr2 & (sizeof(int) - 1)) {
+				return -EINVAL;
+			}
+			if((errno = check_user_area(VERIFY_WRITE, uaddr2, sizeof(int)))) {
+				return errno;
+			}
+			return futex_wake_op(uaddr, uaddr2, val, (int)timeout, val3, private);
+	}
+	return -ENOSYS;
+}
@@ -0,0 +1,59 @@
+/*
+ * fiwix/kernel/syscalls/get_thread_area.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/segments.h>
+#include <fiwix/process.h>
+#include <fiwix/fs.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_get_thread_area(struct user_desc *u_info)
+{
+	struct seg_desc *sd;
+	unsigned int n;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_get_thread_area(0x%08x)\n", current->pid, (unsigned int)u_info);
+#endif /*__DEBUG__ */
+
+	if((errno = check_user_area(VERIFY_WRITE, u_info, sizeof(struct user_desc)))) {
+		return errno;
+	}
+	n = u_info->entry_number;
+	if(n < TLS_ENTRY_MIN || n >= TLS_ENTRY_MIN + NR_TLS_ENTRIES) {
+		return -EINVAL;
+	}
+
+	sd = &current->tls[n - TLS_ENTRY_MIN];
+	memset_b(u_info, 0, sizeof(struct user_desc));
+	u_info->entry_number = n;
+	if(!sd->sd_loflags) {
+		/* an empty entry */
+		u_info->read_exec_only = 1;
+		u_info->seg_not_present = 1;
+		return 0;
+	}
+	u_info->base_addr = sd->sd_lobase | (sd->sd_hibase << 24);
+	u_info->limit = sd->sd_lolimit | (sd->sd_hilimit << 16);
+	u_info->seg_32bit = (sd->sd_hiflags & SD_OPSIZE32) ? 1 : 0;
+	if(sd->sd_loflags & (SD_CODE & ~SD_DATA)) {
+		u_info->contents = 2;
+	} else {
+		u_info->contents = (sd->sd_loflags & SD_EXPDOWN) ? 1 : 0;
+	}
+	u_info->read_exec_only = (sd->sd_loflags & SD_DATA) ? 0 : 1;
+	u_info->limit_in_pages = (sd->sd_hiflags & SD_PAGE4KB) ? 1 : 0;
+	u_info->seg_not_present = (sd->sd_loflags & SD_PRESENT) ? 0 : 1;
+	u_info->useable = (sd->sd_hiflags & SD_AVL) ? 1 : 0;
+	return 0;
+}
@@ -29,14 +29,14 @@ int sys_getdents64(unsigned int ufd, struct dirent64 *dirent, unsigned int count
 	if((errno = check_user_area(VERIFY_WRITE, dirent, sizeof(struct dirent64)))) {
 		return errno;
 	}
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 
 	if(!S_ISDIR(i->i_mode)) {
 		return -ENOTDIR;
 	}
 
 	if(i->fsop && i->fsop->readdir64) {
-		errno = i->fsop->readdir64(i, &fd_table[current->fd[ufd]], dirent, count);
+		errno = i->fsop->readdir64(i, &fd_table[current->files->fd[ufd]], dirent, count);
 	#ifdef __DEBUG__
 		printk(" -> returning %d\n", errno);
 	#endif /*__DEBUG__ */
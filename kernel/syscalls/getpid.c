@@ -14,7 +14,7 @@
 int sys_getpid(void)
 {
 #ifdef __DEBUG__
-	printk("(pid %d) sys_getpid() -> %d\n", current->pid, current->pid);
+	printk("(pid %d) sys_getpid() -> %d\n", current->pid, current->tgid);
 #endif /*__DEBUG__ */
-	return current->pid;
+	return current->tgid;
 }
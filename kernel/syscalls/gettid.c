@@ -0,0 +1,20 @@
+/*
+ * fiwix/kernel/syscalls/gettid.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/process.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_gettid(void)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_gettid() -> %d\n", current->pid, current->pid);
+#endif /*__DEBUG__ */
+	return current->pid;
+}
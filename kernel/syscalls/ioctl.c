@@ -22,9 +22,9 @@ int sys_ioctl(unsigned int ufd, int cmd, unsigned int arg)
 #endif /*__DEBUG__ */
 
 	CHECK_UFD(ufd);
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	if(i->fsop && i->fsop->ioctl) {
-		errno = i->fsop->ioctl(i, &fd_table[current->fd[ufd]], cmd, arg);
+		errno = i->fsop->ioctl(i, &fd_table[current->files->fd[ufd]], cmd, arg);
 
 #ifdef __DEBUG__
 		printk("%d\n", errno);
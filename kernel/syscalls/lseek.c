@@ -26,13 +26,13 @@ int sys_lseek(unsigned int ufd, __off_t offset, unsigned int whence)
 
 	CHECK_UFD(ufd);
 
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	switch(whence) {
 		case SEEK_SET:
 			new_offset = offset;
 			break;
 		case SEEK_CUR:
-			new_offset = fd_table[current->fd[ufd]].offset + offset;
+			new_offset = fd_table[current->files->fd[ufd]].offset + offset;
 			break;
 		case SEEK_END:
 			new_offset = i->i_size + offset;
@@ -44,7 +44,7 @@ int sys_lseek(unsigned int ufd, __off_t offset, unsigned int whence)
 		return -EINVAL;
 	}
 	if(i->fsop && i->fsop->llseek) {
-		fd_table[current->fd[ufd]].offset = new_offset;
+		fd_table[current->files->fd[ufd]].offset = new_offset;
 		new_offset = i->fsop->llseek(i, new_offset);
 	} else {
 		return -EPERM;
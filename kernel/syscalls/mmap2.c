@@ -38,10 +38,10 @@ int sys_mmap2(unsigned int start, unsigned int length, unsigned int prot, unsign
 	flags = 0;
 	if(!(user_flags & MAP_ANONYMOUS)) {
 		CHECK_UFD(fd);
-		if(!(i = fd_table[current->fd[fd]].inode)) {
+		if(!(i = fd_table[current->files->fd[fd]].inode)) {
 			return -EBADF;
 		}
-		flags = fd_table[current->fd[fd]].flags & O_ACCMODE;
+		flags = fd_table[current->files->fd[fd]].flags & O_ACCMODE;
 	}
 	page = do_mmap(i, start, length, prot, user_flags, offset*4096, P_MMAP, flags, NULL);
 #ifdef __DEBUG__
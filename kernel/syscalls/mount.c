@@ -23,7 +23,7 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 	struct inode *i_source, *i_target;
 	struct mount *mp;
 	struct filesystems *fs;
-	char *tmp_source, *tmp_target, *tmp_fstype;
+	char *tmp_source, *tmp_target, *tmp_fstype, *tmp_data;
 	__dev_t dev;
 	int errno;
 
@@ -59,7 +59,19 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 		}
 		fs = mp->fs;
 		if(fs->fsop && fs->fsop->remount_fs) {
-			if((errno = fs->fsop->remount_fs(&mp->sb, flags))) {
+			tmp_data = NULL;
+			if(data && (errno = malloc_name(data, &tmp_data)) < 0) {
+				iput(i_target);
+				free_name(tmp_target);
+				return errno;
+			}
+			mp->sb.options = tmp_data;
+			errno = fs->fsop->remount_fs(&mp->sb, flags);
+			mp->sb.options = NULL;
+			if(tmp_data) {
+				free_name(tmp_data);
+			}
+			if(errno) {
 				iput(i_target);
 				free_name(tmp_target);
 				return errno;
@@ -70,8 +82,12 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 			return -EINVAL;
 		}
 
-		/* switching from RW to RO */
-		if(flags & MS_RDONLY && !(mp->sb.flags & MS_RDONLY)) {
+		/*
+		 * Switching from RW to RO. There is nothing to flush on a
+		 * filesystem without a backing device, and releasing its
+		 * superblock would discard all its files.
+		 */
+		if(flags & MS_RDONLY && !(mp->sb.flags & MS_RDONLY) && !(fs->fsop->flags & FSOP_NO_BACKING)) {
 			dev = mp->dev;
 			/* 
 			 * FIXME: if there are files opened in RW mode then
@@ -151,6 +167,28 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 			return -EINVAL;
 		}
 		dev = i_source->rdev;
+	} else if(!dev) {
+		/* every mount of a device-less filesystem gets its own device */
+		if(!(dev = get_unnamed_dev())) {
+			iput(i_target);
+			free_name(tmp_target);
+			free_name(tmp_fstype);
+			free_name(tmp_source);
+			return -EMFILE;
+		}
+	}
+
+	tmp_data = NULL;
+	if(data && (errno = malloc_name(data, &tmp_data)) < 0) {
+		if(fs->fsop->flags == FSOP_REQUIRES_DEV) {
+			i_source->fsop->close(i_source, NULL);
+			iput(i_source);
+		}
+		iput(i_target);
+		free_name(tmp_target);
+		free_name(tmp_fstype);
+		free_name(tmp_source);
+		return errno;
 	}
 
 	if(!(mp = add_mount_point(dev, tmp_source, tmp_target))) {
@@ -162,14 +200,23 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 		free_name(tmp_target);
 		free_name(tmp_fstype);
 		free_name(tmp_source);
+		if(tmp_data) {
+			free_name(tmp_data);
+		}
 		return -EBUSY;
 	}
 
 	mp->sb.flags = flags;
 	if(fs->fsop->read_superblock) {
-		if((errno = fs->fsop->read_superblock(dev, &mp->sb))) {
-			i_source->fsop->close(i_source, NULL);
+		mp->sb.options = tmp_data;
+		errno = fs->fsop->read_superblock(dev, &mp->sb);
+		mp->sb.options = NULL;
+		if(tmp_data) {
+			free_name(tmp_data);
+		}
+		if(errno) {
 			if(fs->fsop->flags == FSOP_REQUIRES_DEV) {
+				i_source->fsop->close(i_source, NULL);
 				iput(i_source);
 			}
 			iput(i_target);
@@ -188,6 +235,9 @@ int sys_mount(const char *source, const char *target, const char *fstype, unsign
 		free_name(tmp_target);
 		free_name(tmp_fstype);
 		free_name(tmp_source);
+		if(tmp_data) {
+			free_name(tmp_data);
+		}
 		return -EINVAL;
 	}
 
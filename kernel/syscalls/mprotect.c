@@ -40,6 +40,9 @@ int sys_mprotect(unsigned int addr, __size_t length, int prot)
 	if((addr + length) > vma->end) {
 		return -ENOMEM;
 	}
+	if(vma->s_type == P_VDSO && (prot & PROT_WRITE)) {
+		return -EACCES;
+	}
 	if(vma->inode && (vma->flags & MAP_SHARED)) {
 		if(prot & PROT_WRITE) {
 			if(!(vma->o_mode & (O_WRONLY | O_RDWR))) {
@@ -0,0 +1,65 @@
+/*
+ * fiwix/kernel/syscalls/mq_getsetattr.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/fd.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_mqueue.h>
+#include <fiwix/syscalls.h>
+#include <fiwix/process.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+#include <fiwix/fcntl.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+#ifdef CONFIG_POSIX_MQUEUE
+int sys_mq_getsetattr(int mqdes, const struct mq_attr *newattr, struct mq_attr *oldattr)
+{
+	struct fd *f;
+	struct inode *i;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_mq_getsetattr(%d, 0x%08x, 0x%08x)\n", current->pid, mqdes, (unsigned int)newattr, (unsigned int)oldattr);
+#endif /*__DEBUG__ */
+
+	CHECK_UFD(mqdes);
+	f = &fd_table[current->files->fd[mqdes]];
+	i = f->inode;
+	if(i->fsop != &mqueue_fsop) {
+		return -EBADF;
+	}
+	if(newattr) {
+		if((errno = check_user_area(VERIFY_READ, newattr, sizeof(struct mq_attr)))) {
+			return errno;
+		}
+		if(newattr->mq_flags & ~O_NONBLOCK) {
+			return -EINVAL;
+		}
+	}
+	if(oldattr) {
+		if((errno = check_user_area(VERIFY_WRITE, oldattr, sizeof(struct mq_attr)))) {
+			return errno;
+		}
+		oldattr->mq_flags = f->flags & O_NONBLOCK;
+		oldattr->mq_maxmsg = i->u.mqueue.i_maxmsg;
+		oldattr->mq_msgsize = i->u.mqueue.i_msgsize;
+		oldattr->mq_curmsgs = i->u.mqueue.i_curmsgs;
+	}
+
+	/* only the O_NONBLOCK flag of the descriptor can be changed */
+	if(newattr) {
+		f->flags &= ~O_NONBLOCK;
+		f->flags |= newattr->mq_flags & O_NONBLOCK;
+	}
+	return 0;
+}
+#endif /* CONFIG_POSIX_MQUEUE */
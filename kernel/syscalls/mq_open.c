@@ -0,0 +1,47 @@
+/*
+ * fiwix/kernel/syscalls/mq_open.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/fd.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_mqueue.h>
+#include <fiwix/syscalls.h>
+#include <fiwix/process.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+#include <fiwix/fcntl.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+#ifdef CONFIG_POSIX_MQUEUE
+int sys_mq_open(const char *name, int oflag, __mode_t mode, struct mq_attr *attr)
+{
+	char *tmp_name;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_mq_open('%s', %o, %o, 0x%08x)\n", current->pid, name, oflag, mode, (unsigned int)attr);
+#endif /*__DEBUG__ */
+
+	if(attr && (oflag & O_CREAT)) {
+		if((errno = check_user_area(VERIFY_READ, attr, sizeof(struct mq_attr)))) {
+			return errno;
+		}
+	} else {
+		attr = NULL;
+	}
+	if((errno = malloc_name(name, &tmp_name)) < 0) {
+		return errno;
+	}
+	errno = mqueue_open(tmp_name, oflag, mode, attr);
+	free_name(tmp_name);
+	return errno;
+}
+#endif /* CONFIG_POSIX_MQUEUE */
@@ -0,0 +1,50 @@
+/*
+ * fiwix/kernel/syscalls/mq_timedsend.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/fd.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_mqueue.h>
+#include <fiwix/syscalls.h>
+#include <fiwix/process.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+#ifdef CONFIG_POSIX_MQUEUE
+int sys_mq_timedsend(int mqdes, const char *msg_ptr, __size_t msg_len, unsigned int msg_prio, const struct timespec *abs_timeout)
+{
+	struct fd *f;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_mq_timedsend(%d, 0x%08x, %d, %d, 0x%08x)\n", current->pid, mqdes, (unsigned int)msg_ptr, msg_len, msg_prio, (unsigned int)abs_timeout);
+#endif /*__DEBUG__ */
+
+	CHECK_UFD(mqdes);
+	f = &fd_table[current->files->fd[mqdes]];
+	if(f->inode->fsop != &mqueue_fsop) {
+		return -EBADF;
+	}
+	if((errno = check_user_area(VERIFY_READ, msg_ptr, msg_len))) {
+		return errno;
+	}
+	if(abs_timeout) {
+		if((errno = check_user_area(VERIFY_READ, abs_timeout, sizeof(struct timespec)))) {
+			return errno;
+		}
+		if(abs_timeout->tv_nsec < 0 || abs_timeout->tv_nsec >= 1000000000L) {
+			return -EINVAL;
+		}
+	}
+	return mqueue_send(f, msg_ptr, msg_len, msg_prio, abs_timeout);
+}
+#endif /* CONFIG_POSIX_MQUEUE */
@@ -0,0 +1,39 @@
+/*
+ * fiwix/kernel/syscalls/mq_unlink.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/fd.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fs_mqueue.h>
+#include <fiwix/syscalls.h>
+#include <fiwix/process.h>
+#include <fiwix/errno.h>
+#include <fiwix/string.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+#ifdef CONFIG_POSIX_MQUEUE
+int sys_mq_unlink(const char *name)
+{
+	char *tmp_name;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_mq_unlink('%s')\n", current->pid, name);
+#endif /*__DEBUG__ */
+
+	if((errno = malloc_name(name, &tmp_name)) < 0) {
+		return errno;
+	}
+	errno = mqueue_unlink(tmp_name);
+	free_name(tmp_name);
+	return errno;
+}
+#endif /* CONFIG_POSIX_MQUEUE */
@@ -11,6 +11,8 @@
 #include <fiwix/string.h>
 #include <fiwix/process.h>
 #include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/mm.h>
 #include <fiwix/errno.h>
 #include <fiwix/ipc.h>
 #include <fiwix/msg.h>
@@ -25,7 +27,8 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
 	struct msqid_ds *mq;
 	struct msginfo *mi;
 	struct ipc_perm *perm;
-	struct msg *m, *mn;
+	struct msg *m;
+	struct msg_waiter *w;
 	int errno;
 
 #ifdef __DEBUG__
@@ -86,15 +89,18 @@ int sys_msgctl(int msqid, int cmd, struct msqid_ds *buf)
 			if(!IS_SUPERUSER && current->euid != perm->uid && current->euid != perm->cuid) {
 				return -EPERM;
 			}
-			if((m = mq->msg_first)) {
-				do {
-					mq->msg_qnum--;
-					mq->msg_cbytes -= m->msg_ts;
-					num_msgs--;
-					mn = m->msg_next;
-					msg_release_md(m);
-					m = mn;
-				} while(m);
+			while((m = mq->msg_first)) {
+				msg_dequeue(mq, m);
+				mq->msg_qnum--;
+				mq->msg_cbytes -= m->msg_ts;
+				num_msgs--;
+				if(m->msg_spot) {
+					kfree((unsigned int)m->msg_spot);
+				}
+				msg_release_md(m);
+			}
+			for(w = MSG_QUEUE(mq)->waiters; w; w = w->next) {
+				wakeup(w);
 			}
 			msg_release_mq(mq);
 			msgque[msqid % MSGMNI] = (struct msqid_ds *)IPC_UNUSED;
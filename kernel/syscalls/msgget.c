@@ -10,6 +10,8 @@
 #include <fiwix/string.h>
 #include <fiwix/errno.h>
 #include <fiwix/process.h>
+#include <fiwix/sleep.h>
+#include <fiwix/mm.h>
 #include <fiwix/ipc.h>
 #include <fiwix/msg.h>
 
@@ -25,15 +27,15 @@ unsigned int max_mqid;
 unsigned int msg_seq;
 
 /* FIXME: this should be allocated dynamically */
-static struct msqid_ds msgque_pool[MSGMNI];
+static struct msg_queue msgque_pool[MSGMNI];
 struct msqid_ds *msg_get_new_mq(void)
 {
 	int n;
 
 	for(n = 0; n < MSGMNI; n++) {
-		if(msgque_pool[n].msg_ctime == 0) {
-			msgque_pool[n].msg_ctime = 1;
-			return &msgque_pool[n];
+		if(msgque_pool[n].ds.msg_ctime == 0) {
+			msgque_pool[n].ds.msg_ctime = 1;
+			return &msgque_pool[n].ds;
 		}
 	}
 	return NULL;
@@ -41,7 +43,7 @@ struct msqid_ds *msg_get_new_mq(void)
 
 void msg_release_mq(struct msqid_ds *mq)
 {
-	memset_b(mq, 0, sizeof(struct msqid_ds));
+	memset_b(MSG_QUEUE(mq), 0, sizeof(struct msg_queue));
 }
 
 struct msg msg_pool[MSGTQL];
@@ -70,6 +72,161 @@ void msg_release_md(struct msg *msg)
 	unlock_resource(&ipcmsg_resource);
 }
 
+static struct msg_type *get_msg_type(struct msqid_ds *mq, int type)
+{
+	struct msg_type *mt;
+
+	mt = MSG_QUEUE(mq)->hash[type & (MSG_TYPE_HASH - 1)];
+	while(mt) {
+		if(mt->type == type) {
+			return mt;
+		}
+		mt = mt->next_hash;
+	}
+	return NULL;
+}
+
+/*
+ * Appends the message to the queue and to the sub-queue of its type, which
+ * is created if needed. The sub-queues are kept sorted by type so that the
+ * lowest one is always the first.
+ */
+int msg_enqueue(struct msqid_ds *mq, struct msg *m)
+{
+	struct msg_queue *q = MSG_QUEUE(mq);
+	struct msg_type *mt, **t;
+	int n;
+
+	if(!(mt = get_msg_type(mq, m->msg_type))) {
+		if(!(mt = (struct msg_type *)kmalloc(sizeof(struct msg_type)))) {
+			return -ENOMEM;
+		}
+		memset_b(mt, 0, sizeof(struct msg_type));
+		mt->type = m->msg_type;
+		n = mt->type & (MSG_TYPE_HASH - 1);
+		mt->next_hash = q->hash[n];
+		q->hash[n] = mt;
+		for(t = &q->types; *t && (*t)->type < mt->type; t = &(*t)->next);
+		mt->next = *t;
+		*t = mt;
+	}
+
+	m->msg_next = m->msg_tnext = NULL;
+	m->msg_prev = mq->msg_last;
+	if(!mq->msg_first) {
+		mq->msg_first = mq->msg_last = m;
+	} else {
+		mq->msg_last->msg_next = m;
+		mq->msg_last = m;
+	}
+	if(!mt->first) {
+		mt->first = mt->last = m;
+	} else {
+		mt->last->msg_tnext = m;
+		mt->last = m;
+	}
+	return 0;
+}
+
+/*
+ * Returns the first message that matches 'msgtyp'. Only MSG_EXCEPT needs to
+ * scan the queue, since any other filter is satisfied by the oldest message
+ * of a single type.
+ */
+struct msg *msg_find(struct msqid_ds *mq, int msgtyp, int msgflg)
+{
+	struct msg_type *mt;
+	struct msg *m;
+
+	if(!msgtyp) {
+		return mq->msg_first;
+	}
+	if(msgtyp > 0) {
+		if(msgflg & MSG_EXCEPT) {
+			for(m = mq->msg_first; m; m = m->msg_next) {
+				if(m->msg_type != msgtyp) {
+					return m;
+				}
+			}
+			return NULL;
+		}
+		if((mt = get_msg_type(mq, msgtyp))) {
+			return mt->first;
+		}
+		return NULL;
+	}
+	if((mt = MSG_QUEUE(mq)->types) && mt->type <= -msgtyp) {
+		return mt->first;
+	}
+	return NULL;
+}
+
+/* removes a message, which is always the oldest one of its type */
+void msg_dequeue(struct msqid_ds *mq, struct msg *m)
+{
+	struct msg_queue *q = MSG_QUEUE(mq);
+	struct msg_type *mt, **t;
+
+	if(m->msg_prev) {
+		m->msg_prev->msg_next = m->msg_next;
+	} else {
+		mq->msg_first = m->msg_next;
+	}
+	if(m->msg_next) {
+		m->msg_next->msg_prev = m->msg_prev;
+	} else {
+		mq->msg_last = m->msg_prev;
+	}
+
+	mt = get_msg_type(mq, m->msg_type);
+	if((mt->first = m->msg_tnext)) {
+		return;
+	}
+
+	/* this was the last message of its type */
+	for(t = &q->hash[mt->type & (MSG_TYPE_HASH - 1)]; *t != mt; t = &(*t)->next_hash);
+	*t = mt->next_hash;
+	for(t = &q->types; *t != mt; t = &(*t)->next);
+	*t = mt->next;
+	kfree((unsigned int)mt);
+}
+
+void msg_add_waiter(struct msqid_ds *mq, struct msg_waiter *w)
+{
+	w->next = MSG_QUEUE(mq)->waiters;
+	MSG_QUEUE(mq)->waiters = w;
+}
+
+void msg_del_waiter(struct msqid_ds *mq, struct msg_waiter *w)
+{
+	struct msg_waiter **wp;
+
+	for(wp = &MSG_QUEUE(mq)->waiters; *wp; wp = &(*wp)->next) {
+		if(*wp == w) {
+			*wp = w->next;
+			break;
+		}
+	}
+}
+
+/* wakes up only the receivers that would accept a message of type 'type' */
+void msg_wakeup_receivers(struct msqid_ds *mq, int type)
+{
+	struct msg_waiter *w;
+
+	for(w = MSG_QUEUE(mq)->waiters; w; w = w->next) {
+		if(!w->type) {
+			wakeup(w);
+		} else if(w->type > 0) {
+			if((w->flags & MSG_EXCEPT) ? type != w->type : type == w->type) {
+				wakeup(w);
+			}
+		} else if(type <= -w->type) {
+			wakeup(w);
+		}
+	}
+}
+
 void msg_init(void)
 {
 	int n;
@@ -26,8 +26,9 @@ int sys_msgrcv(int msqid, void *msgp, __size_t msgsz, int msgtyp, int msgflg)
 {
 	struct msqid_ds *mq;
 	struct msgbuf *mb;
-	struct msg *m, *mprev;
-	int errno, found, count;
+	struct msg *m;
+	struct msg_waiter w;
+	int errno, count;
 
 #ifdef __DEBUG__
 	printk("(pid %d) sys_msgrcv(%d, 0x%08x, %d, %d, 0x%x)\n", current->pid, msqid, (int)msgp, msgsz, msgtyp, msgflg);
@@ -43,53 +44,34 @@ int sys_msgrcv(int msqid, void *msgp, __size_t msgsz, int msgtyp, int msgflg)
 	if(mq == IPC_UNUSED) {
 		return -EINVAL;
 	}
-	found = 0;
-	mprev = NULL;
+
+	/* senders only wake up those receivers whose type filter matches */
+	w.type = msgtyp;
+	w.flags = msgflg;
+	msg_add_waiter(mq, &w);
 	for(;;) {
 		if(!ipc_has_perms(&mq->msg_perm, IPC_R)) {
+			msg_del_waiter(mq, &w);
 			return -EACCES;
 		}
-		if((m = mq->msg_first)) {
-			if(!msgtyp) {
-				break;
-			} else if(msgtyp > 0) {
-				if(msgflg & MSG_EXCEPT) {
-					while(m) {
-						if(m->msg_type != msgtyp) {
-							found = 1;
-							break;
-						}
-						mprev = m;
-						m = m->msg_next;
-					}
-				} else {
-					while(m) {
-						if(m->msg_type == msgtyp) {
-							found = 1;
-							break;
-						}
-						mprev = m;
-						m = m->msg_next;
-					}
-				}
-			} else {
-				/* FIXME: pending to do */
-			}
-		}
-		if(found) {
+		if((m = msg_find(mq, msgtyp, msgflg))) {
 			break;
 		}
 		if(msgflg & IPC_NOWAIT) {
+			msg_del_waiter(mq, &w);
 			return -ENOMSG;
 		}
-		if(sleep(mq, PROC_INTERRUPTIBLE)) {
+		if(sleep(&w, PROC_INTERRUPTIBLE)) {
+			if(msgque[msqid % MSGMNI] == mq) {
+				msg_del_waiter(mq, &w);
+			}
 			return -EINTR;
 		}
-		mq = msgque[msqid % MSGMNI];
-		if(mq == IPC_UNUSED) {
+		if(msgque[msqid % MSGMNI] != mq) {
 			return -EIDRM;
 		}
 	}
+	msg_del_waiter(mq, &w);
 
 	if(msgsz < m->msg_ts) {
 		if(!(msgflg & MSG_NOERROR)) {
@@ -105,17 +87,16 @@ int sys_msgrcv(int msqid, void *msgp, __size_t msgsz, int msgtyp, int msgflg)
 	memcpy_b(mb->mtext, m->msg_spot, count);
 
 	lock_resource(&ipcmsg_resource);
-	kfree((unsigned int)m->msg_spot);
-	if(!mprev) {
-		mq->msg_first = m->msg_next;
-	} else {
-		mprev->msg_next = m->msg_next;
+	msg_dequeue(mq, m);
+	if(m->msg_spot) {
+		kfree((unsigned int)m->msg_spot);
 	}
 	mq->msg_rtime = mq->msg_ctime = CURRENT_TIME;
 	mq->msg_qnum--;
 	mq->msg_cbytes -= m->msg_ts;
 	mq->msg_lrpid = current->pid;
 	num_msgs--;
+	current->usage.ru_msgrcv++;
 	unlock_resource(&ipcmsg_resource);
 	msg_release_md(m);
 	wakeup(mq);
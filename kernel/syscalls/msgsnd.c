@@ -55,46 +55,52 @@ int sys_msgsnd(int msqid, const void *msgp, __size_t msgsz, int msgflg)
 		if(!ipc_has_perms(&mq->msg_perm, IPC_W)) {
 			return -EACCES;
 		}
-		if(mq->msg_cbytes + msgsz > mq->msg_qbytes || mq->msg_qnum + 1 > mq->msg_qbytes) {
-			if(msgflg & IPC_NOWAIT) {
-				return -EAGAIN;
-			}
-			if(sleep(mq, PROC_INTERRUPTIBLE)) {
-				return -EINTR;
-			}
+		if(mq->msg_cbytes + msgsz <= mq->msg_qbytes && mq->msg_qnum + 1 <= mq->msg_qbytes) {
+			break;
 		}
-		if(mq == IPC_UNUSED) {
+		if(msgflg & IPC_NOWAIT) {
+			return -EAGAIN;
+		}
+		if(sleep(mq, PROC_INTERRUPTIBLE)) {
+			return -EINTR;
+		}
+		if(msgque[msqid % MSGMNI] != mq) {
 			return -EIDRM;
 		}
-		break;
 	}
 
 	if(!(m = msg_get_new_md())) {
 		return -ENOMEM;
 	}
-	m->msg_next = NULL;
 	m->msg_type = mb->mtype;
-	if(!(m->msg_spot = (void *)kmalloc(PAGE_SIZE))) {
-		msg_release_md(m);
-		return -ENOMEM;
+	/* the text takes just the memory it needs */
+	m->msg_spot = NULL;
+	if(msgsz) {
+		if(!(m->msg_spot = (void *)kmalloc(msgsz))) {
+			msg_release_md(m);
+			return -ENOMEM;
+		}
+		memcpy_b(m->msg_spot, mb->mtext, msgsz);
 	}
-	memcpy_b(m->msg_spot, mb->mtext, msgsz);
 	m->msg_stime = CURRENT_TIME;
 	m->msg_ts = msgsz;
 	lock_resource(&ipcmsg_resource);
-	if(!mq->msg_first) {
-		mq->msg_first = mq->msg_last = m;
-	} else {
-		mq->msg_last->msg_next = m;
-		mq->msg_last = m;
+	if((errno = msg_enqueue(mq, m))) {
+		unlock_resource(&ipcmsg_resource);
+		if(m->msg_spot) {
+			kfree((unsigned int)m->msg_spot);
+		}
+		msg_release_md(m);
+		return errno;
 	}
 	mq->msg_stime = mq->msg_ctime = CURRENT_TIME;
 	mq->msg_qnum++;
 	mq->msg_cbytes += msgsz;
 	mq->msg_lspid = current->pid;
 	num_msgs++;
+	current->usage.ru_msgsnd++;
 	unlock_resource(&ipcmsg_resource);
-	wakeup(mq);
+	msg_wakeup_receivers(mq, m->msg_type);
 	return 0;
 }
 #endif /* CONFIG_SYSVIPC */
@@ -27,7 +27,7 @@ int sys_newfstat(unsigned int ufd, struct new_stat *statbuf)
 	if((errno = check_user_area(VERIFY_WRITE, statbuf, sizeof(struct new_stat)))) {
 		return errno;
 	}
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	statbuf->st_dev = i->dev;
 	statbuf->__pad1 = 0;
 	statbuf->st_ino = i->inode;
@@ -59,8 +59,8 @@ int sys_pipe(int pipefd[2])
 
 	pipefd[0] = rufd;
 	pipefd[1] = wufd;
-	current->fd[rufd] = rfd;
-	current->fd[wufd] = wfd;
+	current->files->fd[rufd] = rfd;
+	current->files->fd[wufd] = wfd;
 	fd_table[rfd].flags = O_RDONLY;
 	fd_table[wfd].flags = O_WRONLY;
 
@@ -27,7 +27,7 @@ int sys_read(unsigned int ufd, char *buf, int count)
 	if((errno = check_user_area(VERIFY_WRITE, buf, count))) {
 		return errno;
 	}
-	if(fd_table[current->fd[ufd]].flags & O_WRONLY) {
+	if(fd_table[current->files->fd[ufd]].flags & O_WRONLY) {
 		return -EBADF;
 	}
 	if(!count) {
@@ -37,9 +37,9 @@ int sys_read(unsigned int ufd, char *buf, int count)
 		return -EINVAL;
 	}
 
-	i = fd_table[current->fd[ufd]].inode;
+	i = fd_table[current->files->fd[ufd]].inode;
 	if(i->fsop && i->fsop->read) {
-		errno = i->fsop->read(i, &fd_table[current->fd[ufd]], buf, count);
+		errno = i->fsop->read(i, &fd_table[current->files->fd[ufd]], buf, count);
 #ifdef __DEBUG__
 		printk("%d\n", errno);
 #endif /*__DEBUG__ */
@@ -35,7 +35,7 @@ int sys_readv(unsigned int ufd, const struct iovec *iov, int iovcnt)
 		if((errno = check_user_area(VERIFY_WRITE, io_read->iov_base, io_read->iov_len))) {
 			return errno;
 		}
-		if(fd_table[current->fd[ufd]].flags & O_WRONLY) {
+		if(fd_table[current->files->fd[ufd]].flags & O_WRONLY) {
 			return -EBADF;
 		}
 		if(!io_read->iov_len) {
@@ -45,9 +45,9 @@ int sys_readv(unsigned int ufd, const struct iovec *iov, int iovcnt)
 			return -EINVAL;
 		}
 
-		i = fd_table[current->fd[ufd]].inode;
+		i = fd_table[current->files->fd[ufd]].inode;
 		if(i->fsop && i->fsop->read) {
-			errno = i->fsop->read(i, &fd_table[current->fd[ufd]], io_read->iov_base, io_read->iov_len);
+			errno = i->fsop->read(i, &fd_table[current->files->fd[ufd]], io_read->iov_base, io_read->iov_len);
 			if (errno < 0) {
 			    return errno;
 			}
@@ -59,24 +59,24 @@ int do_select(int nfds, fd_set *rfds, fd_set *wfds, fd_set *efds, fd_set *res_rf
 	count = 0;
 	for(;;) {
 		for(n = 0; n < nfds; n++) {
-			if(!current->fd[n]) {
+			if(!current->files->fd[n]) {
 				continue;
 			}
-			i = fd_table[current->fd[n]].inode;
+			i = fd_table[current->files->fd[n]].inode;
 			if(__FD_ISSET(n, rfds)) {
-				if(do_check(i, &fd_table[current->fd[n]], SEL_R)) {
+				if(do_check(i, &fd_table[current->files->fd[n]], SEL_R)) {
 					__FD_SET(n, res_rfds);
 					count++;
 				}
 			}
 			if(__FD_ISSET(n, wfds)) {
-				if(do_check(i, &fd_table[current->fd[n]], SEL_W)) {
+				if(do_check(i, &fd_table[current->files->fd[n]], SEL_W)) {
 					__FD_SET(n, res_wfds);
 					count++;
 				}
 			}
 			if(__FD_ISSET(n, efds)) {
-				if(do_check(i, &fd_table[current->fd[n]], SEL_E)) {
+				if(do_check(i, &fd_table[current->files->fd[n]], SEL_E)) {
 					__FD_SET(n, res_efds);
 					count++;
 				}
@@ -0,0 +1,74 @@
+/*
+ * fiwix/kernel/syscalls/sendfile.c
+ *
+ * Copyright 2018-2023, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/syscalls.h>
+#include <fiwix/fs.h>
+#include <fiwix/mm.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stat.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+/*
+ * Checks the descriptors of sendfile() and sendfile64() and sends the data
+ * from '*ppos', or from the current offset of 'in_fd' if 'ppos' is NULL.
+ */
+int do_sendfile_ufd(int out_fd, int in_fd, __loff_t *ppos, __size_t count)
+{
+	struct fd *fin, *fout;
+	__loff_t pos;
+	int errno;
+
+	CHECK_UFD(in_fd);
+	CHECK_UFD(out_fd);
+	fin = &fd_table[current->files->fd[in_fd]];
+	fout = &fd_table[current->files->fd[out_fd]];
+	if((fin->flags & O_ACCMODE) == O_WRONLY || (fout->flags & O_ACCMODE) == O_RDONLY) {
+		return -EBADF;
+	}
+
+	/* the input must be seekable */
+	if(!S_ISREG(fin->inode->i_mode) && !S_ISBLK(fin->inode->i_mode)) {
+		return -EINVAL;
+	}
+	if(fout->flags & O_APPEND) {
+		return -EINVAL;
+	}
+
+	if(ppos) {
+		return do_sendfile(fin, fout, ppos, count);
+	}
+	pos = fin->offset;
+	errno = do_sendfile(fin, fout, &pos, count);
+	fin->offset = pos;
+	return errno;
+}
+
+int sys_sendfile(int out_fd, int in_fd, __off_t *offset, __size_t count)
+{
+	__loff_t pos;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sendfile(%d, %d, 0x%08x, %d)\n", current->pid, out_fd, in_fd, offset, count);
+#endif /*__DEBUG__ */
+
+	if(!offset) {
+		return do_sendfile_ufd(out_fd, in_fd, NULL, count);
+	}
+	if((errno = check_user_area(VERIFY_WRITE, offset, sizeof(__off_t)))) {
+		return errno;
+	}
+	pos = *offset;
+	errno = do_sendfile_ufd(out_fd, in_fd, &pos, count);
+	*offset = pos;
+	return errno;
+}
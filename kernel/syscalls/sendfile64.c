@@ -0,0 +1,36 @@
+/*
+ * fiwix/kernel/syscalls/sendfile64.c
+ *
+ * Copyright 2018-2023, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/syscalls.h>
+#include <fiwix/mm.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_sendfile64(int out_fd, int in_fd, __loff_t *offset, __size_t count)
+{
+	__loff_t pos;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_sendfile64(%d, %d, 0x%08x, %d)\n", current->pid, out_fd, in_fd, offset, count);
+#endif /*__DEBUG__ */
+
+	if(!offset) {
+		return do_sendfile_ufd(out_fd, in_fd, NULL, count);
+	}
+	if((errno = check_user_area(VERIFY_WRITE, offset, sizeof(__loff_t)))) {
+		return errno;
+	}
+	pos = *offset;
+	errno = do_sendfile_ufd(out_fd, in_fd, &pos, count);
+	*offset = pos;
+	return errno;
+}
@@ -0,0 +1,52 @@
+/*
+ * fiwix/kernel/syscalls/set_thread_area.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/segments.h>
+#include <fiwix/process.h>
+#include <fiwix/fs.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+int sys_set_thread_area(struct user_desc *u_info)
+{
+	unsigned int n;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_set_thread_area(0x%08x)\n", current->pid, (unsigned int)u_info);
+#endif /*__DEBUG__ */
+
+	if((errno = check_user_area(VERIFY_WRITE, u_info, sizeof(struct user_desc)))) {
+		return errno;
+	}
+
+	/* -1 asks for the first free entry */
+	n = u_info->entry_number;
+	if(n == -1) {
+		for(n = 0; n < NR_TLS_ENTRIES; n++) {
+			if(!current->tls[n].sd_loflags) {
+				break;
+			}
+		}
+		if(n >= NR_TLS_ENTRIES) {
+			return -ESRCH;
+		}
+		n += TLS_ENTRY_MIN;
+		u_info->entry_number = n;
+	}
+	if(n < TLS_ENTRY_MIN || n >= TLS_ENTRY_MIN + NR_TLS_ENTRIES) {
+		return -EINVAL;
+	}
+
+	set_tls_desc(&current->tls[n - TLS_ENTRY_MIN], u_info);
+	load_tls(current->tls);
+	return 0;
+}
@@ -10,6 +10,7 @@
 #include <fiwix/time.h>
 #include <fiwix/timer.h>
 #include <fiwix/process.h>
+#include <fiwix/vdso.h>
 #include <fiwix/errno.h>
 
 #ifdef __DEBUG__
@@ -41,6 +42,7 @@ int sys_settimeofday(const struct timeval *tv, const struct timezone *tz)
 		}
 		kstat.tz_minuteswest = tz->tz_minuteswest;
 		kstat.tz_dsttime = tz->tz_dsttime;
+		vdso_update();
 	}
 	return 0;
 }
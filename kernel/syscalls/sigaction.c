@@ -32,19 +32,19 @@ int sys_sigaction(__sigset_t signum, const struct sigaction *newaction, struct s
 		if((errno = check_user_area(VERIFY_WRITE, oldaction, sizeof(struct sigaction)))) {
 			return errno;
 		}
-		*oldaction = current->sigaction[signum - 1];
+		*oldaction = current->sighand->sigaction[signum - 1];
 	}
 	if(newaction) {
 		if((errno = check_user_area(VERIFY_READ, newaction, sizeof(struct sigaction)))) {
 			return errno;
 		}
-		current->sigaction[signum - 1] = *newaction;
-		if(current->sigaction[signum - 1].sa_handler == SIG_IGN) {
+		current->sighand->sigaction[signum - 1] = *newaction;
+		if(current->sighand->sigaction[signum - 1].sa_handler == SIG_IGN) {
 			if(signum != SIGCHLD) {
 				current->sigpending &= SIG_MASK(signum);
 			}
 		}
-		if(current->sigaction[signum - 1].sa_handler == SIG_DFL) {
+		if(current->sighand->sigaction[signum - 1].sa_handler == SIG_DFL) {
 			if(signum != SIGCHLD) {
 				current->sigpending &= SIG_MASK(signum);
 			}
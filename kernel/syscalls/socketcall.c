@@ -6,6 +6,7 @@
  */
 
 #include <fiwix/config.h>
+#include <fiwix/fs.h>
 #include <fiwix/net.h>
 #include <fiwix/errno.h>
 #include <fiwix/process.h>
@@ -99,6 +100,26 @@ int sys_socketcall(int call, unsigned int *args)
 				return errno;
 			}
 			return getsockopt(args[0], args[1], args[2], (void *)args[3], (socklen_t *)args[4]);
+		case SYS_SENDMSG:
+			if((errno = check_user_area(VERIFY_READ, args, sizeof(unsigned int) * 3))) {
+				return errno;
+			}
+			return sendmsg(args[0], (struct msghdr *)args[1], args[2]);
+		case SYS_RECVMSG:
+			if((errno = check_user_area(VERIFY_READ, args, sizeof(unsigned int) * 3))) {
+				return errno;
+			}
+			return recvmsg(args[0], (struct msghdr *)args[1], args[2]);
+		case SYS_RECVMMSG:
+			if((errno = check_user_area(VERIFY_READ, args, sizeof(unsigned int) * 5))) {
+				return errno;
+			}
+			return recvmmsg(args[0], (struct mmsghdr *)args[1], args[2], args[3], (struct timespec *)args[4]);
+		case SYS_SENDMMSG:
+			if((errno = check_user_area(VERIFY_READ, args, sizeof(unsigned int) * 4))) {
+				return errno;
+			}
+			return sendmmsg(args[0], (struct mmsghdr *)args[1], args[2], args[3]);
 	}
 
 	return -EINVAL;
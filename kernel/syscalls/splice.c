@@ -0,0 +1,69 @@
+/*
+ * fiwix/kernel/syscalls/splice.c
+ *
+ * Copyright 2018-2023, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/syscalls.h>
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stat.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+/*
+ * The 'flags' argument is the 6th one, so without CONFIG_SYSCALL_6TH_ARG it
+ * is taken directly from the EBP register of the caller.
+ */
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_splice(int fd_in, __loff_t *off_in, int fd_out, __loff_t *off_out, __size_t len, unsigned int flags)
+#else
+int sys_splice(int fd_in, __loff_t *off_in, int fd_out, __loff_t *off_out, __size_t len, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+	struct fd *fin, *fout;
+	int errno;
+#ifndef CONFIG_SYSCALL_6TH_ARG
+	unsigned int flags;
+
+	flags = sc->ebp;
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_splice(%d, 0x%08x, %d, 0x%08x, %d, 0x%x)\n", current->pid, fd_in, off_in, fd_out, off_out, len, flags);
+#endif /*__DEBUG__ */
+
+	CHECK_UFD(fd_in);
+	CHECK_UFD(fd_out);
+	fin = &fd_table[current->files->fd[fd_in]];
+	fout = &fd_table[current->files->fd[fd_out]];
+	if((fin->flags & O_ACCMODE) == O_WRONLY || (fout->flags & O_ACCMODE) == O_RDONLY) {
+		return -EBADF;
+	}
+	if(off_in) {
+		if(S_ISFIFO(fin->inode->i_mode)) {
+			return -ESPIPE;
+		}
+		if((errno = check_user_area(VERIFY_WRITE, off_in, sizeof(__loff_t)))) {
+			return errno;
+		}
+	}
+	if(off_out) {
+		if(S_ISFIFO(fout->inode->i_mode)) {
+			return -ESPIPE;
+		}
+		if((errno = check_user_area(VERIFY_WRITE, off_out, sizeof(__loff_t)))) {
+			return errno;
+		}
+	}
+	if(!len) {
+		return 0;
+	}
+	return pipefs_splice(fin, off_in, fout, off_out, len, flags);
+}
@@ -0,0 +1,37 @@
+/*
+ * fiwix/kernel/syscalls/tee.c
+ *
+ * Copyright 2018-2023, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_tee(int fd_in, int fd_out, __size_t len, unsigned int flags)
+{
+	struct fd *fin, *fout;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_tee(%d, %d, %d, 0x%x)\n", current->pid, fd_in, fd_out, len, flags);
+#endif /*__DEBUG__ */
+
+	CHECK_UFD(fd_in);
+	CHECK_UFD(fd_out);
+	fin = &fd_table[current->files->fd[fd_in]];
+	fout = &fd_table[current->files->fd[fd_out]];
+	if((fin->flags & O_ACCMODE) == O_WRONLY || (fout->flags & O_ACCMODE) == O_RDONLY) {
+		return -EBADF;
+	}
+	if(!len) {
+		return 0;
+	}
+	return pipefs_tee(fin->inode, fout->inode, len, flags);
+}
@@ -0,0 +1,39 @@
+/*
+ * fiwix/kernel/syscalls/timer_create.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/ptimer.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_timer_create(__clockid_t clock, struct sigevent *sevp, __timer_t *timerid)
+{
+	int errno, id;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_timer_create(%d, 0x%08x, 0x%08x)\n", current->pid, clock, (unsigned int)sevp, (unsigned int)timerid);
+#endif /*__DEBUG__ */
+
+	if(sevp) {
+		if((errno = check_user_area(VERIFY_READ, sevp, sizeof(struct sigevent)))) {
+			return errno;
+		}
+	}
+	if((errno = check_user_area(VERIFY_WRITE, timerid, sizeof(__timer_t)))) {
+		return errno;
+	}
+	if((id = ptimer_create(clock, sevp)) < 0) {
+		return id;
+	}
+	*timerid = id;
+	return 0;
+}
@@ -0,0 +1,23 @@
+/*
+ * fiwix/kernel/syscalls/timer_delete.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/ptimer.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_timer_delete(__timer_t timerid)
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_timer_delete(%d)\n", current->pid, timerid);
+#endif /*__DEBUG__ */
+
+	return ptimer_delete(timerid);
+}
@@ -0,0 +1,30 @@
+/*
+ * fiwix/kernel/syscalls/timer_gettime.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/ptimer.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_timer_gettime(__timer_t timerid, struct itimerspec *curr_value)
+{
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_timer_gettime(%d, 0x%08x)\n", current->pid, timerid, (unsigned int)curr_value);
+#endif /*__DEBUG__ */
+
+	if((errno = check_user_area(VERIFY_WRITE, curr_value, sizeof(struct itimerspec)))) {
+		return errno;
+	}
+	return ptimer_gettime(timerid, curr_value);
+}
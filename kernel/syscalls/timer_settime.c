@@ -0,0 +1,44 @@
+/*
+ * fiwix/kernel/syscalls/timer_settime.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/fs.h>
+#include <fiwix/ptimer.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_timer_settime(__timer_t timerid, int flags, const struct itimerspec *new_value, struct itimerspec *old_value)
+{
+	const struct timespec *ts;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_timer_settime(%d, %d, 0x%08x, 0x%08x)\n", current->pid, timerid, flags, (unsigned int)new_value, (unsigned int)old_value);
+#endif /*__DEBUG__ */
+
+	if((errno = check_user_area(VERIFY_READ, new_value, sizeof(struct itimerspec)))) {
+		return errno;
+	}
+	ts = &new_value->it_value;
+	if(ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000L) {
+		return -EINVAL;
+	}
+	ts = &new_value->it_interval;
+	if(ts->tv_sec < 0 || ts->tv_nsec < 0 || ts->tv_nsec >= 1000000000L) {
+		return -EINVAL;
+	}
+	if(old_value) {
+		if((errno = check_user_area(VERIFY_WRITE, old_value, sizeof(struct itimerspec)))) {
+			return errno;
+		}
+	}
+	return ptimer_settime(timerid, flags, new_value, old_value);
+}
@@ -10,6 +10,7 @@
 #include <fiwix/filesystems.h>
 #include <fiwix/stat.h>
 #include <fiwix/sleep.h>
+#include <fiwix/process.h>
 #include <fiwix/devices.h>
 #include <fiwix/buffer.h>
 #include <fiwix/errno.h>
@@ -76,6 +77,8 @@ int sys_umount2(const char *target, int flags)
 	iput(i_target);
 	free_name(tmp_target);
 
+	/* the dynamic loaders kept in memory must not keep it busy */
+	release_resident_interp(dev);
 	if(check_fs_busy(dev, sb->root)) {
 		return -EBUSY;
 	}
@@ -0,0 +1,35 @@
+/*
+ * fiwix/kernel/syscalls/vfork.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/types.h>
+#include <fiwix/segments.h>
+#include <fiwix/sigcontext.h>
+#include <fiwix/process.h>
+#include <fiwix/syscalls.h>
+#include <fiwix/string.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#endif /*__DEBUG__ */
+
+/*
+ * The child borrows the address space instead of copying the page tables,
+ * so it must only call execve() or _exit(). This is what the C library
+ * needs to implement posix_spawn() cheaply in large processes.
+ */
+#ifdef CONFIG_SYSCALL_6TH_ARG
+int sys_vfork(int arg1, int arg2, int arg3, int arg4, int arg5, int arg6, struct sigcontext *sc)
+#else
+int sys_vfork(int arg1, int arg2, int arg3, int arg4, int arg5, struct sigcontext *sc)
+#endif /* CONFIG_SYSCALL_6TH_ARG */
+{
+#ifdef __DEBUG__
+	printk("(pid %d) sys_vfork()\n", current->pid);
+#endif /*__DEBUG__ */
+
+	return do_fork(CLONE_VM | CLONE_VFORK | SIGCHLD, 0, NULL, NULL, NULL, sc);
+}
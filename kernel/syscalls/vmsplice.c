@@ -0,0 +1,51 @@
+/*
+ * fiwix/kernel/syscalls/vmsplice.c
+ *
+ * Copyright 2018-2023, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/fs.h>
+#include <fiwix/filesystems.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/stat.h>
+#include <fiwix/errno.h>
+
+#ifdef __DEBUG__
+#include <fiwix/stdio.h>
+#include <fiwix/process.h>
+#endif /*__DEBUG__ */
+
+int sys_vmsplice(int ufd, const struct iovec *iov, unsigned int nr_segs, unsigned int flags)
+{
+	struct fd *f;
+	unsigned int n;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sys_vmsplice(%d, 0x%08x, %d, 0x%x)\n", current->pid, ufd, iov, nr_segs, flags);
+#endif /*__DEBUG__ */
+
+	CHECK_UFD(ufd);
+	f = &fd_table[current->files->fd[ufd]];
+	if(!S_ISFIFO(f->inode->i_mode)) {
+		return -EBADF;
+	}
+	if(nr_segs > UIO_MAXIOV) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_READ, iov, sizeof(struct iovec) * nr_segs))) {
+		return errno;
+	}
+	for(n = 0; n < nr_segs; n++) {
+		if((f->flags & O_ACCMODE) == O_RDONLY) {
+			errno = check_user_area(VERIFY_WRITE, iov[n].iov_base, iov[n].iov_len);
+		} else {
+			errno = check_user_area(VERIFY_READ, iov[n].iov_base, iov[n].iov_len);
+		}
+		if(errno) {
+			return errno;
+		}
+	}
+	return pipefs_vmsplice(f, iov, nr_segs, flags);
+}
@@ -35,7 +35,8 @@ int sys_wait4(__pid_t pid, int *status, int options, struct rusage *ru)
 	while(current->children) {
 		flag = 0;
 		FOR_EACH_PROCESS(p) {
-			if(p->ppid != current) {
+			/* only the thread group leaders are waited for */
+			if(p->ppid != current || !TG_LEADER(p)) {
 				p = p->next;
 				continue;
 			}
@@ -72,7 +73,7 @@ int sys_wait4(__pid_t pid, int *status, int options, struct rusage *ru)
 					}
 					return p->pid;
 				}
-				if(p->state == PROC_ZOMBIE) {
+				if(p->state == PROC_ZOMBIE && !has_live_threads(p)) {
 					add_rusage(p);
 					if(status) {
 						*status = p->exit_code;
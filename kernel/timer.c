@@ -19,6 +19,8 @@
 #include <fiwix/signal.h>
 #include <fiwix/process.h>
 #include <fiwix/sleep.h>
+#include <fiwix/vdso.h>
+#include <fiwix/ptimer.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
@@ -181,6 +183,7 @@ void irq_timer(int num, struct sigcontext *sc)
 		CURRENT_TIME++;
 		kstat.uptime++;
 	}
+	vdso_update();
 
 	timer_bh.flags |= BH_ACTIVE;
 }
@@ -196,6 +199,152 @@ void ticks2tv(int ticks, struct timeval *tv)
 	tv->tv_usec = (ticks % HZ) * 1000000 / HZ;
 }
 
+unsigned int ts2ticks(const struct timespec *ts)
+{
+	return (ts->tv_sec * HZ) + ((unsigned int)ts->tv_nsec + (1000000000 / HZ) - 1) / (1000000000 / HZ);
+}
+
+void ticks2ts(int ticks, struct timespec *ts)
+{
+	ts->tv_sec = ticks / HZ;
+	ts->tv_nsec = (ticks % HZ) * (1000000000 / HZ);
+}
+
+void ts_sub(struct timespec *ts, const struct timespec *sub)
+{
+	ts->tv_sec -= sub->tv_sec;
+	ts->tv_nsec -= sub->tv_nsec;
+	if(ts->tv_nsec < 0) {
+		ts->tv_nsec += 1000000000;
+		ts->tv_sec--;
+	}
+}
+
+/*
+ * Returns the nanoseconds elapsed since the last tick. The TSC is used if the
+ * vDSO uses it, so that both always agree, otherwise the PIT counter is read.
+ * It must be called with interrupts disabled.
+ */
+static unsigned int get_tick_offset(void)
+{
+	if(vdso_uses_tsc()) {
+		return vdso_tick_offset();
+	}
+	return gettimeoffset() * 1000;
+}
+
+/*
+ * Returns the number of ticks of 'current->timeout' needed to wait at least
+ * the time in 'ts', taking into account the part of the current tick that
+ * has already elapsed.
+ */
+unsigned int timeout_ticks(const struct timespec *ts)
+{
+	struct timespec tmp;
+	unsigned int flags;
+
+	tmp = *ts;
+	SAVE_FLAGS(flags); CLI();
+	tmp.tv_nsec += get_tick_offset();
+	RESTORE_FLAGS(flags);
+	return ts2ticks(&tmp);
+}
+
+/* the opposite of timeout_ticks() */
+void timeout_ts(unsigned int ticks, struct timespec *ts)
+{
+	struct timespec tmp;
+	unsigned int flags;
+
+	ticks2ts(ticks, ts);
+	tmp.tv_sec = 0;
+	SAVE_FLAGS(flags); CLI();
+	tmp.tv_nsec = get_tick_offset();
+	RESTORE_FLAGS(flags);
+	ts_sub(ts, &tmp);
+	if(ts->tv_sec < 0) {
+		ts->tv_sec = ts->tv_nsec = 0;
+	}
+}
+
+static void add_cputime(struct proc *p, struct timespec *ts)
+{
+	ts->tv_sec += p->usage.ru_utime.tv_sec + p->usage.ru_stime.tv_sec;
+	ts->tv_nsec += (p->usage.ru_utime.tv_usec + p->usage.ru_stime.tv_usec) * 1000;
+	while(ts->tv_nsec >= 1000000000) {
+		ts->tv_nsec -= 1000000000;
+		ts->tv_sec++;
+	}
+}
+
+/*
+ * Reads a clock with sub-tick precision. The CPU-time clocks are only as
+ * precise as the tick accounting. CLOCK_MONOTONIC never goes backwards, not
+ * even when the tick that wrapped the PIT counter is still pending.
+ */
+int do_clock_gettime(__clockid_t clock, struct timespec *ts)
+{
+	static struct timespec last;
+	unsigned int flags, nsec;
+	struct proc *p;
+
+	switch(clock) {
+		case CLOCK_REALTIME:
+		case CLOCK_MONOTONIC:
+			SAVE_FLAGS(flags); CLI();
+			ts->tv_sec = clock == CLOCK_REALTIME ? CURRENT_TIME : kstat.uptime;
+			nsec = (kstat.ticks % HZ) * (1000000000 / HZ);
+			nsec += get_tick_offset();
+			if(nsec >= 1000000000) {
+				nsec -= 1000000000;
+				ts->tv_sec++;
+			}
+			ts->tv_nsec = nsec;
+			if(clock == CLOCK_MONOTONIC) {
+				if(ts->tv_sec < last.tv_sec || (ts->tv_sec == last.tv_sec && ts->tv_nsec < last.tv_nsec)) {
+					*ts = last;
+				}
+				last = *ts;
+			}
+			RESTORE_FLAGS(flags);
+			break;
+		case CLOCK_PROCESS_CPUTIME_ID:
+			ts->tv_sec = ts->tv_nsec = 0;
+			FOR_EACH_PROCESS(p) {
+				if(p->tgid == current->tgid) {
+					add_cputime(p, ts);
+				}
+				p = p->next;
+			}
+			break;
+		case CLOCK_THREAD_CPUTIME_ID:
+			ts->tv_sec = ts->tv_nsec = 0;
+			add_cputime(current, ts);
+			break;
+		default:
+			return -EINVAL;
+	}
+	return 0;
+}
+
+int do_clock_getres(__clockid_t clock, struct timespec *ts)
+{
+	ts->tv_sec = 0;
+	switch(clock) {
+		case CLOCK_REALTIME:
+		case CLOCK_MONOTONIC:
+			ts->tv_nsec = vdso_uses_tsc() ? 1 : 1000;
+			break;
+		case CLOCK_PROCESS_CPUTIME_ID:
+		case CLOCK_THREAD_CPUTIME_ID:
+			ts->tv_nsec = 1000000000 / HZ;
+			break;
+		default:
+			return -EINVAL;
+	}
+	return 0;
+}
+
 int setitimer(int which, const struct itimerval *new_value, struct itimerval *old_value)
 {
 	switch(which) {
@@ -255,10 +404,12 @@ unsigned int mktime(struct mt *mt)
 	return seconds;
 }
 
-void irq_timer_bh(struct sigcontext *sc)
+/*
+ * Charges the tick to the process running in this CPU. The BSP does it from
+ * the timer bottom half, the rest of the CPUs from their local APIC timer.
+ */
+void account_process_tick(struct sigcontext *sc)
 {
-	struct proc *p;
-
 	if(sc->cs == KERNEL_CS) {
 		current->usage.ru_stime.tv_usec += TICK;
 		if(current->usage.ru_stime.tv_usec >= 1000000) {
@@ -298,6 +449,20 @@ void irq_timer_bh(struct sigcontext *sc)
 		}
 	}
 
+	account_ptimers();
+
+	if(current->pid > IDLE && --current->cpu_count <= 0) {
+		current->cpu_count = 0;
+		set_need_resched();
+	}
+}
+
+void irq_timer_bh(struct sigcontext *sc)
+{
+	struct proc *p;
+
+	account_process_tick(sc);
+
 	calc_load();
 	FOR_EACH_PROCESS(p) {
 		if(p->timeout > 0 && p->timeout < INFINITE_WAIT) {
@@ -315,6 +480,7 @@ void irq_timer_bh(struct sigcontext *sc)
 		}
 		p = p->next;
 	}
+	run_ptimers();
 
 	/* callouts */
 	if(callout_head) {
@@ -328,11 +494,6 @@ void irq_timer_bh(struct sigcontext *sc)
 			callouts_bh.flags |= BH_ACTIVE;
 		}
 	}
-
-	if(current->pid > IDLE && --current->cpu_count <= 0) {
-		current->cpu_count = 0;
-		need_resched = 1;
-	}
 }
 
 void do_callouts_bh(struct sigcontext *sc)
@@ -426,6 +587,7 @@ void set_system_time(__time_t t)
 	cmos_write_date(CMOS_CENTURY, (y - (y % 100)) / 100);
 
 	CURRENT_TIME = t;
+	vdso_update();
 }
 
 int gettimeoffset(void)
@@ -0,0 +1,324 @@
+/*
+ * fiwix/kernel/vdso.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/asm.h>
+#include <fiwix/kernel.h>
+#include <fiwix/types.h>
+#include <fiwix/errno.h>
+#include <fiwix/segments.h>
+#include <fiwix/sigcontext.h>
+#include <fiwix/process.h>
+#include <fiwix/cpu.h>
+#include <fiwix/fs.h>
+#include <fiwix/i386elf.h>
+#include <fiwix/mm.h>
+#include <fiwix/mman.h>
+#include <fiwix/timer.h>
+#include <fiwix/vdso.h>
+#include <fiwix/stddef.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#define NR_VDSO_SYMS	5
+#define VDSO_SONAME	"linux-gate.so.1"
+
+/*
+ * The vDSO is a tiny shared object built here at boot time, with just the
+ * dynamic information that the dynamic loader needs to find its symbols.
+ * The code is copied from core386.S right after these tables.
+ */
+struct vdso_image {
+	Elf32_Ehdr ehdr;
+	Elf32_Phdr phdr[2];
+	unsigned int hash[3 + NR_VDSO_SYMS];	/* nbucket, nchain, bucket, chain */
+	Elf32_Sym sym[NR_VDSO_SYMS];
+	Elf32_Dyn dyn[7];
+	char str[128];
+};
+
+static const char *vdso_names[NR_VDSO_SYMS] = {
+	"",
+	"__kernel_vsyscall",
+	"__vdso_clock_gettime",
+	"__vdso_gettimeofday",
+	"__vdso_time",
+};
+
+static unsigned int vdso_page;
+static unsigned int vvar_page;
+static struct vdso_data *vdso_data;
+
+/* user address of __kernel_vsyscall */
+unsigned int vsyscall_entry;
+
+/* user address where 'sysenter' returns, or 0 if it's not used */
+unsigned int sysenter_return;
+
+#ifndef CONFIG_SMP
+/*
+ * Returns the nanoseconds per TSC cycle shifted left by VDSO_TSC_SHIFT, that
+ * is (1000000 << VDSO_TSC_SHIFT) / khz, without 64-bit divisions.
+ */
+static unsigned int get_tsc_mult(unsigned int khz)
+{
+	unsigned int q, r;
+	int n;
+
+	q = 1000000 / khz;
+	r = 1000000 % khz;
+	for(n = 0; n < VDSO_TSC_SHIFT; n++) {
+		q <<= 1;
+		r <<= 1;
+		if(r >= khz) {
+			r -= khz;
+			q |= 1;
+		}
+	}
+	return q;
+}
+#endif /* !CONFIG_SMP */
+
+/* copies a block of code into the vDSO and returns its offset */
+static unsigned int copy_code(unsigned int *offset, unsigned int start, unsigned int end)
+{
+	unsigned int n;
+
+	n = *offset;
+	if(n + (end - start) > PAGE_SIZE) {
+		PANIC("%s(): the vDSO doesn't fit in one page.\n", __FUNCTION__);
+	}
+	memcpy_b((void *)(vdso_page + n), (void *)start, end - start);
+	*offset = (n + (end - start) + 15) & ~15;
+	return n;
+}
+
+static void build_vdso(unsigned int start, unsigned int end)
+{
+	struct vdso_image *img;
+	unsigned int offset, text, value[NR_VDSO_SYMS];
+	int n, len, soname;
+
+	img = (struct vdso_image *)vdso_page;
+	offset = (sizeof(struct vdso_image) + 15) & ~15;
+	text = copy_code(&offset, (unsigned int)vdso_text, (unsigned int)end_vdso_text);
+	value[0] = 0;
+	value[1] = copy_code(&offset, start, end);
+	value[2] = text + ((unsigned int)vdso_clock_gettime - (unsigned int)vdso_text);
+	value[3] = text + ((unsigned int)vdso_gettimeofday - (unsigned int)vdso_text);
+	value[4] = text + ((unsigned int)vdso_time - (unsigned int)vdso_text);
+	vsyscall_entry = VDSO_ADDR + value[1];
+	if(start == (unsigned int)vsyscall_sysenter) {
+		sysenter_return = vsyscall_entry + ((unsigned int)vsyscall_sysenter_return - start);
+	}
+
+	/* all symbols are chained in a single hash bucket */
+	img->hash[0] = 1;
+	img->hash[1] = NR_VDSO_SYMS;
+	img->hash[2] = 1;
+	len = 1;
+	for(n = 1; n < NR_VDSO_SYMS; n++) {
+		img->hash[3 + n] = n + 1 < NR_VDSO_SYMS ? n + 1 : 0;
+		img->sym[n].st_name = len;
+		img->sym[n].st_value = value[n];
+		img->sym[n].st_info = (STB_GLOBAL << 4) | STT_FUNC;
+		img->sym[n].st_shndx = 1;	/* defined, not SHN_UNDEF */
+		strcpy(img->str + len, vdso_names[n]);
+		len += strlen(vdso_names[n]) + 1;
+	}
+	soname = len;
+	strcpy(img->str + len, VDSO_SONAME);
+	len += strlen(VDSO_SONAME) + 1;
+
+	/* the addresses are relative to the load address of the vDSO */
+	img->dyn[0].d_tag = DT_HASH;
+	img->dyn[0].d_un.d_ptr = offsetof(struct vdso_image, hash);
+	img->dyn[1].d_tag = DT_STRTAB;
+	img->dyn[1].d_un.d_ptr = offsetof(struct vdso_image, str);
+	img->dyn[2].d_tag = DT_SYMTAB;
+	img->dyn[2].d_un.d_ptr = offsetof(struct vdso_image, sym);
+	img->dyn[3].d_tag = DT_STRSZ;
+	img->dyn[3].d_un.d_val = len;
+	img->dyn[4].d_tag = DT_SYMENT;
+	img->dyn[4].d_un.d_val = sizeof(Elf32_Sym);
+	img->dyn[5].d_tag = DT_SONAME;
+	img->dyn[5].d_un.d_val = soname;
+	img->dyn[6].d_tag = DT_NULL;
+
+	memcpy_b(img->ehdr.e_ident, ELFMAG, SELFMAG);
+	img->ehdr.e_ident[EI_CLASS] = ELFCLASS32;
+	img->ehdr.e_ident[EI_DATA] = ELFDATA2LSB;
+	img->ehdr.e_ident[EI_VERSION] = EV_CURRENT;
+	img->ehdr.e_type = ET_DYN;
+	img->ehdr.e_machine = EM_386;
+	img->ehdr.e_version = EV_CURRENT;
+	img->ehdr.e_phoff = offsetof(struct vdso_image, phdr);
+	img->ehdr.e_ehsize = sizeof(Elf32_Ehdr);
+	img->ehdr.e_phentsize = sizeof(Elf32_Phdr);
+	img->ehdr.e_phnum = 2;
+
+	img->phdr[0].p_type = PT_LOAD;
+	img->phdr[0].p_filesz = PAGE_SIZE;
+	img->phdr[0].p_memsz = PAGE_SIZE;
+	img->phdr[0].p_flags = PF_R | PF_X;
+	img->phdr[0].p_align = PAGE_SIZE;
+	img->phdr[1].p_type = PT_DYNAMIC;
+	img->phdr[1].p_offset = offsetof(struct vdso_image, dyn);
+	img->phdr[1].p_vaddr = offsetof(struct vdso_image, dyn);
+	img->phdr[1].p_paddr = offsetof(struct vdso_image, dyn);
+	img->phdr[1].p_filesz = sizeof(img->dyn);
+	img->phdr[1].p_memsz = sizeof(img->dyn);
+	img->phdr[1].p_flags = PF_R;
+	img->phdr[1].p_align = sizeof(unsigned int);
+}
+
+/*
+ * The vsyscall page enters with the user stack in %ebp and the original
+ * %ebp saved on top of it. It goes into the frame so that the 6th argument,
+ * the signal handlers and the restarted system calls see the real one.
+ */
+int sysenter_ebp(struct sigcontext *sc)
+{
+	if(check_user_area(VERIFY_READ, (void *)sc->oldesp, sizeof(unsigned int))) {
+		return 0;
+	}
+	return *(int *)sc->oldesp;
+}
+
+/*
+ * Each CPU has its own MSRs. The kernel stack changes with every process, so
+ * set_tss() updates MSR_SYSENTER_ESP at each context switch.
+ */
+void sysenter_init(void)
+{
+	if(sysenter_return) {
+		wrmsr(MSR_SYSENTER_CS, KERNEL_CS, 0);
+		wrmsr(MSR_SYSENTER_ESP, current->tss.esp0, 0);
+		wrmsr(MSR_SYSENTER_EIP, (unsigned int)sysenter_entry, 0);
+	}
+}
+
+/* called at every tick and whenever the system time is changed */
+void vdso_update(void)
+{
+	unsigned long long int tsc;
+	unsigned int flags;
+
+	if(!vdso_data) {
+		return;
+	}
+
+	SAVE_FLAGS(flags); CLI();
+	vdso_data->seq++;
+	BARRIER();
+	vdso_data->sec = CURRENT_TIME;
+	vdso_data->mono_sec = kstat.uptime;
+	vdso_data->nsec = (kstat.ticks % HZ) * vdso_data->tick_nsec;
+	if(vdso_data->tsc_mult) {
+		tsc = get_rdtsc();
+		vdso_data->tsc_low = (unsigned int)tsc;
+		vdso_data->tsc_high = (unsigned int)(tsc >> 32);
+	}
+	vdso_data->tz_minuteswest = kstat.tz_minuteswest;
+	vdso_data->tz_dsttime = kstat.tz_dsttime;
+	BARRIER();
+	vdso_data->seq++;
+	RESTORE_FLAGS(flags);
+}
+
+/* returns whether the time is interpolated with the TSC between ticks */
+int vdso_uses_tsc(void)
+{
+	return vdso_data && vdso_data->tsc_mult;
+}
+
+/*
+ * Returns the nanoseconds elapsed since the last tick, computed from the TSC
+ * exactly as the vDSO does. It must be called with interrupts disabled.
+ */
+unsigned int vdso_tick_offset(void)
+{
+	unsigned long long int delta;
+
+	delta = get_rdtsc() - (((unsigned long long int)vdso_data->tsc_high << 32) | vdso_data->tsc_low);
+	if((long long int)delta < 0) {
+		return 0;
+	}
+	if(!(delta >> 32)) {
+		delta = (delta * vdso_data->tsc_mult) >> VDSO_TSC_SHIFT;
+		if(delta < vdso_data->tick_nsec) {
+			return (unsigned int)delta;
+		}
+	}
+	return vdso_data->tick_nsec - 1;
+}
+
+/* the same physical pages are shared (read-only) by all processes */
+int map_vdso(void)
+{
+	int errno;
+
+	errno = do_mmap(NULL, VVAR_ADDR, PAGE_SIZE, PROT_READ, MAP_PRIVATE | MAP_FIXED, 0, P_VDSO, 0, NULL);
+	if(errno < 0 && errno > -PAGE_SIZE) {
+		return errno;
+	}
+	errno = do_mmap(NULL, VDSO_ADDR, PAGE_SIZE, PROT_READ | PROT_EXEC, MAP_PRIVATE | MAP_FIXED, 0, P_VDSO, 0, NULL);
+	if(errno < 0 && errno > -PAGE_SIZE) {
+		do_munmap(VVAR_ADDR, PAGE_SIZE);
+		return errno;
+	}
+	if(!map_page_flags(current, VVAR_ADDR, V2P(vvar_page), PROT_READ, PAGE_NOALLOC)) {
+		do_munmap(VVAR_ADDR, PAGE_SIZE * 2);
+		return -ENOMEM;
+	}
+	current->rss++;
+	if(!map_page_flags(current, VDSO_ADDR, V2P(vdso_page), PROT_READ, PAGE_NOALLOC)) {
+		do_munmap(VVAR_ADDR, PAGE_SIZE * 2);
+		return -ENOMEM;
+	}
+	current->rss++;
+	return 0;
+}
+
+void vdso_init(void)
+{
+	unsigned int start, end;
+
+	if(!(vdso_page = kmalloc(PAGE_SIZE))) {
+		PANIC("%s(): unable to allocate the vDSO page.\n", __FUNCTION__);
+	}
+	if(!(vvar_page = kmalloc(PAGE_SIZE))) {
+		PANIC("%s(): unable to allocate the vvar page.\n", __FUNCTION__);
+	}
+	memset_b((void *)vdso_page, 0, PAGE_SIZE);
+	memset_b((void *)vvar_page, 0, PAGE_SIZE);
+
+	start = (unsigned int)vsyscall_int80;
+	end = (unsigned int)end_vsyscall_int80;
+
+	/* the first Pentium Pro models report SEP but don't implement it */
+	if(_cpuflags & CPU_SEP) {
+		if(cpu_table.family != 6 || cpu_table.model >= 3 || cpu_table.stepping >= 3) {
+			start = (unsigned int)vsyscall_sysenter;
+			end = (unsigned int)end_vsyscall_sysenter;
+		}
+	}
+	build_vdso(start, end);
+	sysenter_init();
+
+	vdso_data = (struct vdso_data *)vvar_page;
+	vdso_data->tick_nsec = 1000000000 / HZ;
+#ifndef CONFIG_SMP
+	/*
+	 * The TSCs of different processors are not guaranteed to be in sync,
+	 * so on SMP the vDSO always falls back to the system call.
+	 */
+	if((_cpuflags & CPU_TSC) && cpu_table.hz >= 1000000) {
+		vdso_data->tsc_mult = get_tsc_mult(cpu_table.hz / 1000);
+	}
+#endif /* !CONFIG_SMP */
+	vdso_update();
+}
@@ -20,6 +20,8 @@
 #include <fiwix/syscalls.h>
 #include <fiwix/shm.h>
 
+#define PREFAULT_BATCH	8	/* pages read in a single request group */
+
 /* send the SIGSEGV signal to the ofending process */
 static void send_sigsegv(struct sigcontext *sc)
 {
@@ -164,6 +166,101 @@ static int page_not_present(struct vma *vma, unsigned int cr2, struct sigcontext
 	return 0;
 }
 
+static int is_mapped(unsigned int addr)
+{
+	unsigned int *pgdir, *pgtbl;
+	int pde;
+
+	pgdir = (unsigned int *)P2V(current->tss.cr3);
+	pde = GET_PGDIR(addr);
+	if(!(pgdir[pde] & PAGE_PRESENT)) {
+		return 0;
+	}
+	pgtbl = (unsigned int *)P2V((pgdir[pde] & PAGE_MASK));
+	return pgtbl[GET_PGTBL(addr)] & PAGE_PRESENT;
+}
+
+/* reads the file data of 'nr' consecutive pages already mapped at 'addrs' */
+static void prefault_read(struct vma *vma, struct page **pgs, unsigned int *addrs, int nr)
+{
+	unsigned int file_offset;
+	int n;
+
+	if(!nr) {
+		return;
+	}
+	file_offset = (addrs[0] - vma->start + vma->offset) & PAGE_MASK;
+	if(bread_pages(pgs, nr, vma->inode, file_offset, vma->prot, vma->flags)) {
+		/* they will be demand-faulted later */
+		for(n = 0; n < nr; n++) {
+			if(pgs[n]->inode) {
+				remove_page_from_cache(pgs[n]);
+			}
+			unmap_page(addrs[n]);
+		}
+	}
+}
+
+/*
+ * Maps in advance the pages of the file-backed 'vma', so they won't be
+ * demand-faulted one by one. The pages found in the page cache are mapped
+ * directly, and only the first 'nr_read' pages not found there are read,
+ * in request groups of up to PREFAULT_BATCH consecutive pages.
+ */
+void prefault_vma(struct vma *vma, int nr_read)
+{
+	struct page *pgs[PREFAULT_BATCH], *pg;
+	unsigned int addrs[PREFAULT_BATCH];
+	unsigned int addr, vaddr, file_offset;
+	int n, cacheable;
+
+	if(!vma || !vma->inode || vma->prot == PROT_NONE) {
+		return;
+	}
+
+	/* the same pages that page_not_present() would take from the cache */
+	cacheable = !(vma->prot & PROT_WRITE) || vma->flags & MAP_SHARED;
+
+	n = 0;
+	for(addr = vma->start; addr < vma->end; addr += PAGE_SIZE) {
+		file_offset = (addr - vma->start + vma->offset) & PAGE_MASK;
+		if(file_offset >= vma->inode->i_size) {
+			break;
+		}
+		if(!is_mapped(addr)) {
+			if(cacheable && (pg = search_page_hash(vma->inode, file_offset))) {
+				prefault_read(vma, pgs, addrs, n);
+				n = 0;
+				if(!map_page(current, addr, (unsigned int)V2P(pg->data), vma->prot)) {
+					release_page(pg);
+					break;
+				}
+				/* wait in case it's still being read */
+				page_lock(pg);
+				page_unlock(pg);
+				continue;
+			}
+			if(nr_read > 0) {
+				if(!(vaddr = map_page(current, addr, 0, vma->prot))) {
+					break;
+				}
+				pgs[n] = &page_table[V2P(vaddr) >> PAGE_SHIFT];
+				addrs[n++] = addr;
+				nr_read--;
+				if(n < PREFAULT_BATCH) {
+					continue;
+				}
+			}
+		}
+		prefault_read(vma, pgs, addrs, n);
+		n = 0;
+		if(!cacheable && nr_read <= 0) {
+			break;
+		}
+	}
+	prefault_read(vma, pgs, addrs, n);
+}
+
 /*
  * Exception 0xE: Page Fault
  *
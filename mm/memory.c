@@ -15,9 +15,11 @@
 #include <fiwix/bios.h>
 #include <fiwix/ramdisk.h>
 #include <fiwix/process.h>
+#include <fiwix/sched.h>
 #include <fiwix/buffer.h>
 #include <fiwix/fs.h>
 #include <fiwix/kexec.h>
+#include <fiwix/smp.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
 
@@ -148,7 +150,7 @@ int clone_pages(struct proc *child)
 
 	src_pgdir = (unsigned int *)P2V(current->tss.cr3);
 	dst_pgdir = (unsigned int *)P2V(child->tss.cr3);
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 	pages = 0;
 
 	while(vma) {
@@ -159,6 +161,10 @@ int clone_pages(struct proc *child)
 		for(n = vma->start; n < vma->end; n += PAGE_SIZE) {
 			pde = GET_PGDIR(n);
 			pte = GET_PGTBL(n);
+			/* the VMAs can't change meanwhile if no thread shares them */
+			if(!pte && current->mm->count == 1) {
+				cond_resched();
+			}
 			if(src_pgdir[pde] & PAGE_PRESENT) {
 				src_pgtbl = (unsigned int *)P2V((src_pgdir[pde] & PAGE_MASK));
 				if(!(dst_pgdir[pde] & PAGE_PRESENT)) {
@@ -440,6 +446,11 @@ void mem_init(void)
 	}
 #endif /* CONFIG_KEXEC */
 
+#ifdef CONFIG_SMP
+	/* the APs start running in real mode from this page */
+	bios_map_reserve(SMP_TRAMPOLINE_ADDR, SMP_TRAMPOLINE_ADDR + PAGE_SIZE);
+#endif /* CONFIG_SMP */
+
 	/* the last one must be the page_table structure */
 	n = (kstat.physical_pages * PAGE_HASH_PER_10K) / 10000;
 	n = MAX(n, 1);	/* 1 page for the hash table as minimum */
@@ -12,6 +12,7 @@
 #include <fiwix/fcntl.h>
 #include <fiwix/stat.h>
 #include <fiwix/process.h>
+#include <fiwix/sched.h>
 #include <fiwix/mman.h>
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
@@ -30,7 +31,7 @@ void show_vma_regions(struct proc *p)
 	unsigned int n;
 	int count;
 
-	vma = p->vma_table;
+	vma = p->mm->vma_table;
 	n = 0;
 	printk("num  address range         flag offset     dev   inode      mod section cnt\n");
 	printk("---- --------------------- ---- ---------- ----- ---------- --- ------- ----\n");
@@ -59,6 +60,8 @@ void show_vma_regions(struct proc *p)
 					break;
 			case P_MMAP:	section = "mmap ";
 					break;
+			case P_VDSO:	section = "vdso ";
+					break;
 #ifdef CONFIG_SYSVIPC
 			case P_SHM:	section = "shm  ";
 					break;
@@ -88,7 +91,7 @@ static void insert_vma_region(struct vma *vma)
 {
 	struct vma *vmat;
 
-	vmat = current->vma_table;
+	vmat = current->mm->vma_table;
 
 	while(vmat) {
 		if(vmat->start > vma->start) {
@@ -99,16 +102,16 @@ static void insert_vma_region(struct vma *vma)
 
 	if(!vmat) {
 		/* append */
-		vma->prev = current->vma_table->prev;
-		current->vma_table->prev->next = vma;
-		current->vma_table->prev = vma;
+		vma->prev = current->mm->vma_table->prev;
+		current->mm->vma_table->prev->next = vma;
+		current->mm->vma_table->prev = vma;
 	} else {
 		/* insert */
 		vma->prev = vmat->prev;
 		vma->next = vmat;
-		if(vmat == current->vma_table) {
+		if(vmat == current->mm->vma_table) {
 			/* insert in the head */
-			current->vma_table = vma;
+			current->mm->vma_table = vma;
 		} else {
 			/* insert in the middle */
 			vmat->prev->next = vma;
@@ -126,9 +129,9 @@ static void add_vma_region(struct vma *vma)
 	unsigned int flags;
 
 	SAVE_FLAGS(flags); CLI();
-	if(!current->vma_table) {
-		current->vma_table = vma;
-		current->vma_table->prev = vma;
+	if(!current->mm->vma_table) {
+		current->mm->vma_table = vma;
+		current->mm->vma_table->prev = vma;
 	} else {
 		insert_vma_region(vma);
 	}
@@ -152,15 +155,15 @@ static void del_vma_region(struct vma *vma)
 		vma->next->prev = vma->prev;
 	}
 	if(vma->prev) {
-		if(vma != current->vma_table) {
+		if(vma != current->mm->vma_table) {
 			vma->prev->next = vma->next;
 		}
 	}
 	if(!vma->next) {
-		current->vma_table->prev = vma->prev;
+		current->mm->vma_table->prev = vma->prev;
 	}
-	if(vma == current->vma_table) {
-		current->vma_table = vma->next;
+	if(vma == current->mm->vma_table) {
+		current->mm->vma_table = vma->next;
 	}
 	RESTORE_FLAGS(flags);
 
@@ -321,13 +324,16 @@ void release_binary(void)
 {
 	struct vma *vma, *tmp;
 
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		tmp = vma->next;
 		free_vma_pages(vma, vma->start, vma->end - vma->start);
 		free_vma_region(vma, vma->start, vma->end - vma->start);
 		vma = tmp;
+		if(current->mm->count == 1) {
+			cond_resched();
+		}
 	}
 
 	invalidate_tlb();
@@ -342,7 +348,7 @@ struct vma *find_vma_region(unsigned int addr)
 	}
 
 	addr &= PAGE_MASK;
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		if((addr >= vma->start) && (addr < vma->end)) {
@@ -357,7 +363,7 @@ struct vma *find_vma_intersection(unsigned int start, unsigned int end)
 {
 	struct vma *vma;
 
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		if(end <= vma->start) {
@@ -375,7 +381,7 @@ int expand_heap(unsigned int new)
 {
 	struct vma *vma, *heap;
 
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 	heap = NULL;
 
 	while(vma) {
@@ -407,7 +413,7 @@ unsigned int get_unmapped_vma_region(unsigned int length)
 	}
 
 	addr = MMAP_START;
-	vma = current->vma_table;
+	vma = current->mm->vma_table;
 
 	while(vma) {
 		if(vma->start < MMAP_START) {
@@ -208,6 +208,46 @@ repeat:
 	return pg;
 }
 
+/*
+ * Takes 'nr' physically contiguous pages off the free list. This is only meant
+ * for the drivers that need to share with a device a structure bigger than a
+ * page, and the pages are released one by one with release_page().
+ */
+struct page *get_free_contig_pages(int nr)
+{
+	unsigned int flags;
+	struct page *pg;
+	int n, found;
+
+	SAVE_FLAGS(flags); CLI();
+
+	for(n = 0, found = 0; n < NR_PAGES && found < nr; n++) {
+		pg = &page_table[n];
+		if(pg->count || (pg->flags & PAGE_RESERVED) || !pg->data) {
+			found = 0;
+		} else {
+			found++;
+		}
+	}
+	if(found < nr) {
+		RESTORE_FLAGS(flags);
+		return NULL;
+	}
+
+	pg = &page_table[n - nr];
+	for(n = 0; n < nr; n++) {
+		remove_from_free_list(&pg[n]);
+		remove_from_hash(&pg[n]);
+		pg[n].count = 1;
+		pg[n].inode = 0;
+		pg[n].offset = 0;
+		pg[n].dev = 0;
+	}
+
+	RESTORE_FLAGS(flags);
+	return pg;
+}
+
 struct page *search_page_hash(struct inode *inode, __off_t offset)
 {
 	struct page *pg;
@@ -230,6 +270,31 @@ struct page *search_page_hash(struct inode *inode, __off_t offset)
 	return NULL;
 }
 
+/* makes 'pg' the page cache page of the file data at 'offset' */
+void add_page_to_cache(struct page *pg, struct inode *i, __off_t offset)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	pg->inode = i->inode;
+	pg->offset = offset;
+	pg->dev = i->dev;
+	insert_to_hash(pg);
+	RESTORE_FLAGS(flags);
+}
+
+void remove_page_from_cache(struct page *pg)
+{
+	unsigned int flags;
+
+	SAVE_FLAGS(flags); CLI();
+	remove_from_hash(pg);
+	pg->inode = 0;
+	pg->offset = 0;
+	pg->dev = 0;
+	RESTORE_FLAGS(flags);
+}
+
 void release_page(struct page *pg)
 {
 	unsigned int flags;
@@ -292,7 +357,8 @@ void invalidate_inode_pages(struct inode *i)
 	}
 }
 
-void update_page_cache(struct inode *i, __off_t offset, const char *buf, int count)
+/* returns 1 if the page was present in the page cache */
+int update_page_cache(struct inode *i, __off_t offset, const char *buf, int count)
 {
 	__off_t poffset;
 	struct page *pg;
@@ -309,8 +375,10 @@ void update_page_cache(struct inode *i, __off_t offset, const char *buf, int cou
 			memcpy_b(pg->data + poffset, buf, bytes);
 			page_unlock(pg);
 			release_page(pg);
+			return 1;
 		}
 	}
+	return 0;
 }
 
 int write_page(struct page *pg, struct inode *i, __off_t offset, unsigned int length)
@@ -333,13 +401,42 @@ int write_page(struct page *pg, struct inode *i, __off_t offset, unsigned int le
 	return errno;
 }
 
-int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char flags)
+/*
+ * The file blocks not present in the buffer cache are read directly into the
+ * pages, so the file data is cached only once. Those already in the buffer
+ * cache are copied and then released from it. The 'nr' pages hold the file
+ * data from 'offset' onwards and all their blocks go in a single request
+ * group, so the block layer can merge them into a few large requests.
+ */
+int bread_pages(struct page **pgs, int nr, struct inode *i, __off_t offset, char prot, char flags)
 {
 	__blk_t block;
 	__off_t size_read;
-	int blksize, retval;
+	int blksize, retval, n, cached;
 	struct device *d;
 	struct blk_request brh, *br, *tmp;
+	struct buffer local_pbuf[PAGE_SIZE / BLKSIZE_1K], *pbuf;
+	struct page *pg, *tmp_pg;
+	char *data;
+
+	/*
+	 * Filesystems without a backing device keep all their data in the
+	 * page cache, so a page not found there is a page full of zeros.
+	 */
+	if(i->sb && i->sb->fsop->flags & FSOP_NO_BACKING) {
+		for(n = 0; n < nr; n++) {
+			pg = pgs[n];
+			page_lock(pg);
+			if((tmp_pg = search_page_hash(i, offset + (n << PAGE_SHIFT)))) {
+				memcpy_b(pg->data, tmp_pg->data, PAGE_SIZE);
+				release_page(tmp_pg);
+			} else {
+				memset_b(pg->data, 0, PAGE_SIZE);
+			}
+			page_unlock(pg);
+		}
+		return 0;
+	}
 
 	blksize = i->sb->s_blocksize;
 	retval = size_read = 0;
@@ -350,35 +447,56 @@ int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char
 		return 1;
 	}
 
+	/* a single page is the common case and fits in the stack */
+	pbuf = local_pbuf;
+	if(nr > 1) {
+		if(!(pbuf = (struct buffer *)kmalloc(nr * (PAGE_SIZE / BLKSIZE_1K) * sizeof(struct buffer)))) {
+			return 1;
+		}
+	}
+
 	memset_b(&brh, 0, sizeof(struct blk_request));
-	page_lock(pg);
+	for(n = 0; n < nr; n++) {
+		pg = pgs[n];
+		page_lock(pg);
 
-	/* cache any read-only or public (shared) pages */
-	if(!(prot & PROT_WRITE) || flags & MAP_SHARED) {
-		pg->inode = i->inode;
-		pg->offset = offset;
-		pg->dev = i->dev;
-		insert_to_hash(pg);
+		/* cache any read-only or public (shared) pages */
+		if(!(prot & PROT_WRITE) || flags & MAP_SHARED) {
+			pg->inode = i->inode;
+			pg->offset = offset + (n << PAGE_SHIFT);
+			pg->dev = i->dev;
+			insert_to_hash(pg);
+		}
 	}
 
-	while(size_read < PAGE_SIZE) {
+	for(n = 0; size_read < (nr << PAGE_SHIFT); n++) {
 		if(!(br = (struct blk_request *)kmalloc(sizeof(struct blk_request)))) {
 			printk("WARNING: %s(): no more free memory for block requests.\n", __FUNCTION__);
 			retval = 1;
 			break;
 		}
 		if((block = bmap(i, offset + size_read, FOR_READING)) < 0) {
+			kfree((unsigned int)br);
 			retval = 1;
 			break;
 		}
 		memset_b(br, 0, sizeof(struct blk_request));
 		br->dev = i->dev;
 		br->block = block;
-		br->flags = block ? 0 : BRF_NOBLOCK;
+		br->flags = block ? BRF_NOCACHE : BRF_NOBLOCK;
 		br->size = blksize;
 		br->device = d;
 		br->fn = d->fsop->read_block;
 		br->head_group = &brh;
+		if(block) {
+			/* a private buffer that points into the page */
+			memset_b(&pbuf[n], 0, sizeof(struct buffer));
+			pbuf[n].dev = i->dev;
+			pbuf[n].block = block;
+			pbuf[n].size = blksize;
+			pbuf[n].data = pgs[size_read >> PAGE_SHIFT]->data + (size_read & ~PAGE_MASK);
+			br->buffer = &pbuf[n];
+		}
 		if(!brh.next_group) {
 			brh.next_group = br;
 		} else {
@@ -398,34 +516,73 @@ int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char
 	retval = retval < 0 ? retval : 0;
 	br = brh.next_group;
 	size_read = 0;
-	while(br) {
+	for(n = 0; br; n++) {
+		cached = br->block && br->buffer != &pbuf[n];
 		if(!retval) {
-			if(br->block) {
-				memcpy_b(pg->data + size_read, br->buffer->data, br->size);
-				br->buffer->flags |= BUFFER_VALID;
-			} else {
+			data = pgs[size_read >> PAGE_SHIFT]->data + (size_read & ~PAGE_MASK);
+			if(!br->block) {
 				/* fill the hole with zeros */
-				memset_b(pg->data + size_read, 0, br->size);
+				memset_b(data, 0, br->size);
+			} else if(cached) {
+				memcpy_b(data, br->buffer->data, br->size);
+				br->buffer->flags |= BUFFER_VALID;
 			}
 			size_read += br->size;
 		}
-		if(br->block) {
-			brelse(br->buffer);
+		if(cached) {
+			if(pgs[0]->inode) {
+				bforget(br->buffer);
+			} else {
+				brelse(br->buffer);
+			}
 		}
 		tmp = br->next_group;
 		kfree((unsigned int)br);
 		br = tmp;
 	}
 
-	page_unlock(pg);
+	for(n = 0; n < nr; n++) {
+		page_unlock(pgs[n]);
+	}
+	if(pbuf != local_pbuf) {
+		kfree((unsigned int)pbuf);
+	}
 	return retval;
 }
 
+int bread_page(struct page *pg, struct inode *i, __off_t offset, char prot, char flags)
+{
+	return bread_pages(&pg, 1, i, offset, prot, flags);
+}
+
+/*
+ * Returns in 'pg' the page cache page holding the file data at 'offset'
+ * (page aligned), reading it if needed. The caller gets a reference to it.
+ */
+int get_file_page(struct inode *i, __off_t offset, struct page **pg)
+{
+	unsigned int addr;
+
+	if((*pg = search_page_hash(i, offset))) {
+		return 0;
+	}
+	if(!(addr = kmalloc(PAGE_SIZE))) {
+		return -ENOMEM;
+	}
+	*pg = &page_table[V2P(addr) >> PAGE_SHIFT];
+	if(bread_page(*pg, i, offset, 0, MAP_SHARED)) {
+		kfree(addr);
+		return -EIO;
+	}
+	return 0;
+}
+
 int file_read(struct inode *i, struct fd *f, char *buffer, __size_t count)
 {
 	__size_t total_read;
-	unsigned int addr, poffset, bytes;
+	unsigned int poffset, bytes;
 	struct page *pg;
+	int errno;
 
 	inode_lock(i);
 
@@ -442,21 +599,10 @@ int file_read(struct inode *i, struct fd *f, char *buffer, __size_t count)
 		}
 
 		poffset = f->offset & (PAGE_SIZE - 1);	/* mod PAGE_SIZE */
-		if(!(pg = search_page_hash(i, f->offset & PAGE_MASK))) {
-			if(!(addr = kmalloc(PAGE_SIZE))) {
-				inode_unlock(i);
-				printk("%s(): returning -ENOMEM\n", __FUNCTION__);
-				return -ENOMEM;
-			}
-			pg = &page_table[V2P(addr) >> PAGE_SHIFT];
-			if(bread_page(pg, i, f->offset & PAGE_MASK, 0, MAP_SHARED)) {
-				kfree(addr);
-				inode_unlock(i);
-				printk("%s(): returning -EIO\n", __FUNCTION__);
-				return -EIO;
-			}
-		} else {
-			addr = (unsigned int)pg->data;
+		if((errno = get_file_page(i, f->offset & PAGE_MASK, &pg))) {
+			inode_unlock(i);
+			printk("%s(): returning %d\n", __FUNCTION__, errno);
+			return errno;
 		}
 
 		page_lock(pg);
@@ -466,14 +612,85 @@ int file_read(struct inode *i, struct fd *f, char *buffer, __size_t count)
 		total_read += bytes;
 		count -= bytes;
 		f->offset += bytes;
-		kfree(addr);
 		page_unlock(pg);
+		release_page(pg);
 	}
 
 	inode_unlock(i);
 	return total_read;
 }
 
+/*
+ * Sends 'count' bytes of the file 'in', starting at '*ppos', to the file 'out'
+ * by passing the page cache pages straight to its write operation. Files not
+ * using the page cache are read into a temporary kernel page instead.
+ */
+int do_sendfile(struct fd *in, struct fd *out, __loff_t *ppos, __size_t count)
+{
+	struct inode *i, *o;
+	struct page *pg;
+	struct fd fdt;
+	unsigned int addr, poffset, bytes;
+	int total, errno;
+
+	i = in->inode;
+	o = out->inode;
+	if(!i->fsop || !i->fsop->read || !o->fsop || !o->fsop->write) {
+		return -EINVAL;
+	}
+
+	total = errno = 0;
+	addr = 0;
+	while(count) {
+		if(i->fsop->read == file_read) {
+			inode_lock(i);
+			if(*ppos >= i->i_size) {
+				inode_unlock(i);
+				break;
+			}
+			poffset = *ppos & (PAGE_SIZE - 1);	/* mod PAGE_SIZE */
+			bytes = PAGE_SIZE - poffset;
+			bytes = MIN(bytes, count);
+			bytes = MIN(bytes, i->i_size - *ppos);
+			errno = get_file_page(i, *ppos & PAGE_MASK, &pg);
+			inode_unlock(i);
+			if(errno) {
+				break;
+			}
+			errno = o->fsop->write(o, out, pg->data + poffset, bytes);
+			release_page(pg);
+		} else {
+			if(!addr && !(addr = kmalloc(PAGE_SIZE))) {
+				errno = -ENOMEM;
+				break;
+			}
+			fdt = *in;
+			fdt.offset = *ppos;
+			if((errno = i->fsop->read(i, &fdt, (char *)addr, MIN(count, PAGE_SIZE))) <= 0) {
+				break;
+			}
+			bytes = errno;
+			errno = o->fsop->write(o, out, (char *)addr, bytes);
+		}
+		if(errno > 0) {
+			*ppos += errno;
+			total += errno;
+			count -= errno;
+		}
+		if(errno < (int)bytes) {
+			break;
+		}
+	}
+
+	if(addr) {
+		kfree(addr);
+	}
+	if(total) {
+		return total;
+	}
+	return errno < 0 ? errno : 0;
+}
+
 void reserve_pages(unsigned int from, unsigned int to)
 {
 	struct page *pg;
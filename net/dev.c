@@ -0,0 +1,71 @@
+/*
+ * fiwix/net/dev.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/config.h>
+#include <fiwix/errno.h>
+#include <fiwix/net/device.h>
+#include <fiwix/stdio.h>
+#include <fiwix/string.h>
+
+#ifdef CONFIG_NET
+struct net_device *net_device_head;
+
+struct net_device loopback_dev = {
+	"lo",
+	IFF_UP | IFF_LOOPBACK,
+	65536,
+};
+
+void register_netdevice(struct net_device *dev)
+{
+	struct net_device *d;
+
+	dev->next = NULL;
+	if((d = net_device_head)) {
+		while(d->next) {
+			d = d->next;
+		}
+		d->next = dev;
+	} else {
+		net_device_head = dev;
+	}
+}
+
+/*
+ * Sends the frame 'buf' through the device 'dev'. If 'csum_start' is not
+ * NETIF_NO_CSUM the checksum of the data from that offset is still pending,
+ * and it must be stored at 'csum_start' + 'csum_offset'.
+ */
+int dev_queue_xmit(struct net_device *dev, const char *buf, int len, int csum_start, int csum_offset)
+{
+	if(!(dev->flags & IFF_UP) || !dev->xmit) {
+		dev->stats.tx_dropped++;
+		return -ENETDOWN;
+	}
+	if(len > dev->mtu + ETH_HLEN) {
+		dev->stats.tx_errors++;
+		return -EMSGSIZE;
+	}
+	if(csum_start != NETIF_NO_CSUM && !(dev->features & NETIF_F_HW_CSUM)) {
+		return -EOPNOTSUPP;
+	}
+	return dev->xmit(dev, buf, len, csum_start, csum_offset);
+}
+
+/*
+ * Entry point of the frames received by the network drivers. A non-zero
+ * 'csum_ok' means that the device has already verified their checksums.
+ * There is no link layer protocol attached to the devices yet, so frames are
+ * only accounted and then discarded.
+ */
+void netif_rx(struct net_device *dev, const char *buf, int len, int csum_ok)
+{
+	dev->stats.rx_packets++;
+	dev->stats.rx_bytes += len;
+	dev->stats.rx_dropped++;
+}
+#endif /* CONFIG_NET */
@@ -7,13 +7,17 @@
 
 #include <fiwix/config.h>
 #include <fiwix/errno.h>
+#include <fiwix/fs.h>
 #include <fiwix/net.h>
 #include <fiwix/socket.h>
 #include <fiwix/stdio.h>
+#include <fiwix/string.h>
+#include <fiwix/virtio_net.h>
 
 #ifdef CONFIG_NET
 struct domain_table domains[] = {
         { AF_UNIX, "AF_UNIX", &unix_ops },
+        { AF_INET, "AF_INET", &inet_ops },
         { 0, 0, 0 }
 };
 
@@ -29,6 +33,8 @@ struct proto_ops unix_ops = {
 	unix_recv,
 	unix_sendto,
 	unix_recvfrom,
+	unix_sendmsg,
+	unix_recvmsg,
 	unix_read,
 	unix_write,
 	unix_select,
@@ -38,6 +44,29 @@ struct proto_ops unix_ops = {
         unix_init,
 };
 
+struct proto_ops inet_ops = {
+	inet_create,
+	inet_free,
+	inet_bind,
+	inet_connect,
+	inet_accept,
+	inet_getname,
+	NULL,		/* socketpair */
+	inet_send,
+	inet_recv,
+	inet_sendto,
+	inet_recvfrom,
+	inet_sendmsg,
+	inet_recvmsg,
+	inet_read,
+	inet_write,
+	inet_select,
+	inet_shutdown,
+	inet_setsockopt,
+	inet_getsockopt,
+	inet_init,
+};
+
 int assign_proto(struct socket *so, int domain)
 {
 	struct domain_table *d;
@@ -65,5 +94,11 @@ void net_init(void)
 		ops->init();
 		d++;
 	}
+
+#ifdef CONFIG_PCI
+#ifdef CONFIG_VIRTIO_NET
+	virtio_net_init();
+#endif /* CONFIG_VIRTIO_NET */
+#endif /* CONFIG_PCI */
 }
 #endif /* CONFIG_NET */
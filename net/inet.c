@@ -0,0 +1,1011 @@
+/*
+ * fiwix/net/inet.c
+ *
+ * Copyright 2024, Jordi Sanfeliu. All rights reserved.
+ * Distributed under the terms of the Fiwix License.
+ */
+
+#include <fiwix/config.h>
+#include <fiwix/asm.h>
+#include <fiwix/fs.h>
+#include <fiwix/errno.h>
+#include <fiwix/socket.h>
+#include <fiwix/net.h>
+#include <fiwix/net/inet.h>
+#include <fiwix/net/device.h>
+#include <fiwix/fcntl.h>
+#include <fiwix/sched.h>
+#include <fiwix/sleep.h>
+#include <fiwix/process.h>
+#include <fiwix/mm.h>
+#include <fiwix/string.h>
+#include <fiwix/stdio.h>
+
+/*
+ * This is an AF_INET stack for the loopback interface only. Since both ends
+ * of every conversation live in this kernel, there are no IP headers nor a
+ * TCP state machine on the wire: each segment or datagram is a packet that
+ * is copied once from the sender and queued straight into the receiving
+ * socket, where it's copied once more to the reader. A TCP sender can't
+ * have more bytes in flight than the free space in the receive buffer of
+ * its peer, which acts as the advertised window.
+ */
+
+#ifdef CONFIG_NET
+struct inet_info *inet_socket_head;
+
+static unsigned short int next_port = INET_PORT_FIRST;
+
+static void add_inet_socket(struct inet_info *in)
+{
+	struct inet_info *h;
+
+	if((h = inet_socket_head)) {
+		while(h->next) {
+			h = h->next;
+		}
+		h->next = in;
+	} else {
+		inet_socket_head = in;
+	}
+}
+
+static void remove_inet_socket(struct inet_info *in)
+{
+	struct inet_info *h;
+
+	if(inet_socket_head == in) {
+		inet_socket_head = in->next;
+		return;
+	}
+
+	h = inet_socket_head;
+	while(h && h->next != in) {
+		h = h->next;
+	}
+	if(h && h->next == in) {
+		h->next = in->next;
+	}
+}
+
+static int same_addr(unsigned int a, unsigned int b)
+{
+	return a == INADDR_ANY || b == INADDR_ANY || a == b;
+}
+
+static int port_in_use(struct inet_info *in, unsigned int addr, unsigned short int port)
+{
+	struct inet_info *h;
+
+	for(h = inet_socket_head; h; h = h->next) {
+		if(h == in || h->socket->type != in->socket->type) {
+			continue;
+		}
+		if(h->lport != port || !same_addr(h->laddr, addr)) {
+			continue;
+		}
+		/* SO_REUSEADDR allows to bind while nobody is listening */
+		if((in->options & INET_REUSEADDR) && !(h->socket->flags & SO_ACCEPTCONN)) {
+			continue;
+		}
+		return 1;
+	}
+	return 0;
+}
+
+static int autobind(struct inet_info *in)
+{
+	unsigned short int port;
+	int n;
+
+	for(n = INET_PORT_FIRST; n <= INET_PORT_LAST; n++) {
+		port = htons(next_port);
+		if(++next_port > INET_PORT_LAST) {
+			next_port = INET_PORT_FIRST;
+		}
+		if(!port_in_use(in, in->laddr, port)) {
+			in->lport = port;
+			return 0;
+		}
+	}
+	return -EADDRNOTAVAIL;
+}
+
+static struct inet_info *lookup_listener(unsigned int addr, unsigned short int port)
+{
+	struct inet_info *h;
+
+	for(h = inet_socket_head; h; h = h->next) {
+		if(h->socket->type != SOCK_STREAM || !(h->socket->flags & SO_ACCEPTCONN)) {
+			continue;
+		}
+		if(h->lport == port && same_addr(h->laddr, addr)) {
+			return h;
+		}
+	}
+	return NULL;
+}
+
+static struct inet_info *lookup_udp(unsigned int daddr, unsigned short int dport, unsigned int saddr, unsigned short int sport)
+{
+	struct inet_info *h;
+
+	for(h = inet_socket_head; h; h = h->next) {
+		if(h->socket->type != SOCK_DGRAM || h->lport != dport) {
+			continue;
+		}
+		if(!same_addr(h->laddr, daddr)) {
+			continue;
+		}
+		/* a connected socket only accepts datagrams from its peer */
+		if(h->fport && (h->fport != sport || h->faddr != saddr)) {
+			continue;
+		}
+		return h;
+	}
+	return NULL;
+}
+
+static int get_sockaddr(const struct sockaddr *addr, int addrlen, unsigned int *saddr, unsigned short int *port)
+{
+	struct sockaddr_in *sin;
+
+	sin = (struct sockaddr_in *)addr;
+	if(addrlen < sizeof(struct sockaddr_in)) {
+		return -EINVAL;
+	}
+	if(sin->sin_family != AF_INET) {
+		return -EAFNOSUPPORT;
+	}
+	*saddr = sin->sin_addr.s_addr;
+	*port = sin->sin_port;
+	return 0;
+}
+
+static void put_sockaddr(struct sockaddr_in *sin, unsigned int addr, unsigned short int port)
+{
+	memset_b(sin, 0, sizeof(struct sockaddr_in));
+	sin->sin_family = AF_INET;
+	sin->sin_addr.s_addr = addr;
+	sin->sin_port = port;
+}
+
+static void free_queue(struct packet **queue)
+{
+	struct packet *p;
+
+	while((p = remove_packet_from_queue(queue))) {
+		packet_free(p);
+	}
+}
+
+/* removes a connection not yet accepted from the queue of its listener */
+static void unlink_connection(struct socket *ss, struct socket *sc)
+{
+	unsigned int flags;
+	struct socket *s;
+
+	SAVE_FLAGS(flags); CLI();
+	if(ss->queue_head == sc) {
+		ss->queue_head = sc->next_queue;
+		ss->queue_len--;
+	} else {
+		for(s = ss->queue_head; s; s = s->next_queue) {
+			if(s->next_queue == sc) {
+				s->next_queue = sc->next_queue;
+				ss->queue_len--;
+				break;
+			}
+		}
+	}
+	RESTORE_FLAGS(flags);
+}
+
+static void delivered(int len)
+{
+	loopback_dev.stats.tx_packets++;
+	loopback_dev.stats.tx_bytes += len;
+	loopback_dev.stats.rx_packets++;
+	loopback_dev.stats.rx_bytes += len;
+}
+
+static int tcp_write(struct socket *s, struct fd *f, const char *buffer, __size_t count, int flags)
+{
+	struct inet_info *in, *up;
+	struct packet *p;
+	struct resource *lock;
+	struct packet **queue;
+	int *queued, room, n, errno, bytes_written;
+
+	in = &s->u.inet_info;
+	bytes_written = 0;
+
+	while(bytes_written < count) {
+		if(in->error) {
+			errno = in->error;
+			in->error = 0;
+			return bytes_written ? bytes_written : errno;
+		}
+		if(s->state != SS_CONNECTED || (in->shutdown & INET_SND_SHUTDOWN)) {
+			if(bytes_written) {
+				return bytes_written;
+			}
+			if(s->state == SS_CONNECTED || s->state == SS_DISCONNECTING) {
+				if(!(flags & MSG_NOSIGNAL)) {
+					send_sig(current, SIGPIPE);
+				}
+				return -EPIPE;
+			}
+			return -ENOTCONN;
+		}
+
+		/* until accepted, the data waits in the backlog of the sender */
+		if((up = in->peer)) {
+			lock = &up->lock;
+			queue = &up->packet_queue;
+			queued = &up->rcv_queued;
+			room = up->rcvbuf - up->rcv_queued;
+		} else {
+			lock = &in->lock;
+			queue = &in->backlog;
+			queued = &in->backlog_len;
+			room = in->sndbuf - in->backlog_len;
+		}
+		if(room <= 0) {
+			if(f->flags & O_NONBLOCK) {
+				return bytes_written ? bytes_written : -EAGAIN;
+			}
+			if(sleep(queued, PROC_INTERRUPTIBLE)) {
+				return bytes_written ? bytes_written : -EINTR;
+			}
+			continue;
+		}
+
+		n = MIN(count - bytes_written, room);
+		n = MIN(n, INET_MAX_SEGMENT);
+		if(!(p = packet_alloc(n))) {
+			return bytes_written ? bytes_written : -ENOMEM;
+		}
+		memcpy_b(p->data, buffer + bytes_written, n);
+		p->len = n;
+		lock_resource(lock);
+
+		/* the copy or the lock may have slept, the peer may be gone */
+		if(in->peer != up || s->state != SS_CONNECTED || (in->shutdown & INET_SND_SHUTDOWN)) {
+			unlock_resource(lock);
+			packet_free(p);
+			continue;
+		}
+		append_packet_to_queue(p, queue);
+		*queued += n;
+		unlock_resource(lock);
+		bytes_written += n;
+		delivered(n);
+		if(up) {
+			wakeup(up);
+			wakeup(&do_select);
+		}
+	}
+	return bytes_written;
+}
+
+static int tcp_read(struct socket *s, struct fd *f, char *buffer, __size_t count, int flags)
+{
+	struct inet_info *in;
+	struct packet *p;
+	int n, off, errno, bytes_read;
+
+	in = &s->u.inet_info;
+	for(;;) {
+		lock_resource(&in->lock);
+		if(in->packet_queue) {
+			break;
+		}
+		unlock_resource(&in->lock);
+		if(in->error) {
+			errno = in->error;
+			in->error = 0;
+			return errno;
+		}
+		if((in->shutdown & INET_RCV_SHUTDOWN) || s->state == SS_DISCONNECTING) {
+			return 0;
+		}
+		if(s->state != SS_CONNECTED) {
+			return -ENOTCONN;
+		}
+		if(f->flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		if(sleep(in, PROC_INTERRUPTIBLE)) {
+			return -EINTR;
+		}
+	}
+
+	bytes_read = 0;
+	p = in->packet_queue;
+	off = p->offset;
+	while(p && bytes_read < count) {
+		n = MIN(p->len - off, count - bytes_read);
+		memcpy_b(buffer + bytes_read, p->data + off, n);
+		bytes_read += n;
+		off += n;
+		if(off < p->len) {
+			break;
+		}
+		if(flags & MSG_PEEK) {
+			p = p->next;
+		} else {
+			packet_free(remove_packet_from_queue(&in->packet_queue));
+			p = in->packet_queue;
+		}
+		off = p ? p->offset : 0;
+	}
+	if(flags & MSG_PEEK) {
+		unlock_resource(&in->lock);
+		return bytes_read;
+	}
+	if(p) {
+		p->offset = off;
+	}
+	in->rcv_queued -= bytes_read;
+	unlock_resource(&in->lock);
+
+	/* the window of the sender has just grown */
+	wakeup(&in->rcv_queued);
+	wakeup(&do_select);
+	return bytes_read;
+}
+
+static int udp_send(struct socket *s, const struct msghdr *msg, int flags)
+{
+	struct inet_info *in, *up;
+	struct packet *p;
+	unsigned int daddr;
+	unsigned short int dport;
+	char *data;
+	int n, size, errno;
+
+	in = &s->u.inet_info;
+	if(in->shutdown & INET_SND_SHUTDOWN) {
+		if(!(flags & MSG_NOSIGNAL)) {
+			send_sig(current, SIGPIPE);
+		}
+		return -EPIPE;
+	}
+	if(msg->msg_name) {
+		if((errno = get_sockaddr(msg->msg_name, msg->msg_namelen, &daddr, &dport))) {
+			return errno;
+		}
+	} else {
+		if(!in->fport) {
+			return -EDESTADDRREQ;
+		}
+		daddr = in->faddr;
+		dport = in->fport;
+	}
+	if(daddr == INADDR_ANY) {
+		daddr = htonl(INADDR_LOOPBACK);
+	}
+	if(!IS_LOOPBACK(daddr)) {
+		return -ENETUNREACH;
+	}
+
+	if((size = packet_msg_size(msg, MIN(INET_MAX_DGRAM, in->sndbuf))) < 0) {
+		return size;
+	}
+	if(!in->lport) {
+		if((errno = autobind(in))) {
+			return errno;
+		}
+	}
+
+	if(!(p = packet_alloc(size))) {
+		return -ENOMEM;
+	}
+	data = p->data;
+	for(n = 0; n < msg->msg_iovlen; n++) {
+		memcpy_b(data, msg->msg_iov[n].iov_base, msg->msg_iov[n].iov_len);
+		data += msg->msg_iov[n].iov_len;
+	}
+	p->len = size;
+	p->addr = in->laddr != INADDR_ANY ? in->laddr : htonl(INADDR_LOOPBACK);
+	p->port = in->lport;
+
+	/* as in any UDP, datagrams that can't be received are dropped */
+	loopback_dev.stats.tx_packets++;
+	loopback_dev.stats.tx_bytes += size;
+	up = lookup_udp(daddr, dport, p->addr, p->port);
+	if(!up || (up->shutdown & INET_RCV_SHUTDOWN) || up->rcv_queued + size > up->rcvbuf) {
+		loopback_dev.stats.rx_dropped++;
+		packet_free(p);
+		return size;
+	}
+	lock_resource(&up->lock);
+	append_packet_to_queue(p, &up->packet_queue);
+	up->rcv_queued += size;
+	unlock_resource(&up->lock);
+	loopback_dev.stats.rx_packets++;
+	loopback_dev.stats.rx_bytes += size;
+	wakeup(up);
+	wakeup(&do_select);
+	return size;
+}
+
+static int udp_recv(struct socket *s, struct fd *f, struct msghdr *msg, int flags)
+{
+	struct inet_info *in;
+	struct sockaddr_in sin;
+	struct packet *p;
+	char *data;
+	int n, len, left, size;
+
+	in = &s->u.inet_info;
+	for(;;) {
+		lock_resource(&in->lock);
+		if((p = peek_packet(in->packet_queue))) {
+			break;
+		}
+		unlock_resource(&in->lock);
+		if(in->shutdown & INET_RCV_SHUTDOWN) {
+			return 0;
+		}
+		if(f->flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		if(sleep(in, PROC_INTERRUPTIBLE)) {
+			return -EINTR;
+		}
+	}
+
+	data = p->data;
+	left = p->len;
+	for(size = 0, n = 0; n < msg->msg_iovlen && left; n++) {
+		len = MIN(msg->msg_iov[n].iov_len, left);
+		memcpy_b(msg->msg_iov[n].iov_base, data, len);
+		data += len;
+		left -= len;
+		size += len;
+	}
+	msg->msg_flags = left ? MSG_TRUNC : 0;
+	msg->msg_controllen = 0;
+	if(flags & MSG_TRUNC) {
+		size = p->len;
+	}
+	if(msg->msg_name) {
+		put_sockaddr(&sin, p->addr, p->port);
+		memcpy_b(msg->msg_name, &sin, MIN(msg->msg_namelen, sizeof(struct sockaddr_in)));
+		msg->msg_namelen = sizeof(struct sockaddr_in);
+	}
+
+	if(flags & MSG_PEEK) {
+		unlock_resource(&in->lock);
+		return size;
+	}
+	remove_packet_from_queue(&in->packet_queue);
+	in->rcv_queued -= p->len;
+	unlock_resource(&in->lock);
+	wakeup(&do_select);
+	packet_free(p);
+	return size;
+}
+
+int inet_create(struct socket *s)
+{
+	struct inet_info *in;
+
+	if(s->type != SOCK_STREAM && s->type != SOCK_DGRAM) {
+		return -ESOCKTNOSUPPORT;
+	}
+	in = &s->u.inet_info;
+	memset_b(in, 0, sizeof(struct inet_info));
+	in->socket = s;
+	in->sndbuf = INET_DEF_SNDBUF;
+	in->rcvbuf = INET_DEF_RCVBUF;
+	add_inet_socket(in);
+	return 0;
+}
+
+void inet_free(struct socket *s)
+{
+	struct inet_info *in, *up;
+	struct socket *sc;
+
+	in = &s->u.inet_info;
+
+	/* reset the connections that were never accepted */
+	if(s->flags & SO_ACCEPTCONN) {
+		while((sc = s->queue_head)) {
+			unlink_connection(s, sc);
+			sc->u.inet_info.listener = NULL;
+			sc->u.inet_info.error = -ECONNRESET;
+			sc->state = SS_DISCONNECTING;
+			wakeup(&sc->u.inet_info);
+			wakeup(&sc->u.inet_info.backlog_len);
+		}
+	}
+	if(in->listener) {
+		unlink_connection(in->listener, s);
+		in->listener = NULL;
+	}
+
+	if((up = in->peer)) {
+		up->peer = NULL;
+		up->socket->state = SS_DISCONNECTING;
+		wakeup(up);
+		wakeup(&up->rcv_queued);
+		in->peer = NULL;
+	}
+
+	lock_resource(&in->lock);
+	free_queue(&in->packet_queue);
+	free_queue(&in->backlog);
+	unlock_resource(&in->lock);
+	remove_inet_socket(in);
+	wakeup(&in->rcv_queued);
+	wakeup(&do_select);
+}
+
+int inet_bind(struct socket *s, const struct sockaddr *addr, int addrlen)
+{
+	struct inet_info *in;
+	unsigned int saddr;
+	unsigned short int port;
+	int errno;
+
+	in = &s->u.inet_info;
+	if((errno = get_sockaddr(addr, addrlen, &saddr, &port))) {
+		return errno;
+	}
+	if(in->lport) {
+		return -EINVAL;
+	}
+	if(saddr != INADDR_ANY && !IS_LOOPBACK(saddr)) {
+		return -EADDRNOTAVAIL;
+	}
+	if(port && ntohs(port) < INET_PORT_RESERVED && !IS_SUPERUSER) {
+		return -EACCES;
+	}
+
+	in->laddr = saddr;
+	if(!port) {
+		return autobind(in);
+	}
+	if(port_in_use(in, saddr, port)) {
+		return -EADDRINUSE;
+	}
+	in->lport = port;
+	return 0;
+}
+
+/*
+ * There is no handshake on the loopback interface: the connection is
+ * established as soon as it enters the queue of the listening socket,
+ * and the data sent meanwhile is kept until the accept().
+ */
+int inet_connect(struct socket *s, const struct sockaddr *addr, int addrlen)
+{
+	struct inet_info *in, *ls;
+	unsigned int daddr;
+	unsigned short int dport;
+	int errno;
+
+	in = &s->u.inet_info;
+	if((errno = get_sockaddr(addr, addrlen, &daddr, &dport))) {
+		return errno;
+	}
+	if(daddr == INADDR_ANY) {
+		daddr = htonl(INADDR_LOOPBACK);
+	}
+	if(!IS_LOOPBACK(daddr)) {
+		return -ENETUNREACH;
+	}
+
+	if(s->type == SOCK_DGRAM) {
+		if(!in->lport) {
+			if((errno = autobind(in))) {
+				return errno;
+			}
+		}
+		in->faddr = daddr;
+		in->fport = dport;
+		s->state = SS_CONNECTED;
+		return 0;
+	}
+
+	if(s->state == SS_CONNECTED) {
+		return -EISCONN;
+	}
+	if(s->state == SS_DISCONNECTING || (s->flags & SO_ACCEPTCONN)) {
+		return -EINVAL;
+	}
+	if(!(ls = lookup_listener(daddr, dport))) {
+		return -ECONNREFUSED;
+	}
+	if(in->laddr == INADDR_ANY) {
+		in->laddr = daddr;
+	}
+	if(!in->lport) {
+		if((errno = autobind(in))) {
+			return errno;
+		}
+	}
+	if((errno = insert_socket_to_queue(ls->socket, s))) {
+		return errno;
+	}
+	in->faddr = daddr;
+	in->fport = dport;
+	in->listener = ls->socket;
+	s->state = SS_CONNECTED;
+	wakeup(ls->socket);
+	wakeup(&do_select);
+	return 0;
+}
+
+int inet_accept(struct socket *sc, struct socket *nss)
+{
+	struct inet_info *ci, *ni, *ls;
+
+	ci = &sc->u.inet_info;
+	ni = &nss->u.inet_info;
+
+	if(ci->listener) {
+		ls = &ci->listener->u.inet_info;
+		ni->options = ls->options;
+		ni->sndbuf = ls->sndbuf;
+		ni->rcvbuf = ls->rcvbuf;
+		ci->listener = NULL;
+	}
+	ni->laddr = ci->faddr;
+	ni->lport = ci->fport;
+	ni->faddr = ci->laddr;
+	ni->fport = ci->lport;
+
+	/* hand over the data sent before the connection was accepted */
+	lock_resource(&ci->lock);
+	ni->packet_queue = ci->backlog;
+	ni->rcv_queued = ci->backlog_len;
+	ci->backlog = NULL;
+	ci->backlog_len = 0;
+	unlock_resource(&ci->lock);
+	if(ci->shutdown & INET_SND_SHUTDOWN) {
+		ni->shutdown |= INET_RCV_SHUTDOWN;
+	}
+
+	ci->peer = ni;
+	ni->peer = ci;
+	nss->state = SS_CONNECTED;
+	wakeup(&ci->backlog_len);
+	wakeup(&do_select);
+	return 0;
+}
+
+int inet_getname(struct socket *s, struct sockaddr *addr, int *addrlen, int call)
+{
+	struct inet_info *in;
+	struct sockaddr_in sin;
+	int len, errno;
+
+	if((errno = check_user_area(VERIFY_WRITE, addrlen, sizeof(int)))) {
+		return errno;
+	}
+	in = &s->u.inet_info;
+	if(call == SYS_GETSOCKNAME) {
+		put_sockaddr(&sin, in->laddr, in->lport);
+	} else {
+		/* SYS_GETPEERNAME */
+		if(!in->fport) {
+			return -ENOTCONN;
+		}
+		put_sockaddr(&sin, in->faddr, in->fport);
+	}
+	len = MIN(*addrlen, sizeof(struct sockaddr_in));
+	if(len > 0) {
+		if((errno = check_user_area(VERIFY_WRITE, addr, len))) {
+			return errno;
+		}
+		memcpy_b(addr, &sin, len);
+	}
+	*addrlen = sizeof(struct sockaddr_in);
+	return 0;
+}
+
+int inet_send(struct socket *s, struct fd *f, const char *buffer, __size_t count, int flags)
+{
+	return inet_sendto(s, f, buffer, count, flags, NULL, 0);
+}
+
+int inet_recv(struct socket *s, struct fd *f, char *buffer, __size_t count, int flags)
+{
+	int addrlen;
+
+	return inet_recvfrom(s, f, buffer, count, flags, NULL, &addrlen);
+}
+
+int inet_sendto(struct socket *s, struct fd *f, const char *buffer, __size_t count, int flags, const struct sockaddr *addr, int addrlen)
+{
+	struct msghdr msg;
+	struct iovec iov;
+
+	iov.iov_base = (void *)buffer;
+	iov.iov_len = count;
+	memset_b(&msg, 0, sizeof(struct msghdr));
+	msg.msg_name = (void *)addr;
+	msg.msg_namelen = addrlen;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	return inet_sendmsg(s, f, &msg, flags);
+}
+
+int inet_recvfrom(struct socket *s, struct fd *f, char *buffer, __size_t count, int flags, struct sockaddr *addr, int *addrlen)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	int errno;
+
+	iov.iov_base = buffer;
+	iov.iov_len = count;
+	memset_b(&msg, 0, sizeof(struct msghdr));
+	msg.msg_name = addr;
+	msg.msg_namelen = addr ? sizeof(struct sockaddr_in) : 0;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	*addrlen = 0;
+	if((errno = inet_recvmsg(s, f, &msg, flags)) >= 0) {
+		*addrlen = msg.msg_namelen;
+	}
+	return errno;
+}
+
+int inet_sendmsg(struct socket *s, struct fd *f, const struct msghdr *msg, int flags)
+{
+	int n, errno, bytes_written;
+
+	if(flags & ~(MSG_DONTWAIT | MSG_NOSIGNAL)) {
+		return -EINVAL;
+	}
+	if(s->type == SOCK_DGRAM) {
+		return udp_send(s, msg, flags);
+	}
+	if(msg->msg_name && s->state != SS_CONNECTED) {
+		return -EOPNOTSUPP;
+	}
+
+	bytes_written = 0;
+	for(n = 0; n < msg->msg_iovlen; n++) {
+		if((errno = tcp_write(s, f, msg->msg_iov[n].iov_base, msg->msg_iov[n].iov_len, flags)) < 0) {
+			return bytes_written ? bytes_written : errno;
+		}
+		bytes_written += errno;
+		if(errno < msg->msg_iov[n].iov_len) {
+			break;
+		}
+	}
+	return bytes_written;
+}
+
+int inet_recvmsg(struct socket *s, struct fd *f, struct msghdr *msg, int flags)
+{
+	struct sockaddr_in sin;
+	int n, errno, bytes_read;
+
+	if(flags & ~(MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT)) {
+		return -EINVAL;
+	}
+	if(s->type == SOCK_DGRAM) {
+		return udp_recv(s, f, msg, flags);
+	}
+
+	bytes_read = 0;
+	for(n = 0; n < msg->msg_iovlen; n++) {
+		/* a peek only looks at the first buffer */
+		if((errno = tcp_read(s, f, msg->msg_iov[n].iov_base, msg->msg_iov[n].iov_len, flags)) < 0) {
+			return bytes_read ? bytes_read : errno;
+		}
+		bytes_read += errno;
+		if(errno < msg->msg_iov[n].iov_len || (flags & MSG_PEEK)) {
+			break;
+		}
+	}
+	msg->msg_flags = 0;
+	msg->msg_controllen = 0;
+	if(msg->msg_name) {
+		put_sockaddr(&sin, s->u.inet_info.faddr, s->u.inet_info.fport);
+		memcpy_b(msg->msg_name, &sin, MIN(msg->msg_namelen, sizeof(struct sockaddr_in)));
+		msg->msg_namelen = sizeof(struct sockaddr_in);
+	}
+	return bytes_read;
+}
+
+int inet_read(struct socket *s, struct fd *f, char *buffer, __size_t count)
+{
+	return inet_recv(s, f, buffer, count, 0);
+}
+
+int inet_write(struct socket *s, struct fd *f, const char *buffer, __size_t count)
+{
+	return inet_send(s, f, buffer, count, 0);
+}
+
+int inet_select(struct socket *s, int flag)
+{
+	struct inet_info *in, *up;
+
+	if(s->flags & SO_ACCEPTCONN) {
+		if(flag == SEL_R && s->queue_len) {
+			return 1;
+		}
+		return 0;
+	}
+
+	in = &s->u.inet_info;
+	switch(flag) {
+		case SEL_R:
+			if(in->packet_queue || in->error || (in->shutdown & INET_RCV_SHUTDOWN)) {
+				return 1;
+			}
+			if(s->type == SOCK_STREAM && s->state != SS_CONNECTED) {
+				return 1;
+			}
+			break;
+		case SEL_W:
+			if(s->type == SOCK_DGRAM) {
+				return 1;
+			}
+			if(s->state != SS_CONNECTED || in->error || (in->shutdown & INET_SND_SHUTDOWN)) {
+				return 1;
+			}
+			if((up = in->peer)) {
+				return up->rcv_queued < up->rcvbuf;
+			}
+			return in->backlog_len < in->sndbuf;
+	}
+	return 0;
+}
+
+int inet_shutdown(struct socket *s, int how)
+{
+	struct inet_info *in;
+
+	in = &s->u.inet_info;
+	if(how != SHUT_RD && how != SHUT_WR && how != SHUT_RDWR) {
+		return -EINVAL;
+	}
+	if(s->type == SOCK_STREAM && s->state != SS_CONNECTED) {
+		return -ENOTCONN;
+	}
+
+	if(how != SHUT_WR) {
+		in->shutdown |= INET_RCV_SHUTDOWN;
+		wakeup(in);
+	}
+	if(how != SHUT_RD) {
+		in->shutdown |= INET_SND_SHUTDOWN;
+		/* the peer sees the end of the stream once it drains the data */
+		if(in->peer) {
+			in->peer->shutdown |= INET_RCV_SHUTDOWN;
+			wakeup(in->peer);
+		}
+		wakeup(&in->backlog_len);
+	}
+	wakeup(&do_select);
+	return 0;
+}
+
+int inet_setsockopt(struct socket *s, int level, int optname, const void *optval, socklen_t optlen)
+{
+	struct inet_info *in;
+	int val, flag, errno;
+
+	in = &s->u.inet_info;
+	if(optlen < sizeof(int)) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_READ, optval, sizeof(int)))) {
+		return errno;
+	}
+	val = *(int *)optval;
+
+	flag = 0;
+	if(level == SOL_SOCKET) {
+		switch(optname) {
+			case SO_REUSEADDR:
+				flag = INET_REUSEADDR;
+				break;
+			case SO_KEEPALIVE:
+				flag = INET_KEEPALIVE;
+				break;
+			case SO_SNDBUF:
+				in->sndbuf = MIN(MAX(val, INET_MIN_BUF), INET_MAX_BUF);
+				wakeup(&in->backlog_len);
+				return 0;
+			case SO_RCVBUF:
+				in->rcvbuf = MIN(MAX(val, INET_MIN_BUF), INET_MAX_BUF);
+				wakeup(&in->rcv_queued);
+				return 0;
+			default:
+				return -ENOPROTOOPT;
+		}
+	} else if(level == IPPROTO_TCP && s->type == SOCK_STREAM) {
+		switch(optname) {
+			/* there is no Nagle algorithm to disable, segments are never delayed */
+			case TCP_NODELAY:
+				flag = INET_NODELAY;
+				break;
+			default:
+				return -ENOPROTOOPT;
+		}
+	} else {
+		return -ENOPROTOOPT;
+	}
+
+	if(val) {
+		in->options |= flag;
+	} else {
+		in->options &= ~flag;
+	}
+	return 0;
+}
+
+int inet_getsockopt(struct socket *s, int level, int optname, void *optval, socklen_t *optlen)
+{
+	struct inet_info *in;
+	int val, errno;
+
+	in = &s->u.inet_info;
+	if((errno = check_user_area(VERIFY_WRITE, optlen, sizeof(socklen_t)))) {
+		return errno;
+	}
+	if(*optlen < sizeof(int)) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_WRITE, optval, sizeof(int)))) {
+		return errno;
+	}
+
+	if(level == SOL_SOCKET) {
+		switch(optname) {
+			case SO_REUSEADDR:
+				val = (in->options & INET_REUSEADDR) ? 1 : 0;
+				break;
+			case SO_KEEPALIVE:
+				val = (in->options & INET_KEEPALIVE) ? 1 : 0;
+				break;
+			case SO_TYPE:
+				val = s->type;
+				break;
+			case SO_ERROR:
+				val = -in->error;
+				in->error = 0;
+				break;
+			case SO_SNDBUF:
+				val = in->sndbuf;
+				break;
+			case SO_RCVBUF:
+				val = in->rcvbuf;
+				break;
+			default:
+				return -ENOPROTOOPT;
+		}
+	} else if(level == IPPROTO_TCP && s->type == SOCK_STREAM) {
+		switch(optname) {
+			case TCP_NODELAY:
+				val = (in->options & INET_NODELAY) ? 1 : 0;
+				break;
+			default:
+				return -ENOPROTOOPT;
+		}
+	} else {
+		return -ENOPROTOOPT;
+	}
+	*(int *)optval = val;
+	*optlen = sizeof(int);
+	return 0;
+}
+
+int inet_init(void)
+{
+	inet_socket_head = NULL;
+	register_netdevice(&loopback_dev);
+	return 0;
+}
+#endif /* CONFIG_NET */
@@ -6,22 +6,145 @@
  */
 
 #include <fiwix/config.h>
+#include <fiwix/asm.h>
+#include <fiwix/fs.h>
 #include <fiwix/net.h>
 #include <fiwix/net/packet.h>
 #include <fiwix/socket.h>
+#include <fiwix/mm.h>
+#include <fiwix/string.h>
+#include <fiwix/errno.h>
 
 #ifdef CONFIG_NET
+/*
+ * Small packets are served from a pool of fixed-size slots carved out of
+ * whole pages, so the common case of short datagrams needs neither the
+ * buddy allocator nor a second allocation for the data. The pool grows on
+ * demand up to PACKET_POOL_PAGES and its slots are recycled thereafter.
+ */
+static struct packet *packet_pool_head;
+static int packet_pool_pages;
+
+static void grow_packet_pool(void)
+{
+	struct packet *p;
+	unsigned int flags, addr;
+	int n;
+
+	if(!(addr = kmalloc(PAGE_SIZE))) {
+		return;
+	}
+	SAVE_FLAGS(flags); CLI();
+	for(n = 0; n < PAGE_SIZE / PACKET_SLOT_SIZE; n++) {
+		p = (struct packet *)(addr + (n * PACKET_SLOT_SIZE));
+		p->next = packet_pool_head;
+		packet_pool_head = p;
+	}
+	packet_pool_pages++;
+	RESTORE_FLAGS(flags);
+}
+
+struct packet *packet_alloc(int len)
+{
+	unsigned int flags;
+	struct packet *p;
+
+	p = NULL;
+	if(len <= PACKET_INLINE_SIZE) {
+		if(!packet_pool_head && packet_pool_pages < PACKET_POOL_PAGES) {
+			grow_packet_pool();
+		}
+		SAVE_FLAGS(flags); CLI();
+		if((p = packet_pool_head)) {
+			packet_pool_head = p->next;
+		}
+		RESTORE_FLAGS(flags);
+		if(p) {
+			memset_b(p, 0, sizeof(struct packet));
+			p->data = (char *)(p + 1);
+			p->flags = PACKET_POOL;
+			return p;
+		}
+	}
+
+	/* keep the header and the data together whenever they fit */
+	if(sizeof(struct packet) + len <= PAGE_SIZE) {
+		if(!(p = (struct packet *)kmalloc(sizeof(struct packet) + len))) {
+			return NULL;
+		}
+		memset_b(p, 0, sizeof(struct packet));
+		p->data = (char *)(p + 1);
+		return p;
+	}
+
+	if(len > PAGE_SIZE) {
+		return NULL;
+	}
+	if(!(p = (struct packet *)kmalloc(sizeof(struct packet)))) {
+		return NULL;
+	}
+	memset_b(p, 0, sizeof(struct packet));
+	if(!(p->data = (char *)kmalloc(len))) {
+		kfree((unsigned int)p);
+		return NULL;
+	}
+	p->flags = PACKET_EXTDATA;
+	return p;
+}
+
+void packet_free(struct packet *p)
+{
+	unsigned int flags;
+
+	if(p->flags & PACKET_POOL) {
+		SAVE_FLAGS(flags); CLI();
+		p->next = packet_pool_head;
+		packet_pool_head = p;
+		RESTORE_FLAGS(flags);
+		return;
+	}
+	if(p->flags & PACKET_EXTDATA) {
+		kfree((unsigned int)p->data);
+	}
+	kfree((unsigned int)p);
+}
+
+/*
+ * Returns the total length of the data in a message or -EMSGSIZE if it's
+ * larger than 'max'. Every iov_len comes from the user, so the sum is kept
+ * bounded at each step and can never wrap around.
+ */
+int packet_msg_size(const struct msghdr *msg, int max)
+{
+	__size_t n, size;
+
+	for(size = 0, n = 0; n < msg->msg_iovlen; n++) {
+		if(msg->msg_iov[n].iov_len > max - size) {
+			return -EMSGSIZE;
+		}
+		size += msg->msg_iov[n].iov_len;
+	}
+	return size;
+}
+
 struct packet *peek_packet(struct packet *queue_head)
 {
 	return queue_head;
 }
 
+/*
+ * The 'prev' field of the first packet in a queue points to the last one,
+ * so appending doesn't need to walk the whole queue.
+ */
 struct packet *remove_packet_from_queue(struct packet **queue_head)
 {
 	struct packet *p;
 
 	if((p = *queue_head)) {
-		*queue_head = (*queue_head)->next;
+		if((*queue_head = p->next)) {
+			(*queue_head)->prev = p->prev;
+		}
+		p->next = p->prev = NULL;
 	}
 
 	return p;
@@ -31,12 +154,12 @@ void append_packet_to_queue(struct packet *p, struct packet **queue_head)
 {
 	struct packet *h;
 
+	p->next = NULL;
 	if((h = *queue_head)) {
-		while(h->next) {
-			h = h->next;
-		}
-		h->next = p;
+		h->prev->next = p;
+		h->prev = p;
 	} else {
+		p->prev = p;
 		*queue_head = p;
 	}
 }
@@ -18,6 +18,7 @@
 #include <fiwix/errno.h>
 #include <fiwix/stdio.h>
 #include <fiwix/string.h>
+#include <fiwix/limits.h>
 
 #ifdef __DEBUG__
 #include <fiwix/process.h>
@@ -29,7 +30,7 @@ static int check_sd(int sd)
 	struct inode *i;
 
 	CHECK_UFD(sd);
-	i = fd_table[current->fd[sd]].inode;
+	i = fd_table[current->files->fd[sd]].inode;
 	if(!i || !S_ISSOCK(i->i_mode)) {
 		return -ENOTSOCK;
 	}
@@ -37,6 +38,42 @@ static int check_sd(int sd)
 	return 0;
 }
 
+/* checks the message header and all the buffers it points to */
+static int check_msghdr(const struct msghdr *msg, int verify)
+{
+	unsigned int n;
+	int errno;
+
+	if((errno = check_user_area(verify, msg, sizeof(struct msghdr)))) {
+		return errno;
+	}
+	if(msg->msg_iovlen > UIO_MAXIOV) {
+		return -EMSGSIZE;
+	}
+	if((errno = check_user_area(VERIFY_READ, msg->msg_iov, sizeof(struct iovec) * msg->msg_iovlen))) {
+		return errno;
+	}
+	for(n = 0; n < msg->msg_iovlen; n++) {
+		if(!msg->msg_iov[n].iov_len) {
+			continue;
+		}
+		if((errno = check_user_area(verify, msg->msg_iov[n].iov_base, msg->msg_iov[n].iov_len))) {
+			return errno;
+		}
+	}
+	if(msg->msg_name && msg->msg_namelen) {
+		if((errno = check_user_area(verify, msg->msg_name, msg->msg_namelen))) {
+			return errno;
+		}
+	}
+	if(msg->msg_control && msg->msg_controllen) {
+		if((errno = check_user_area(verify, msg->msg_control, msg->msg_controllen))) {
+			return errno;
+		}
+	}
+	return 0;
+}
+
 static struct socket *remove_socket_from_queue(struct socket *ss)
 {
 	unsigned int flags;
@@ -77,7 +114,7 @@ static int sock_alloc(struct socket **s)
 		iput(i);
 		return -EMFILE;
 	}
-	current->fd[ufd] = fd;
+	current->files->fd[ufd] = fd;
 	i = fd_table[fd].inode;
 	ns = &i->u.sockfs.sock;
 	ns->state = SS_UNCONNECTED;
@@ -91,7 +128,7 @@ static struct socket *get_socket_from_fd(int fd)
 {
 	struct inode *i;
 
-	i = fd_table[current->fd[fd]].inode;
+	i = fd_table[current->files->fd[fd]].inode;
 	return &i->u.sockfs.sock;
 }
 
@@ -106,7 +143,7 @@ void sock_free(struct socket *s)
 	fd = ((unsigned int)s->fd - (unsigned int)&fd_table[0]) / sizeof(struct fd);
 
 	for(n = 0; n < OPEN_MAX; n++) {
-		if(current->fd[n] == fd) {
+		if(current->files->fd[n] == fd) {
 			ufd = n;
 			break;
 		}
@@ -162,7 +199,7 @@ int socket(int domain, int type, int protocol)
 	printk("(pid %d) socket(%d, %d, %d)\n", current->pid, domain, type, protocol);
 #endif /*__DEBUG__ */
 
-	if(type != SOCK_STREAM && type != SOCK_DGRAM) {
+	if(type != SOCK_STREAM && type != SOCK_DGRAM && type != SOCK_SEQPACKET) {
 		return -EINVAL;
 	}
 
@@ -214,7 +251,7 @@ int listen(int sd, int backlog)
 		return errno;
 	}
 	ss = get_socket_from_fd(sd);
-	if(ss->type != SOCK_STREAM) {
+	if(ss->type != SOCK_STREAM && ss->type != SOCK_SEQPACKET) {
 		return -EOPNOTSUPP;
 	}
 	ss->flags |= SO_ACCEPTCONN;
@@ -259,11 +296,11 @@ int accept(int sd, struct sockaddr *addr, int *addrlen)
 	if(!(ss->flags & SO_ACCEPTCONN)) {
 		return -EINVAL;
 	}
-	if(ss->type != SOCK_STREAM) {
+	if(ss->type != SOCK_STREAM && ss->type != SOCK_SEQPACKET) {
 		return -EOPNOTSUPP;
 	}
 	while(!(sc = remove_socket_from_queue(ss))) {
-		if(fd_table[current->fd[sd]].flags & O_NONBLOCK) {
+		if(fd_table[current->files->fd[sd]].flags & O_NONBLOCK) {
 			return -EAGAIN;
 		}
 		if(sleep(ss, PROC_INTERRUPTIBLE)) {
@@ -429,6 +466,11 @@ int sendto(int sd, const void *buf, __size_t len, int flags, const struct sockad
 	if((errno = check_user_area(VERIFY_READ, buf, len))) {
 		return errno;
 	}
+	if(addr) {
+		if((errno = check_user_area(VERIFY_READ, addr, addrlen))) {
+			return errno;
+		}
+	}
 	fd_table.flags = s->fd->flags | ((flags & MSG_DONTWAIT) ? O_NONBLOCK : 0);
 	return s->ops->sendto(s, &fd_table, buf, len, flags, addr, addrlen);
 }
@@ -437,7 +479,7 @@ int recvfrom(int sd, void *buf, __size_t len, int flags, struct sockaddr *addr,
 {
 	struct socket *s;
 	struct fd fd_table;
-	char ret_addr[108];
+	char ret_addr[sizeof(struct sockaddr_un)];
 	int errno, ret_len, bytes_read;
 
 #ifdef __DEBUG__
@@ -452,7 +494,8 @@ int recvfrom(int sd, void *buf, __size_t len, int flags, struct sockaddr *addr,
 		return errno;
 	}
 	fd_table.flags = s->fd->flags | ((flags & MSG_DONTWAIT) ? O_NONBLOCK : 0);
-	memset_b(ret_addr, 0, 108);
+	memset_b(ret_addr, 0, sizeof(ret_addr));
+	ret_len = 0;
 	if((errno = s->ops->recvfrom(s, &fd_table, buf, len, flags, (struct sockaddr *)ret_addr, &ret_len)) < 0) {
 		return errno;
 	}
@@ -466,6 +509,128 @@ int recvfrom(int sd, void *buf, __size_t len, int flags, struct sockaddr *addr,
 	return bytes_read;
 }
 
+int sendmsg(int sd, const struct msghdr *msg, int flags)
+{
+	struct socket *s;
+	struct fd fd_table;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sendmsg(%d, 0x%08x, %d)\n", current->pid, sd, (int)msg, flags);
+#endif /*__DEBUG__ */
+
+	if((errno = check_sd(sd)) < 0) {
+		return errno;
+	}
+	s = get_socket_from_fd(sd);
+	if((errno = check_msghdr(msg, VERIFY_READ))) {
+		return errno;
+	}
+	fd_table.flags = s->fd->flags | ((flags & MSG_DONTWAIT) ? O_NONBLOCK : 0);
+	return s->ops->sendmsg(s, &fd_table, msg, flags);
+}
+
+int recvmsg(int sd, struct msghdr *msg, int flags)
+{
+	struct socket *s;
+	struct fd fd_table;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) recvmsg(%d, 0x%08x, %d)\n", current->pid, sd, (int)msg, flags);
+#endif /*__DEBUG__ */
+
+	if((errno = check_sd(sd)) < 0) {
+		return errno;
+	}
+	s = get_socket_from_fd(sd);
+	if((errno = check_msghdr(msg, VERIFY_WRITE))) {
+		return errno;
+	}
+	fd_table.flags = s->fd->flags | ((flags & MSG_DONTWAIT) ? O_NONBLOCK : 0);
+	return s->ops->recvmsg(s, &fd_table, msg, flags);
+}
+
+int sendmmsg(int sd, struct mmsghdr *msgvec, unsigned int vlen, int flags)
+{
+	struct socket *s;
+	struct fd fd_table;
+	unsigned int n;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) sendmmsg(%d, 0x%08x, %d, %d)\n", current->pid, sd, (int)msgvec, vlen, flags);
+#endif /*__DEBUG__ */
+
+	if((errno = check_sd(sd)) < 0) {
+		return errno;
+	}
+	s = get_socket_from_fd(sd);
+	vlen = MIN(vlen, UIO_MAXIOV);
+	if((errno = check_user_area(VERIFY_WRITE, msgvec, sizeof(struct mmsghdr) * vlen))) {
+		return errno;
+	}
+	fd_table.flags = s->fd->flags | ((flags & MSG_DONTWAIT) ? O_NONBLOCK : 0);
+
+	/* an error is only reported if no message could be sent */
+	for(n = 0; n < vlen; n++) {
+		if((errno = check_msghdr(&msgvec[n].msg_hdr, VERIFY_READ))) {
+			break;
+		}
+		if((errno = s->ops->sendmsg(s, &fd_table, &msgvec[n].msg_hdr, flags)) < 0) {
+			break;
+		}
+		msgvec[n].msg_len = errno;
+	}
+	return n ? n : errno;
+}
+
+/*
+ * The timeout is not implemented, but when one is given the call doesn't
+ * block after the first message, as with MSG_WAITFORONE.
+ */
+int recvmmsg(int sd, struct mmsghdr *msgvec, unsigned int vlen, int flags, struct timespec *timeout)
+{
+	struct socket *s;
+	struct fd fd_table;
+	unsigned int n;
+	int errno;
+
+#ifdef __DEBUG__
+	printk("(pid %d) recvmmsg(%d, 0x%08x, %d, %d, 0x%08x)\n", current->pid, sd, (int)msgvec, vlen, flags, (int)timeout);
+#endif /*__DEBUG__ */
+
+	if((errno = check_sd(sd)) < 0) {
+		return errno;
+	}
+	s = get_socket_from_fd(sd);
+	vlen = MIN(vlen, UIO_MAXIOV);
+	if((errno = check_user_area(VERIFY_WRITE, msgvec, sizeof(struct mmsghdr) * vlen))) {
+		return errno;
+	}
+	if(timeout) {
+		if((errno = check_user_area(VERIFY_READ, timeout, sizeof(struct timespec)))) {
+			return errno;
+		}
+		flags |= MSG_WAITFORONE;
+	}
+	fd_table.flags = s->fd->flags | ((flags & MSG_DONTWAIT) ? O_NONBLOCK : 0);
+
+	for(n = 0; n < vlen; n++) {
+		if((errno = check_msghdr(&msgvec[n].msg_hdr, VERIFY_WRITE))) {
+			break;
+		}
+		if((errno = s->ops->recvmsg(s, &fd_table, &msgvec[n].msg_hdr, flags & ~MSG_WAITFORONE)) < 0) {
+			break;
+		}
+		msgvec[n].msg_len = errno;
+		if(flags & MSG_WAITFORONE) {
+			fd_table.flags |= O_NONBLOCK;
+		}
+	}
+	return n ? n : errno;
+}
+
 int shutdown(int sd, int how)
 {
 	struct socket *s;
@@ -19,12 +19,13 @@
 #include <fiwix/mm.h>
 #include <fiwix/string.h>
 #include <fiwix/stdio.h>
+#include <fiwix/locks.h>
+#include <fiwix/limits.h>
+#include <fiwix/process.h>
 
 #ifdef CONFIG_NET
 struct unix_info *unix_socket_head;
 
-static struct resource packet_resource = { 0, 0 };
-
 static void add_unix_socket(struct unix_info *u)
 {
 	struct unix_info *h;
@@ -74,6 +75,406 @@ static struct unix_info *lookup_unix_socket(char *path, struct inode *i)
 	return NULL;
 }
 
+static int find_unix_socket(const struct sockaddr *addr, int addrlen, struct unix_info **up)
+{
+	struct inode *i;
+	struct sockaddr_un *su;
+	char *tmp_name;
+	int errno;
+
+	su = (struct sockaddr_un *)addr;
+	if(su->sun_family != AF_UNIX) {
+                return -EINVAL;
+	}
+	if(addrlen < 0 || addrlen > sizeof(struct sockaddr_un)) {
+                return -EINVAL;
+	}
+
+	if((errno = malloc_name(su->sun_path, &tmp_name)) < 0) {
+		return errno;
+	}
+	if((errno = namei(tmp_name, &i, NULL, FOLLOW_LINKS))) {
+		free_name(tmp_name);
+		return errno;
+	}
+	*up = lookup_unix_socket(tmp_name, i);
+	iput(i);
+	free_name(tmp_name);
+	return *up ? 0 : -ECONNREFUSED;
+}
+
+/* drops a reference to an entry of fd_table, as close() would do */
+static void put_fd(unsigned int fd)
+{
+	struct inode *i;
+
+	if(--fd_table[fd].count) {
+		return;
+	}
+	i = fd_table[fd].inode;
+	flock_release_inode(i);
+	if(i->fsop && i->fsop->close) {
+		i->fsop->close(i, &fd_table[fd]);
+	}
+	release_fd(fd);
+	iput(i);
+}
+
+static void release_rights(struct packet *p)
+{
+	int n;
+
+	for(n = 0; n < p->nr_fds; n++) {
+		put_fd(p->fds[n]);
+	}
+	if(p->fds) {
+		kfree((unsigned int)p->fds);
+	}
+	p->fds = NULL;
+	p->nr_fds = 0;
+}
+
+/*
+ * Attaches the ancillary data of the message to the packet. The descriptors
+ * passed with SCM_RIGHTS gain a reference in fd_table that is kept while
+ * the packet is in flight.
+ */
+static int scm_send(const struct msghdr *msg, struct packet *p)
+{
+	struct cmsghdr *cmsg;
+	struct ucred *cred;
+	char *c, *end;
+	int n, nr, ufd;
+
+	p->cred.pid = current->pid;
+	p->cred.uid = current->uid;
+	p->cred.gid = current->gid;
+	if(!msg->msg_control) {
+		return 0;
+	}
+
+	c = (char *)msg->msg_control;
+	end = c + msg->msg_controllen;
+	while(c + sizeof(struct cmsghdr) <= end) {
+		cmsg = (struct cmsghdr *)c;
+		if(cmsg->cmsg_len < sizeof(struct cmsghdr) || c + cmsg->cmsg_len > end) {
+			return -EINVAL;
+		}
+		if(cmsg->cmsg_level != SOL_SOCKET) {
+			return -EINVAL;
+		}
+		switch(cmsg->cmsg_type) {
+			case SCM_RIGHTS:
+				nr = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+				if(p->fds || nr <= 0 || nr > SCM_MAX_FD) {
+					return -EINVAL;
+				}
+				if(!(p->fds = (int *)kmalloc(sizeof(int) * nr))) {
+					return -ENOMEM;
+				}
+				for(n = 0; n < nr; n++) {
+					ufd = ((int *)CMSG_DATA(cmsg))[n];
+					if(ufd < 0 || ufd >= OPEN_MAX || !current->files->fd[ufd]) {
+						return -EBADF;
+					}
+					p->fds[n] = current->files->fd[ufd];
+					fd_table[p->fds[n]].count++;
+					p->nr_fds++;
+				}
+				break;
+			case SCM_CREDENTIALS:
+				if(cmsg->cmsg_len != CMSG_LEN(sizeof(struct ucred))) {
+					return -EINVAL;
+				}
+				cred = (struct ucred *)CMSG_DATA(cmsg);
+				/* only the superuser can pretend to be someone else */
+				if(!IS_SUPERUSER) {
+					if(cred->pid != current->pid) {
+						return -EPERM;
+					}
+					if(cred->uid != current->uid && cred->uid != current->euid && cred->uid != current->suid) {
+						return -EPERM;
+					}
+					if(cred->gid != current->gid && cred->gid != current->egid && cred->gid != current->sgid) {
+						return -EPERM;
+					}
+				}
+				p->cred = *cred;
+				break;
+			default:
+				return -EINVAL;
+		}
+		c += CMSG_ALIGN(cmsg->cmsg_len);
+	}
+	return 0;
+}
+
+/*
+ * Fills msg_control with the ancillary data of the packet. The descriptors
+ * that don't fit (or can't be installed) are closed and MSG_CTRUNC is set.
+ * A peek leaves the descriptors in the packet for the next receive.
+ */
+static void scm_recv(struct socket *s, struct msghdr *msg, struct packet *p, int flags)
+{
+	struct cmsghdr *cmsg;
+	char *c, *end;
+	int n, nr, ufd;
+
+	c = (char *)msg->msg_control;
+	end = c ? c + msg->msg_controllen : c;
+
+	if(s->u.unix_info.passcred) {
+		if(c + CMSG_LEN(sizeof(struct ucred)) <= end) {
+			cmsg = (struct cmsghdr *)c;
+			cmsg->cmsg_len = CMSG_LEN(sizeof(struct ucred));
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_CREDENTIALS;
+			memcpy_b(CMSG_DATA(cmsg), &p->cred, sizeof(struct ucred));
+			c += MIN(CMSG_SPACE(sizeof(struct ucred)), end - c);
+		} else {
+			msg->msg_flags |= MSG_CTRUNC;
+		}
+	}
+
+	if(p->nr_fds && !(flags & MSG_PEEK)) {
+		nr = 0;
+		if(c + CMSG_LEN(sizeof(int)) <= end) {
+			nr = MIN((end - c - CMSG_LEN(0)) / sizeof(int), p->nr_fds);
+		}
+		cmsg = (struct cmsghdr *)c;
+		for(n = 0; n < nr; n++) {
+			if((ufd = get_new_user_fd(0)) < 0) {
+				break;
+			}
+			current->files->fd[ufd] = p->fds[n];
+			if(flags & MSG_CMSG_CLOEXEC) {
+				current->files->fd_flags[ufd] |= FD_CLOEXEC;
+			}
+			((int *)CMSG_DATA(cmsg))[n] = ufd;
+		}
+		if(n) {
+			cmsg->cmsg_len = CMSG_LEN(sizeof(int) * n);
+			cmsg->cmsg_level = SOL_SOCKET;
+			cmsg->cmsg_type = SCM_RIGHTS;
+			c += MIN(CMSG_SPACE(sizeof(int) * n), end - c);
+		}
+		if(n < p->nr_fds) {
+			msg->msg_flags |= MSG_CTRUNC;
+		}
+
+		/* the installed descriptors keep their reference */
+		for(; n < p->nr_fds; n++) {
+			put_fd(p->fds[n]);
+		}
+		kfree((unsigned int)p->fds);
+		p->fds = NULL;
+		p->nr_fds = 0;
+	}
+	msg->msg_controllen = c - (char *)msg->msg_control;
+}
+
+/*
+ * Discards the packets queued in the socket and makes sure that the ones
+ * it sent to other sockets don't keep a reference to it.
+ */
+static void purge_packets(struct socket *s)
+{
+	struct unix_info *u, *h, *us;
+	struct packet *p, *queue;
+
+	u = &s->u.unix_info;
+	lock_resource(&u->lock);
+	queue = u->packet_queue;
+	u->packet_queue = NULL;
+	u->rcv_queued = 0;
+	unlock_resource(&u->lock);
+	wakeup(&u->rcv_queued);
+
+	/* releasing a descriptor might close a socket that is purged too */
+	while((p = remove_packet_from_queue(&queue))) {
+		if(p->socket) {
+			us = &p->socket->u.unix_info;
+			us->snd_queued -= p->len;
+			wakeup(&us->snd_queued);
+		}
+		release_rights(p);
+		packet_free(p);
+	}
+
+	for(h = unix_socket_head; h; h = h->next) {
+		if(h == u) {
+			continue;
+		}
+		lock_resource(&h->lock);
+		for(p = h->packet_queue; p; p = p->next) {
+			if(p->socket == s) {
+				p->socket = NULL;
+			}
+		}
+		unlock_resource(&h->lock);
+	}
+}
+
+/*
+ * Sends a datagram to the socket named in the message or, if there is no
+ * name, to the peer of the socket. The data is gathered straight from the
+ * user buffers into the packet, which is then queued to the receiver.
+ * SOCK_SEQPACKET sockets use this too, always with their peer.
+ */
+static int dgram_send(struct socket *s, struct fd *f, const struct msghdr *msg)
+{
+	struct unix_info *u, *up;
+	struct packet *p;
+	char *data;
+	void *wait;
+	int n, size, errno;
+
+	u = &s->u.unix_info;
+	if((size = packet_msg_size(msg, MIN(UNIX_MAX_DGRAM, u->sndbuf))) < 0) {
+		return size;
+	}
+
+	if(!(p = packet_alloc(size))) {
+		return -ENOMEM;
+	}
+	data = p->data;
+	for(n = 0; n < msg->msg_iovlen; n++) {
+		memcpy_b(data, msg->msg_iov[n].iov_base, msg->msg_iov[n].iov_len);
+		data += msg->msg_iov[n].iov_len;
+	}
+	p->len = size;
+	p->socket = s;
+	if((errno = scm_send(msg, p))) {
+		release_rights(p);
+		packet_free(p);
+		return errno;
+	}
+
+	for(;;) {
+		/* the receiver might have gone away while sleeping */
+		if(msg->msg_name) {
+			if((errno = find_unix_socket(msg->msg_name, msg->msg_namelen, &up))) {
+				break;
+			}
+		} else {
+			if(s->state == SS_DISCONNECTING) {
+				if(s->type == SOCK_SEQPACKET) {
+					send_sig(current, SIGPIPE);
+					errno = -EPIPE;
+				} else {
+					errno = -ECONNREFUSED;
+				}
+				break;
+			}
+			if(!(up = u->peer)) {
+				errno = -ENOTCONN;
+				break;
+			}
+		}
+
+		/* an empty buffer always accepts a datagram */
+		if(u->snd_queued && u->snd_queued + size > u->sndbuf) {
+			wait = &u->snd_queued;
+		} else if(up->rcv_queued && up->rcv_queued + size > up->rcvbuf) {
+			wait = &up->rcv_queued;
+		} else {
+			lock_resource(&up->lock);
+			append_packet_to_queue(p, &up->packet_queue);
+			up->rcv_queued += size;
+			u->snd_queued += size;
+			unlock_resource(&up->lock);
+			wakeup(up);
+			wakeup(&do_select);
+			return size;
+		}
+		if(f->flags & O_NONBLOCK) {
+			errno = -EAGAIN;
+			break;
+		}
+		if(sleep(wait, PROC_INTERRUPTIBLE)) {
+			errno = -EINTR;
+			break;
+		}
+	}
+	release_rights(p);
+	packet_free(p);
+	return errno;
+}
+
+static int dgram_recv(struct socket *s, struct fd *f, struct msghdr *msg, int flags)
+{
+	struct unix_info *u, *us;
+	struct packet *p;
+	char *data;
+	int n, len, left, size;
+
+	u = &s->u.unix_info;
+	for(;;) {
+		lock_resource(&u->lock);
+		if((p = peek_packet(u->packet_queue))) {
+			break;
+		}
+		unlock_resource(&u->lock);
+		if(s->state == SS_DISCONNECTING) {
+			return 0;
+		}
+		if(s->type == SOCK_SEQPACKET && s->state != SS_CONNECTED) {
+			return -ENOTCONN;
+		}
+		if(f->flags & O_NONBLOCK) {
+			return -EAGAIN;
+		}
+		if(sleep(u, PROC_INTERRUPTIBLE)) {
+			return -EINTR;
+		}
+	}
+
+	/* whatever doesn't fit in the user buffers is discarded */
+	data = p->data;
+	left = p->len;
+	for(size = 0, n = 0; n < msg->msg_iovlen && left; n++) {
+		len = MIN(msg->msg_iov[n].iov_len, left);
+		memcpy_b(msg->msg_iov[n].iov_base, data, len);
+		data += len;
+		left -= len;
+		size += len;
+	}
+	msg->msg_flags = left ? MSG_TRUNC : 0;
+	if(flags & MSG_TRUNC) {
+		size = p->len;
+	}
+
+	us = p->socket ? &p->socket->u.unix_info : NULL;
+	if(msg->msg_name) {
+		if(us && us->sun) {
+			memcpy_b(msg->msg_name, us->sun, MIN(msg->msg_namelen, us->sun_len));
+			msg->msg_namelen = us->sun_len;
+		} else {
+			msg->msg_namelen = 0;
+		}
+	}
+
+	if(flags & MSG_PEEK) {
+		scm_recv(s, msg, p, flags);
+		unlock_resource(&u->lock);
+		return size;
+	}
+	remove_packet_from_queue(&u->packet_queue);
+	u->rcv_queued -= p->len;
+	if(us) {
+		us->snd_queued -= p->len;
+	}
+	unlock_resource(&u->lock);
+	if(us) {
+		wakeup(&us->snd_queued);
+	}
+	wakeup(&u->rcv_queued);
+	wakeup(&do_select);
+	scm_recv(s, msg, p, flags);
+	packet_free(p);
+	return size;
+}
+
 int unix_create(struct socket *s)
 {
 	struct unix_info *u;
@@ -82,6 +483,8 @@ int unix_create(struct socket *s)
 	memset_b(u, 0, sizeof(struct unix_info));
 	u->count = 1;
 	u->socket = s;
+	u->sndbuf = UNIX_DEF_SNDBUF;
+	u->rcvbuf = UNIX_DEF_RCVBUF;
 	add_unix_socket(u);
 	return 0;
 }
@@ -91,6 +494,7 @@ void unix_free(struct socket *s)
 	struct unix_info *u;
 
 	u = &s->u.unix_info;
+	purge_packets(s);
 	if(!(--u->count)) {
 		if(u->data) {
 			kfree((unsigned int)u->data);
@@ -164,34 +568,12 @@ int unix_bind(struct socket *s, const struct sockaddr *addr, int addrlen)
 
 int unix_connect(struct socket *sc, const struct sockaddr *addr, int addrlen)
 {
-	struct inode *i;
-	struct sockaddr_un *su;
 	struct unix_info *up;
-	char *tmp_name;
 	int errno;
 
-	su = (struct sockaddr_un *)addr;
-	if(su->sun_family != AF_UNIX) {
-                return -EINVAL;
-	}
-	if(addrlen < 0 || addrlen > sizeof(struct sockaddr_un)) {
-                return -EINVAL;
-	}
-
-	if((errno = malloc_name(su->sun_path, &tmp_name)) < 0) {
+	if((errno = find_unix_socket(addr, addrlen, &up))) {
 		return errno;
 	}
-	if((errno = namei(tmp_name, &i, NULL, FOLLOW_LINKS))) {
-		free_name(tmp_name);
-		return errno;
-	}
-	if(!(up = lookup_unix_socket(tmp_name, i))) {
-		iput(i);
-		free_name(tmp_name);
-		return -ECONNREFUSED;
-	}
-	iput(i);
-	free_name(tmp_name);
 	if((errno = insert_socket_to_queue(up->socket, sc))) {
 		return errno;
 	}
@@ -207,10 +589,12 @@ int unix_accept(struct socket *sc, struct socket *nss)
 	uc = &sc->u.unix_info;
 	us = &nss->u.unix_info;
 
-	if(!(uc->data = (char *)kmalloc(PIPE_BUF))) {
-		return -ENOMEM;
+	if(sc->type == SOCK_STREAM) {
+		if(!(uc->data = (char *)kmalloc(PIPE_BUF))) {
+			return -ENOMEM;
+		}
+		us->data = uc->data;
 	}
-	us->data = uc->data;
 	us->sun = uc->sun;
 	us->sun_len = uc->sun_len;
 	us->peer = uc;
@@ -259,10 +643,13 @@ int unix_socketpair(struct socket *s1, struct socket *s2)
 	u1 = &s1->u.unix_info;
 	u2 = &s2->u.unix_info;
 
-	if(!(u1->data = (char *)kmalloc(PIPE_BUF))) {
-		return -ENOMEM;
+	/* only stream sockets share a buffer, the rest exchange packets */
+	if(s1->type == SOCK_STREAM) {
+		if(!(u1->data = (char *)kmalloc(PIPE_BUF))) {
+			return -ENOMEM;
+		}
+		u2->data = u1->data;
 	}
-	u2->data = u1->data;
 	u1->count++;
 	u2->count++;
 	u1->peer = u2;
@@ -290,102 +677,170 @@ int unix_recv(struct socket *s, struct fd *f, char *buffer, __size_t count, int
 
 int unix_sendto(struct socket *s, struct fd *f, const char *buffer, __size_t count, int flags, const struct sockaddr *addr, int addrlen)
 {
-	struct inode *i;
-	struct unix_info *u;
-	struct sockaddr_un *su;
+	struct msghdr msg;
+	struct iovec iov;
+
+	iov.iov_base = (void *)buffer;
+	iov.iov_len = count;
+	memset_b(&msg, 0, sizeof(struct msghdr));
+	msg.msg_name = (void *)addr;
+	msg.msg_namelen = addrlen;
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	return unix_sendmsg(s, f, &msg, flags);
+}
+
+int unix_recvfrom(struct socket *s, struct fd *f, char *buffer, __size_t count, int flags, struct sockaddr *addr, int *addrlen)
+{
+	struct msghdr msg;
+	struct iovec iov;
+	int errno;
+
+	iov.iov_base = buffer;
+	iov.iov_len = count;
+	memset_b(&msg, 0, sizeof(struct msghdr));
+	msg.msg_name = addr;
+	msg.msg_namelen = sizeof(struct sockaddr_un);
+	msg.msg_iov = &iov;
+	msg.msg_iovlen = 1;
+	if((errno = unix_recvmsg(s, f, &msg, flags)) >= 0) {
+		*addrlen = msg.msg_namelen;
+	}
+	return errno;
+}
+
+/*
+ * The ancillary data of a stream socket travels in an empty packet of its
+ * own, which is picked up by the next recvmsg() that reads any data.
+ */
+static int send_control(struct socket *s, const struct msghdr *msg)
+{
+	struct unix_info *up;
 	struct packet *p;
-	char *tmp_name;
 	int errno;
 
-	su = (struct sockaddr_un *)addr;
-	if(su->sun_family != AF_UNIX) {
-                return -EINVAL;
+	if(s->state != SS_CONNECTED) {
+		if(s->state == SS_DISCONNECTING) {
+			send_sig(current, SIGPIPE);
+			return -EPIPE;
+		}
+		return -ENOTCONN;
 	}
-	if(addrlen < 0 || addrlen > sizeof(struct sockaddr_un)) {
-                return -EINVAL;
+	up = s->u.unix_info.peer;
+	if(!(p = packet_alloc(0))) {
+		return -ENOMEM;
 	}
-
-	if((errno = malloc_name(su->sun_path, &tmp_name)) < 0) {
+	if((errno = scm_send(msg, p))) {
+		release_rights(p);
+		packet_free(p);
 		return errno;
 	}
-	if((errno = namei(tmp_name, &i, NULL, FOLLOW_LINKS))) {
-		free_name(tmp_name);
-		return errno;
+	lock_resource(&up->lock);
+	append_packet_to_queue(p, &up->packet_queue);
+	unlock_resource(&up->lock);
+	return 0;
+}
+
+int unix_sendmsg(struct socket *s, struct fd *f, const struct msghdr *msg, int flags)
+{
+	int n, errno, bytes_written;
+
+	if(flags & ~MSG_DONTWAIT) {
+		return -EINVAL;
 	}
-	if(!(u = lookup_unix_socket(tmp_name, i))) {
-		iput(i);
-		free_name(tmp_name);
-		return -ECONNREFUSED;
+	if(s->type == SOCK_DGRAM) {
+		return dgram_send(s, f, msg);
 	}
-	iput(i);
-	free_name(tmp_name);
-
-	if(!(p = (struct packet *)kmalloc(sizeof(struct packet)))) {
-		return -ENOMEM;
+	if(msg->msg_name) {
+		return s->state == SS_CONNECTED ? -EISCONN : -EOPNOTSUPP;
 	}
-	memset_b(p, 0, sizeof(struct packet));
-	if(!(p->data = (char *)kmalloc(count + 1))) {
-		kfree((unsigned int)p);
-		return -ENOMEM;
+	if(s->type == SOCK_SEQPACKET) {
+		if(s->state != SS_CONNECTED && s->state != SS_DISCONNECTING) {
+			return -ENOTCONN;
+		}
+		return dgram_send(s, f, msg);
 	}
-	memset_b(p->data, 0, count + 1);
-	memcpy_b(p->data, buffer, count);
-	p->len = count;
-	p->socket = s;
-	lock_resource(&packet_resource);
-	append_packet_to_queue(p, &u->packet_queue);
-	unlock_resource(&packet_resource);
-	wakeup(u);
-	return count;
+	if(msg->msg_control && msg->msg_controllen) {
+		if((errno = send_control(s, msg))) {
+			return errno;
+		}
+	}
+
+	bytes_written = 0;
+	for(n = 0; n < msg->msg_iovlen; n++) {
+		if((errno = unix_write(s, f, msg->msg_iov[n].iov_base, msg->msg_iov[n].iov_len)) < 0) {
+			return bytes_written ? bytes_written : errno;
+		}
+		bytes_written += errno;
+	}
+	return bytes_written;
 }
 
-int unix_recvfrom(struct socket *s, struct fd *f, char *buffer, __size_t count, int flags, struct sockaddr *addr, int *addrlen)
+int unix_recvmsg(struct socket *s, struct fd *f, struct msghdr *msg, int flags)
 {
-	struct unix_info *u, *up;
-	struct sockaddr_un *sun;
+	struct unix_info *u;
 	struct packet *p;
-	int size;
+	int n, errno, bytes_read;
 
-	u = &s->u.unix_info;
+	if(s->type != SOCK_STREAM) {
+		if(flags & ~(MSG_PEEK | MSG_TRUNC | MSG_DONTWAIT)) {
+			return -EINVAL;
+		}
+		return dgram_recv(s, f, msg, flags);
+	}
+	if(flags & ~MSG_DONTWAIT) {
+		return -EINVAL;
+	}
 
-	lock_resource(&packet_resource);
-	while(!(p = peek_packet(u->packet_queue))) {
-		unlock_resource(&packet_resource);
-		if(!(f->flags & O_NONBLOCK)) {
-			if(sleep(u, PROC_INTERRUPTIBLE)) {
-				return -EINTR;
-			}
-			lock_resource(&packet_resource);
-		} else {
-			unlock_resource(&packet_resource);
-			return -EAGAIN;
+	msg->msg_namelen = 0;
+	msg->msg_flags = 0;
+	bytes_read = 0;
+	for(n = 0; n < msg->msg_iovlen; n++) {
+		if((errno = unix_read(s, f, msg->msg_iov[n].iov_base, msg->msg_iov[n].iov_len)) < 0) {
+			return bytes_read ? bytes_read : errno;
+		}
+		bytes_read += errno;
+
+		/* don't wait for more data to fill the rest of the buffers */
+		if(errno < msg->msg_iov[n].iov_len) {
+			break;
 		}
 	}
 
-	size = MIN(p->len - p->offset, count);
-	memcpy_b(buffer, p->data + p->offset, size);
-	p->offset += size;
-	if(!(flags & MSG_PEEK)) {
+	/* pick up the ancillary data sent along with the stream, if any */
+	u = &s->u.unix_info;
+	p = NULL;
+	if(bytes_read) {
+		lock_resource(&u->lock);
 		p = remove_packet_from_queue(&u->packet_queue);
-		kfree((unsigned int)p->data);
-		kfree((unsigned int)p);
+		unlock_resource(&u->lock);
 	}
-	unlock_resource(&packet_resource);
-
-	up = &p->socket->u.unix_info;
-	sun = (struct sockaddr_un *)addr;
-	sun->sun_family = AF_UNIX;
-	memcpy_b(sun->sun_path, up->sun->sun_path, up->sun_len);
-	*addrlen = up->sun_len;
-	return size;
+	if(p) {
+		scm_recv(s, msg, p, flags);
+		packet_free(p);
+	} else {
+		msg->msg_controllen = 0;
+	}
+	return bytes_read;
 }
 
 int unix_read(struct socket *s, struct fd *f, char *buffer, __size_t count)
 {
 	struct unix_info *u;
+	struct msghdr msg;
+	struct iovec iov;
 	int bytes_read;
 	int n, limit;
 
+	if(s->type != SOCK_STREAM) {
+		iov.iov_base = buffer;
+		iov.iov_len = count;
+		memset_b(&msg, 0, sizeof(struct msghdr));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		return dgram_recv(s, f, &msg, 0);
+	}
+
 	u = &s->u.unix_info;
 	bytes_read = 0;
 
@@ -444,9 +899,20 @@ int unix_read(struct socket *s, struct fd *f, char *buffer, __size_t count)
 int unix_write(struct socket *s, struct fd *f, const char *buffer, __size_t count)
 {
 	struct unix_info *u, *up;
+	struct msghdr msg;
+	struct iovec iov;
 	int bytes_written;
 	int n, limit;
 
+	if(s->type != SOCK_STREAM) {
+		iov.iov_base = (void *)buffer;
+		iov.iov_len = count;
+		memset_b(&msg, 0, sizeof(struct msghdr));
+		msg.msg_iov = &iov;
+		msg.msg_iovlen = 1;
+		return dgram_send(s, f, &msg);
+	}
+
 	u = &s->u.unix_info;
 	up = s->u.unix_info.peer;
 	bytes_written = 0;
@@ -510,6 +976,25 @@ int unix_select(struct socket *s, int flag)
 	u = &s->u.unix_info;
 	up = s->u.unix_info.peer;
 
+	if(s->type != SOCK_STREAM) {
+		switch(flag) {
+			case SEL_R:
+				if(u->packet_queue || s->state == SS_DISCONNECTING) {
+					return 1;
+				}
+				break;
+			case SEL_W:
+				if(s->state == SS_DISCONNECTING) {
+					return 1;
+				}
+				if(u->snd_queued < u->sndbuf && (!up || up->rcv_queued < up->rcvbuf)) {
+					return 1;
+				}
+				break;
+		}
+		return 0;
+	}
+
 	switch(flag) {
 		case SEL_R:
 			if(u->size) {
@@ -540,12 +1025,73 @@ int unix_shutdown(struct socket *s, int how)
 
 int unix_setsockopt(struct socket *s, int level, int optname, const void *optval, socklen_t optlen)
 {
-	return -EOPNOTSUPP;
+	struct unix_info *u;
+	int val, errno;
+
+	u = &s->u.unix_info;
+	if(level != SOL_SOCKET) {
+		return -ENOPROTOOPT;
+	}
+	if(optlen < sizeof(int)) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_READ, optval, sizeof(int)))) {
+		return errno;
+	}
+	val = *(int *)optval;
+
+	switch(optname) {
+		case SO_SNDBUF:
+			u->sndbuf = MIN(MAX(val, UNIX_MIN_BUF), UNIX_MAX_BUF);
+			wakeup(&u->snd_queued);
+			break;
+		case SO_RCVBUF:
+			u->rcvbuf = MIN(MAX(val, UNIX_MIN_BUF), UNIX_MAX_BUF);
+			wakeup(&u->rcv_queued);
+			break;
+		case SO_PASSCRED:
+			u->passcred = val ? 1 : 0;
+			break;
+		default:
+			return -ENOPROTOOPT;
+	}
+	return 0;
 }
 
 int unix_getsockopt(struct socket *s, int level, int optname, void *optval, socklen_t *optlen)
 {
-	return -EOPNOTSUPP;
+	struct unix_info *u;
+	int errno;
+
+	u = &s->u.unix_info;
+	if(level != SOL_SOCKET) {
+		return -ENOPROTOOPT;
+	}
+	if((errno = check_user_area(VERIFY_WRITE, optlen, sizeof(socklen_t)))) {
+		return errno;
+	}
+	if(*optlen < sizeof(int)) {
+		return -EINVAL;
+	}
+	if((errno = check_user_area(VERIFY_WRITE, optval, sizeof(int)))) {
+		return errno;
+	}
+
+	switch(optname) {
+		case SO_SNDBUF:
+			*(int *)optval = u->sndbuf;
+			break;
+		case SO_RCVBUF:
+			*(int *)optval = u->rcvbuf;
+			break;
+		case SO_PASSCRED:
+			*(int *)optval = u->passcred;
+			break;
+		default:
+			return -ENOPROTOOPT;
+	}
+	*optlen = sizeof(int);
+	return 0;
 }
 
 int unix_init(void)